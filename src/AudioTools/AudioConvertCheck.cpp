@@ -0,0 +1,389 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// AudioConvertCheck - exactness and speed of the sample conversions, gains and peak detection, not part of the build
+//
+//   build it as a console program with the AudioTools and DSUtil libraries
+//
+//   AudioConvertCheck           run every conversion, gain and peak function once with g_cpuid's SSE2 flag
+//                               cleared, which gives the SAMPLE_* macros and C loops, and once with it set
+//   AudioConvertCheck --bench   also time both on 7.1 audio
+//
+// The outputs have to be bit identical, exits with 1 when one isn't. The input covers every sample
+// format, odd sample counts for the tails, full scale, values past full scale and half steps of the
+// output format. NaN isn't in it, converting it to an integer was undefined before.
+//
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "AudioHelper.h"
+#include "../DSUtil/AudioTools.h"
+#include "../DSUtil/vd.h"
+
+static const struct {
+	SampleFormat	sfmt;
+	const char*		name;
+} s_formats[] = {
+	{SAMPLE_FMT_U8,		"u8"},
+	{SAMPLE_FMT_S16,	"s16"},
+	{SAMPLE_FMT_S24,	"s24"},
+	{SAMPLE_FMT_S32,	"s32"},
+	{SAMPLE_FMT_FLT,	"flt"},
+	{SAMPLE_FMT_DBL,	"dbl"},
+	{SAMPLE_FMT_U8P,	"u8p"},
+	{SAMPLE_FMT_S16P,	"s16p"},
+	{SAMPLE_FMT_S32P,	"s32p"},
+	{SAMPLE_FMT_FLTP,	"fltp"},
+	{SAMPLE_FMT_DBLP,	"dblp"},
+};
+
+typedef HRESULT (*convert_t)(const SampleFormat sfmt, const WORD nChannels, const DWORD nSamples, BYTE* pIn, BYTE* pOut);
+
+static HRESULT to_int16(const SampleFormat sfmt, const WORD nChannels, const DWORD nSamples, BYTE* pIn, BYTE* pOut)		{ return convert_to_int16(sfmt, nChannels, nSamples, pIn, (int16_t*)pOut); }
+static HRESULT to_int24(const SampleFormat sfmt, const WORD nChannels, const DWORD nSamples, BYTE* pIn, BYTE* pOut)		{ return convert_to_int24(sfmt, nChannels, nSamples, pIn, pOut); }
+static HRESULT to_int32(const SampleFormat sfmt, const WORD nChannels, const DWORD nSamples, BYTE* pIn, BYTE* pOut)		{ return convert_to_int32(sfmt, nChannels, nSamples, pIn, (int32_t*)pOut); }
+static HRESULT to_float(const SampleFormat sfmt, const WORD nChannels, const DWORD nSamples, BYTE* pIn, BYTE* pOut)		{ return convert_to_float(sfmt, nChannels, nSamples, pIn, (float*)pOut); }
+static HRESULT to_planar_float(const SampleFormat sfmt, const WORD nChannels, const DWORD nSamples, BYTE* pIn, BYTE* pOut)	{ return convert_to_planar_float(sfmt, nChannels, nSamples, pIn, (float*)pOut); }
+
+static const struct {
+	convert_t	convert;
+	const char*	name;
+} s_converts[] = {
+	{to_int16,			"convert_to_int16"},
+	{to_int24,			"convert_to_int24"},
+	{to_int32,			"convert_to_int32"},
+	{to_float,			"convert_to_float"},
+	{to_planar_float,	"convert_to_planar_float"},
+};
+
+static unsigned s_rnd = 1;
+
+static unsigned Rand()
+{
+	s_rnd = s_rnd * 1103515245u + 12345u;
+	return s_rnd >> 8;
+}
+
+static float TestFloat()
+{
+	switch (Rand() % 12) {
+		case 0:
+			return 1.0f;
+		case 1:
+			return -1.0f;
+		case 2:
+			return F16MAX;
+		case 3:
+			return (float)D32MAX;
+		case 4:
+			return (Rand() & 1) ? 1.0000001f : -1.0000001f;
+		case 5:
+			return ((int)(Rand() % 65536) - 32768 + 0.5f) / INT16_PEAK; // half a 16-bit step
+		case 6:
+			return (float)(((int)(Rand() % 16777216) - 8388608 + 0.5) / INT24_PEAK);
+		case 7:
+			return (Rand() & 1) ? 0.0f : -0.0f;
+		case 8:
+			return (Rand() & 1) ? 1e-30f : -1e-30f;
+		default:
+			return (float)((int)(Rand() % 2000001) - 1000000) / 800000.0f; // -1.25 .. 1.25
+	}
+}
+
+static void FillSamples(SampleFormat sfmt, BYTE* p, size_t allsamples)
+{
+	for (size_t i = 0; i < allsamples; i++) {
+		switch (sfmt) {
+			case SAMPLE_FMT_U8:
+			case SAMPLE_FMT_U8P:
+				p[i] = (BYTE)Rand();
+				break;
+			case SAMPLE_FMT_S16:
+			case SAMPLE_FMT_S16P:
+				((int16_t*)p)[i] = (i % 7 == 0) ? (i & 8 ? INT16_MIN : INT16_MAX) : (int16_t)Rand();
+				break;
+			case SAMPLE_FMT_S24:
+				p[i * 3 + 0] = (BYTE)Rand();
+				p[i * 3 + 1] = (BYTE)Rand();
+				p[i * 3 + 2] = (BYTE)Rand();
+				break;
+			case SAMPLE_FMT_S32:
+			case SAMPLE_FMT_S32P:
+				((int32_t*)p)[i] = (i % 7 == 0) ? (i & 8 ? INT32_MIN : INT32_MAX) : (int32_t)(Rand() << 8 ^ Rand());
+				break;
+			case SAMPLE_FMT_FLT:
+			case SAMPLE_FMT_FLTP:
+				((float*)p)[i] = TestFloat();
+				break;
+			case SAMPLE_FMT_DBL:
+			case SAMPLE_FMT_DBLP:
+				((double*)p)[i] = (double)TestFloat() + ((int)(Rand() % 3) - 1) * 1e-12;
+				break;
+		}
+	}
+}
+
+static CCpuID::flag_t s_flags;
+
+static void SetSSE2(bool bSSE2)
+{
+	g_cpuid.m_flags = bSSE2 ? s_flags : (CCpuID::flag_t)(s_flags & ~CCpuID::sse2);
+}
+
+static const WORD s_channels[] = {1, 2, 6, 8};
+static const DWORD s_samples[] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 1001};
+
+static int CheckConversions()
+{
+	int failed = 0;
+
+	for (size_t c = 0; c < _countof(s_converts) + 1; c++) {
+		for (size_t f = 0; f < _countof(s_formats); f++) {
+			// the last round is convert_float_to(), it takes float and converts to the format
+			const bool bFrom = c == _countof(s_converts);
+			const SampleFormat sfmt = s_formats[f].sfmt;
+			HRESULT hr = S_OK;
+			bool bSame = true;
+
+			for (size_t ch = 0; ch < _countof(s_channels) && bSame; ch++) {
+				for (size_t n = 0; n < _countof(s_samples) && bSame; n++) {
+					size_t allsamples = s_channels[ch] * s_samples[n];
+					std::vector<BYTE> in(allsamples * 8), in2, out1(allsamples * 8 + 16, 0xcd), out2(out1);
+					FillSamples(bFrom ? SAMPLE_FMT_FLT : sfmt, &in[0], allsamples);
+					in2 = in;
+
+					HRESULT hr1, hr2;
+					SetSSE2(false);
+					if (bFrom) {
+						hr1 = convert_float_to(sfmt, s_channels[ch], s_samples[n], (float*)&in[0], &out1[0]);
+					} else {
+						hr1 = s_converts[c].convert(sfmt, s_channels[ch], s_samples[n], &in[0], &out1[0]);
+					}
+					SetSSE2(true);
+					if (bFrom) {
+						hr2 = convert_float_to(sfmt, s_channels[ch], s_samples[n], (float*)&in2[0], &out2[0]);
+					} else {
+						hr2 = s_converts[c].convert(sfmt, s_channels[ch], s_samples[n], &in2[0], &out2[0]);
+					}
+
+					hr = hr1;
+					if (hr1 != hr2 || out1 != out2) {
+						printf("%-24s %-5s FAILED: %u channel(s), %u samples\n", bFrom ? "convert_float_to" : s_converts[c].name, s_formats[f].name,
+							   s_channels[ch], s_samples[n]);
+						bSame = false;
+						failed++;
+					}
+				}
+			}
+
+			if (bSame && SUCCEEDED(hr)) {
+				printf("%-24s %-5s identical\n", bFrom ? "convert_float_to" : s_converts[c].name, s_formats[f].name);
+			}
+		}
+	}
+
+	return failed;
+}
+
+template<typename T>
+static bool CheckGain(void (*gain)(const double factor, const size_t allsamples, T* pData), SampleFormat sfmt, int bytes, const char* name)
+{
+	static const double factors[] = {0.25, 0.7071, 1.0, 1.5, 4.0};
+
+	for (size_t i = 0; i < _countof(factors); i++) {
+		for (size_t n = 0; n < _countof(s_samples); n++) {
+			size_t allsamples = 8 * s_samples[n];
+			std::vector<BYTE> d1(allsamples * bytes), d2;
+			FillSamples(sfmt, &d1[0], allsamples);
+			d2 = d1;
+
+			SetSSE2(false);
+			gain(factors[i], allsamples, (T*)&d1[0]);
+			SetSSE2(true);
+			gain(factors[i], allsamples, (T*)&d2[0]);
+
+			if (d1 != d2) {
+				printf("%-24s FAILED: factor %.4f, %u samples\n", name, factors[i], (unsigned)allsamples);
+				return false;
+			}
+		}
+	}
+
+	printf("%-24s identical\n", name);
+	return true;
+}
+
+template<typename T>
+static bool CheckPeak(double (*peak)(T* pData, const size_t allsamples), SampleFormat sfmt, int bytes, const char* name)
+{
+	for (size_t n = 0; n < _countof(s_samples); n++) {
+		size_t allsamples = 8 * s_samples[n];
+		std::vector<BYTE> d(allsamples * bytes);
+		FillSamples(sfmt, &d[0], allsamples);
+
+		SetSSE2(false);
+		double p1 = peak((T*)&d[0], allsamples);
+		SetSSE2(true);
+		double p2 = peak((T*)&d[0], allsamples);
+
+		if (memcmp(&p1, &p2, sizeof(double))) {
+			printf("%-24s FAILED: %u samples, %.17g != %.17g\n", name, (unsigned)allsamples, p1, p2);
+			return false;
+		}
+	}
+
+	printf("%-24s identical\n", name);
+	return true;
+}
+
+static int CheckGainsAndPeaks()
+{
+	int failed = 0;
+
+	failed += !CheckGain(gain_uint8, SAMPLE_FMT_U8, 1, "gain_uint8");
+	failed += !CheckGain(gain_int16, SAMPLE_FMT_S16, 2, "gain_int16");
+	failed += !CheckGain(gain_int24, SAMPLE_FMT_S24, 3, "gain_int24");
+	failed += !CheckGain(gain_int32, SAMPLE_FMT_S32, 4, "gain_int32");
+	failed += !CheckGain(gain_float, SAMPLE_FMT_FLT, 4, "gain_float");
+	failed += !CheckGain(gain_double, SAMPLE_FMT_DBL, 8, "gain_double");
+
+	failed += !CheckPeak(get_max_peak_uint8, SAMPLE_FMT_U8, 1, "get_max_peak_uint8");
+	failed += !CheckPeak(get_max_peak_int16, SAMPLE_FMT_S16, 2, "get_max_peak_int16");
+	failed += !CheckPeak(get_max_peak_int24, SAMPLE_FMT_S24, 3, "get_max_peak_int24");
+	failed += !CheckPeak(get_max_peak_int32, SAMPLE_FMT_S32, 4, "get_max_peak_int32");
+	failed += !CheckPeak(get_max_peak_float, SAMPLE_FMT_FLT, 4, "get_max_peak_float");
+	failed += !CheckPeak(get_max_peak_double, SAMPLE_FMT_DBL, 8, "get_max_peak_double");
+
+	return failed;
+}
+
+static double Now()
+{
+	LARGE_INTEGER freq, t;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart / freq.QuadPart;
+}
+
+// 7.1 at 48 kHz in buffers of 1024 samples, the FLTP case is stereo like the FFmpeg decoders deliver it
+static void Bench()
+{
+	const DWORD nSamples = 1024;
+	const int runs = 2000;
+
+	static const struct {
+		const char*		name;
+		SampleFormat	in;
+		SampleFormat	out;	// SAMPLE_FMT_NONE for convert_float_to()
+		convert_t		convert;
+		WORD			nChannels;
+	} paths[] = {
+		{"flt -> s16",		SAMPLE_FMT_FLT,		SAMPLE_FMT_S16,	NULL,		8},
+		{"flt -> s24",		SAMPLE_FMT_FLT,		SAMPLE_FMT_S24,	NULL,		8},
+		{"flt -> s32",		SAMPLE_FMT_FLT,		SAMPLE_FMT_S32,	NULL,		8},
+		{"s16 -> flt",		SAMPLE_FMT_S16,		SAMPLE_FMT_FLT,	to_float,	8},
+		{"s32 -> flt",		SAMPLE_FMT_S32,		SAMPLE_FMT_FLT,	to_float,	8},
+		{"fltp -> s16",		SAMPLE_FMT_FLTP,	SAMPLE_FMT_S16,	to_int16,	2},
+		{"fltp -> s32",		SAMPLE_FMT_FLTP,	SAMPLE_FMT_S32,	to_int32,	2},
+		{"fltp -> flt",		SAMPLE_FMT_FLTP,	SAMPLE_FMT_FLT,	to_float,	2},
+	};
+
+	std::vector<BYTE> in(8 * nSamples * 8), out(8 * nSamples * 8);
+
+	printf("\n%-24s %12s %12s %8s\n", "Msamples/s", "C", "SSE2", "speedup");
+	for (size_t i = 0; i < _countof(paths); i++) {
+		FillSamples(paths[i].in, &in[0], paths[i].nChannels * nSamples);
+		double rate[2];
+		for (int sse2 = 0; sse2 < 2; sse2++) {
+			SetSSE2(!!sse2);
+			double start = Now();
+			for (int r = 0; r < runs; r++) {
+				if (paths[i].convert) {
+					paths[i].convert(paths[i].in, paths[i].nChannels, nSamples, &in[0], &out[0]);
+				} else {
+					convert_float_to(paths[i].out, paths[i].nChannels, nSamples, (float*)&in[0], &out[0]);
+				}
+			}
+			rate[sse2] = (double)paths[i].nChannels * nSamples * runs / (Now() - start) / 1e6;
+		}
+		printf("%-24s %12.1f %12.1f %7.1fx\n", paths[i].name, rate[0], rate[1], rate[1] / rate[0]);
+	}
+
+	static const struct {
+		const char*		name;
+		SampleFormat	sfmt;
+		int				kind;	// 0 gain, 1 peak
+	} loops[] = {
+		{"gain_int16",			SAMPLE_FMT_S16,	0},
+		{"gain_int32",			SAMPLE_FMT_S32,	0},
+		{"gain_float",			SAMPLE_FMT_FLT,	0},
+		{"get_max_peak_int16",	SAMPLE_FMT_S16,	1},
+		{"get_max_peak_float",	SAMPLE_FMT_FLT,	1},
+	};
+
+	const size_t allsamples = 8 * nSamples;
+	for (size_t i = 0; i < _countof(loops); i++) {
+		FillSamples(loops[i].sfmt, &in[0], allsamples);
+		double rate[2];
+		for (int sse2 = 0; sse2 < 2; sse2++) {
+			SetSSE2(!!sse2);
+			double start = Now();
+			for (int r = 0; r < runs; r++) {
+				// a gain of 1 keeps the data the same from run to run
+				switch (loops[i].sfmt) {
+					case SAMPLE_FMT_S16:
+						loops[i].kind ? (void)get_max_peak_int16((int16_t*)&in[0], allsamples) : gain_int16(1.0, allsamples, (int16_t*)&in[0]);
+						break;
+					case SAMPLE_FMT_S32:
+						gain_int32(1.0, allsamples, (int32_t*)&in[0]);
+						break;
+					case SAMPLE_FMT_FLT:
+						loops[i].kind ? (void)get_max_peak_float((float*)&in[0], allsamples) : gain_float(1.0, allsamples, (float*)&in[0]);
+						break;
+				}
+			}
+			rate[sse2] = (double)allsamples * runs / (Now() - start) / 1e6;
+		}
+		printf("%-24s %12.1f %12.1f %7.1fx\n", loops[i].name, rate[0], rate[1], rate[1] / rate[0]);
+	}
+
+	SetSSE2(true);
+}
+
+int main(int argc, char* argv[])
+{
+	s_flags = g_cpuid.m_flags;
+	if (!(s_flags & CCpuID::sse2)) {
+		printf("no SSE2, nothing to compare\n");
+		return 0;
+	}
+
+	int failed = CheckConversions() + CheckGainsAndPeaks();
+
+	if (argc > 1 && !strcmp(argv[1], "--bench")) {
+		Bench();
+	}
+
+	return failed ? 1 : 0;
+}
@@ -22,9 +22,177 @@
 #include "stdafx.h"
 #include <MMReg.h>
 #include "AudioHelper.h"
+#include "../DSUtil/vd.h"
+#include "../DSUtil/simd_common.h"
 
 #define limit(a, x, b) if (x < a) { x = a; } else if (x > b) { x = b; }
 
+// SSE2 versions of the SAMPLE_* conversions, bit exact with the macros.
+// The functions fall back to the macros on CPUs without SSE2 and for the last samples.
+
+static __forceinline __m128i float_to_int16_sse2(const __m128 x)
+{
+	__m128 y = _mm_mul_ps(x, _mm_set1_ps((float)INT16_PEAK));
+	y = _mm_max_ps(_mm_min_ps(y, _mm_set1_ps((float)INT16_MAX)), _mm_set1_ps((float)INT16_MIN));
+	// round half away from zero like round_f()
+	y = _mm_add_ps(y, _mm_or_ps(_mm_and_ps(y, _mm_set1_ps(-0.0f)), _mm_set1_ps(0.5f)));
+	return _mm_cvttps_epi32(y);
+}
+
+static __forceinline __m128d double_to_int32_round_sse2(__m128d d)
+{
+	d = _mm_max_pd(_mm_min_pd(d, _mm_set1_pd((double)INT32_MAX)), _mm_set1_pd((double)INT32_MIN));
+	// round half away from zero like round_d()
+	return _mm_add_pd(d, _mm_or_pd(_mm_and_pd(d, _mm_set1_pd(-0.0)), _mm_set1_pd(0.5)));
+}
+
+static __forceinline __m128i float_to_int32_sse2(const __m128 x)
+{
+	const __m128d peak = _mm_set1_pd((double)INT32_PEAK);
+	__m128d lo = double_to_int32_round_sse2(_mm_mul_pd(_mm_cvtps_pd(x), peak));
+	__m128d hi = double_to_int32_round_sse2(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)), peak));
+	return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+static void convert_float_to_int16_sse2(int16_t* pOut, const float* pIn, const size_t allsamples)
+{
+	size_t i = 0;
+	if (g_cpuid.m_flags & CCpuID::sse2) {
+		for (; i + 8 <= allsamples; i += 8) {
+			__m128i lo = float_to_int16_sse2(_mm_loadu_ps(pIn + i));
+			__m128i hi = float_to_int16_sse2(_mm_loadu_ps(pIn + i + 4));
+			_mm_storeu_si128((__m128i*)(pOut + i), _mm_packs_epi32(lo, hi));
+		}
+	}
+	for (; i < allsamples; i++) {
+		pOut[i] = SAMPLE_float_to_int16(pIn[i]);
+	}
+}
+
+static void convert_float_to_int32_sse2(int32_t* pOut, const float* pIn, const size_t allsamples)
+{
+	size_t i = 0;
+	if (g_cpuid.m_flags & CCpuID::sse2) {
+		for (; i + 4 <= allsamples; i += 4) {
+			_mm_storeu_si128((__m128i*)(pOut + i), float_to_int32_sse2(_mm_loadu_ps(pIn + i)));
+		}
+	}
+	for (; i < allsamples; i++) {
+		pOut[i] = SAMPLE_float_to_int32(pIn[i]);
+	}
+}
+
+static void convert_float_to_int24_sse2(BYTE* pOut, const float* pIn, const size_t allsamples)
+{
+	size_t i = 0;
+	if (g_cpuid.m_flags & CCpuID::sse2) {
+		__align16(uint32_t, u32[4]);
+		for (; i + 4 <= allsamples; i += 4) {
+			_mm_store_si128((__m128i*)u32, float_to_int32_sse2(_mm_loadu_ps(pIn + i)));
+			for (int k = 0; k < 4; k++) {
+				*pOut++ = (BYTE)(u32[k] >> 8);
+				*pOut++ = (BYTE)(u32[k] >> 16);
+				*pOut++ = (BYTE)(u32[k] >> 24);
+			}
+		}
+	}
+	for (; i < allsamples; i++) {
+		double d = (double)pIn[i];
+		limit(-1, d, D32MAX);
+		uint32_t u32 = (uint32_t)(int32_t)round_d(d * INT32_PEAK);
+		*pOut++ = (BYTE)(u32 >> 8);
+		*pOut++ = (BYTE)(u32 >> 16);
+		*pOut++ = (BYTE)(u32 >> 24);
+	}
+}
+
+static void convert_int16_to_float_sse2(float* pOut, const int16_t* pIn, const size_t allsamples)
+{
+	size_t i = 0;
+	if (g_cpuid.m_flags & CCpuID::sse2) {
+		const __m128 scale = _mm_set1_ps(1.0f / INT16_PEAK);
+		for (; i + 8 <= allsamples; i += 8) {
+			__m128i v = _mm_loadu_si128((__m128i*)(pIn + i));
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			_mm_storeu_ps(pOut + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(pOut + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+	}
+	for (; i < allsamples; i++) {
+		pOut[i] = SAMPLE_int16_to_float(pIn[i]);
+	}
+}
+
+static void convert_int32_to_float_sse2(float* pOut, const int32_t* pIn, const size_t allsamples)
+{
+	size_t i = 0;
+	if (g_cpuid.m_flags & CCpuID::sse2) {
+		// int -> float rounds once, the scale is a power of two, same result as the double division of the macro
+		const __m128 scale = _mm_set1_ps(1.0f / INT32_PEAK);
+		for (; i + 4 <= allsamples; i += 4) {
+			__m128i v = _mm_loadu_si128((__m128i*)(pIn + i));
+			_mm_storeu_ps(pOut + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+		}
+	}
+	for (; i < allsamples; i++) {
+		pOut[i] = SAMPLE_int32_to_float(pIn[i]);
+	}
+}
+
+// planar stereo to interleaved, the common output of the FFmpeg decoders
+
+static bool convert_fltp_stereo_sse2(const SampleFormat out_sfmt, const DWORD nSamples, const float* pL, const float* pR, BYTE* pOut)
+{
+	if (!(g_cpuid.m_flags & CCpuID::sse2)) {
+		return false;
+	}
+
+	size_t i = 0;
+	const size_t n4 = nSamples & ~3;
+	switch (out_sfmt) {
+		case SAMPLE_FMT_S16:
+			for (int16_t* p = (int16_t*)pOut; i < n4; i += 4, p += 8) {
+				__m128i l = float_to_int16_sse2(_mm_loadu_ps(pL + i));
+				__m128i r = float_to_int16_sse2(_mm_loadu_ps(pR + i));
+				_mm_storeu_si128((__m128i*)p, _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r)));
+			}
+			for (int16_t* p = (int16_t*)pOut + i * 2; i < nSamples; i++) {
+				*p++ = SAMPLE_float_to_int16(pL[i]);
+				*p++ = SAMPLE_float_to_int16(pR[i]);
+			}
+			break;
+		case SAMPLE_FMT_S32:
+			for (int32_t* p = (int32_t*)pOut; i < n4; i += 4, p += 8) {
+				__m128i l = float_to_int32_sse2(_mm_loadu_ps(pL + i));
+				__m128i r = float_to_int32_sse2(_mm_loadu_ps(pR + i));
+				_mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi32(l, r));
+				_mm_storeu_si128((__m128i*)(p + 4), _mm_unpackhi_epi32(l, r));
+			}
+			for (int32_t* p = (int32_t*)pOut + i * 2; i < nSamples; i++) {
+				*p++ = SAMPLE_float_to_int32(pL[i]);
+				*p++ = SAMPLE_float_to_int32(pR[i]);
+			}
+			break;
+		case SAMPLE_FMT_FLT:
+			for (float* p = (float*)pOut; i < n4; i += 4, p += 8) {
+				__m128 l = _mm_loadu_ps(pL + i);
+				__m128 r = _mm_loadu_ps(pR + i);
+				_mm_storeu_ps(p, _mm_unpacklo_ps(l, r));
+				_mm_storeu_ps(p + 4, _mm_unpackhi_ps(l, r));
+			}
+			for (float* p = (float*)pOut + i * 2; i < nSamples; i++) {
+				*p++ = pL[i];
+				*p++ = pR[i];
+			}
+			break;
+		default:
+			return false;
+	}
+
+	return true;
+}
+
 SampleFormat GetSampleFormat(const WAVEFORMATEX* wfe)
 {
 	SampleFormat sample_format = SAMPLE_FMT_NONE;
@@ -82,7 +250,7 @@ HRESULT convert_to_int16(const SampleFormat sfmt, const WORD nChannels, const DW
 			convert_int32_to_int16(pOut, (int32_t*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_FLT:
-			convert_float_to_int16(pOut, (float*)pIn, allsamples);
+			convert_float_to_int16_sse2(pOut, (float*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_DBL:
 			convert_double_to_int16(pOut, (double*)pIn, allsamples);
@@ -113,6 +281,9 @@ HRESULT convert_to_int16(const SampleFormat sfmt, const WORD nChannels, const DW
 			}
 			break;
 		case SAMPLE_FMT_FLTP:
+			if (nChannels == 2 && convert_fltp_stereo_sse2(SAMPLE_FMT_S16, nSamples, (float*)pIn, (float*)pIn + nSamples, (BYTE*)pOut)) {
+				break;
+			}
 			for (size_t i = 0; i < nSamples; ++i) {
 				float* p = (float*)pIn + i;
 				for (int ch = 0; ch < nChannels; ++ch) {
@@ -165,15 +336,7 @@ HRESULT convert_to_int24(const SampleFormat sfmt, const WORD nChannels, const DW
 			}
 			break;
 		case SAMPLE_FMT_FLT:
-			for (size_t i = 0; i < allsamples; ++i) {
-				double d = (double)(*(float*)pIn);
-				limit(-1, d, D32MAX);
-				uint32_t u32 = (uint32_t)(int32_t)round_d(d * INT32_PEAK);
-				*pOut++ = (BYTE)(u32 >> 8);
-				*pOut++ = (BYTE)(u32 >> 16);
-				*pOut++ = (BYTE)(u32 >> 24);
-				pIn += sizeof(float);
-			}
+			convert_float_to_int24_sse2(pOut, (float*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_DBL:
 			for (size_t i = 0; i < allsamples; ++i) {
@@ -268,7 +431,7 @@ HRESULT convert_to_int32(const SampleFormat sfmt, const WORD nChannels, const DW
 			memcpy(pOut, pIn, nSamples * nChannels * sizeof(int32_t));
 			break;
 		case SAMPLE_FMT_FLT:
-			convert_float_to_int32(pOut, (float*)pIn, allsamples);
+			convert_float_to_int32_sse2(pOut, (float*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_DBL:
 			convert_double_to_int32(pOut, (double*)pIn, allsamples);
@@ -299,6 +462,9 @@ HRESULT convert_to_int32(const SampleFormat sfmt, const WORD nChannels, const DW
 			}
 			break;
 		case SAMPLE_FMT_FLTP:
+			if (nChannels == 2 && convert_fltp_stereo_sse2(SAMPLE_FMT_S32, nSamples, (float*)pIn, (float*)pIn + nSamples, (BYTE*)pOut)) {
+				break;
+			}
 			for (size_t i = 0; i < nSamples; ++i) {
 				float* p = (float*)pIn + i;
 				for (int ch = 0; ch < nChannels; ++ch) {
@@ -329,7 +495,7 @@ HRESULT convert_to_float(const SampleFormat sfmt, const WORD nChannels, const DW
 			convert_uint8_to_float(pOut, (uint8_t*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_S16:
-			convert_int16_to_float(pOut, (int16_t*)pIn, allsamples);
+			convert_int16_to_float_sse2(pOut, (int16_t*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_S24:
 			for (size_t i = 0; i < allsamples; ++i) {
@@ -343,7 +509,7 @@ HRESULT convert_to_float(const SampleFormat sfmt, const WORD nChannels, const DW
 			}
 			break;
 		case SAMPLE_FMT_S32:
-			convert_int32_to_float(pOut, (int32_t*)pIn, allsamples);
+			convert_int32_to_float_sse2(pOut, (int32_t*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_FLT:
 			memcpy(pOut, pIn, allsamples * sizeof(float));
@@ -377,6 +543,9 @@ HRESULT convert_to_float(const SampleFormat sfmt, const WORD nChannels, const DW
 			}
 			break;
 		case SAMPLE_FMT_FLTP:
+			if (nChannels == 2 && convert_fltp_stereo_sse2(SAMPLE_FMT_FLT, nSamples, (float*)pIn, (float*)pIn + nSamples, (BYTE*)pOut)) {
+				break;
+			}
 			for (size_t i = 0; i < nSamples; ++i) {
 				float* p = (float*)pIn + i;
 				for (int ch = 0; ch < nChannels; ++ch) {
@@ -448,10 +617,10 @@ HRESULT convert_to_planar_float(const SampleFormat sfmt, const WORD nChannels, c
 			convert_uint8_to_float(pOut, (uint8_t*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_S16P:
-			convert_int16_to_float(pOut, (int16_t*)pIn, allsamples);
+			convert_int16_to_float_sse2(pOut, (int16_t*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_S32P:
-			convert_int32_to_float(pOut, (int32_t*)pIn, allsamples);
+			convert_int32_to_float_sse2(pOut, (int32_t*)pIn, allsamples);
 			break;
 		case SAMPLE_FMT_FLTP:
 			memcpy(pOut, pIn, allsamples * sizeof(float));
@@ -474,20 +643,13 @@ HRESULT convert_float_to(const SampleFormat sfmt, const WORD nChannels, const DW
 			convert_float_to_uint8((uint8_t*)pOut, pIn, allsamples);
 			break;
 		case SAMPLE_FMT_S16:
-			convert_float_to_int16((int16_t*)pOut, pIn, allsamples);
+			convert_float_to_int16_sse2((int16_t*)pOut, pIn, allsamples);
 			break;
 		case SAMPLE_FMT_S24:
-			for (size_t i = 0; i < allsamples; ++i) {
-				double d = (double)(*pIn++);
-				limit(-1, d, D32MAX);
-				uint32_t u32 = (uint32_t)(int32_t)round_d(d * INT32_PEAK);
-				*pOut++ = (BYTE)(u32 >> 8);
-				*pOut++ = (BYTE)(u32 >> 16);
-				*pOut++ = (BYTE)(u32 >> 24);
-			}
+			convert_float_to_int24_sse2(pOut, pIn, allsamples);
 			break;
 		case SAMPLE_FMT_S32:
-			convert_float_to_int32((int32_t*)pOut, pIn, allsamples);
+			convert_float_to_int32_sse2((int32_t*)pOut, pIn, allsamples);
 			break;
 		case SAMPLE_FMT_FLT:
 			memcpy(pOut, pIn, allsamples * sizeof(float));
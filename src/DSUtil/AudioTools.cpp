@@ -21,6 +21,8 @@
 
 #include "stdafx.h"
 #include "AudioTools.h"
+#include "vd.h"
+#include "simd_common.h"
 
 #define INT8_PEAK       128
 #define INT16_PEAK      32768
@@ -41,9 +43,34 @@ void gain_uint8(const double factor, const size_t allsamples, uint8_t* pData)
     }
 }
 
+// the SSE2 loops do the same double math as the C loops, the C loops do the last samples
+
+static __forceinline __m128d gain_clamp_sse2(const __m128d d, const __m128d factor, const __m128d dmin, const __m128d dmax)
+{
+    // operand order keeps NaN like the C loop does
+    return _mm_max_pd(dmin, _mm_min_pd(dmax, _mm_mul_pd(d, factor)));
+}
+
 void gain_int16(const double factor, const size_t allsamples, int16_t* pData)
 {
     int16_t* end = pData + allsamples;
+
+    if (g_cpuid.m_flags & CCpuID::sse2) {
+        const __m128d f    = _mm_set1_pd(factor);
+        const __m128d dmin = _mm_set1_pd(INT16_MIN);
+        const __m128d dmax = _mm_set1_pd(INT16_MAX);
+        for (int16_t* end8 = pData + (allsamples & ~7); pData < end8; pData += 8) {
+            __m128i v  = _mm_loadu_si128((__m128i*)pData);
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            lo = _mm_unpacklo_epi64(_mm_cvttpd_epi32(gain_clamp_sse2(_mm_cvtepi32_pd(lo), f, dmin, dmax)),
+                                    _mm_cvttpd_epi32(gain_clamp_sse2(_mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), f, dmin, dmax)));
+            hi = _mm_unpacklo_epi64(_mm_cvttpd_epi32(gain_clamp_sse2(_mm_cvtepi32_pd(hi), f, dmin, dmax)),
+                                    _mm_cvttpd_epi32(gain_clamp_sse2(_mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), f, dmin, dmax)));
+            _mm_storeu_si128((__m128i*)pData, _mm_packs_epi32(lo, hi));
+        }
+    }
+
     for (; pData < end; ++pData) {
         double d = factor * (*pData);
         limit(INT16_MIN, d, INT16_MAX);
@@ -72,6 +99,19 @@ void gain_int24(const double factor, const size_t allsamples, BYTE* pData)
 void gain_int32(const double factor, const size_t allsamples, int32_t* pData)
 {
     int32_t* end = pData + allsamples;
+
+    if (g_cpuid.m_flags & CCpuID::sse2) {
+        const __m128d f    = _mm_set1_pd(factor);
+        const __m128d dmin = _mm_set1_pd(INT32_MIN);
+        const __m128d dmax = _mm_set1_pd(INT32_MAX);
+        for (int32_t* end4 = pData + (allsamples & ~3); pData < end4; pData += 4) {
+            __m128i v = _mm_loadu_si128((__m128i*)pData);
+            v = _mm_unpacklo_epi64(_mm_cvttpd_epi32(gain_clamp_sse2(_mm_cvtepi32_pd(v), f, dmin, dmax)),
+                                   _mm_cvttpd_epi32(gain_clamp_sse2(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), f, dmin, dmax)));
+            _mm_storeu_si128((__m128i*)pData, v);
+        }
+    }
+
     for (; pData < end; ++pData) {
         double d = factor * (*pData);
         limit(INT32_MIN, d, INT32_MAX);
@@ -82,6 +122,19 @@ void gain_int32(const double factor, const size_t allsamples, int32_t* pData)
 void gain_float(const double factor, const size_t allsamples, float* pData)
 {
     float* end = pData + allsamples;
+
+    if (g_cpuid.m_flags & CCpuID::sse2) {
+        const __m128d f    = _mm_set1_pd(factor);
+        const __m128d dmin = _mm_set1_pd(-1.0);
+        const __m128d dmax = _mm_set1_pd(1.0);
+        for (float* end4 = pData + (allsamples & ~3); pData < end4; pData += 4) {
+            __m128 v = _mm_loadu_ps(pData);
+            __m128 lo = _mm_cvtpd_ps(gain_clamp_sse2(_mm_cvtps_pd(v), f, dmin, dmax));
+            __m128 hi = _mm_cvtpd_ps(gain_clamp_sse2(_mm_cvtps_pd(_mm_movehl_ps(v, v)), f, dmin, dmax));
+            _mm_storeu_ps(pData, _mm_movelh_ps(lo, hi));
+        }
+    }
+
     for (; pData < end; ++pData) {
         double d = factor * (*pData);
         limit(-1.0, d, 1.0);
@@ -119,7 +172,27 @@ double get_max_peak_int16(int16_t* pData, const size_t allsamples)
 {
     int max_peak = 0;
 
-    for (int16_t* end = pData + allsamples; pData < end; ++pData) {
+    int16_t* end = pData + allsamples;
+
+    if (g_cpuid.m_flags & CCpuID::sse2) {
+        // abs(INT16_MIN) does not fit into 16 bits, track the minimum and the maximum
+        __m128i vmin = _mm_setzero_si128();
+        __m128i vmax = _mm_setzero_si128();
+        for (int16_t* end8 = pData + (allsamples & ~7); pData < end8; pData += 8) {
+            __m128i v = _mm_loadu_si128((__m128i*)pData);
+            vmin = _mm_min_epi16(vmin, v);
+            vmax = _mm_max_epi16(vmax, v);
+        }
+        __align16(int16_t, mins[8]);
+        __align16(int16_t, maxs[8]);
+        _mm_store_si128((__m128i*)mins, vmin);
+        _mm_store_si128((__m128i*)maxs, vmax);
+        for (int i = 0; i < 8; i++) {
+            max_peak = max(max_peak, max(-mins[i], (int)maxs[i]));
+        }
+    }
+
+    for (; pData < end; ++pData) {
         int peak = abs(*pData);
         if (peak > max_peak) {
             max_peak = peak;
@@ -170,7 +243,25 @@ double get_max_peak_float(float* pData, const size_t allsamples)
 {
     float max_peak = 0.0f;
 
-    for (float* end = pData + allsamples; pData < end; ++pData) {
+    float* end = pData + allsamples;
+
+    if (g_cpuid.m_flags & CCpuID::sse2) {
+        // _mm_max_ps() returns the second operand for NaN, NaN samples are skipped like in the C loop
+        const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 vmax = _mm_setzero_ps();
+        for (float* end4 = pData + (allsamples & ~3); pData < end4; pData += 4) {
+            vmax = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(pData), abs_mask), vmax);
+        }
+        __align16(float, maxs[4]);
+        _mm_store_ps(maxs, vmax);
+        for (int i = 0; i < 4; i++) {
+            if (maxs[i] > max_peak) {
+                max_peak = maxs[i];
+            }
+        }
+    }
+
+    for (; pData < end; ++pData) {
         float peak = abs(*pData);
         if (peak > max_peak) {
             max_peak = peak;
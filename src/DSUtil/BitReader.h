@@ -0,0 +1,193 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <intrin.h>
+
+//
+// CBitReader - big-endian bit reader shared by CGolombBuffer and CBaseSplitterFile
+//
+// Up to 64 bits are kept in m_bitbuff and refilled a whole word at a time
+// straight from the memory the owner exposes through BitData().
+// Bytes moved into m_bitbuff are already consumed from the owner's point of view,
+// the owner's byte position is therefore its own position minus (m_bitlen >> 3).
+//
+
+class CBitReader
+{
+protected:
+	UINT64	m_bitbuff;
+	int		m_bitlen;
+
+	// returns the bytes available at the current position without consuming them, NULL at the end of data
+	virtual const BYTE* BitData(size_t& size) PURE;
+	// advances the current position after BitData()
+	virtual void BitConsume(size_t size) PURE;
+
+	bool BitFill() {
+		size_t size = 0;
+		const BYTE* pData = BitData(size);
+		if (!pData || !size) {
+			return false;
+		}
+
+		size_t n = (64 - m_bitlen) >> 3;
+		if (n > size) {
+			n = size;
+		}
+
+		if (n == 8) {
+			m_bitbuff = _byteswap_uint64(*(UNALIGNED UINT64*)pData);
+		} else if (n > 0 && size >= 8) {
+			m_bitbuff = (m_bitbuff << (n << 3)) | (_byteswap_uint64(*(UNALIGNED UINT64*)pData) >> (64 - (n << 3)));
+		} else {
+			for (size_t i = 0; i < n; i++) {
+				m_bitbuff = (m_bitbuff << 8) | pData[i];
+			}
+		}
+
+		m_bitlen += (int)(n << 3);
+		BitConsume(n);
+
+		return true;
+	}
+
+	// number of leading zero bits in the buffer, m_bitlen if all buffered bits are zero
+	int BitLeadingZeros() const {
+		if (m_bitlen == 0) {
+			return 0;
+		}
+
+		UINT64 v = m_bitbuff << (64 - m_bitlen);
+		if (!v) {
+			return m_bitlen;
+		}
+
+		unsigned long idx;
+#ifdef _WIN64
+		_BitScanReverse64(&idx, v);
+		return 63 - idx;
+#else
+		if (v >> 32) {
+			_BitScanReverse(&idx, (unsigned long)(v >> 32));
+			return 31 - idx;
+		}
+		_BitScanReverse(&idx, (unsigned long)v);
+		return 63 - idx;
+#endif
+	}
+
+	UINT64 BitReadLong(int nBits, bool fPeek) {
+		// more than 56 bits requested while the buffer is not byte aligned - it can't take the next whole byte
+		if (!fPeek) {
+			UINT64 ret = BitRead(nBits - 32) << 32;
+			return ret | BitRead(32);
+		}
+
+		size_t size = 0;
+		const BYTE* pData = BitData(size);
+		if (!pData || !size) {
+			return 0;
+		}
+
+		int tail = nBits - m_bitlen;
+		return (BitRead(m_bitlen, true) << tail) | (pData[0] >> (8 - tail));
+	}
+
+public:
+	CBitReader()
+		: m_bitbuff(0)
+		, m_bitlen(0) {
+	}
+
+	UINT64 BitRead(int nBits, bool fPeek = false) {
+		ASSERT(nBits >= 0 && nBits <= 64);
+
+		while (m_bitlen < nBits) {
+			if (m_bitlen > 56) {
+				return BitReadLong(nBits, fPeek);
+			}
+			if (!BitFill()) {
+				if (!fPeek) {
+					m_bitlen = 0; // EOF, drop the rest
+				}
+				return 0;
+			}
+		}
+
+		if (nBits == 0) {
+			return 0;
+		}
+
+		int bitlen = m_bitlen - nBits;
+
+		// The shift to 64 bits can give incorrect results.
+		// "The behavior is undefined if the right operand is negative, or greater than or equal to the length in bits of the promoted left operand."
+		UINT64 ret = (m_bitbuff >> bitlen) & (~0ui64 >> (64 - nBits));
+
+		if (!fPeek) {
+			m_bitlen = bitlen;
+		}
+
+		return ret;
+	}
+
+	UINT64 UExpGolombRead() {
+		int n = 0;
+		for (;;) {
+			if (m_bitlen == 0 && !BitFill()) {
+				return 0;
+			}
+
+			int lz = BitLeadingZeros();
+			if (lz < m_bitlen) {
+				n += lz;
+				m_bitlen -= lz + 1;
+				break;
+			}
+
+			n += m_bitlen;
+			m_bitlen = 0;
+			if (n >= 64) {
+				return 0; // broken data
+			}
+		}
+
+		if (n >= 64) {
+			return 0;
+		}
+
+		return (1ui64 << n) - 1 + BitRead(n);
+	}
+
+	INT64 SExpGolombRead() {
+		UINT64 k = UExpGolombRead();
+		return ((k & 1) ? 1 : -1) * ((k + 1) >> 1);
+	}
+
+	void BitByteAlign() {
+		m_bitlen &= ~7;
+	}
+
+	void BitFlush() {
+		m_bitlen = 0;
+	}
+};
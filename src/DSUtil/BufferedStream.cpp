@@ -0,0 +1,324 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "BufferedStream.h"
+#include "DSUtil.h"
+
+//
+// CBufferedStream
+//
+
+CBufferedStream::CBufferedStream(IStream* pStream)
+	: CUnknown(NAME("CBufferedStream"), NULL)
+	, m_pStream(pStream)
+	, m_iBuff(0)
+	, m_bufstart(0)
+	, m_buflen(0)
+	, m_bufpos(0)
+	, m_iWrite(1)
+	, m_writestart(0)
+	, m_writelen(0)
+	, m_streampos((UINT64)-1)
+	, m_hrWrite(S_OK)
+	, m_evIdle(TRUE)
+{
+	ASSERT(m_pStream);
+
+	LARGE_INTEGER li = {0};
+	ULARGE_INTEGER pos = {0};
+	if (SUCCEEDED(m_pStream->Seek(li, STREAM_SEEK_CUR, &pos))) {
+		m_bufstart = m_streampos = pos.QuadPart;
+	}
+
+	m_evIdle.Set();
+
+	if (m_buff[0].SetCount(BUFFEREDSTREAM_SIZE) && m_buff[1].SetCount(BUFFEREDSTREAM_SIZE)) {
+		Create();
+	} else {
+		// out of memory, everything goes straight to the stream
+		m_buff[0].RemoveAll();
+		m_buff[1].RemoveAll();
+	}
+}
+
+CBufferedStream::~CBufferedStream()
+{
+	Flush(true);
+
+	if (ThreadExists()) {
+		CallWorker(CMD_EXIT);
+		Close();
+	}
+}
+
+STDMETHODIMP CBufferedStream::NonDelegatingQueryInterface(REFIID riid, void** ppv)
+{
+	CheckPointer(ppv, E_POINTER);
+
+	return
+		QI(IStream)
+		QI(ISequentialStream)
+		__super::NonDelegatingQueryInterface(riid, ppv);
+}
+
+DWORD CBufferedStream::ThreadProc()
+{
+	SetThreadName((DWORD)-1, "CBufferedStream");
+
+	for (;;) {
+		DWORD cmd = GetRequest();
+		Reply(S_OK);
+
+		switch (cmd) {
+			case CMD_EXIT:
+				return 0;
+			case CMD_WRITE: {
+				HRESULT hr = WriteStream(m_writestart, m_buff[m_iWrite].GetData(), m_writelen);
+				if (FAILED(hr) && SUCCEEDED(m_hrWrite)) {
+					m_hrWrite = hr;
+				}
+				m_evIdle.Set();
+				break;
+			}
+		}
+	}
+}
+
+HRESULT CBufferedStream::WriteStream(UINT64 pos, const BYTE* pData, size_t len)
+{
+	HRESULT hr = S_OK;
+
+	if (pos != m_streampos) {
+		LARGE_INTEGER li;
+		li.QuadPart = pos;
+		if (FAILED(hr = m_pStream->Seek(li, STREAM_SEEK_SET, NULL))) {
+			m_streampos = (UINT64)-1;
+			return hr;
+		}
+		m_streampos = pos;
+	}
+
+	ULONG written = 0;
+	if (len && SUCCEEDED(hr = m_pStream->Write(pData, (ULONG)len, &written)) && written != len) {
+		hr = STG_E_MEDIUMFULL;
+	}
+	m_streampos += written;
+
+	return hr;
+}
+
+HRESULT CBufferedStream::WaitIdle()
+{
+	m_evIdle.Wait();
+	return m_hrWrite;
+}
+
+HRESULT CBufferedStream::Flush(bool bWait)
+{
+	HRESULT hr = WaitIdle();
+	if (FAILED(hr) || !m_buflen) {
+		return hr;
+	}
+
+	if (ThreadExists()) {
+		m_iWrite		= m_iBuff;
+		m_writestart	= m_bufstart;
+		m_writelen		= m_buflen;
+		m_evIdle.Reset();
+		CallWorker(CMD_WRITE);
+
+		m_iBuff ^= 1;
+	} else {
+		hr = WriteStream(m_bufstart, m_buff[m_iBuff].GetData(), m_buflen);
+	}
+
+	m_bufstart += m_bufpos;
+	m_buflen = m_bufpos = 0;
+
+	if (bWait && SUCCEEDED(hr)) {
+		hr = WaitIdle();
+	}
+
+	return hr;
+}
+
+// ISequentialStream
+
+STDMETHODIMP CBufferedStream::Read(void* pv, ULONG cb, ULONG* pcbRead)
+{
+	HRESULT hr = Flush(true);
+	if (FAILED(hr)) {
+		return hr;
+	}
+
+	if (m_bufstart != m_streampos) {
+		LARGE_INTEGER li;
+		li.QuadPart = m_bufstart;
+		if (FAILED(hr = m_pStream->Seek(li, STREAM_SEEK_SET, NULL))) {
+			m_streampos = (UINT64)-1;
+			return hr;
+		}
+		m_streampos = m_bufstart;
+	}
+
+	ULONG read = 0;
+	hr = m_pStream->Read(pv, cb, &read);
+	m_bufstart = m_streampos += read;
+	if (pcbRead) {
+		*pcbRead = read;
+	}
+
+	return hr;
+}
+
+STDMETHODIMP CBufferedStream::Write(const void* pv, ULONG cb, ULONG* pcbWritten)
+{
+	CheckPointer(pv, STG_E_INVALIDPOINTER);
+
+	HRESULT hr = S_OK;
+
+	if (m_bufpos + cb > m_buff[m_iBuff].GetCount()) {
+		if (FAILED(hr = Flush(false))) {
+			return hr;
+		}
+
+		if (cb > m_buff[m_iBuff].GetCount()) {
+			// too big for the buffer, write it directly after the pending one
+			if (FAILED(hr = WaitIdle())
+					|| FAILED(hr = WriteStream(m_bufstart, (const BYTE*)pv, cb))) {
+				return hr;
+			}
+			m_bufstart += cb;
+			if (pcbWritten) {
+				*pcbWritten = cb;
+			}
+			return S_OK;
+		}
+	}
+
+	memcpy(m_buff[m_iBuff].GetData() + m_bufpos, pv, cb);
+	m_bufpos += cb;
+	if (m_buflen < m_bufpos) {
+		m_buflen = m_bufpos;
+	}
+	if (pcbWritten) {
+		*pcbWritten = cb;
+	}
+
+	return S_OK;
+}
+
+// IStream
+
+STDMETHODIMP CBufferedStream::Seek(LARGE_INTEGER dlibMove, DWORD dwOrigin, ULARGE_INTEGER* plibNewPosition)
+{
+	HRESULT hr = S_OK;
+	UINT64 pos;
+
+	switch (dwOrigin) {
+		case STREAM_SEEK_SET:
+			pos = dlibMove.QuadPart;
+			break;
+		case STREAM_SEEK_CUR:
+			pos = m_bufstart + m_bufpos + dlibMove.QuadPart;
+			break;
+		case STREAM_SEEK_END: {
+			if (FAILED(hr = Flush(true))) {
+				return hr;
+			}
+			ULARGE_INTEGER newpos;
+			if (FAILED(hr = m_pStream->Seek(dlibMove, STREAM_SEEK_END, &newpos))) {
+				m_streampos = (UINT64)-1;
+				return hr;
+			}
+			m_bufstart = m_streampos = pos = newpos.QuadPart;
+			break;
+		}
+		default:
+			return STG_E_INVALIDFUNCTION;
+	}
+
+	if (pos >= m_bufstart && pos <= m_bufstart + m_buflen) {
+		// inside the buffer, the next writes patch it in place
+		m_bufpos = (size_t)(pos - m_bufstart);
+	} else {
+		if (FAILED(hr = Flush(false))) {
+			return hr;
+		}
+		m_bufstart = pos;
+	}
+
+	if (plibNewPosition) {
+		plibNewPosition->QuadPart = pos;
+	}
+
+	return S_OK;
+}
+
+STDMETHODIMP CBufferedStream::SetSize(ULARGE_INTEGER libNewSize)
+{
+	HRESULT hr = Flush(true);
+	return SUCCEEDED(hr) ? m_pStream->SetSize(libNewSize) : hr;
+}
+
+STDMETHODIMP CBufferedStream::CopyTo(IStream* pstm, ULARGE_INTEGER cb, ULARGE_INTEGER* pcbRead, ULARGE_INTEGER* pcbWritten)
+{
+	return E_NOTIMPL;
+}
+
+STDMETHODIMP CBufferedStream::Commit(DWORD grfCommitFlags)
+{
+	HRESULT hr = Flush(true);
+	if (FAILED(hr)) {
+		return hr;
+	}
+
+	// everything is written, a stream without transactions has nothing more to commit
+	hr = m_pStream->Commit(grfCommitFlags);
+	return hr == E_NOTIMPL ? S_OK : hr;
+}
+
+STDMETHODIMP CBufferedStream::Revert()
+{
+	return E_NOTIMPL;
+}
+
+STDMETHODIMP CBufferedStream::LockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType)
+{
+	HRESULT hr = Flush(true);
+	return SUCCEEDED(hr) ? m_pStream->LockRegion(libOffset, cb, dwLockType) : hr;
+}
+
+STDMETHODIMP CBufferedStream::UnlockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType)
+{
+	return m_pStream->UnlockRegion(libOffset, cb, dwLockType);
+}
+
+STDMETHODIMP CBufferedStream::Stat(STATSTG* pstatstg, DWORD grfStatFlag)
+{
+	HRESULT hr = Flush(true);
+	return SUCCEEDED(hr) ? m_pStream->Stat(pstatstg, grfStatFlag) : hr;
+}
+
+STDMETHODIMP CBufferedStream::Clone(IStream** ppstm)
+{
+	return E_NOTIMPL;
+}
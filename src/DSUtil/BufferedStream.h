@@ -0,0 +1,89 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atlcoll.h>
+
+//
+// CBufferedStream - write-behind IStream wrapper for the muxers
+//
+// Writes are collected in a buffer and handed to a flush thread when it is full, the caller goes on
+// filling the second buffer meanwhile. The position is tracked locally, seeking back into the current
+// buffer (to patch a header or a size field) does not touch the underlying stream at all.
+// Commit(), Stat(), SetSize() and Read() flush everything first. A failed background write is
+// returned by the next call that has to wait for the flush thread.
+//
+
+#define BUFFEREDSTREAM_SIZE	(4 * 1024 * 1024)
+
+class CBufferedStream
+	: public CUnknown
+	, public IStream
+	, protected CAMThread
+{
+	CComPtr<IStream> m_pStream;
+
+	CAtlArray<BYTE> m_buff[2];
+	int		m_iBuff;		// buffer being filled
+	UINT64	m_bufstart;		// stream position of the first byte in m_buff[m_iBuff]
+	size_t	m_buflen;		// valid bytes in m_buff[m_iBuff]
+	size_t	m_bufpos;		// current position in m_buff[m_iBuff], <= m_buflen
+
+	// owned by the flush thread while m_evIdle is reset
+	int		m_iWrite;
+	UINT64	m_writestart;
+	size_t	m_writelen;
+	UINT64	m_streampos;	// position of m_pStream, (UINT64)-1 if unknown
+	HRESULT	m_hrWrite;		// first failed write
+
+	CAMEvent m_evIdle;
+
+	enum { CMD_EXIT, CMD_WRITE };
+	DWORD ThreadProc();
+
+	HRESULT WriteStream(UINT64 pos, const BYTE* pData, size_t len);
+	HRESULT WaitIdle();
+	HRESULT Flush(bool bWait);
+
+public:
+	CBufferedStream(IStream* pStream);
+	virtual ~CBufferedStream();
+
+	DECLARE_IUNKNOWN;
+	STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void** ppv);
+
+	// ISequentialStream
+
+	STDMETHODIMP Read(void* pv, ULONG cb, ULONG* pcbRead);
+	STDMETHODIMP Write(const void* pv, ULONG cb, ULONG* pcbWritten);
+
+	// IStream
+
+	STDMETHODIMP Seek(LARGE_INTEGER dlibMove, DWORD dwOrigin, ULARGE_INTEGER* plibNewPosition);
+	STDMETHODIMP SetSize(ULARGE_INTEGER libNewSize);
+	STDMETHODIMP CopyTo(IStream* pstm, ULARGE_INTEGER cb, ULARGE_INTEGER* pcbRead, ULARGE_INTEGER* pcbWritten);
+	STDMETHODIMP Commit(DWORD grfCommitFlags);
+	STDMETHODIMP Revert();
+	STDMETHODIMP LockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType);
+	STDMETHODIMP UnlockRegion(ULARGE_INTEGER libOffset, ULARGE_INTEGER cb, DWORD dwLockType);
+	STDMETHODIMP Stat(STATSTG* pstatstg, DWORD grfStatFlag);
+	STDMETHODIMP Clone(IStream** ppstm);
+};
@@ -0,0 +1,341 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "DeinterlaceYadif.h"
+#include "DSUtil.h"
+#include "vd.h"
+#include "simd_common.h"
+
+// yadif by Michael Niedermayer, see libavfilter/vf_yadif.c
+//
+// cur points to the missing line, mrefs/prefs are the offsets of the lines above and below it.
+// prev2/next2 are the frames holding the missing field closest in time before and after the kept one.
+
+static void yadif_line_c(BYTE* dst, const BYTE* prev, const BYTE* cur, const BYTE* next, int x, int w, int mrefs, int prefs, bool bFirst, bool bSpatial)
+{
+	const BYTE* prev2 = bFirst ? prev : cur;
+	const BYTE* next2 = bFirst ? cur : next;
+
+	for (; x < w; x++) {
+		const int c = cur[x + mrefs];
+		const int d = (prev2[x] + next2[x]) >> 1;
+		const int e = cur[x + prefs];
+		const int td0 = abs(prev2[x] - next2[x]);
+		const int td1 = (abs(prev[x + mrefs] - c) + abs(prev[x + prefs] - e)) >> 1;
+		const int td2 = (abs(next[x + mrefs] - c) + abs(next[x + prefs] - e)) >> 1;
+		int diff = max(max(td0 >> 1, td1), td2);
+		int spatial_pred = (c + e) >> 1;
+
+		// edge directed interpolation, not near the left and right border
+		if (x >= 3 && x < w - 3) {
+			int spatial_score = abs(cur[x - 1 + mrefs] - cur[x - 1 + prefs]) + abs(c - e)
+								+ abs(cur[x + 1 + mrefs] - cur[x + 1 + prefs]) - 1;
+
+#define CHECK(j)																		\
+			{																			\
+				int score = abs(cur[x - 1 + j + mrefs] - cur[x - 1 - j + prefs])		\
+							+ abs(cur[x + j + mrefs] - cur[x - j + prefs])				\
+							+ abs(cur[x + 1 + j + mrefs] - cur[x + 1 - j + prefs]);		\
+				if (score < spatial_score) {											\
+					spatial_score = score;												\
+					spatial_pred = (cur[x + j + mrefs] + cur[x - j + prefs]) >> 1;
+
+			CHECK(-1) CHECK(-2) }} }}
+			CHECK( 1) CHECK( 2) }} }}
+#undef CHECK
+		}
+
+		if (bSpatial) {
+			const int b = (prev2[x + 2 * mrefs] + next2[x + 2 * mrefs]) >> 1;
+			const int f = (prev2[x + 2 * prefs] + next2[x + 2 * prefs]) >> 1;
+			const int max_ = max(max(d - e, d - c), min(b - c, f - e));
+			const int min_ = min(min(d - e, d - c), max(b - c, f - e));
+
+			diff = max(max(diff, min_), -max_);
+		}
+
+		if (spatial_pred > d + diff) {
+			spatial_pred = d + diff;
+		} else if (spatial_pred < d - diff) {
+			spatial_pred = d - diff;
+		}
+
+		dst[x] = (BYTE)spatial_pred;
+	}
+}
+
+// the same on 8 pixels at once in 16 bit lanes, from x = 3 while the reads stay inside the line,
+// returns the first pixel left for yadif_line_c()
+
+#define LOAD8(p)		_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p)), zero)
+#define ABSDIFF(a, b)	_mm_max_epi16(_mm_sub_epi16(a, b), _mm_sub_epi16(b, a))
+#define SELECT(m, a, b)	_mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+
+static int yadif_line_sse2(BYTE* dst, const BYTE* prev, const BYTE* cur, const BYTE* next, int w, int mrefs, int prefs, bool bFirst, bool bSpatial)
+{
+	const BYTE* prev2 = bFirst ? prev : cur;
+	const BYTE* next2 = bFirst ? cur : next;
+	const BYTE* a = cur + mrefs;
+	const BYTE* b = cur + prefs;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+
+	int x = 3;
+	for (; x + 11 <= w; x += 8) {
+		const __m128i c		= LOAD8(a + x);
+		const __m128i e		= LOAD8(b + x);
+		const __m128i p2	= LOAD8(prev2 + x);
+		const __m128i n2	= LOAD8(next2 + x);
+		const __m128i d		= _mm_srli_epi16(_mm_add_epi16(p2, n2), 1);
+
+		const __m128i td0 = ABSDIFF(p2, n2);
+		const __m128i td1 = _mm_srli_epi16(_mm_add_epi16(ABSDIFF(LOAD8(prev + x + mrefs), c), ABSDIFF(LOAD8(prev + x + prefs), e)), 1);
+		const __m128i td2 = _mm_srli_epi16(_mm_add_epi16(ABSDIFF(LOAD8(next + x + mrefs), c), ABSDIFF(LOAD8(next + x + prefs), e)), 1);
+		__m128i diff = _mm_max_epi16(_mm_max_epi16(_mm_srli_epi16(td0, 1), td1), td2);
+
+		__m128i spatial_pred = _mm_srli_epi16(_mm_add_epi16(c, e), 1);
+		__m128i spatial_score = _mm_add_epi16(ABSDIFF(LOAD8(a + x - 1), LOAD8(b + x - 1)), ABSDIFF(c, e));
+		spatial_score = _mm_sub_epi16(_mm_add_epi16(spatial_score, ABSDIFF(LOAD8(a + x + 1), LOAD8(b + x + 1))), one);
+
+		// the second step of a direction only counts where the first one was taken
+		__m128i mask = _mm_cmpeq_epi16(zero, zero);
+		for (int j = -1; j >= -2; j--) {
+			__m128i score = _mm_add_epi16(ABSDIFF(LOAD8(a + x - 1 + j), LOAD8(b + x - 1 - j)), ABSDIFF(LOAD8(a + x + j), LOAD8(b + x - j)));
+			score = _mm_add_epi16(score, ABSDIFF(LOAD8(a + x + 1 + j), LOAD8(b + x + 1 - j)));
+			mask = _mm_and_si128(mask, _mm_cmplt_epi16(score, spatial_score));
+			spatial_score = SELECT(mask, score, spatial_score);
+			spatial_pred = SELECT(mask, _mm_srli_epi16(_mm_add_epi16(LOAD8(a + x + j), LOAD8(b + x - j)), 1), spatial_pred);
+		}
+		mask = _mm_cmpeq_epi16(zero, zero);
+		for (int j = 1; j <= 2; j++) {
+			__m128i score = _mm_add_epi16(ABSDIFF(LOAD8(a + x - 1 + j), LOAD8(b + x - 1 - j)), ABSDIFF(LOAD8(a + x + j), LOAD8(b + x - j)));
+			score = _mm_add_epi16(score, ABSDIFF(LOAD8(a + x + 1 + j), LOAD8(b + x + 1 - j)));
+			mask = _mm_and_si128(mask, _mm_cmplt_epi16(score, spatial_score));
+			spatial_score = SELECT(mask, score, spatial_score);
+			spatial_pred = SELECT(mask, _mm_srli_epi16(_mm_add_epi16(LOAD8(a + x + j), LOAD8(b + x - j)), 1), spatial_pred);
+		}
+
+		if (bSpatial) {
+			const __m128i bb = _mm_srli_epi16(_mm_add_epi16(LOAD8(prev2 + x + 2 * mrefs), LOAD8(next2 + x + 2 * mrefs)), 1);
+			const __m128i ff = _mm_srli_epi16(_mm_add_epi16(LOAD8(prev2 + x + 2 * prefs), LOAD8(next2 + x + 2 * prefs)), 1);
+			const __m128i dc = _mm_sub_epi16(d, c);
+			const __m128i de = _mm_sub_epi16(d, e);
+			const __m128i bc = _mm_sub_epi16(bb, c);
+			const __m128i fe = _mm_sub_epi16(ff, e);
+			const __m128i max_ = _mm_max_epi16(_mm_max_epi16(de, dc), _mm_min_epi16(bc, fe));
+			const __m128i min_ = _mm_min_epi16(_mm_min_epi16(de, dc), _mm_max_epi16(bc, fe));
+
+			diff = _mm_max_epi16(_mm_max_epi16(diff, min_), _mm_sub_epi16(zero, max_));
+		}
+
+		spatial_pred = _mm_min_epi16(_mm_max_epi16(spatial_pred, _mm_sub_epi16(d, diff)), _mm_add_epi16(d, diff));
+
+		_mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(spatial_pred, zero));
+	}
+
+	return x;
+}
+
+#undef LOAD8
+#undef ABSDIFF
+#undef SELECT
+
+// lines [y0, y1) of one plane, the lines of the kept field are copied from cur
+
+static void yadif_plane(BYTE* dst, int dstpitch, const BYTE* prev, const BYTE* cur, const BYTE* next, int srcpitch,
+						int w, int h, int y0, int y1, bool bTopField, bool bFirst)
+{
+	const bool bSSE2 = !!(g_cpuid.m_flags & CCpuID::sse2);
+
+	for (int y = y0; y < y1; y++) {
+		BYTE* d = dst + y * dstpitch;
+		const int offset = y * srcpitch;
+
+		if (((y & 1) == (bTopField ? 0 : 1)) || h < 2) {
+			memcpy(d, cur + offset, w);
+			continue;
+		}
+
+		// mirror the missing neighbours at the top and the bottom, the spatial check reads two lines further
+		// and is skipped where that would leave the plane (y == 1, y + 2 == h) as libavfilter does
+		const int mrefs = y > 0 ? -srcpitch : srcpitch;
+		const int prefs = y + 1 < h ? srcpitch : -srcpitch;
+		const bool bSpatial = y != 1 && y + 2 != h && h >= 3;
+
+		int x = 3;
+		if (bSSE2) {
+			x = yadif_line_sse2(d, prev + offset, cur + offset, next + offset, w, mrefs, prefs, bFirst, bSpatial);
+		}
+		yadif_line_c(d, prev + offset, cur + offset, next + offset, 0, min(3, w), mrefs, prefs, bFirst, bSpatial);
+		yadif_line_c(d, prev + offset, cur + offset, next + offset, x, w, mrefs, prefs, bFirst, bSpatial);
+	}
+}
+
+//
+// CYadifDeinterlacer
+//
+
+CYadifDeinterlacer::CYadifDeinterlacer()
+	: m_nThreads(-1)
+	, m_bExitThreads(false)
+{
+	memset(m_Threads, 0, sizeof(m_Threads));
+	memset(m_hEvDone, 0, sizeof(m_hEvDone));
+	memset(&m_Job, 0, sizeof(m_Job));
+}
+
+CYadifDeinterlacer::~CYadifDeinterlacer()
+{
+	StopThreads();
+}
+
+void CYadifDeinterlacer::StartThreads()
+{
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	const int nThreads = min((int)SystemInfo.dwNumberOfProcessors, YADIF_MAX_THREADS) - 1;
+
+	m_bExitThreads = false;
+
+	for (m_nThreads = 0; m_nThreads < nThreads; m_nThreads++) {
+		thread_t& thread = m_Threads[m_nThreads];
+		thread.pDeinterlacer	= this;
+		thread.band				= m_nThreads + 1;
+		thread.hEvStart			= CreateEvent(NULL, FALSE, FALSE, NULL);
+		m_hEvDone[m_nThreads] = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+		thread.hThread = (thread.hEvStart && m_hEvDone[m_nThreads]) ? ::CreateThread(NULL, 0, ThreadProc, &thread, 0, NULL) : NULL;
+		if (!thread.hThread) {
+			if (thread.hEvStart) {
+				CloseHandle(thread.hEvStart);
+			}
+			if (m_hEvDone[m_nThreads]) {
+				CloseHandle(m_hEvDone[m_nThreads]);
+			}
+			memset(&thread, 0, sizeof(thread));
+			m_hEvDone[m_nThreads] = NULL;
+			break;
+		}
+	}
+
+	DbgLog((LOG_TRACE, 3, L"CYadifDeinterlacer::StartThreads() : %d band threads", m_nThreads));
+}
+
+void CYadifDeinterlacer::StopThreads()
+{
+	if (m_nThreads > 0) {
+		m_bExitThreads = true;
+		for (int i = 0; i < m_nThreads; i++) {
+			SetEvent(m_Threads[i].hEvStart);
+		}
+		for (int i = 0; i < m_nThreads; i++) {
+			WaitForSingleObject(m_Threads[i].hThread, INFINITE);
+			CloseHandle(m_Threads[i].hThread);
+			CloseHandle(m_Threads[i].hEvStart);
+			CloseHandle(m_hEvDone[i]);
+		}
+		memset(m_Threads, 0, sizeof(m_Threads));
+		memset(m_hEvDone, 0, sizeof(m_hEvDone));
+	}
+
+	m_nThreads = -1;
+}
+
+DWORD WINAPI CYadifDeinterlacer::ThreadProc(LPVOID lpParam)
+{
+	thread_t* pThread = (thread_t*)lpParam;
+	CYadifDeinterlacer* pDeinterlacer = pThread->pDeinterlacer;
+
+	SetThreadName((DWORD)-1, "CYadifDeinterlacer");
+
+	for (;;) {
+		WaitForSingleObject(pThread->hEvStart, INFINITE);
+		if (pDeinterlacer->m_bExitThreads) {
+			break;
+		}
+
+		pDeinterlacer->DeinterlaceBand(pThread->band);
+		SetEvent(pDeinterlacer->m_hEvDone[pThread->band - 1]);
+	}
+
+	return 0;
+}
+
+void CYadifDeinterlacer::DeinterlaceBand(int band)
+{
+	// the band height is a multiple of 4, the chroma bands keep the field parity of the luma ones
+	const int y0 = band * m_Job.bandHeight;
+	const int y1 = min(y0 + m_Job.bandHeight, m_Job.h);
+
+	for (int i = 0; i < 3; i++) {
+		const int shift = i ? 1 : 0;
+		yadif_plane(m_Job.dst[i], m_Job.dstpitch >> shift,
+					m_Job.prev[i], m_Job.cur[i], m_Job.next[i], m_Job.srcpitch >> shift,
+					m_Job.w >> shift, m_Job.h >> shift, y0 >> shift, y1 >> shift,
+					m_Job.bTopField, m_Job.bFirst);
+	}
+
+	if (m_Job.pPostProc) {
+		m_Job.pPostProc(m_Job.pPostProcParam, m_Job.dst, m_Job.dstpitch, m_Job.w, y0, y1);
+	}
+}
+
+void CYadifDeinterlacer::Deinterlace(BYTE* const dst[3], int dstpitch,
+									 const BYTE* const prev[3], const BYTE* const cur[3], const BYTE* const next[3], int srcpitch,
+									 int w, int h, bool bTopField, bool bTFF,
+									 POSTPROC pPostProc, LPVOID pPostProcParam)
+{
+	for (int i = 0; i < 3; i++) {
+		m_Job.dst[i]	= dst[i];
+		m_Job.prev[i]	= prev[i];
+		m_Job.cur[i]	= cur[i];
+		m_Job.next[i]	= next[i];
+	}
+	m_Job.dstpitch	= dstpitch;
+	m_Job.srcpitch	= srcpitch;
+	m_Job.w			= w;
+	m_Job.h			= h;
+	m_Job.bTopField	= bTopField;
+	m_Job.bFirst	= bTopField == bTFF;
+	m_Job.pPostProc			= pPostProc;
+	m_Job.pPostProcParam	= pPostProcParam;
+
+	int bands = 1;
+	if (h >= 2 * YADIF_MIN_BAND) {
+		if (m_nThreads < 0) {
+			StartThreads();
+		}
+		bands = min(m_nThreads + 1, h / YADIF_MIN_BAND);
+	}
+	m_Job.bandHeight = (((h + bands - 1) / bands) + 3) & ~3;
+	bands = (h + m_Job.bandHeight - 1) / m_Job.bandHeight;
+
+	for (int i = 1; i < bands; i++) {
+		SetEvent(m_Threads[i - 1].hEvStart);
+	}
+
+	DeinterlaceBand(0);
+
+	if (bands > 1) {
+		WaitForMultipleObjects(bands - 1, m_hEvDone, TRUE, INFINITE);
+	}
+}
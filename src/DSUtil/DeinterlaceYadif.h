@@ -0,0 +1,83 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+//
+// CYadifDeinterlacer - motion adaptive deinterlacer (yadif algorithm) for planar 4:2:0 frames
+//
+// The missing lines of the kept field are interpolated along edges of the current frame and
+// limited by the temporal difference to the previous and the next frame.
+// For double rate output call it twice per frame, once for each field.
+// The frame is processed in horizontal bands on up to YADIF_MAX_THREADS threads,
+// an optional callback post-processes each band on the same thread while it is still in the cache.
+//
+
+#define YADIF_MAX_THREADS	8	// including the calling thread
+#define YADIF_MIN_BAND		64	// luma lines
+
+class CYadifDeinterlacer
+{
+public:
+	// luma lines [y0, y1) of dst and the matching chroma lines
+	typedef void (*POSTPROC)(LPVOID param, BYTE* const dst[3], int dstpitch, int w, int y0, int y1);
+
+private:
+	struct thread_t {
+		CYadifDeinterlacer*	pDeinterlacer;
+		HANDLE				hThread;
+		HANDLE				hEvStart;
+		int					band;
+	};
+	thread_t	m_Threads[YADIF_MAX_THREADS - 1];
+	HANDLE		m_hEvDone[YADIF_MAX_THREADS - 1];
+	int			m_nThreads;		// -1 until the first frame
+	bool		m_bExitThreads;
+
+	struct {
+		BYTE*		dst[3];
+		const BYTE*	prev[3];
+		const BYTE*	cur[3];
+		const BYTE*	next[3];
+		int			dstpitch;
+		int			srcpitch;
+		int			w, h;
+		bool		bTopField;	// field of cur that is kept
+		bool		bFirst;		// the kept field is the first one of the frame
+		int			bandHeight;
+		POSTPROC	pPostProc;
+		LPVOID		pPostProcParam;
+	} m_Job;
+
+	void StartThreads();
+	void StopThreads();
+	void DeinterlaceBand(int band);
+	static DWORD WINAPI ThreadProc(LPVOID lpParam);
+
+public:
+	CYadifDeinterlacer();
+	~CYadifDeinterlacer();
+
+	// prev and next may point to cur at the start and the end of the stream
+	void Deinterlace(BYTE* const dst[3], int dstpitch,
+					 const BYTE* const prev[3], const BYTE* const cur[3], const BYTE* const next[3], int srcpitch,
+					 int w, int h, bool bTopField, bool bTFF,
+					 POSTPROC pPostProc = NULL, LPVOID pPostProcParam = NULL);
+};
@@ -0,0 +1,333 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// DeinterlaceYadifCheck - quality and speed of CYadifDeinterlacer on synthetic interlaced video, not part of the build
+//
+//   build it as a console program from this file with the DSUtil library, it includes DeinterlaceYadif.cpp
+//   itself for the single threaded plane function
+//
+//   DeinterlaceYadifCheck           quality of every pattern in both field orders
+//   DeinterlaceYadifCheck --bench   also time 1920x1080 at double rate
+//
+// Every pattern is rendered progressively at the field rate and interlaced, top or bottom field first.
+// The double rate output is compared with the progressive pictures (PSNR over all planes, without the
+// first and the last frame that have no neighbours), next to line doubling (bob) and weave. Yadif has to
+// reach the limits in the pattern table. The output of the SSE2 path on the band threads also has to be
+// identical to the C path on one thread. Exits with 1 when a check fails.
+//
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "DeinterlaceYadif.cpp"
+
+#define CHECK_WIDTH		720
+#define CHECK_HEIGHT	576
+#define CHECK_FRAMES	12
+#define BENCH_WIDTH		1920
+#define BENCH_HEIGHT	1080
+#define BENCH_FRAMES	60
+
+typedef double (*PATTERN)(double x, double y, double t);	// 0..1 at a luma position, t in fields
+
+static double Static(double x, double y, double t)
+{
+	// thin lines and small blocks, what weave keeps and line doubling loses. The lines are two lines of
+	// each field (one in the chroma), yadif's spatial check takes a single line for combing and interpolates it
+	const int ix = (int)x, iy = (int)y;
+	if (iy % 16 >= 4 && iy % 16 < 8) {
+		return 0.9;
+	}
+	return ((ix / 6 + iy / 6) & 1) ? 0.7 : 0.2;
+}
+
+static double PanningEdge(double x, double y, double t)
+{
+	// a soft diagonal edge moving 3 pixels per field
+	const double d = (x - 3.0 * t) - 0.6 * y;
+	return 0.5 + 0.4 * tanh(fmod(d + 10000.0, 96.0) < 48.0 ? 1.5 : -1.5);
+}
+
+static double RisingBar(double x, double y, double t)
+{
+	// a bright bar rising 2 lines per field over a static gradient
+	const double pos = fmod(500.0 - 2.0 * t, 600.0);
+	const double bar = y >= pos && y < pos + 40.0 ? 0.9 : 0.0;
+	return max(bar, 0.1 + 0.5 * x / CHECK_WIDTH);
+}
+
+static double Zoneplate(double x, double y, double t)
+{
+	// a slowly panning grating, fine vertical detail in motion
+	const double cx = x - 0.5 * t - CHECK_WIDTH / 2, cy = y - CHECK_HEIGHT / 2;
+	return 0.5 + 0.35 * cos((cx * cx + cy * cy) / 1200.0);
+}
+
+static double Mixed(double x, double y, double t)
+{
+	// a static background with a moving edge on its left half
+	return x < CHECK_WIDTH / 2 ? PanningEdge(x, y, t) : Static(x, y, t);
+}
+
+static const struct {
+	const char*	name;
+	PATTERN		pattern;
+	double		minPSNR;		// dB
+	double		minOverBob;		// dB yadif has to gain over line doubling
+} s_patterns[] = {
+	{"static",			Static,			48.0,	10.0},
+	{"panning edge",	PanningEdge,	28.0,	 1.0},
+	{"rising bar",		RisingBar,		34.0,	-0.5},
+	{"zoneplate pan",	Zoneplate,		40.0,	 5.0},
+	{"mixed",			Mixed,			30.0,	 8.0},
+};
+
+struct frame_t {
+	int w, h, pitch;
+	std::vector<BYTE> data;
+	BYTE* buf[3];
+
+	frame_t(int w, int h)
+		: w(w), h(h), pitch(w), data(w * h * 3 / 2) {
+		SetPlanes();
+	}
+
+	frame_t(const frame_t& f)
+		: w(f.w), h(f.h), pitch(f.pitch), data(f.data) {
+		SetPlanes();
+	}
+
+private:
+	void SetPlanes() {
+		buf[0] = &data[0];
+		buf[1] = buf[0] + w * h;
+		buf[2] = buf[1] + w * h / 4;
+	}
+
+	frame_t& operator = (const frame_t&);
+};
+
+static BYTE Sample(PATTERN pattern, double x, double y, double t)
+{
+	return (BYTE)(16.5 + 219.0 * min(max(pattern(x, y, t), 0.0), 1.0));
+}
+
+// progressive picture at the time of a field, the chroma takes the pattern of the shifted luma
+static void Render(frame_t& f, PATTERN pattern, double t)
+{
+	for (int y = 0; y < f.h; y++) {
+		for (int x = 0; x < f.w; x++) {
+			f.buf[0][y * f.pitch + x] = Sample(pattern, x, y, t);
+		}
+	}
+	for (int y = 0; y < f.h / 2; y++) {
+		for (int x = 0; x < f.w / 2; x++) {
+			f.buf[1][y * f.pitch / 2 + x] = Sample(pattern, 2 * x + 17, 2 * y, t);
+			f.buf[2][y * f.pitch / 2 + x] = 255 - Sample(pattern, 2 * x, 2 * y + 9, t);
+		}
+	}
+}
+
+// the lines of the top field from the first picture, the bottom ones from the second
+static void Weave(frame_t& dst, const frame_t& top, const frame_t& bottom)
+{
+	for (int i = 0; i < 3; i++) {
+		const int w = i ? dst.w / 2 : dst.w, h = i ? dst.h / 2 : dst.h, pitch = i ? dst.pitch / 2 : dst.pitch;
+		for (int y = 0; y < h; y++) {
+			memcpy(dst.buf[i] + y * pitch, ((y & 1) ? bottom : top).buf[i] + y * pitch, w);
+		}
+	}
+}
+
+static void Bob(frame_t& dst, const frame_t& src, bool bTopField)
+{
+	for (int i = 0; i < 3; i++) {
+		const int w = i ? dst.w / 2 : dst.w, h = i ? dst.h / 2 : dst.h, pitch = i ? dst.pitch / 2 : dst.pitch;
+		for (int y = 0; y < h; y++) {
+			BYTE* d = dst.buf[i] + y * pitch;
+			const BYTE* s = src.buf[i] + y * pitch;
+			if ((y & 1) == (bTopField ? 0 : 1)) {
+				memcpy(d, s, w);
+			} else {
+				const BYTE* a = y > 0 ? s - pitch : s + pitch;
+				const BYTE* b = y + 1 < h ? s + pitch : s - pitch;
+				for (int x = 0; x < w; x++) {
+					d[x] = (BYTE)((a[x] + b[x] + 1) >> 1);
+				}
+			}
+		}
+	}
+}
+
+static double SquaredError(const frame_t& a, const frame_t& b)
+{
+	double sum = 0;
+	for (size_t i = 0; i < a.data.size(); i++) {
+		const int d = a.data[i] - b.data[i];
+		sum += d * d;
+	}
+	return sum;
+}
+
+static double PSNR(double sse, double samples)
+{
+	return sse > 0 ? 10.0 * log10(255.0 * 255.0 * samples / sse) : 99.0;
+}
+
+// all lines of every plane on the calling thread, like one band of CYadifDeinterlacer
+static void YadifSingle(frame_t& dst, const frame_t& prev, const frame_t& cur, const frame_t& next, bool bTopField, bool bTFF)
+{
+	for (int i = 0; i < 3; i++) {
+		const int shift = i ? 1 : 0;
+		yadif_plane(dst.buf[i], dst.pitch >> shift, prev.buf[i], cur.buf[i], next.buf[i], cur.pitch >> shift,
+					cur.w >> shift, cur.h >> shift, 0, cur.h >> shift, bTopField, bTopField == bTFF);
+	}
+}
+
+static int CheckQuality()
+{
+	const CCpuID::flag_t flags = g_cpuid.m_flags;
+	int failed = 0;
+
+	printf("%-16s %-3s %9s %9s %9s %s\n", "pattern", "", "yadif dB", "bob dB", "weave dB", "");
+	for (size_t p = 0; p < _countof(s_patterns); p++) {
+		for (int order = 0; order < 2; order++) {
+			const bool bTFF = order == 0;
+
+			// interlaced frames, field 2n first, 2n + 1 second
+			std::vector<frame_t> truth, frames;
+			for (int n = 0; n < CHECK_FRAMES; n++) {
+				frame_t first(CHECK_WIDTH, CHECK_HEIGHT), second(CHECK_WIDTH, CHECK_HEIGHT), frame(CHECK_WIDTH, CHECK_HEIGHT);
+				Render(first, s_patterns[p].pattern, 2 * n);
+				Render(second, s_patterns[p].pattern, 2 * n + 1);
+				Weave(frame, bTFF ? first : second, bTFF ? second : first);
+				truth.push_back(first);
+				truth.push_back(second);
+				frames.push_back(frame);
+			}
+
+			CYadifDeinterlacer yadif;
+			frame_t out(CHECK_WIDTH, CHECK_HEIGHT), ref(CHECK_WIDTH, CHECK_HEIGHT), bob(CHECK_WIDTH, CHECK_HEIGHT);
+			double sse[3] = {0, 0, 0}, samples = 0;
+			bool bSame = true;
+
+			for (int n = 1; n + 1 < CHECK_FRAMES; n++) {
+				for (int field = 0; field < 2; field++) {
+					const bool bTopField = field ? !bTFF : bTFF;
+					const frame_t& t = truth[2 * n + field];
+
+					g_cpuid.m_flags = (CCpuID::flag_t)(flags | CCpuID::sse2);
+					yadif.Deinterlace(out.buf, out.pitch, frames[n - 1].buf, frames[n].buf, frames[n + 1].buf, frames[n].pitch,
+									  CHECK_WIDTH, CHECK_HEIGHT, bTopField, bTFF);
+
+					g_cpuid.m_flags = (CCpuID::flag_t)(flags & ~CCpuID::sse2);
+					YadifSingle(ref, frames[n - 1], frames[n], frames[n + 1], bTopField, bTFF);
+					bSame = bSame && out.data == ref.data;
+
+					Bob(bob, frames[n], bTopField);
+
+					sse[0] += SquaredError(out, t);
+					sse[1] += SquaredError(bob, t);
+					sse[2] += SquaredError(frames[n], t);
+					samples += t.data.size();
+				}
+			}
+			g_cpuid.m_flags = flags;
+
+			const double psnr[3] = {PSNR(sse[0], samples), PSNR(sse[1], samples), PSNR(sse[2], samples)};
+			const bool bPassed = bSame && psnr[0] >= s_patterns[p].minPSNR && psnr[0] - psnr[1] >= s_patterns[p].minOverBob;
+			printf("%-16s %-3s %9.2f %9.2f %9.2f %s\n", s_patterns[p].name, bTFF ? "tff" : "bff", psnr[0], psnr[1], psnr[2],
+				   !bSame ? "FAILED: sse2 or band output differs from the c path"
+				   : !bPassed ? "FAILED: below the limits" : "");
+			failed += !bPassed;
+		}
+	}
+
+	return failed;
+}
+
+static double Now()
+{
+	LARGE_INTEGER freq, t;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart / freq.QuadPart;
+}
+
+static void Bench()
+{
+	const CCpuID::flag_t flags = g_cpuid.m_flags;
+
+	std::vector<frame_t> frames;
+	for (int n = 0; n < 3; n++) {
+		frame_t first(BENCH_WIDTH, BENCH_HEIGHT), second(BENCH_WIDTH, BENCH_HEIGHT), frame(BENCH_WIDTH, BENCH_HEIGHT);
+		Render(first, Mixed, 2 * n);
+		Render(second, Mixed, 2 * n + 1);
+		Weave(frame, first, second);
+		frames.push_back(frame);
+	}
+	frame_t out(BENCH_WIDTH, BENCH_HEIGHT);
+	CYadifDeinterlacer yadif;
+
+	printf("\n%dx%d double rate, output frames per second\n", BENCH_WIDTH, BENCH_HEIGHT);
+	for (int run = 0; run < 3; run++) {
+		g_cpuid.m_flags = (CCpuID::flag_t)(run ? flags | CCpuID::sse2 : flags & ~CCpuID::sse2);
+
+		const double start = Now();
+		for (int i = 0; i < BENCH_FRAMES; i++) {
+			const bool bTopField = !(i & 1);
+			if (run < 2) {
+				YadifSingle(out, frames[0], frames[1], frames[2], bTopField, true);
+			} else {
+				yadif.Deinterlace(out.buf, out.pitch, frames[0].buf, frames[1].buf, frames[2].buf, frames[1].pitch,
+								  BENCH_WIDTH, BENCH_HEIGHT, bTopField, true);
+			}
+		}
+		const double fps = BENCH_FRAMES / (Now() - start);
+
+		static const char* names[3] = {"c, 1 thread", "sse2, 1 thread", "sse2, band threads"};
+		printf("%-20s %8.1f fps%s\n", names[run], fps, run == 2 ? (fps >= 60.0 ? "  (1080i60 -> 1080p60 fits)" : "  (too slow for 1080i60 -> 1080p60)") : "");
+	}
+
+	g_cpuid.m_flags = flags;
+}
+
+int main(int argc, char* argv[])
+{
+	bool bBench = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--bench")) {
+			bBench = true;
+		} else {
+			fprintf(stderr, "usage: %s [--bench]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	int failed = CheckQuality();
+
+	if (bBench) {
+		Bench();
+	}
+
+	return failed ? 1 : 0;
+}
@@ -29,47 +29,14 @@ CGolombBuffer::CGolombBuffer(BYTE* pBuffer, int nSize)
 	Reset();
 }
 
-UINT64 CGolombBuffer::BitRead(int nBits, bool fPeek)
+const BYTE* CGolombBuffer::BitData(size_t& size)
 {
-	//ASSERT(nBits >= 0 && nBits <= 64);
-
-	while (m_bitlen < nBits) {
-		m_bitbuff <<= 8;
-
-		if (m_nBitPos >= m_nSize) {
-			return 0;
-		}
-
-		*(BYTE*)&m_bitbuff = m_pBuffer[m_nBitPos++];
-		m_bitlen += 8;
-	}
-
-	int bitlen = m_bitlen - nBits;
-
-	UINT64 ret;
-	// The shift to 64 bits can give incorrect results.
-	// "The behavior is undefined if the right operand is negative, or greater than or equal to the length in bits of the promoted left operand."
-	if (nBits == 64) {
-		ret = m_bitbuff;
-	} else {
-		ret = (m_bitbuff >> bitlen) & ((1ui64 << nBits) - 1);
+	if (m_nBitPos >= m_nSize) {
+		return NULL;
 	}
 
-	if (!fPeek) {
-		m_bitbuff	&= ((1ui64 << bitlen) - 1);
-		m_bitlen	= bitlen;
-	}
-
-	return ret;
-}
-
-UINT64 CGolombBuffer::UExpGolombRead()
-{
-	int n = -1;
-	for (BYTE b = 0; !b; n++) {
-		b = (BYTE)BitRead(1);
-	}
-	return (1ui64 << n) - 1 + BitRead(n);
+	size = m_nSize - m_nBitPos;
+	return m_pBuffer + m_nBitPos;
 }
 
 unsigned int CGolombBuffer::UintGolombRead()
@@ -84,26 +51,12 @@ unsigned int CGolombBuffer::UintGolombRead()
 	return (1 << count) - 1 + value;
 }
 
-INT64 CGolombBuffer::SExpGolombRead()
-{
-	UINT64 k = UExpGolombRead();
-	return ((k&1) ? 1 : -1) * ((k + 1) >> 1);
-}
-
-void CGolombBuffer::BitByteAlign()
-{
-	m_bitlen &= ~7;
-}
-
-int CGolombBuffer::GetPos()
-{
-	return m_nBitPos - (m_bitlen>>3);
-}
-
 void CGolombBuffer::ReadBuffer(BYTE* pDest, int nSize)
 {
+	ASSERT ((m_bitlen & 7) == 0);
+	Seek(GetPos());
+
 	ASSERT (m_nBitPos + nSize <= m_nSize);
-	ASSERT (m_bitlen == 0);
 	nSize = min (nSize, m_nSize - m_nBitPos);
 
 	memcpy (pDest, m_pBuffer+m_nBitPos, nSize);
@@ -127,7 +80,7 @@ void CGolombBuffer::Reset(BYTE* pNewBuffer, int nNewSize)
 
 void CGolombBuffer::SkipBytes(int nCount)
 {
-	m_nBitPos  += nCount;
+	m_nBitPos	= GetPos() + nCount;
 	m_bitlen	= 0;
 	m_bitbuff	= 0;
 }
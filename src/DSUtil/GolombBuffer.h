@@ -20,16 +20,14 @@
 
 #pragma once
 
-class CGolombBuffer
+#include "BitReader.h"
+
+class CGolombBuffer : public CBitReader
 {
 public:
 	CGolombBuffer(BYTE* pBuffer, int nSize);
 
-	UINT64			BitRead(int nBits, bool fPeek = false);
-	UINT64			UExpGolombRead();
 	unsigned int	UintGolombRead();
-	INT64			SExpGolombRead();
-	void			BitByteAlign();
 
 	inline BYTE		ReadByte()		{ return (BYTE)BitRead (8); };
 	inline SHORT	ReadShort()		{ return (SHORT)BitRead (16); };
@@ -43,10 +41,10 @@ public:
 
 	void			SetSize(int nValue) { m_nSize = nValue; };
 	int				GetSize() const     { return m_nSize; };
-	int				RemainingSize() const { return m_nSize - m_nBitPos; };
-	bool			IsEOF() const { return m_nBitPos >= m_nSize; };
-	int				GetPos();
-	BYTE*			GetBufferPos() { return m_pBuffer + m_nBitPos; };
+	int				RemainingSize() const { return m_nSize - GetPos(); };
+	bool			IsEOF() const { return GetPos() >= m_nSize; };
+	int				GetPos() const { return m_nBitPos - (m_bitlen>>3); };
+	BYTE*			GetBufferPos() { return m_pBuffer + GetPos(); };
 
 	void			SkipBytes(int nCount);
 	void			Seek(int nPos);
@@ -55,6 +53,7 @@ private :
 	BYTE*		m_pBuffer;
 	int			m_nSize;
 	int			m_nBitPos;
-	int			m_bitlen;
-	INT64		m_bitbuff;
+
+	const BYTE*	BitData(size_t& size);
+	void		BitConsume(size_t size) { m_nBitPos += (int)size; };
 };
@@ -19,8 +19,123 @@
  */
 
 #include "stdafx.h"
+#include <typeinfo>
 #include "Packet.h"
 
+//
+// CPacketPool
+//
+
+CPacketPool::CPacketPool()
+	: m_nBytes(0)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CPacketPool::~CPacketPool()
+{
+	DbgLog((LOG_TRACE, 3, L"CPacketPool::~CPacketPool() : allocs = %I64u, reuses = %I64u, recycled = %I64u, released = %I64u",
+			m_stats.allocs, m_stats.reuses, m_stats.recycled, m_stats.released));
+
+	RemoveAll();
+}
+
+Packet* CPacketPool::Get(size_t size)
+{
+	if (size > 0) {
+		int n = 0;
+		while (n < PACKETPOOL_CLASSES && ((size_t)PACKETPOOL_MINSIZE << n) < size) {
+			n++;
+		}
+
+		if (n < PACKETPOOL_CLASSES) {
+			{
+				CAutoLock cAutoLock(&m_cs);
+
+				// the next larger class is still better than a new allocation
+				for (int i = n; i < min(n + 2, PACKETPOOL_CLASSES); i++) {
+					if (size_t count = m_free[i].GetCount()) {
+						Packet* p = m_free[i][count - 1];
+						m_free[i].RemoveAt(count - 1);
+						m_nBytes -= PACKETPOOL_MINSIZE << i;
+						m_stats.reuses++;
+
+						p->TrackNumber		= 0;
+						p->bDiscontinuity	= p->bSyncPoint = p->bAppendable = FALSE;
+						p->rtStart			= p->rtStop = INVALID_TIME;
+						p->SetCount(size);
+						return p;
+					}
+				}
+
+				m_stats.allocs++;
+			}
+
+			// reserve the whole class, so the packet can go back to it
+			Packet* p = DNew Packet();
+			p->SetCount(PACKETPOOL_MINSIZE << n);
+			p->SetCount(size);
+			p->nPoolClass	= n;
+			p->pPoolData	= p->GetData();
+			return p;
+		}
+	}
+
+	CAutoLock cAutoLock(&m_cs);
+	m_stats.allocs++;
+
+	Packet* p = DNew Packet();
+	p->SetCount(size);
+	return p;
+}
+
+void CPacketPool::Recycle(CAutoPtr<Packet>& p)
+{
+	// derived packets carry their own data, only plain ones are reused
+	if (!p || typeid(*p) != typeid(Packet)) {
+		return;
+	}
+
+	// the packet goes back to the class it was allocated for, unless the buffer was reallocated
+	// (grown by SetCount() when appending, freed by SetCount(0)) or the packet was not allocated by Get()
+	int n = p->nPoolClass;
+	if (n >= 0 && (p->GetData() != p->pPoolData || p->GetCount() > ((size_t)PACKETPOOL_MINSIZE << n))) {
+		n = -1;
+	}
+
+	if (p->pmt) {
+		DeleteMediaType(p->pmt);
+		p->pmt = NULL;
+	}
+
+	CAutoLock cAutoLock(&m_cs);
+
+	if (n < 0
+			|| m_free[n].GetCount() >= PACKETPOOL_MAXPACKETS
+			|| m_nBytes + (PACKETPOOL_MINSIZE << n) > PACKETPOOL_MAXBYTES) {
+		m_stats.released++;
+		p.Free();
+		return;
+	}
+
+	m_free[n].Add(p.Detach());
+	m_nBytes += PACKETPOOL_MINSIZE << n;
+	m_stats.recycled++;
+}
+
+void CPacketPool::RemoveAll()
+{
+	CAutoLock cAutoLock(&m_cs);
+
+	for (int i = 0; i < PACKETPOOL_CLASSES; i++) {
+		for (size_t j = 0; j < m_free[i].GetCount(); j++) {
+			delete m_free[i][j];
+		}
+		m_free[i].RemoveAll();
+	}
+	m_nBytes = 0;
+}
+
 //
 // CPacketQueue
 //
@@ -95,3 +210,126 @@ size_t CPacketQueue::GetSize()
 	CAutoLock cAutoLock(this);
 	return m_size;
 }
+
+//
+// CPacketRing
+//
+
+CPacketRing::CPacketRing(size_t capacity)
+	: m_head(0)
+	, m_tail(0)
+	, m_count(0)
+	, m_size(0)
+	, m_fWaiting(FALSE)
+{
+	size_t n = 16;
+	while (n < capacity) {
+		n <<= 1;
+	}
+
+	m_slots.Allocate(n);
+	memset(m_slots, 0, n * sizeof(slot_t));
+	m_mask = n - 1;
+}
+
+CPacketRing::~CPacketRing()
+{
+	RemoveAll();
+}
+
+bool CPacketRing::Add(CAutoPtr<Packet> p)
+{
+	LONG size = p ? (LONG)p->GetDataSize() : 0;
+
+	if (p && p->bAppendable && !p->bDiscontinuity && !p->pmt
+			&& p->rtStart == INVALID_TIME) {
+		// the previous packet can be extended as long as the consumer has not taken it yet
+		slot_t& s = m_slots[(m_tail - 1) & m_mask];
+		if (InterlockedCompareExchange(&s.state, Busy, Ready) == Ready) {
+			Packet* tail = s.p;
+			if (tail && tail->rtStart != INVALID_TIME) {
+				size_t oldsize = tail->GetCount();
+				size_t newsize = tail->GetCount() + p->GetCount();
+				tail->SetCount(newsize, max(1024, newsize)); // doubles the reserved buffer size
+				memcpy(tail->GetData() + oldsize, p->GetData(), p->GetCount());
+				InterlockedExchangeAdd(&m_size, size);
+				InterlockedExchange(&s.state, Ready);
+				return true;
+			}
+			InterlockedExchange(&s.state, Ready);
+		}
+	}
+
+	if (IsFull()) {
+		ASSERT(0);
+		return false;
+	}
+
+	slot_t& s = m_slots[m_tail & m_mask];
+	ASSERT(s.state == Empty);
+	s.p = p.Detach();
+	InterlockedExchangeAdd(&m_size, size);
+	InterlockedExchange(&s.state, Ready);
+	m_tail++;
+
+	InterlockedIncrement(&m_count);
+	if (m_fWaiting && InterlockedExchange(&m_fWaiting, FALSE)) {
+		m_evData.Set();
+	}
+
+	return true;
+}
+
+bool CPacketRing::Remove(CAutoPtr<Packet>& p)
+{
+	CAutoLock cAutoLock(&m_csRemove);
+
+	if (m_count == 0) {
+		return false;
+	}
+
+	slot_t& s = m_slots[m_head & m_mask];
+	while (InterlockedCompareExchange(&s.state, Busy, Ready) != Ready) {
+		YieldProcessor(); // Add() is appending to this packet
+	}
+
+	p.Attach(s.p);
+	s.p = NULL;
+	if (p) {
+		InterlockedExchangeAdd(&m_size, -(LONG)p->GetDataSize());
+	}
+	m_head++;
+	InterlockedExchange(&s.state, Empty);
+
+	InterlockedDecrement(&m_count);
+
+	return true;
+}
+
+void CPacketRing::RemoveAll()
+{
+	CAutoLock cAutoLock(&m_csRemove);
+
+	CAutoPtr<Packet> p;
+	while (Remove(p)) {
+		p.Free();
+	}
+}
+
+bool CPacketRing::WaitData(HANDLE hBreak, DWORD dwMilliseconds)
+{
+	if (m_count > 0) {
+		return true;
+	}
+
+	// announce the wait before the last check, Add() in between sets the event
+	InterlockedExchange(&m_fWaiting, TRUE);
+	if (m_count > 0) {
+		return true;
+	}
+
+	HANDLE handles[2] = {m_evData, hBreak};
+	WaitForMultipleObjects(hBreak ? 2 : 1, handles, FALSE, dwMilliseconds);
+
+	return m_count > 0;
+}
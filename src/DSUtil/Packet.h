@@ -30,9 +30,13 @@ public:
 	BOOL bDiscontinuity, bSyncPoint, bAppendable;
 	REFERENCE_TIME rtStart, rtStop;
 	AM_MEDIA_TYPE* pmt;
+	int nPoolClass;				// CPacketPool size class the buffer was allocated for, -1 when not from the pool
+	const BYTE* pPoolData;		// that buffer, a packet grown past its class has a new one
 	Packet() {
 		TrackNumber = 0;
 		pmt = NULL;
+		nPoolClass = -1;
+		pPoolData = NULL;
 		bDiscontinuity = bSyncPoint = bAppendable = FALSE;
 		rtStart = rtStop = INVALID_TIME;
 	}
@@ -48,6 +52,44 @@ public:
 	}
 };
 
+//
+// CPacketPool - recycles plain Packet objects together with their payload buffers
+//
+// Buffers are kept in power of two size classes, a packet taken from class n can hold
+// (PACKETPOOL_MINSIZE << n) bytes without a reallocation. Get() and Recycle() may run on different threads.
+// Only packets allocated by Get() whose buffer was not reallocated since go back to the pool,
+// so the pool always knows the real size of the memory it keeps.
+//
+
+#define PACKETPOOL_MINSIZE		256						// smallest size class
+#define PACKETPOOL_CLASSES		16						// up to 8 MB
+#define PACKETPOOL_MAXPACKETS	64						// per size class
+#define PACKETPOOL_MAXBYTES		(64 * 1024 * 1024)		// total memory kept in the pool
+
+class CPacketPool
+{
+	struct stats_t {
+		UINT64 allocs;		// packets allocated from the heap
+		UINT64 reuses;		// packets served from the pool
+		UINT64 recycled;	// packets returned to the pool
+		UINT64 released;	// packets freed because the pool was full or the packet was not its own
+	};
+
+	CCritSec m_cs;
+	CAtlArray<Packet*> m_free[PACKETPOOL_CLASSES];
+	size_t m_nBytes;
+	stats_t m_stats;	// only traced in the destructor
+
+public:
+	CPacketPool();
+	~CPacketPool();
+
+	// returns a packet with GetCount() == size, size 0 always allocates because SetCount(0) would free the buffer
+	Packet* Get(size_t size);
+	void Recycle(CAutoPtr<Packet>& p);
+	void RemoveAll();
+};
+
 class CPacketQueue
 	: public CCritSec
 	, protected CAutoPtrList<Packet>
@@ -63,3 +105,56 @@ public:
 	void RemoveAll();
 	size_t GetCount(), GetSize();
 };
+
+//
+// CPacketRing - bounded single producer / single consumer packet queue
+//
+// Add() is called from one thread only and never takes a lock, Remove() from one other thread.
+// RemoveAll() may run on a third thread, it is serialized with Remove() only.
+// The slot state keeps a packet from being removed while Add() appends to it.
+//
+
+class CPacketRing
+{
+	enum {
+		Empty,
+		Ready,
+		Busy
+	};
+	struct slot_t {
+		Packet* p;
+		volatile LONG state;
+	};
+
+	CAutoVectorPtr<slot_t> m_slots;
+	size_t m_mask;
+	size_t m_head, m_tail;
+
+	volatile LONG m_count;
+	volatile LONG m_size; // the splitter queues are capped far below 2 GB
+
+	CAMEvent m_evData;
+	volatile LONG m_fWaiting;
+	CCritSec m_csRemove;
+
+public:
+	CPacketRing(size_t capacity);
+	~CPacketRing();
+
+	bool Add(CAutoPtr<Packet> p);
+	bool Remove(CAutoPtr<Packet>& p);
+	void RemoveAll();
+
+	// waits until a packet is queued or hBreak is signaled
+	bool WaitData(HANDLE hBreak, DWORD dwMilliseconds = INFINITE);
+
+	size_t GetCount() const {
+		return (size_t)m_count;
+	}
+	size_t GetSize() const {
+		return (size_t)m_size;
+	}
+	bool IsFull() const {
+		return (size_t)m_count > m_mask;
+	}
+};
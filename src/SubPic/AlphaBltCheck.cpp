@@ -0,0 +1,211 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// AlphaBltCheck - pixel exactness and speed of the CMemSubPic::AlphaBlt() kernels, not part of the SubPic build
+//
+//   build it as a console program with the SubPic library (MemSubPic.cpp)
+//
+//   AlphaBltCheck           compare the SSE2 kernels with the C ones and the P010/P016 blend with an exact one
+//   AlphaBltCheck --bench   also time them on a 1920x1080 subtitle
+//
+// Exits with 1 when a kernel differs. The MSP_* types map to the kernels like AlphaBlt() does, the
+// RGBA/RGB24/RGB16/RGB15 targets and the chroma planes only have the C loops inside AlphaBlt().
+//
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+void AlphaBlt_RGB32_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch);
+void AlphaBlt_RGB32_SSE2(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch);
+void AlphaBlt_Y8_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch);
+void AlphaBlt_Y8_SSE2(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch);
+void AlphaBlt_Y16_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD mask);
+void AlphaBlt_Y16_SSE2(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD mask);
+
+typedef void (*alphablt_t)(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD mask);
+
+static void RGB32_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD)		{ AlphaBlt_RGB32_C(w, h, d, dstpitch, s, srcpitch); }
+static void RGB32_SSE2(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD)	{ AlphaBlt_RGB32_SSE2(w, h, d, dstpitch, s, srcpitch); }
+static void Y8_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD)			{ AlphaBlt_Y8_C(w, h, d, dstpitch, s, srcpitch); }
+static void Y8_SSE2(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD)		{ AlphaBlt_Y8_SSE2(w, h, d, dstpitch, s, srcpitch); }
+
+static const struct {
+	const char*	name;		// the MSP_* types using the kernel
+	int			dstbpp;		// bytes per target pixel
+	WORD		mask;
+	alphablt_t	c, sse2;
+} s_kernels[] = {
+	{"RGB32, AYUV",			4, 0,		RGB32_C,		RGB32_SSE2},
+	{"YV12, NV12, IYUV (Y)",	1, 0,		Y8_C,			Y8_SSE2},
+	{"P010 (Y)",			2, 0xffc0,	AlphaBlt_Y16_C,	AlphaBlt_Y16_SSE2},
+	{"P016 (Y)",			2, 0xffff,	AlphaBlt_Y16_C,	AlphaBlt_Y16_SSE2},
+};
+
+static unsigned s_rnd = 1;
+
+static unsigned Rand()
+{
+	s_rnd = s_rnd * 1103515245u + 12345u;
+	return s_rnd >> 8;
+}
+
+// a subtitle as Unlock() leaves it: mostly transparent (alpha 0xff), opaque text and antialiased edges
+static void FillSource(BYTE* s, size_t size)
+{
+	for (size_t i = 0; i < size; i += 4) {
+		unsigned r = Rand() % 10;
+		BYTE a = r < 7 ? 0xff : r < 8 ? 0 : (BYTE)Rand();
+		s[i + 0] = (BYTE)Rand();
+		s[i + 1] = (BYTE)Rand();
+		s[i + 2] = (BYTE)Rand();
+		s[i + 3] = a;
+	}
+}
+
+static void FillTarget(BYTE* d, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		d[i] = (BYTE)Rand();
+	}
+}
+
+// every width up to a few vectors, odd heights and misaligned rows
+static int CheckKernels()
+{
+	int failed = 0;
+
+	for (size_t k = 0; k < _countof(s_kernels); k++) {
+		bool bSame = true;
+
+		for (int w = 1; w <= 67 && bSame; w++) {
+			for (int h = 1; h <= 3 && bSame; h++) {
+				for (int offset = 0; offset < 4 && bSame; offset++) {
+					int srcpitch = w * 4 + 4 + offset * 4;
+					int dstpitch = w * s_kernels[k].dstbpp + 16 + offset;
+
+					std::vector<BYTE> s(srcpitch * h + 16), d1(dstpitch * h + 16), d2;
+					FillSource(&s[0], s.size() & ~3);
+					FillTarget(&d1[0], d1.size());
+					d2 = d1;
+
+					s_kernels[k].c(w, h, &d1[offset], dstpitch, &s[offset * 4], srcpitch, s_kernels[k].mask);
+					s_kernels[k].sse2(w, h, &d2[offset], dstpitch, &s[offset * 4], srcpitch, s_kernels[k].mask);
+
+					if (d1 != d2) {
+						printf("%-24s FAILED: SSE2 differs from C at w=%d h=%d offset=%d\n", s_kernels[k].name, w, h, offset);
+						bSame = false;
+						failed++;
+					}
+				}
+			}
+		}
+
+		if (bSame) {
+			printf("%-24s SSE2 == C\n", s_kernels[k].name);
+		}
+	}
+
+	return failed;
+}
+
+// the 16-bit blend against the exact value and against blending at 8-bit like before
+static int CheckPrecision()
+{
+	int failed = 0;
+	double maxErr16 = 0.0, maxErr8 = 0.0;
+
+	for (int a = 0; a < 0xff; a++) {
+		for (int y = 0; y < 0x100; y += 3) {
+			for (int v = 0x1000; v <= 0xeb00; v += 0x97) {
+				WORD d = (WORD)v;
+				BYTE s[4] = {0, (BYTE)y, 0, (BYTE)a};
+				AlphaBlt_Y16_C(1, 1, (BYTE*)&d, 2, s, 4, 0xffff);
+
+				double exact = (v - 0x1000) * a / 256.0 + (y << 8);
+				if (exact > 0xffff) {
+					continue; // clamped
+				}
+				double err16 = fabs(d - exact);
+				double err8 = fabs((((((v >> 8) - 0x10) * a) >> 8) + y) * 256.0 - exact);
+				if (err16 > maxErr16) {
+					maxErr16 = err16;
+				}
+				if (err8 > maxErr8) {
+					maxErr8 = err8;
+				}
+			}
+		}
+	}
+
+	bool bOk = maxErr16 < 1.0;
+	printf("P016 (Y) max error %.2f, %.2f when blended at 8-bit (16-bit units)%s\n", maxErr16, maxErr8, bOk ? "" : "  FAILED");
+	failed += !bOk;
+
+	return failed;
+}
+
+static double Now()
+{
+	LARGE_INTEGER freq, t;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart / freq.QuadPart;
+}
+
+static void Bench()
+{
+	const int w = 1920, h = 1080, runs = 50;
+
+	std::vector<BYTE> s(w * 4 * h), d(w * 4 * h);
+	FillSource(&s[0], s.size());
+
+	printf("\n%-24s %10s %10s %8s\n", "1920x1080", "C ms", "SSE2 ms", "speedup");
+	for (size_t k = 0; k < _countof(s_kernels); k++) {
+		double t[2];
+		for (int i = 0; i < 2; i++) {
+			alphablt_t f = i ? s_kernels[k].sse2 : s_kernels[k].c;
+			FillTarget(&d[0], d.size());
+			double start = Now();
+			for (int r = 0; r < runs; r++) {
+				f(w, h, &d[0], w * s_kernels[k].dstbpp, &s[0], w * 4, s_kernels[k].mask);
+			}
+			t[i] = (Now() - start) * 1000.0 / runs;
+		}
+		printf("%-24s %10.3f %10.3f %7.1fx\n", s_kernels[k].name, t[0], t[1], t[0] / t[1]);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool bBench = argc > 1 && !strcmp(argv[1], "--bench");
+
+	int failed = CheckKernels() + CheckPrecision();
+
+	if (bBench) {
+		Bench();
+	}
+
+	return failed ? 1 : 0;
+}
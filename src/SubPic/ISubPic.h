@@ -135,6 +135,20 @@ public IUnknown {
 	STDMETHOD_(SUBTITLE_TYPE, GetType) (POSITION pos) PURE;
 };
 
+//
+// ISubPicProvider2 - lets the queue keep the last rendered subpic and only redraw what changed
+//
+
+interface __declspec(uuid("F55636DE-667F-4278-9065-1DC6D2422D2B"))
+ISubPicProvider2 :
+public ISubPicProvider {
+	// rtFrom is the time of the last Render()/RenderRect() call, the picture of rtTo differs from it only inside rcChanged:
+	// S_OK and an empty rect if nothing changes, S_OK and the area RenderRect() has to redraw, S_FALSE if everything has to be rendered again
+	STDMETHOD (GetChangedRect) (REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, double fps, RECT& rcChanged /*[out]*/) PURE;
+	// like Render() but only the pixels inside rcClip are drawn, the caller has cleared them before
+	STDMETHOD (RenderRect) (SubPicDesc& spd, REFERENCE_TIME rt, double fps, const RECT& rcClip, RECT& bbox) PURE;
+};
+
 //
 // ISubPicQueue
 //
@@ -51,6 +51,9 @@ int y2c_gu[256];
 int y2c_gv[256];
 int y2c_rv[256];
 
+// 2^24 / (256 - alpha) rounded up, exact for the 8.8 fixed point un-premultiply of MSP_RGBA
+DWORD rgba_recip[257];
+
 const int cy_cy = int(255.0/219.0*65536+0.5);
 const int cy_cy2 = int(255.0/219.0*32768+0.5);
 
@@ -81,6 +84,10 @@ void ColorConvInit()
 		y2c_rv[i] = y2c_crv*(i-128);
 	}
 
+	for (i = 1; i <= 256; i++) {
+		rgba_recip[i] = ((1 << 24) + i - 1) / i;
+	}
+
 	fColorConvInitOK = true;
 }
 
@@ -373,6 +380,205 @@ void AlphaBlt_YUY2_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch)
 	}
 }
 
+// the blend kernels below work on the UYxA/ARGB source prepared by Unlock(),
+// the SSE2 versions do the columns that fill whole vectors and leave the rest to the C versions
+
+void AlphaBlt_RGB32_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch)
+{
+	for (ptrdiff_t j = 0; j < h; j++, s += srcpitch, d += dstpitch) {
+		BYTE* s2 = s;
+		BYTE* s2end = s2 + w*4;
+		BYTE* d2 = d;
+
+		for (; s2 < s2end; s2 += 4, d2 += 4) {
+			if (s2[3] < 0xff) {
+				d2[0] = ((d2[0]*s2[3])>>8) + s2[0];
+				d2[1] = ((d2[1]*s2[3])>>8) + s2[1];
+				d2[2] = ((d2[2]*s2[3])>>8) + s2[2];
+				d2[3] = 0;
+			}
+		}
+	}
+}
+
+void AlphaBlt_RGB32_SSE2(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch)
+{
+	const __m128i mm_zero	= _mm_setzero_si128();
+	const __m128i mm_alpha	= _mm_set1_epi32(0xff000000);
+	const __m128i mm_rgb	= _mm_set1_epi32(0x00ffffff);
+	const __m128i mm_00ff	= _mm_set1_epi16(0x00ff);
+
+	int w4 = w & ~3;
+
+	BYTE* s1 = s;
+	BYTE* d1 = d;
+	for (ptrdiff_t j = 0; j < h; j++, s1 += srcpitch, d1 += dstpitch) {
+		__m128i* s2 = (__m128i*)s1;
+		__m128i* s2end = s2 + w4/4;
+		__m128i* d2 = (__m128i*)d1;
+
+		for (; s2 < s2end; s2++, d2++) {
+			__m128i mm_s = _mm_loadu_si128(s2);
+			__m128i mm_keep = _mm_cmpeq_epi32(_mm_and_si128(mm_s, mm_alpha), mm_alpha);
+			if (_mm_movemask_epi8(mm_keep) == 0xffff) {
+				continue;
+			}
+
+			// alpha of each pixel in all of its 16-bit lanes
+			__m128i mm_a = _mm_srli_epi32(mm_s, 24);
+			mm_a = _mm_or_si128(mm_a, _mm_slli_epi32(mm_a, 16));
+			__m128i mm_alo = _mm_unpacklo_epi32(mm_a, mm_a);
+			__m128i mm_ahi = _mm_unpackhi_epi32(mm_a, mm_a);
+
+			__m128i mm_d = _mm_loadu_si128(d2);
+			__m128i mm_dlo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(mm_d, mm_zero), mm_alo), 8);
+			__m128i mm_dhi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(mm_d, mm_zero), mm_ahi), 8);
+			mm_dlo = _mm_and_si128(_mm_add_epi16(mm_dlo, _mm_unpacklo_epi8(mm_s, mm_zero)), mm_00ff);
+			mm_dhi = _mm_and_si128(_mm_add_epi16(mm_dhi, _mm_unpackhi_epi8(mm_s, mm_zero)), mm_00ff);
+
+			__m128i mm_r = _mm_and_si128(_mm_packus_epi16(mm_dlo, mm_dhi), mm_rgb);
+			mm_r = _mm_or_si128(_mm_and_si128(mm_keep, mm_d), _mm_andnot_si128(mm_keep, mm_r));
+			_mm_storeu_si128(d2, mm_r);
+		}
+	}
+
+	if (w4 < w) {
+		AlphaBlt_RGB32_C(w - w4, h, d + w4*4, dstpitch, s + w4*4, srcpitch);
+	}
+}
+
+// 8-bit luma plane of YV12/IYUV/NV12
+
+void AlphaBlt_Y8_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch)
+{
+	for (ptrdiff_t j = 0; j < h; j++, s += srcpitch, d += dstpitch) {
+		BYTE* s2 = s;
+		BYTE* s2end = s2 + w*4;
+		BYTE* d2 = d;
+
+		for (; s2 < s2end; s2 += 4, d2++) {
+			if (s2[3] < 0xff) {
+				d2[0] = (((d2[0] - 0x10) * s2[3]) >> 8) + s2[1];
+			}
+		}
+	}
+}
+
+void AlphaBlt_Y8_SSE2(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch)
+{
+	const __m128i mm_zero	= _mm_setzero_si128();
+	const __m128i mm_00ff	= _mm_set1_epi16(0x00ff);
+	const __m128i mm_ff32	= _mm_set1_epi32(0x000000ff);
+	const __m128i mm_0010	= _mm_set1_epi16(0x0010);
+
+	int w8 = w & ~7;
+
+	BYTE* s1 = s;
+	BYTE* d1 = d;
+	for (ptrdiff_t j = 0; j < h; j++, s1 += srcpitch, d1 += dstpitch) {
+		__m128i* s2 = (__m128i*)s1;
+		__m128i* s2end = s2 + w8/4;
+		BYTE* d2 = d1;
+
+		for (; s2 < s2end; s2 += 2, d2 += 8) {
+			__m128i mm_s0 = _mm_loadu_si128(s2);
+			__m128i mm_s1 = _mm_loadu_si128(s2 + 1);
+			__m128i mm_a = _mm_packs_epi32(_mm_srli_epi32(mm_s0, 24), _mm_srli_epi32(mm_s1, 24));
+			__m128i mm_keep = _mm_cmpeq_epi16(mm_a, mm_00ff);
+			if (_mm_movemask_epi8(mm_keep) == 0xffff) {
+				continue;
+			}
+			__m128i mm_y = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(mm_s0, 8), mm_ff32), _mm_and_si128(_mm_srli_epi32(mm_s1, 8), mm_ff32));
+
+			// ((d - 16) * a) >> 8 == mulhi((d - 16) * 2, a * 128), signed and exact
+			__m128i mm_d = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)d2), mm_zero);
+			__m128i mm_r = _mm_slli_epi16(_mm_sub_epi16(mm_d, mm_0010), 1);
+			mm_r = _mm_mulhi_epi16(mm_r, _mm_slli_epi16(mm_a, 7));
+			mm_r = _mm_and_si128(_mm_add_epi16(mm_r, mm_y), mm_00ff);
+			mm_r = _mm_or_si128(_mm_and_si128(mm_keep, mm_d), _mm_andnot_si128(mm_keep, mm_r));
+			_mm_storel_epi64((__m128i*)d2, _mm_packus_epi16(mm_r, mm_r));
+		}
+	}
+
+	if (w8 < w) {
+		AlphaBlt_Y8_C(w - w8, h, d + w8, dstpitch, s + w8*4, srcpitch);
+	}
+}
+
+// 16-bit samples of P010/P016, blended at full precision, the 8-bit source is scaled up instead of the target down
+
+static __forceinline WORD AlphaBlt16(int d, int offset, int a, int s16, WORD mask)
+{
+	int r = (((d - offset) * a) >> 8) + s16;
+	return (WORD)(max(0, min(r, 0xffff)) & mask);
+}
+
+void AlphaBlt_Y16_C(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD mask)
+{
+	for (ptrdiff_t j = 0; j < h; j++, s += srcpitch, d += dstpitch) {
+		BYTE* s2 = s;
+		BYTE* s2end = s2 + w*4;
+		WORD* d2 = (WORD*)d;
+
+		for (; s2 < s2end; s2 += 4, d2++) {
+			if (s2[3] < 0xff) {
+				d2[0] = AlphaBlt16(d2[0], 0x1000, s2[3], s2[1] << 8, mask);
+			}
+		}
+	}
+}
+
+void AlphaBlt_Y16_SSE2(int w, int h, BYTE* d, int dstpitch, BYTE* s, int srcpitch, WORD mask)
+{
+	const __m128i mm_zero	= _mm_setzero_si128();
+	const __m128i mm_00ff	= _mm_set1_epi16(0x00ff);
+	const __m128i mm_ff32	= _mm_set1_epi32(0x000000ff);
+	const __m128i mm_8000	= _mm_set1_epi16((short)0x8000);
+	const __m128i mm_8000_32 = _mm_set1_epi32(0x8000);
+	const __m128i mm_mask	= _mm_set1_epi16((short)mask);
+
+	int w8 = w & ~7;
+
+	BYTE* s1 = s;
+	BYTE* d1 = d;
+	for (ptrdiff_t j = 0; j < h; j++, s1 += srcpitch, d1 += dstpitch) {
+		__m128i* s2 = (__m128i*)s1;
+		__m128i* s2end = s2 + w8/4;
+		__m128i* d2 = (__m128i*)d1;
+
+		for (; s2 < s2end; s2 += 2, d2++) {
+			__m128i mm_s0 = _mm_loadu_si128(s2);
+			__m128i mm_s1 = _mm_loadu_si128(s2 + 1);
+			__m128i mm_a = _mm_packs_epi32(_mm_srli_epi32(mm_s0, 24), _mm_srli_epi32(mm_s1, 24));
+			__m128i mm_keep = _mm_cmpeq_epi16(mm_a, mm_00ff);
+			if (_mm_movemask_epi8(mm_keep) == 0xffff) {
+				continue;
+			}
+
+			// d * a - 0x1000 * a in 32-bit
+			__m128i mm_d = _mm_loadu_si128(d2);
+			__m128i mm_lo = _mm_mullo_epi16(mm_d, mm_a);
+			__m128i mm_hi = _mm_mulhi_epu16(mm_d, mm_a);
+			__m128i mm_r0 = _mm_sub_epi32(_mm_unpacklo_epi16(mm_lo, mm_hi), _mm_slli_epi32(_mm_unpacklo_epi16(mm_a, mm_zero), 12));
+			__m128i mm_r1 = _mm_sub_epi32(_mm_unpackhi_epi16(mm_lo, mm_hi), _mm_slli_epi32(_mm_unpackhi_epi16(mm_a, mm_zero), 12));
+
+			// + (y << 8), biased by -0x8000 so the signed pack clamps to 0..0xffff
+			__m128i mm_y0 = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(mm_s0, 8), mm_ff32), 8);
+			__m128i mm_y1 = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(mm_s1, 8), mm_ff32), 8);
+			mm_r0 = _mm_add_epi32(_mm_srai_epi32(mm_r0, 8), _mm_sub_epi32(mm_y0, mm_8000_32));
+			mm_r1 = _mm_add_epi32(_mm_srai_epi32(mm_r1, 8), _mm_sub_epi32(mm_y1, mm_8000_32));
+
+			__m128i mm_r = _mm_and_si128(_mm_xor_si128(_mm_packs_epi32(mm_r0, mm_r1), mm_8000), mm_mask);
+			mm_r = _mm_or_si128(_mm_and_si128(mm_keep, mm_d), _mm_andnot_si128(mm_keep, mm_r));
+			_mm_storeu_si128(d2, mm_r);
+		}
+	}
+
+	if (w8 < w) {
+		AlphaBlt_Y16_C(w - w8, h, d + w8*2, dstpitch, s + w8*4, srcpitch, mask);
+	}
+}
+
 STDMETHODIMP CMemSubPic::AlphaBlt(RECT* pSrc, RECT* pDst, SubPicDesc* pTarget)
 {
 	ASSERT(pTarget);
@@ -422,48 +628,36 @@ STDMETHODIMP CMemSubPic::AlphaBlt(RECT* pSrc, RECT* pDst, SubPicDesc* pTarget)
 		dst.pitch = -dst.pitch;
 	}
 
+	const bool bSSE2 = !!(g_cpuid.m_flags & CCpuID::sse2);
+
 	switch (dst.type) {
 		case MSP_P010:
-		case MSP_P016:
-			{
+		case MSP_P016: {
 				// Alpha blend the Y plane. Source is UYxAVYxA packed values (converted by Unlock())
-				// destination is P010/P016 surface.
-				int bitDepth = (dst.type == MSP_P016) ? 16 : 10;
+				// destination is P010/P016 surface, P010 keeps its 6 low bits clear.
+				WORD mask = (dst.type == MSP_P016) ? 0xffff : 0xffc0;
 
-				for(ptrdiff_t j = 0; j < h; j++, s += src.pitch, d += dst.pitch)
-				{
-					BYTE* s2 = s;
-					BYTE* s2end = s2 + w * 4;
-					WORD* d2 = (WORD*)d;
-					for(; s2 < s2end; s2 += 4, d2++)
-					{
-						if(s2[3] < 0xff)
-						{
-							// Convert current luminance to 8-bit value.
-							WORD dstLum = d2[0] >> 8;
-
-							// Perform calculation in 8-bit.
-							WORD result = (((dstLum - 0x10) * s2[3]) >> 8) + s2[1];
-
-							// Convert to 10/16 bit value.
-							d2[0] = result << 8;
-						}
-					}
+				if (bSSE2) {
+					AlphaBlt_Y16_SSE2(w, h, d, dst.pitch, s, src.pitch, mask);
+				} else {
+					AlphaBlt_Y16_C(w, h, d, dst.pitch, s, src.pitch, mask);
 				}
-
-				break;
 			}
+			break;
 		case MSP_RGBA:
+				ColorConvInit();
+
 				for (ptrdiff_t j = 0; j < h; j++, s += src.pitch, d += dst.pitch) {
 					BYTE* s2 = s;
 					BYTE* s2end = s2 + w * 4;
 					DWORD* d2 = (DWORD*)d;
 					for (; s2 < s2end; s2 += 4, d2++) {
 						if (s2[3] < 0xff) {
-							DWORD bd =0x00000100 -( (DWORD) s2[3]);
-							DWORD B = ((*((DWORD*)s2)&0x000000ff)<<8)/bd;
-							DWORD V = ((*((DWORD*)s2)&0x0000ff00)/bd)<<8;
-							DWORD R = (((*((DWORD*)s2)&0x00ff0000)>>8)/bd)<<16;
+							// x / (256 - alpha) as a multiply by the reciprocal
+							UINT64 rcp = rgba_recip[0x100 - s2[3]];
+							DWORD B = (DWORD)((((*((DWORD*)s2)&0x000000ff)<<8) * rcp) >> 24);
+							DWORD V = (DWORD)(((*((DWORD*)s2)&0x0000ff00) * rcp) >> 24)<<8;
+							DWORD R = (DWORD)((((*((DWORD*)s2)&0x00ff0000)>>8) * rcp) >> 24)<<16;
 							*d2 = B | V | R
 								  | (0xff000000-(*((DWORD*)s2)&0xff000000))&0xff000000;
 						}
@@ -471,27 +665,12 @@ STDMETHODIMP CMemSubPic::AlphaBlt(RECT* pSrc, RECT* pDst, SubPicDesc* pTarget)
 				}
 			break;
 		case MSP_RGB32:
-			case MSP_AYUV:
-					for (ptrdiff_t j = 0; j < h; j++, s += src.pitch, d += dst.pitch) {
-						BYTE* s2 = s;
-						BYTE* s2end = s2 + w*4;
-
-						DWORD* d2 = (DWORD*)d;
-						for (; s2 < s2end; s2 += 4, d2++) {
-#ifdef _WIN64
-							DWORD ia = 256-s2[3];
-							if (s2[3] < 0xff) {
-								*d2 = ((((*d2&0x00ff00ff)*s2[3])>>8) + (((*((DWORD*)s2)&0x00ff00ff)*ia)>>8)&0x00ff00ff)
-									  | ((((*d2&0x0000ff00)*s2[3])>>8) + (((*((DWORD*)s2)&0x0000ff00)*ia)>>8)&0x0000ff00);
-							}
-#else
-							if (s2[3] < 0xff) {
-								*d2 = ((((*d2&0x00ff00ff)*s2[3])>>8) + (*((DWORD*)s2)&0x00ff00ff)&0x00ff00ff)
-									  | ((((*d2&0x0000ff00)*s2[3])>>8) + (*((DWORD*)s2)&0x0000ff00)&0x0000ff00);
-							}
-#endif
-						}
-					}
+		case MSP_AYUV:
+			if (bSSE2) {
+				AlphaBlt_RGB32_SSE2(w, h, d, dst.pitch, s, src.pitch);
+			} else {
+				AlphaBlt_RGB32_C(w, h, d, dst.pitch, s, src.pitch);
+			}
 			break;
 		case MSP_RGB24:
 				for (ptrdiff_t j = 0; j < h; j++, s += src.pitch, d += dst.pitch) {
@@ -548,16 +727,11 @@ STDMETHODIMP CMemSubPic::AlphaBlt(RECT* pSrc, RECT* pDst, SubPicDesc* pTarget)
 		case MSP_YV12:
 		case MSP_NV12:
 		case MSP_IYUV:
-					for (ptrdiff_t j = 0; j < h; j++, s += src.pitch, d += dst.pitch) {
-						BYTE* s2 = s;
-						BYTE* s2end = s2 + w * 4;
-						BYTE* d2 = d;
-						for (; s2 < s2end; s2 += 4, d2++) {
-							if (s2[3] < 0xff) {
-								d2[0] = (((d2[0] - 0x10) * s2[3]) >> 8) + s2[1];
-							}
-						}
-					}
+			if (bSSE2) {
+				AlphaBlt_Y8_SSE2(w, h, d, dst.pitch, s, src.pitch);
+			} else {
+				AlphaBlt_Y8_C(w, h, d, dst.pitch, s, src.pitch);
+			}
 			break;
 		default:
 				return E_NOTIMPL;
@@ -570,6 +744,7 @@ STDMETHODIMP CMemSubPic::AlphaBlt(RECT* pSrc, RECT* pDst, SubPicDesc* pTarget)
 		// so we need to sample the current row and the row after for source color info.
 		// Source is UYxAVYxA.
 		int h2 = h / 2;
+		WORD mask = (dst.type == MSP_P016) ? 0xffff : 0xffc0;
 
 		BYTE* ss = (BYTE*)src.bits + src.pitch * rs.top + rs.left * 4;
 		BYTE* dstUV = (BYTE*)dst.bits + dst.pitch * dst.h;
@@ -592,21 +767,9 @@ STDMETHODIMP CMemSubPic::AlphaBlt(RECT* pSrc, RECT* pDst, SubPicDesc* pTarget)
 				unsigned int ia = (srcData[3] + srcData[3 + src.pitch] + srcData[7] + srcData[7 + src.pitch]) >> 2;
 
 				if (ia < 255) {
-					WORD result;
-
-					// Convert U to 8-bit
-					WORD dstUV = dstData[0] >> 8;
-
-					// Alpha blend U
-					result = (((dstUV - 0x80) * ia) >> 8) + ((srcData[0] + srcData[src.pitch]) >> 1);
-
-					// Convert U to 10/16 bit value;
-					dstData[0] = result << 8;
-
-					// Repeat for V
-					dstUV = dstData[1] >> 8;
-					result = (((dstUV - 0x80) * ia) >> 8) + ((srcData[4] + srcData[4 + src.pitch]) >> 1);
-					dstData[1] = result << 8;
+					// the average of the two source rows scaled to 16-bit keeps its half bit
+					dstData[0] = AlphaBlt16(dstData[0], 0x8000, ia, (srcData[0] + srcData[src.pitch]) << 7, mask);
+					dstData[1] = AlphaBlt16(dstData[1], 0x8000, ia, (srcData[4] + srcData[4 + src.pitch]) << 7, mask);
 				}
 			}
 		}
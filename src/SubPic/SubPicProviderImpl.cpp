@@ -37,6 +37,7 @@ STDMETHODIMP CSubPicProviderImpl::NonDelegatingQueryInterface(REFIID riid, void*
 {
 	return
 		QI(ISubPicProvider)
+		QI(ISubPicProvider2)
 		__super::NonDelegatingQueryInterface(riid, ppv);
 }
 
@@ -23,7 +23,7 @@
 
 #include "ISubPic.h"
 
-class CSubPicProviderImpl : public CUnknown, public ISubPicProvider
+class CSubPicProviderImpl : public CUnknown, public ISubPicProvider2
 {
 protected:
 	CCritSec* m_pLock;
@@ -50,4 +50,13 @@ public:
 	STDMETHODIMP GetTextureSize (POSITION pos, SIZE& MaxTextureSize, SIZE& VirtualSize, POINT& VirtualTopLeft) {
 		return E_NOTIMPL;
 	};
+
+	// ISubPicProvider2
+
+	STDMETHODIMP GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, double fps, RECT& rcChanged) {
+		return S_FALSE;
+	};
+	STDMETHODIMP RenderRect(SubPicDesc& spd, REFERENCE_TIME rt, double fps, const RECT& rcClip, RECT& bbox) {
+		return E_NOTIMPL;
+	};
 };
@@ -38,6 +38,9 @@ CSubPicQueueImpl::CSubPicQueueImpl(ISubPicAllocator* pAllocator, HRESULT* phr)
 	, m_rtNow(0)
 	, m_fps(DEFAULT_FPS)
 	, m_rtTimePerFrame(std::llround(10000000.0 / DEFAULT_FPS))
+	, m_rtLastRender(0)
+	, m_nLastRenderEpoch(0)
+	, m_nRenderEpoch(0)
 {
 	if (phr) {
 		*phr = S_OK;
@@ -105,6 +108,61 @@ STDMETHODIMP CSubPicQueueImpl::SetTime(REFERENCE_TIME rtNow)
 
 // private
 
+HRESULT CSubPicQueueImpl::RenderChanged(ISubPic* pSubPic, ISubPicProvider2* pSubPicProvider2, REFERENCE_TIME rtRender, double fps)
+{
+	SubPicDesc spd;
+	if (pSubPic != m_pLastSubPic || m_nLastRenderEpoch != m_nRenderEpoch
+			|| FAILED(pSubPic->GetDesc(spd))
+			|| spd.type != m_spdLast.type || spd.w != m_spdLast.w || spd.h != m_spdLast.h
+			|| CRect(spd.vidrect) != CRect(m_spdLast.vidrect)) {
+		return S_FALSE;
+	}
+
+	CRect rcChanged;
+	if (pSubPicProvider2->GetChangedRect(m_rtLastRender, rtRender, fps, rcChanged) != S_OK) {
+		return S_FALSE;
+	}
+
+	if (rcChanged.IsRectEmpty()) {
+		// same picture, the subpic is used as it is
+		return S_OK;
+	}
+
+	// even edges, the YUV conversion of CMemSubPic::Unlock() doesn't reach outside of the rect then
+	rcChanged.left &= ~1;
+	rcChanged.top &= ~1;
+	rcChanged.right = (rcChanged.right + 1) & ~1;
+	rcChanged.bottom = (rcChanged.bottom + 1) & ~1;
+	rcChanged &= CRect(0, 0, spd.w, spd.h);
+
+	CRect rcDirty;
+	pSubPic->GetDirtyRect(&rcDirty);
+
+	HRESULT hr = pSubPic->SetDirtyRect(rcChanged);
+	if (SUCCEEDED(hr)) {
+		hr = pSubPic->ClearDirtyRect(0xFF000000);
+	}
+	if (SUCCEEDED(hr)) {
+		hr = pSubPic->Lock(spd);
+	}
+	if (SUCCEEDED(hr)) {
+		CRect r(0,0,0,0);
+		hr = pSubPicProvider2->RenderRect(spd, rtRender, fps, rcChanged, r);
+
+		pSubPic->Unlock(rcChanged);
+
+		rcDirty |= r;
+		pSubPic->SetDirtyRect(rcDirty);
+
+		if (SUCCEEDED(hr)) {
+			m_rtLastRender = rtRender;
+		}
+	}
+
+	// the subpic is half cleared on failure, a full render repairs it
+	return SUCCEEDED(hr) ? S_OK : E_FAIL;
+}
+
 HRESULT CSubPicQueueImpl::RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REFERENCE_TIME rtStop, double fps, BOOL bIsAnimated)
 {
 	CheckPointer(pSubPic, E_POINTER);
@@ -116,6 +174,26 @@ HRESULT CSubPicQueueImpl::RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REF
 		return hr;
 	}
 
+	REFERENCE_TIME rtRender = rtStart;
+	if (bIsAnimated) {
+		// This is some sort of hack to avoid rendering the wrong frame
+		// when the start time is slightly mispredicted by the queue
+		rtRender = (rtStart + rtStop) / 2;
+	} else {
+		rtRender += (rtStop - rtStart - 1);
+	}
+
+	CComQIPtr<ISubPicProvider2> pSubPicProvider2 = pSubPicProvider;
+	if (pSubPicProvider2 && RenderChanged(pSubPic, pSubPicProvider2, rtRender, fps) == S_OK) {
+		pSubPic->SetStart(rtStart);
+		pSubPic->SetStop(rtStop);
+
+		return S_OK;
+	}
+
+	LONG nEpoch = m_nRenderEpoch;
+	m_pLastSubPic.Release();
+
 	hr = pSubPic->ClearDirtyRect(0xFF000000);
 	SubPicDesc spd;
 	if (SUCCEEDED(hr)) {
@@ -123,20 +201,19 @@ HRESULT CSubPicQueueImpl::RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REF
 	}
 	if (SUCCEEDED(hr)) {
 		CRect r(0,0,0,0);
-		REFERENCE_TIME rtRender = rtStart;
-		if (bIsAnimated) {
-			// This is some sort of hack to avoid rendering the wrong frame
-			// when the start time is slightly mispredicted by the queue
-			rtRender = (rtStart + rtStop) / 2;
-		} else {
-			rtRender += (rtStop - rtStart - 1);
-		}
 		hr = pSubPicProvider->Render(spd, rtRender, fps, r);
 
 		pSubPic->SetStart(rtStart);
 		pSubPic->SetStop(rtStop);
 
 		pSubPic->Unlock(r);
+
+		if (SUCCEEDED(hr)) {
+			m_pLastSubPic = pSubPic;
+			m_spdLast = spd;
+			m_rtLastRender = rtRender;
+			m_nLastRenderEpoch = nEpoch;
+		}
 	}
 
 	return hr;
@@ -224,6 +301,8 @@ STDMETHODIMP CSubPicQueue::Invalidate(REFERENCE_TIME rtInvalidate)
 	m_rtInvalidate = rtInvalidate;
 	m_rtNowLast = LONGLONG_ERROR;
 
+	InvalidateLastRender();
+
 	{
 		std::lock_guard<std::mutex> lock(m_mutexSubpic);
 		if (m_pSubPic && m_pSubPic->GetStop() > rtInvalidate) {
@@ -676,6 +755,8 @@ STDMETHODIMP CSubPicQueueNoThread::Invalidate(REFERENCE_TIME rtInvalidate)
 {
 	CAutoLock cQueueLock(&m_csLock);
 
+	InvalidateLastRender();
+
 	if (m_pSubPic && m_pSubPic->GetStop() > rtInvalidate) {
 		m_pSubPic = NULL;
 	}
@@ -85,6 +85,15 @@ private:
 	CCritSec m_csSubPicProvider;
 	std::shared_ptr<SubPicProviderWithSharedLock> m_pSubPicProviderWithSharedLock;
 
+	// the subpic the last RenderTo() drew on, the next one only redraws what the provider reports as changed
+	CComPtr<ISubPic> m_pLastSubPic;
+	SubPicDesc m_spdLast;
+	REFERENCE_TIME m_rtLastRender;
+	LONG m_nLastRenderEpoch;
+	volatile LONG m_nRenderEpoch; // bumped by InvalidateLastRender()
+
+	HRESULT RenderChanged(ISubPic* pSubPic, ISubPicProvider2* pSubPicProvider2, REFERENCE_TIME rtRender, double fps);
+
 protected:
 	double m_fps;
 	REFERENCE_TIME m_rtTimePerFrame;
@@ -99,6 +108,11 @@ protected:
 
 	HRESULT RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REFERENCE_TIME rtStop, double fps, BOOL bIsAnimated);
 
+	// the content of the subpics can't be reused anymore, called on Invalidate()
+	void InvalidateLastRender() {
+		InterlockedIncrement(&m_nRenderEpoch);
+	}
+
 public:
 	CSubPicQueueImpl(ISubPicAllocator* pAllocator, HRESULT* phr);
 	virtual ~CSubPicQueueImpl();
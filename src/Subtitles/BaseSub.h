@@ -39,6 +39,9 @@ public:
 	virtual void			CleanOld(REFERENCE_TIME rt) PURE;
 	virtual HRESULT			EndOfStream() PURE;
 
+	// see ISubPicProvider2::GetChangedRect(), by default everything is rendered again
+	virtual HRESULT			GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, RECT& rcChanged) { return S_FALSE; }
+
 protected :
 	SUBTITLE_TYPE			m_nType;
 
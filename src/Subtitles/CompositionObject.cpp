@@ -23,14 +23,56 @@
 #include "../DSUtil/GolombBuffer.h"
 #include <d3d9types.h>
 
+volatile LONG CompositionObject::s_nRunsBytes = 0;
+
 CompositionObject::CompositionObject()
 {
 	memsetd(m_Colors, 0xFF000000, sizeof(m_Colors));
 }
 
+CompositionObject::CompositionObject(const CompositionObject& obj)
+	: m_object_id_ref(obj.m_object_id_ref)
+	, m_window_id_ref(obj.m_window_id_ref)
+	, m_object_cropped_flag(obj.m_object_cropped_flag)
+	, m_forced_on_flag(obj.m_forced_on_flag)
+	, m_version_number(obj.m_version_number)
+	, m_horizontal_position(obj.m_horizontal_position)
+	, m_vertical_position(obj.m_vertical_position)
+	, m_width(obj.m_width)
+	, m_height(obj.m_height)
+	, m_cropping_horizontal_position(obj.m_cropping_horizontal_position)
+	, m_cropping_vertical_position(obj.m_cropping_vertical_position)
+	, m_cropping_width(obj.m_cropping_width)
+	, m_cropping_height(obj.m_cropping_height)
+	, m_compositionNumber(obj.m_compositionNumber)
+	, m_rtStart(obj.m_rtStart)
+	, m_rtStop(obj.m_rtStop)
+	, m_nColorNumber(obj.m_nColorNumber)
+	, m_nPaletteHash(obj.m_nPaletteHash)
+{
+	memcpy(m_Colors, obj.m_Colors, sizeof(m_Colors));
+
+	// the runs stay with the source, they are charged to s_nRunsBytes only once
+	if (obj.m_pRLEData) {
+		SetRLEData(obj.m_pRLEData, obj.m_nRLEDataSize, obj.m_nRLEDataSize);
+		m_nRLEHash	= obj.m_nRLEHash;
+		m_bRLEHash	= obj.m_bRLEHash;
+	}
+}
+
 CompositionObject::~CompositionObject()
 {
 	SAFE_DELETE_ARRAY(m_pRLEData);
+	ReleaseRuns();
+}
+
+#define FNV_OFFSET_BASIS 14695981039346656037ui64
+
+static void HashBytes(UINT64& hash, const void* p, size_t len)
+{
+	for (const BYTE* b = (const BYTE*)p, *e = b + len; b < e; b++) {
+		hash = (hash ^ *b) * 1099511628211ui64;
+	}
 }
 
 void CompositionObject::SetPalette(int nNbEntry, HDMV_PALETTE* pPalette, bool bIsHD, bool bIsRGB)
@@ -47,15 +89,41 @@ void CompositionObject::SetPalette(int nNbEntry, HDMV_PALETTE* pPalette, bool bI
 			}
 		}
 	}
+
+	m_nPaletteHash = FNV_OFFSET_BASIS;
+	HashBytes(m_nPaletteHash, m_Colors, sizeof(m_Colors));
+}
+
+UINT64 CompositionObject::GetRenderHash() const
+{
+	UINT64 hash = FNV_OFFSET_BASIS;
+
+	const SHORT geometry[] = {
+		m_horizontal_position, m_vertical_position, m_width, m_height,
+		m_object_cropped_flag, m_cropping_horizontal_position, m_cropping_vertical_position, m_cropping_width, m_cropping_height
+	};
+	HashBytes(hash, geometry, sizeof(geometry));
+	HashBytes(hash, &m_nColorNumber, sizeof(m_nColorNumber));
+	HashBytes(hash, &m_nPaletteHash, sizeof(m_nPaletteHash));
+	if (m_bRLEHash) {
+		HashBytes(hash, &m_nRLEHash, sizeof(m_nRLEHash));
+	} else {
+		// not queued through PredecodeHdmv()
+		HashBytes(hash, m_pRLEData, m_nRLEDataSize);
+	}
+
+	return hash;
 }
 
 void CompositionObject::SetRLEData(const BYTE* pBuffer, int nSize, int nTotalSize)
 {
 	SAFE_DELETE_ARRAY(m_pRLEData);
+	ReleaseRuns();
 
 	m_pRLEData		= DNew BYTE[nTotalSize];
 	m_nRLEDataSize	= nTotalSize;
 	m_nRLEPos		= min(nSize, nTotalSize);
+	m_bRLEHash		= false;
 
 	memcpy(m_pRLEData, pBuffer, min(nSize, nTotalSize));
 }
@@ -66,7 +134,74 @@ void CompositionObject::AppendRLEData(const BYTE* pBuffer, int nSize)
 	if (m_nRLEPos + nSize <= m_nRLEDataSize) {
 		memcpy(m_pRLEData + m_nRLEPos, pBuffer, nSize);
 		m_nRLEPos += nSize;
+		m_bRLEHash = false;
+		ReleaseRuns();
+	}
+}
+
+bool CompositionObject::HaveRuns(SHORT nX, SHORT nY) const
+{
+	return m_nRunsBytes
+		   && m_runsX == nX && m_runsY == nY
+		   && m_runsWidth == m_width && m_runsHeight == m_height;
+}
+
+void CompositionObject::KeepRuns(PaletteRuns& runs, SHORT nX, SHORT nY)
+{
+	ReleaseRuns();
+
+	size_t nBytes = sizeof(PaletteRun) * runs.size() + 1;
+	if (InterlockedExchangeAdd(&s_nRunsBytes, (LONG)nBytes) + (LONG)nBytes > COMPOSITION_RUNS_MAX_BYTES) {
+		// over the budget, the runs are thrown away after painting
+		InterlockedExchangeAdd(&s_nRunsBytes, -(LONG)nBytes);
+		return;
+	}
+
+	m_runs.swap(runs);
+	m_nRunsBytes	= nBytes;
+	m_runsX			= nX;
+	m_runsY			= nY;
+	m_runsWidth		= m_width;
+	m_runsHeight	= m_height;
+}
+
+void CompositionObject::ReleaseRuns()
+{
+	if (m_nRunsBytes) {
+		ASSERT(s_nRunsBytes >= (LONG)m_nRunsBytes);
+		InterlockedExchangeAdd(&s_nRunsBytes, -(LONG)m_nRunsBytes);
+		m_nRunsBytes = 0;
 	}
+	PaletteRuns().swap(m_runs);
+}
+
+void CompositionObject::PaintRuns(SubPicDesc& spd, const PaletteRuns& runs)
+{
+	for (size_t i = 0, n = runs.size(); i < n; i++) {
+		const PaletteRun& run = runs[i];
+		FillSolidRect(spd, run.x, run.y, run.count, 1, m_Colors[run.index]);
+	}
+}
+
+void CompositionObject::PredecodeHdmv()
+{
+	if (!m_pRLEData || !IsRLEComplete()) {
+		return;
+	}
+
+	if (!m_bRLEHash) {
+		m_nRLEHash = FNV_OFFSET_BASIS;
+		HashBytes(m_nRLEHash, m_pRLEData, m_nRLEDataSize);
+		m_bRLEHash = true;
+	}
+
+	if (HaveRuns(m_horizontal_position, m_vertical_position)) {
+		return;
+	}
+
+	PaletteRuns runs;
+	DecodeHdmv(runs);
+	KeepRuns(runs, m_horizontal_position, m_vertical_position);
 }
 
 void CompositionObject::RenderHdmv(SubPicDesc& spd, SubPicDesc* spdResized)
@@ -75,6 +210,19 @@ void CompositionObject::RenderHdmv(SubPicDesc& spd, SubPicDesc* spdResized)
 		return;
 	}
 
+	if (HaveRuns(m_horizontal_position, m_vertical_position)) {
+		PaintRuns(spdResized ? *spdResized : spd, m_runs);
+		return;
+	}
+
+	PaletteRuns runs;
+	DecodeHdmv(runs);
+	PaintRuns(spdResized ? *spdResized : spd, runs);
+	KeepRuns(runs, m_horizontal_position, m_vertical_position);
+}
+
+void CompositionObject::DecodeHdmv(PaletteRuns& runs)
+{
 	CGolombBuffer	GBuffer (m_pRLEData, m_nRLEDataSize);
 	BYTE			bTemp;
 	BYTE			bSwitch;
@@ -114,7 +262,7 @@ void CompositionObject::RenderHdmv(SubPicDesc& spd, SubPicDesc* spdResized)
 
 		if (nCount > 0) {
 			if (nPaletteIndex != 0xFF) {	// Fully transparent (section 9.14.4.2.2.1.1)
-				FillSolidRect(spdResized ? *spdResized : spd, nX, nY, nCount, 1, m_Colors[nPaletteIndex]);
+				runs.push_back({nX, nY, nCount, nPaletteIndex});
 			}
 			nX += nCount;
 		} else {
@@ -130,6 +278,19 @@ void CompositionObject::RenderDvb(SubPicDesc& spd, SHORT nX, SHORT nY, SubPicDes
 		return;
 	}
 
+	if (HaveRuns(nX, nY)) {
+		PaintRuns(spdResized ? *spdResized : spd, m_runs);
+		return;
+	}
+
+	PaletteRuns runs;
+	DecodeDvb(runs, nX, nY);
+	PaintRuns(spdResized ? *spdResized : spd, runs);
+	KeepRuns(runs, nX, nY);
+}
+
+void CompositionObject::DecodeDvb(PaletteRuns& runs, SHORT nX, SHORT nY)
+{
 	CGolombBuffer	gb(m_pRLEData, m_nRLEDataSize);
 	SHORT			sTopFieldLength;
 	SHORT			sBottomFieldLength;
@@ -137,11 +298,11 @@ void CompositionObject::RenderDvb(SubPicDesc& spd, SHORT nX, SHORT nY, SubPicDes
 	sTopFieldLength		= gb.ReadShort();
 	sBottomFieldLength	= gb.ReadShort();
 
-	DvbRenderField(spdResized ? *spdResized : spd, gb, nX, nY,   sTopFieldLength);
-	DvbRenderField(spdResized ? *spdResized : spd, gb, nX, nY+1, sBottomFieldLength);
+	DvbRenderField(runs, gb, nX, nY,   sTopFieldLength);
+	DvbRenderField(runs, gb, nX, nY+1, sBottomFieldLength);
 }
 
-void CompositionObject::DvbRenderField(SubPicDesc& spd, CGolombBuffer& gb, SHORT nXStart, SHORT nYStart, SHORT nLength)
+void CompositionObject::DvbRenderField(PaletteRuns& runs, CGolombBuffer& gb, SHORT nXStart, SHORT nYStart, SHORT nLength)
 {
 	//FillSolidRect (spd, 0,  0, 300, 10, 0xFFFF0000);	// Red opaque
 	//FillSolidRect (spd, 0, 10, 300, 10, 0xCC00FF00);	// Green 80%
@@ -154,13 +315,13 @@ void CompositionObject::DvbRenderField(SubPicDesc& spd, CGolombBuffer& gb, SHORT
 		BYTE	bType	= gb.ReadByte();
 		switch (bType) {
 			case 0x10 :
-				Dvb2PixelsCodeString(spd, gb, nX, nY);
+				Dvb2PixelsCodeString(runs, gb, nX, nY);
 				break;
 			case 0x11 :
-				Dvb4PixelsCodeString(spd, gb, nX, nY);
+				Dvb4PixelsCodeString(runs, gb, nX, nY);
 				break;
 			case 0x12 :
-				Dvb8PixelsCodeString(spd, gb, nX, nY);
+				Dvb8PixelsCodeString(runs, gb, nX, nY);
 				break;
 			case 0x20 :
 				gb.SkipBytes (2);
@@ -182,7 +343,7 @@ void CompositionObject::DvbRenderField(SubPicDesc& spd, CGolombBuffer& gb, SHORT
 	}
 }
 
-void CompositionObject::Dvb2PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb, SHORT& nX, SHORT& nY)
+void CompositionObject::Dvb2PixelsCodeString(PaletteRuns& runs, CGolombBuffer& gb, SHORT& nX, SHORT& nY)
 {
 	BYTE	bTemp;
 	BYTE	nPaletteIndex = 0;
@@ -230,7 +391,7 @@ void CompositionObject::Dvb2PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb,
 		}
 
 		if (nCount>0) {
-			FillSolidRect(spd, nX, nY, nCount, 1, m_Colors[nPaletteIndex]);
+			runs.push_back({nX, nY, nCount, nPaletteIndex});
 			nX += nCount;
 		}
 	}
@@ -238,7 +399,7 @@ void CompositionObject::Dvb2PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb,
 	gb.BitByteAlign();
 }
 
-void CompositionObject::Dvb4PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb, SHORT& nX, SHORT& nY)
+void CompositionObject::Dvb4PixelsCodeString(PaletteRuns& runs, CGolombBuffer& gb, SHORT& nX, SHORT& nY)
 {
 	BYTE	bTemp;
 	BYTE	nPaletteIndex = 0;
@@ -293,7 +454,7 @@ void CompositionObject::Dvb4PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb,
 #endif
 
 		if (nCount>0) {
-			FillSolidRect(spd, nX, nY, nCount, 1, m_Colors[nPaletteIndex]);
+			runs.push_back({nX, nY, nCount, nPaletteIndex});
 			nX += nCount;
 		}
 	}
@@ -301,7 +462,7 @@ void CompositionObject::Dvb4PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb,
 	gb.BitByteAlign();
 }
 
-void CompositionObject::Dvb8PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb, SHORT& nX, SHORT& nY)
+void CompositionObject::Dvb8PixelsCodeString(PaletteRuns& runs, CGolombBuffer& gb, SHORT& nX, SHORT& nY)
 {
 	BYTE	bTemp;
 	BYTE	nPaletteIndex = 0;
@@ -333,7 +494,7 @@ void CompositionObject::Dvb8PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb,
 		}
 
 		if (nCount>0) {
-			FillSolidRect(spd, nX, nY, nCount, 1, m_Colors[nPaletteIndex]);
+			runs.push_back({nX, nY, nCount, nPaletteIndex});
 			nX += nCount;
 		}
 	}
@@ -32,6 +32,9 @@ struct HDMV_PALETTE {
 
 class CGolombBuffer;
 
+// memory all the objects may use to keep their decoded runs, over it they are decoded on every render
+#define COMPOSITION_RUNS_MAX_BYTES	(32 * 1024 * 1024)
+
 class CompositionObject : Rasterizer
 {
 public :
@@ -57,6 +60,7 @@ public :
 	REFERENCE_TIME	m_rtStop						= INVALID_TIME;
 
 	CompositionObject();
+	CompositionObject(const CompositionObject& obj); // copies the RLE data but not the decoded runs
 	~CompositionObject();
 
 	void				SetRLEData(const BYTE* pBuffer, int nSize, int nTotalSize);
@@ -67,19 +71,20 @@ public :
 
 	void				RenderHdmv(SubPicDesc& spd, SubPicDesc* spdResized);
 	void				RenderDvb(SubPicDesc& spd, SHORT nX, SHORT nY, SubPicDesc* spdResized);
+
+	// decodes the RLE data ahead of the first render and hashes it, called when the object is queued
+	void				PredecodeHdmv();
 	void				RenderXSUB(SubPicDesc& spd);
 
 	void				SetPalette(int nNbEntry, HDMV_PALETTE* pPalette, bool bIsHD, bool bIsRGB = false);
 	const bool			HavePalette() { return m_nColorNumber > 0; };
 
-	CompositionObject* Copy() {
-		CompositionObject* pCompositionObject = DNew CompositionObject(*this);
-		if (m_pRLEData) {
-			pCompositionObject->m_pRLEData = NULL;
-			pCompositionObject->SetRLEData(m_pRLEData, m_nRLEDataSize, m_nRLEDataSize);
-		}
+	// FNV-1a of everything the object is painted from, equal hashes give the same pixels,
+	// the palette and the RLE data enter through the hashes kept by SetPalette() and PredecodeHdmv()
+	UINT64				GetRenderHash() const;
 
-		return pCompositionObject;
+	CompositionObject* Copy() {
+		return DNew CompositionObject(*this);
 	}
 
 private :
@@ -89,8 +94,39 @@ private :
 	int		m_nColorNumber	= 0;
 	DWORD	m_Colors[256];
 
-	void	DvbRenderField(SubPicDesc& spd, CGolombBuffer& gb, SHORT nXStart, SHORT nYStart, SHORT nLength);
-	void	Dvb2PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb, SHORT& nX, SHORT& nY);
-	void	Dvb4PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb, SHORT& nX, SHORT& nY);
-	void	Dvb8PixelsCodeString(SubPicDesc& spd, CGolombBuffer& gb, SHORT& nX, SHORT& nY);
+	UINT64	m_nPaletteHash	= 0;		// of m_Colors, by SetPalette()
+	UINT64	m_nRLEHash		= 0;		// of the complete RLE data, by PredecodeHdmv()
+	bool	m_bRLEHash		= false;
+
+	// the RLE data decoded into runs of one palette index, the palette is only applied when painting
+	// so palette updates don't need a new decode
+	struct PaletteRun {
+		SHORT	x, y, count;
+		BYTE	index;
+	};
+	typedef std::vector<PaletteRun> PaletteRuns;
+
+	PaletteRuns	m_runs;
+	size_t		m_nRunsBytes	= 0;	// part of s_nRunsBytes owned by m_runs
+	SHORT		m_runsX			= 0;	// origin and size the runs were decoded with
+	SHORT		m_runsY			= 0;
+	SHORT		m_runsWidth		= 0;
+	SHORT		m_runsHeight	= 0;
+
+	static volatile LONG s_nRunsBytes;
+
+	bool	HaveRuns(SHORT nX, SHORT nY) const;
+	void	KeepRuns(PaletteRuns& runs, SHORT nX, SHORT nY);
+	void	ReleaseRuns();
+	void	PaintRuns(SubPicDesc& spd, const PaletteRuns& runs);
+
+	CompositionObject& operator = (const CompositionObject&);
+
+	void	DecodeHdmv(PaletteRuns& runs);
+	void	DecodeDvb(PaletteRuns& runs, SHORT nX, SHORT nY);
+
+	void	DvbRenderField(PaletteRuns& runs, CGolombBuffer& gb, SHORT nXStart, SHORT nYStart, SHORT nLength);
+	void	Dvb2PixelsCodeString(PaletteRuns& runs, CGolombBuffer& gb, SHORT& nX, SHORT& nY);
+	void	Dvb4PixelsCodeString(PaletteRuns& runs, CGolombBuffer& gb, SHORT& nX, SHORT& nY);
+	void	Dvb8PixelsCodeString(PaletteRuns& runs, CGolombBuffer& gb, SHORT& nX, SHORT& nY);
 };
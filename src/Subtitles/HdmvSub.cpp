@@ -178,6 +178,14 @@ HRESULT CHdmvSub::ParseSample(BYTE* pData, int lSampleLen, REFERENCE_TIME rtStar
 	return hr;
 }
 
+bool CHdmvSub::IsRenderable(CompositionObject* pObject, REFERENCE_TIME rt)
+{
+	return pObject && rt >= pObject->m_rtStart && rt < pObject->m_rtStop
+		   && pObject->GetRLEDataSize() && pObject->m_width > 0 && pObject->m_height > 0
+		   && m_VideoDescriptor.nVideoWidth >= (pObject->m_horizontal_position + pObject->m_width)
+		   && m_VideoDescriptor.nVideoHeight >= (pObject->m_vertical_position + pObject->m_height);
+}
+
 void CHdmvSub::Render(SubPicDesc& spd, REFERENCE_TIME rt, RECT& bbox)
 {
 	bbox.left	= LONG_MAX;
@@ -185,59 +193,91 @@ void CHdmvSub::Render(SubPicDesc& spd, REFERENCE_TIME rt, RECT& bbox)
 	bbox.right	= 0;
 	bbox.bottom	= 0;
 
+	m_rtRendered = INVALID_TIME;
+	m_renderedHashes.RemoveAll();
+
 	POSITION pos = m_pObjects.GetHeadPosition();
 	while (pos) {
 		CompositionObject* pObject = m_pObjects.GetAt (pos);
 
-		if (pObject && rt >= pObject->m_rtStart && rt < pObject->m_rtStop) {
-			if (pObject->GetRLEDataSize() && pObject->m_width > 0 && pObject->m_height > 0 &&
-					m_VideoDescriptor.nVideoWidth >= (pObject->m_horizontal_position + pObject->m_width) &&
-					m_VideoDescriptor.nVideoHeight >= (pObject->m_vertical_position + pObject->m_height)) {
+		if (IsRenderable(pObject, rt)) {
+			if (g_bForcedSubtitle && !pObject->m_forced_on_flag) {
+				TRACE_HDMVSUB(_T("CHdmvSub::Render() : skip non forced subtitle - forced = %d, %I64d = %s"), pObject->m_forced_on_flag, rt, ReftimeToString(rt));
+				return;
+			}
 
-				if (g_bForcedSubtitle && !pObject->m_forced_on_flag) {
-					TRACE_HDMVSUB(_T("CHdmvSub::Render() : skip non forced subtitle - forced = %d, %I64d = %s"), pObject->m_forced_on_flag, rt, ReftimeToString(rt));
-					return;
-				}
+			if (!pObject->HavePalette() && m_DefaultCLUT.Palette) {
+				pObject->SetPalette(m_DefaultCLUT.pSize, m_DefaultCLUT.Palette, m_VideoDescriptor.nVideoWidth > 720);
+			}
 
-				if (!pObject->HavePalette() && m_DefaultCLUT.Palette) {
-					pObject->SetPalette(m_DefaultCLUT.pSize, m_DefaultCLUT.Palette, m_VideoDescriptor.nVideoWidth > 720);
-				}
+			if (!pObject->HavePalette()) {
+				TRACE_HDMVSUB(_T("CHdmvSub::Render() : The palette is missing - cancel rendering\n"));
+				return;
+			}
 
-				if (!pObject->HavePalette()) {
-					TRACE_HDMVSUB(_T("CHdmvSub::Render() : The palette is missing - cancel rendering\n"));
-					return;
-				}
+			bbox.left	= min(pObject->m_horizontal_position, bbox.left);
+			bbox.top	= min(pObject->m_vertical_position, bbox.top);
+			bbox.right	= max(pObject->m_horizontal_position + pObject->m_width, bbox.right);
+			bbox.bottom	= max(pObject->m_vertical_position + pObject->m_height, bbox.bottom);
 
-				bbox.left	= min(pObject->m_horizontal_position, bbox.left);
-				bbox.top	= min(pObject->m_vertical_position, bbox.top);
-				bbox.right	= max(pObject->m_horizontal_position + pObject->m_width, bbox.right);
-				bbox.bottom	= max(pObject->m_vertical_position + pObject->m_height, bbox.bottom);
+			bbox.left	= bbox.left > 0 ? bbox.left : 0;
+			bbox.top	= bbox.top > 0 ? bbox.top : 0;
+			if (m_VideoDescriptor.nVideoWidth > spd.w) {
+				bbox.left	= MulDiv(bbox.left, spd.w, m_VideoDescriptor.nVideoWidth);
+				bbox.right	= MulDiv(bbox.right, spd.w, m_VideoDescriptor.nVideoWidth);
+			}
+			if (m_VideoDescriptor.nVideoHeight > spd.h) {
+				bbox.top	= MulDiv(bbox.top, spd.h, m_VideoDescriptor.nVideoHeight);
+				bbox.bottom	= MulDiv(bbox.bottom, spd.h, m_VideoDescriptor.nVideoHeight);
+			}
 
-				bbox.left	= bbox.left > 0 ? bbox.left : 0;
-				bbox.top	= bbox.top > 0 ? bbox.top : 0;
-				if (m_VideoDescriptor.nVideoWidth > spd.w) {
-					bbox.left	= MulDiv(bbox.left, spd.w, m_VideoDescriptor.nVideoWidth);
-					bbox.right	= MulDiv(bbox.right, spd.w, m_VideoDescriptor.nVideoWidth);
-				}
-				if (m_VideoDescriptor.nVideoHeight > spd.h) {
-					bbox.top	= MulDiv(bbox.top, spd.h, m_VideoDescriptor.nVideoHeight);
-					bbox.bottom	= MulDiv(bbox.bottom, spd.h, m_VideoDescriptor.nVideoHeight);
-				}
+			TRACE_HDMVSUB(_T("CHdmvSub::Render() : size = %ld, ObjRes = %dx%d, SPDRes = %dx%d, %I64d = %s\n"),
+							pObject->GetRLEDataSize(),
+							pObject->m_width, pObject->m_height, spd.w, spd.h,
+							rt, ReftimeToString(rt));
 
-				TRACE_HDMVSUB(_T("CHdmvSub::Render() : size = %ld, ObjRes = %dx%d, SPDRes = %dx%d, %I64d = %s\n"),
-								pObject->GetRLEDataSize(),
-								pObject->m_width, pObject->m_height, spd.w, spd.h,
-								rt, ReftimeToString(rt));
+			InitSpd(spd, m_VideoDescriptor.nVideoWidth, m_VideoDescriptor.nVideoHeight);
+			pObject->RenderHdmv(spd, m_bResizedRender ? &m_spd : NULL);
 
-				InitSpd(spd, m_VideoDescriptor.nVideoWidth, m_VideoDescriptor.nVideoHeight);
-				pObject->RenderHdmv(spd, m_bResizedRender ? &m_spd : NULL);
-			}
+			m_renderedHashes.Add(pObject->GetRenderHash());
 		}
 
 		m_pObjects.GetNext(pos);
 	}
 
 	FinalizeRender(spd);
+
+	m_rtRendered = rt;
+}
+
+HRESULT CHdmvSub::GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, RECT& rcChanged)
+{
+	if (rtFrom != m_rtRendered) {
+		return S_FALSE;
+	}
+
+	// the same objects with the same palette at the same place, as sent again by many discs
+	size_t i = 0;
+	POSITION pos = m_pObjects.GetHeadPosition();
+	while (pos) {
+		CompositionObject* pObject = m_pObjects.GetNext(pos);
+
+		if (IsRenderable(pObject, rtTo)) {
+			if (!pObject->HavePalette() || (g_bForcedSubtitle && !pObject->m_forced_on_flag)
+					|| i >= m_renderedHashes.GetCount() || pObject->GetRenderHash() != m_renderedHashes[i]) {
+				return S_FALSE;
+			}
+			i++;
+		}
+	}
+
+	if (i != m_renderedHashes.GetCount()) {
+		return S_FALSE;
+	}
+
+	SetRectEmpty(&rcChanged);
+
+	return S_OK;
 }
 
 HRESULT CHdmvSub::GetTextureSize(POSITION pos, SIZE& MaxTextureSize, SIZE& VideoSize, POINT& VideoTopLeft)
@@ -335,6 +375,9 @@ void CHdmvSub::ParsePresentationSegment(CGolombBuffer* pGBuffer, REFERENCE_TIME
 									m_pCurrentWindow->Objects[i]->m_rtStart, m_pCurrentWindow->Objects[i]->m_rtStop,
 									ReftimeToString(m_pCurrentWindow->Objects[i]->m_rtStart), ReftimeToString(m_pCurrentWindow->Objects[i]->m_rtStop));
 
+					// the segments arrive ahead of their presentation time, decode now rather than in the first Render()
+					pObject->PredecodeHdmv();
+
 					m_pObjects.AddTail (m_pCurrentWindow->Objects[i]);
 				} else {
 					delete m_pCurrentWindow->Objects[i];
@@ -95,6 +95,7 @@ public:
 	HRESULT					ParseSample(BYTE* pData, int lSampleLen, REFERENCE_TIME rtStart, REFERENCE_TIME rtStop);
 
 	virtual void			Render(SubPicDesc& spd, REFERENCE_TIME rt, RECT& bbox);
+	virtual HRESULT			GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, RECT& rcChanged);
 	virtual HRESULT			GetTextureSize (POSITION pos, SIZE& MaxTextureSize, SIZE& VideoSize, POINT& VideoTopLeft);
 	virtual void			Reset();
 
@@ -120,6 +121,12 @@ private :
 	HDMV_CLUT						m_CLUT[256];
 	HDMV_CLUT						m_DefaultCLUT;
 
+	// the objects the last Render() painted, a presentation that repeats them can keep the picture
+	REFERENCE_TIME					m_rtRendered		= INVALID_TIME;
+	CAtlArray<UINT64>				m_renderedHashes;
+
+	bool				IsRenderable(CompositionObject* pObject, REFERENCE_TIME rt);
+
 	void				ParsePresentationSegment(CGolombBuffer* pGBuffer, REFERENCE_TIME rtTime);
 	void				ParsePalette(CGolombBuffer* pGBuffer, USHORT nSize);
 	void				ParseObject(CGolombBuffer* pGBuffer, USHORT nUnitSize);
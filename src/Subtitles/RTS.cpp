@@ -67,6 +67,7 @@ CWord::CWord(STSStyle& style, CStringW str, int ktype, int kstart, int kend, dou
 			 RenderingCaches& renderingCaches)
 	: m_style(style)
 	, m_str(str)
+	, m_textDimsHash(CTextDimsKey::Hash(str, style))
 	, m_width(0)
 	, m_ascent(0)
 	, m_descent(0)
@@ -102,6 +103,7 @@ bool CWord::Append(CWord* w)
 
 	m_fWhiteSpaceChar = m_fWhiteSpaceChar && w->m_fWhiteSpaceChar;
 	m_str += w->m_str;
+	m_textDimsHash = CTextDimsKey::Hash(m_str, m_style);
 	m_width += w->m_width;
 
 	m_fDrawn = false;
@@ -118,8 +120,19 @@ void CWord::Paint(const CPoint& p, const CPoint& org)
 
 	COverlayKey overlayKey(this, p, org);
 
-	if (m_renderingCaches.overlayCache.Lookup(overlayKey, m_pOverlayData)) {
-		m_fDrawn = m_renderingCaches.outlineCache.Lookup(overlayKey, m_pOutlineData);
+	// only the caches and CreatePath() are locked, the words can be rasterized in parallel
+	bool bOverlayFound, bOutlineFound = false;
+	{
+		CAutoLock cAutoLock(&m_renderingCaches.csLock);
+
+		bOverlayFound = m_renderingCaches.overlayCache.Lookup(overlayKey, m_pOverlayData);
+		if (bOverlayFound || !m_fDrawn) {
+			bOutlineFound = m_renderingCaches.outlineCache.Lookup(overlayKey, m_pOutlineData);
+		}
+	}
+
+	if (bOverlayFound) {
+		m_fDrawn = bOutlineFound;
 		if (m_style.borderStyle == 1) {
 			if (!CreateOpaqueBox()) {
 				return;
@@ -127,15 +140,18 @@ void CWord::Paint(const CPoint& p, const CPoint& org)
 		}
 	} else {
 		if (!m_fDrawn) {
-			if (m_renderingCaches.outlineCache.Lookup(overlayKey, m_pOutlineData)) {
+			if (bOutlineFound) {
 				if (m_style.borderStyle == 1) {
 					if (!CreateOpaqueBox()) {
 						return;
 					}
 				}
 			} else {
-				if (!CreatePath()) {
-					return;
+				{
+					CAutoLock cAutoLock(&m_renderingCaches.csLock);
+					if (!CreatePath()) {
+						return;
+					}
 				}
 
 				Transform(CPoint((org.x - p.x) * 8, (org.y - p.y) * 8));
@@ -150,6 +166,7 @@ void CWord::Paint(const CPoint& p, const CPoint& org)
 
 					if (!m_pEllipse || m_pEllipse->GetXRadius() != rx || m_pEllipse->GetYRadius() != ry) {
 						CEllipseKey ellipseKey(rx, ry);
+						CAutoLock cAutoLock(&m_renderingCaches.csLock);
 						if (!m_renderingCaches.ellipseCache.Lookup(ellipseKey, m_pEllipse)) {
 							m_pEllipse = std::make_shared<CEllipse>(rx, ry);
 
@@ -166,17 +183,20 @@ void CWord::Paint(const CPoint& p, const CPoint& org)
 					}
 				}
 
+				CAutoLock cAutoLock(&m_renderingCaches.csLock);
 				m_renderingCaches.outlineCache.SetAt(overlayKey, m_pOutlineData);
 			}
 
 			m_fDrawn = true;
 
-			if (!Rasterize(p.x & 7, p.y & 7, m_style.fBlur, m_style.fGaussianBlur)) {
+			if (!Rasterize(p.x & 7, p.y & 7, m_style.fBlur, m_style.fGaussianBlur, m_renderingCaches.bFastBlur)) {
 				return;
 			}
+			CAutoLock cAutoLock(&m_renderingCaches.csLock);
 			m_renderingCaches.overlayCache.SetAt(overlayKey, m_pOverlayData);
 		} else if ((m_p.x & 7) != (p.x & 7) || (m_p.y & 7) != (p.y & 7)) {
-			Rasterize(p.x & 7, p.y & 7, m_style.fBlur, m_style.fGaussianBlur);
+			Rasterize(p.x & 7, p.y & 7, m_style.fBlur, m_style.fGaussianBlur, m_renderingCaches.bFastBlur);
+			CAutoLock cAutoLock(&m_renderingCaches.csLock);
 			m_renderingCaches.overlayCache.SetAt(overlayKey, m_pOverlayData);
 		}
 	}
@@ -220,6 +240,7 @@ bool CWord::CreateOpaqueBox()
 			   (m_width + w + 4) / 8, (m_ascent + m_descent + h + 4) / 8,
 			   -(w + 4) / 8, (m_ascent + m_descent + h + 4) / 8);
 
+	CAutoLock cAutoLock(&m_renderingCaches.csLock); // the polygon path cache
 	m_pOpaqueBox = DNew CPolygon(style, str, 0, 0, 0, 1.0, 1.0, 0, m_renderingCaches);
 
 	return !!m_pOpaqueBox;
@@ -424,6 +445,28 @@ void CWord::Transform_SSE2(const CPoint &org )
 	}
 }
 
+size_t CRenderingCacheCostTraits<SSATagsList>::GetCost(const SSATagsList& value)
+{
+	size_t cost = sizeof(CAtlList<SSATag>);
+
+	POSITION pos = value->GetHeadPosition();
+	while (pos) {
+		const SSATag& tag = value->GetNext(pos);
+		cost += sizeof(SSATag)
+				+ tag.params.GetCount() * sizeof(CStringW)
+				+ tag.paramsInt.GetCount() * sizeof(int)
+				+ tag.paramsReal.GetCount() * sizeof(double);
+		for (size_t i = 0; i < tag.params.GetCount(); i++) {
+			cost += tag.params[i].GetLength() * sizeof(WCHAR);
+		}
+		if (tag.subTagsList) {
+			cost += GetCost(tag.subTagsList);
+		}
+	}
+
+	return cost;
+}
+
 // CText
 
 CText::CText(STSStyle& style, CStringW str, int ktype, int kstart, int kend, double scalex, double scaley,
@@ -434,7 +477,7 @@ CText::CText(STSStyle& style, CStringW str, int ktype, int kstart, int kend, dou
 		m_fWhiteSpaceChar = true;
 	}
 
-	CTextDimsKey textDimsKey(m_str, m_style);
+	CTextDimsKey textDimsKey(m_str, m_style, m_textDimsHash);
 	CTextDims textDims;
 	if (!renderingCaches.textDimsCache.Lookup(textDimsKey, textDims)) {
 		CMyFont font(m_style);
@@ -946,6 +989,34 @@ void CLine::Compact()
 	}
 }
 
+void CLine::GetPaintJobs(CAtlArray<CWordPaintJob>& jobs, CPoint p, CPoint org)
+{
+	// the same positions and in the same order as PaintShadow(), PaintOutline() and PaintBody() use them
+	POSITION pos = GetHeadPosition();
+	while (pos) {
+		CWord* w = GetNext(pos);
+
+		if (w->m_fLineBreak) {
+			return;
+		}
+
+		CWordPaintJob job;
+		job.w		= w;
+		job.org		= org;
+		job.count	= 0;
+
+		if (w->m_style.shadowDepthX != 0 || w->m_style.shadowDepthY != 0) {
+			job.p[job.count++] = CPoint(p.x + (int)(w->m_style.shadowDepthX+0.5),
+										p.y + m_ascent - w->m_ascent + (int)(w->m_style.shadowDepthY+0.5));
+		}
+		job.p[job.count++] = CPoint(p.x, p.y + m_ascent - w->m_ascent);
+
+		jobs.Add(job);
+
+		p.x += w->m_width;
+	}
+}
+
 CRect CLine::PaintShadow(SubPicDesc& spd, CRect& clipRect, BYTE* pAlphaMask, CPoint p, CPoint org, int time, int alpha)
 {
 	CRect bbox(0, 0, 0, 0);
@@ -1550,9 +1621,15 @@ CRenderedTextSubtitle::CRenderedTextSubtitle(CCritSec* pLock)
 	, m_kend(0)
 	, m_nPolygon(0)
 	, m_polygonBaselineOffset(0)
+	, m_rtLastRender(0)
+	, m_rcRenderClip(0, 0, 0, 0)
 {
 	m_size = CSize(0, 0);
 
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	m_nRenderThreads = min((int)si.dwNumberOfProcessors, RTS_MAX_RENDER_THREADS);
+
 	if (g_hDC_refcnt == 0) {
 		g_hDC = CreateCompatibleDC(NULL);
 		SetBkMode(g_hDC, TRANSPARENT);
@@ -1661,6 +1738,7 @@ void CRenderedTextSubtitle::OnChanged()
 	}
 
 	m_subtitleCache.RemoveAll();
+	m_lastRenderSubs.RemoveAll();
 
 	m_sla.Empty();
 }
@@ -1679,6 +1757,16 @@ bool CRenderedTextSubtitle::Init(CSize size, const CRect& vidrect)
 
 void CRenderedTextSubtitle::Deinit()
 {
+#ifdef _DEBUG
+	CRenderingCacheStats stats;
+	m_renderingCaches.overlayCache.GetStats(stats);
+	DbgLog((LOG_TRACE, 3, L"CRenderedTextSubtitle::Deinit() : overlay cache - %Iu hits, %Iu misses, %Iu evictions, %Iu entries, %Iu bytes",
+			stats.nHits, stats.nMisses, stats.nEvictions, stats.nCount, stats.nBytes));
+	m_renderingCaches.outlineCache.GetStats(stats);
+	DbgLog((LOG_TRACE, 3, L"CRenderedTextSubtitle::Deinit() : outline cache - %Iu hits, %Iu misses, %Iu evictions, %Iu entries, %Iu bytes",
+			stats.nHits, stats.nMisses, stats.nEvictions, stats.nCount, stats.nBytes));
+#endif
+
 	POSITION pos = m_subtitleCache.GetStartPosition();
 	while (pos) {
 		int i;
@@ -1688,6 +1776,7 @@ void CRenderedTextSubtitle::Deinit()
 	}
 
 	m_subtitleCache.RemoveAll();
+	m_lastRenderSubs.RemoveAll();
 
 	m_sla.Empty();
 
@@ -2888,6 +2977,67 @@ static int lscomp(const void* ls1, const void* ls2)
 	return ret;
 }
 
+struct paint_words_t {
+	CAtlArray<CWordPaintJob>* jobs;
+	volatile LONG next;
+	volatile LONG pending;
+	CAMEvent* evDone;
+};
+
+static void PaintWordJobs(paint_words_t* ctx)
+{
+	for (;;) {
+		LONG i = InterlockedIncrement(&ctx->next) - 1;
+		if (i >= (LONG)ctx->jobs->GetCount()) {
+			break;
+		}
+
+		// all positions of a word on one thread and in order, the result is the same as painting them serially
+		const CWordPaintJob& job = ctx->jobs->GetAt(i);
+		for (int j = 0; j < job.count; j++) {
+			job.w->Paint(job.p[j], job.org);
+		}
+	}
+}
+
+static DWORD WINAPI PaintWordsThreadProc(LPVOID lpParam)
+{
+	paint_words_t* ctx = (paint_words_t*)lpParam;
+
+	PaintWordJobs(ctx);
+
+	if (InterlockedDecrement(&ctx->pending) == 0) {
+		ctx->evDone->Set();
+	}
+
+	return 0;
+}
+
+void CRenderedTextSubtitle::PaintWords(CAtlArray<CWordPaintJob>& jobs)
+{
+	// outline, widening and blur of the words go to the system thread pool,
+	// the following CLine::Paint*() calls find the results in the caches and only draw them in z-order
+	int nThreads = (int)min((size_t)m_nRenderThreads, jobs.GetCount());
+	if (nThreads < 2) {
+		return;
+	}
+
+	CAMEvent evDone(TRUE);
+	paint_words_t ctx = {&jobs, 0, nThreads - 1, &evDone};
+
+	for (int i = 1; i < nThreads; i++) {
+		if (!QueueUserWorkItem(PaintWordsThreadProc, &ctx, WT_EXECUTEDEFAULT)) {
+			if (InterlockedDecrement(&ctx.pending) == 0) {
+				evDone.Set();
+			}
+		}
+	}
+
+	PaintWordJobs(&ctx);
+
+	evDone.Wait();
+}
+
 STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, double fps, RECT& bbox)
 {
 	CRect bbox2(0,0,0,0);
@@ -2896,6 +3046,15 @@ STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 		Init(CSize(spd.w, spd.h), spd.vidrect);
 	}
 
+	// RenderRect() redraws a part of the last picture, the subtitles and their areas stay the same
+	const bool bPartial = !m_rcRenderClip.IsRectEmpty();
+
+	m_rtLastRender = rt;
+	if (!bPartial) {
+		m_lastRenderSubs.RemoveAll();
+		m_subtitleBBox.RemoveAll();
+	}
+
 	int t = (int)(rt / 10000);
 
 	int segment;
@@ -2904,6 +3063,10 @@ STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 		return S_FALSE;
 	}
 
+	if (!bPartial) {
+		m_lastRenderSubs.Copy(stss->subs);
+	}
+
 	// clear any cached subs that is behind current time
 	{
 		POSITION pos = m_subtitleCache.GetStartPosition();
@@ -3109,6 +3272,34 @@ STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 		iclipRect[2] = CRect(clipRect.right, clipRect.top, spd.w, clipRect.bottom);
 		iclipRect[3] = CRect(0, clipRect.bottom, spd.w, spd.h);
 
+		if (bPartial) {
+			clipRect &= m_rcRenderClip;
+			for (int k = 0; k < _countof(iclipRect); k++) {
+				iclipRect[k] &= m_rcRenderClip;
+			}
+		}
+
+		CRect bboxSub(0, 0, 0, 0);
+
+		if (m_nRenderThreads > 1) {
+			CAtlArray<CWordPaintJob> jobs;
+
+			pos = s->GetHeadPosition();
+			while (pos) {
+				CLine* l = s->GetNext(pos);
+
+				p.x = (s->m_scrAlignment%3) == 1 ? org.x
+					  : (s->m_scrAlignment%3) == 0 ? org.x - l->m_width
+					  :							   org.x - (l->m_width/2);
+				l->GetPaintJobs(jobs, p, org2);
+				p.y += l->m_ascent + l->m_descent;
+			}
+
+			PaintWords(jobs);
+
+			p = p2;
+		}
+
 		pos = s->GetHeadPosition();
 		while (pos) {
 			CLine* l = s->GetNext(pos);
@@ -3117,12 +3308,12 @@ STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 				  : (s->m_scrAlignment%3) == 0 ? org.x - l->m_width
 				  :							   org.x - (l->m_width/2);
 			if (s->m_clipInverse) {
-				bbox2 |= l->PaintShadow(spd, iclipRect[0], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintShadow(spd, iclipRect[1], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintShadow(spd, iclipRect[2], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintShadow(spd, iclipRect[3], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintShadow(spd, iclipRect[0], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintShadow(spd, iclipRect[1], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintShadow(spd, iclipRect[2], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintShadow(spd, iclipRect[3], pAlphaMask, p, org2, m_time, alpha);
 			} else {
-				bbox2 |= l->PaintShadow(spd, clipRect, pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintShadow(spd, clipRect, pAlphaMask, p, org2, m_time, alpha);
 			}
 			p.y += l->m_ascent + l->m_descent;
 		}
@@ -3137,12 +3328,12 @@ STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 				  : (s->m_scrAlignment%3) == 0 ? org.x - l->m_width
 				  :							   org.x - (l->m_width/2);
 			if (s->m_clipInverse) {
-				bbox2 |= l->PaintOutline(spd, iclipRect[0], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintOutline(spd, iclipRect[1], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintOutline(spd, iclipRect[2], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintOutline(spd, iclipRect[3], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintOutline(spd, iclipRect[0], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintOutline(spd, iclipRect[1], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintOutline(spd, iclipRect[2], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintOutline(spd, iclipRect[3], pAlphaMask, p, org2, m_time, alpha);
 			} else {
-				bbox2 |= l->PaintOutline(spd, clipRect, pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintOutline(spd, clipRect, pAlphaMask, p, org2, m_time, alpha);
 			}
 			p.y += l->m_ascent + l->m_descent;
 		}
@@ -3157,15 +3348,20 @@ STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 				  : (s->m_scrAlignment%3) == 0 ? org.x - l->m_width
 				  :							   org.x - (l->m_width/2);
 			if (s->m_clipInverse) {
-				bbox2 |= l->PaintBody(spd, iclipRect[0], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintBody(spd, iclipRect[1], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintBody(spd, iclipRect[2], pAlphaMask, p, org2, m_time, alpha);
-				bbox2 |= l->PaintBody(spd, iclipRect[3], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintBody(spd, iclipRect[0], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintBody(spd, iclipRect[1], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintBody(spd, iclipRect[2], pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintBody(spd, iclipRect[3], pAlphaMask, p, org2, m_time, alpha);
 			} else {
-				bbox2 |= l->PaintBody(spd, clipRect, pAlphaMask, p, org2, m_time, alpha);
+				bboxSub |= l->PaintBody(spd, clipRect, pAlphaMask, p, org2, m_time, alpha);
 			}
 			p.y += l->m_ascent + l->m_descent;
 		}
+
+		if (!bPartial) {
+			m_subtitleBBox[entry] = bboxSub;
+		}
+		bbox2 |= bboxSub;
 	}
 
 	bbox = bbox2;
@@ -3173,6 +3369,61 @@ STDMETHODIMP CRenderedTextSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 	return (subs.GetCount() && !bbox2.IsRectEmpty()) ? S_OK : S_FALSE;
 }
 
+// ISubPicProvider2
+
+STDMETHODIMP CRenderedTextSubtitle::GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, double fps, RECT& rcChanged)
+{
+	if (rtFrom != m_rtLastRender || m_lastRenderSubs.IsEmpty()) {
+		return S_FALSE;
+	}
+
+	// other subtitles on the screen may move the ones that stay
+	const STSSegment* stss = SearchSubs((int)(rtTo / 10000), fps);
+	if (!stss || stss->subs.GetCount() != m_lastRenderSubs.GetCount()
+			|| memcmp(stss->subs.GetData(), m_lastRenderSubs.GetData(), m_lastRenderSubs.GetCount() * sizeof(int))) {
+		return S_FALSE;
+	}
+
+	CRect r(0, 0, 0, 0);
+
+	for (size_t i = 0, count = m_lastRenderSubs.GetCount(); i < count; i++) {
+		int entry = m_lastRenderSubs[i];
+
+		CSubtitle* s;
+		CRect bbox;
+		if (!m_subtitleCache.Lookup(entry, s) || s->m_fAnimated || !m_subtitleBBox.Lookup(entry, bbox)) {
+			return S_FALSE;
+		}
+
+		// karaoke and fades only change the colors of what is already there,
+		// a subtitle that moves needs a full render
+		if (s->m_bIsAnimated) {
+			if (s->m_effects[EF_MOVE] || s->m_effects[EF_BANNER] || s->m_effects[EF_SCROLL]) {
+				return S_FALSE;
+			}
+			r |= bbox;
+		}
+	}
+
+	rcChanged = r;
+
+	return S_OK;
+}
+
+STDMETHODIMP CRenderedTextSubtitle::RenderRect(SubPicDesc& spd, REFERENCE_TIME rt, double fps, const RECT& rcClip, RECT& bbox)
+{
+	if (m_size != CSize(spd.w*8, spd.h*8) || m_vidrect != CRect(spd.vidrect.left*8, spd.vidrect.top*8, spd.vidrect.right*8, spd.vidrect.bottom*8)
+			|| IsRectEmpty(&rcClip)) {
+		return E_INVALIDARG;
+	}
+
+	m_rcRenderClip = rcClip;
+	HRESULT hr = Render(spd, rt, fps, bbox);
+	m_rcRenderClip.SetRectEmpty();
+
+	return hr;
+}
+
 // IPersist
 
 STDMETHODIMP CRenderedTextSubtitle::GetClassID(CLSID* pClassID)
@@ -37,6 +37,33 @@ typedef std::shared_ptr<CPolygonPath> CPolygonPathSharedPtr;
 struct SSATag;
 typedef std::shared_ptr<CAtlList<SSATag>> SSATagsList;
 
+template<>
+struct CRenderingCacheCostTraits<CPolygonPathSharedPtr> {
+	static size_t GetCost(const CPolygonPathSharedPtr& value) {
+		return sizeof(CPolygonPath) + value->typesOrg.GetCount() * sizeof(BYTE) + value->pointsOrg.GetCount() * sizeof(CPoint);
+	}
+};
+
+template<>
+struct CRenderingCacheCostTraits<SSATagsList> {
+	static size_t GetCost(const SSATagsList& value);
+};
+
+template<>
+struct CRenderingCacheCostTraits<COutlineDataSharedPtr> {
+	static size_t GetCost(const COutlineDataSharedPtr& value) {
+		return sizeof(COutlineData) + (value->mOutline.capacity() + value->mWideOutline.capacity()) * sizeof(tSpanBuffer::value_type);
+	}
+};
+
+template<>
+struct CRenderingCacheCostTraits<COverlayDataSharedPtr> {
+	static size_t GetCost(const COverlayDataSharedPtr& value) {
+		// body and border planes
+		return sizeof(COverlayData) + 2 * (size_t)value->mOverlayPitch * value->mOverlayHeight;
+	}
+};
+
 typedef CRenderingCache<CTextDimsKey, CTextDims, CKeyTraits<CTextDimsKey>> CTextDimsCache;
 typedef CRenderingCache<CPolygonPathKey, CPolygonPathSharedPtr, CKeyTraits<CPolygonPathKey>> CPolygonCache;
 typedef CRenderingCache<CStringW, SSATagsList, CStringElementTraits<CStringW>> CSSATagsCache;
@@ -52,13 +79,21 @@ struct RenderingCaches {
 	COutlineCache outlineCache;
 	COverlayCache overlayCache;
 
+	// guards the caches and g_hDC while words are painted on several threads
+	CCritSec csLock;
+
+	// approximate long \blur kernels by box blurs instead of the exact gaussian
+	bool bFastBlur;
+
+	// the entry counts bound the small caches, the byte budgets the ones holding spans and bitmaps
 	RenderingCaches()
 		: textDimsCache(2048)
-		, polygonCache(2048)
-		, SSATagsCache(2048)
+		, polygonCache(2048, 16 * 1024 * 1024)
+		, SSATagsCache(2048, 8 * 1024 * 1024)
 		, ellipseCache(64)
-		, outlineCache(128)
-		, overlayCache(128) {}
+		, outlineCache(512, 32 * 1024 * 1024)
+		, overlayCache(512, 64 * 1024 * 1024)
+		, bFastBlur(false) {}
 };
 
 class CMyFont : public CFont
@@ -92,6 +127,7 @@ protected:
 
 	double m_scalex, m_scaley;
 	CStringW m_str;
+	ULONG m_textDimsHash; // CTextDimsKey::Hash() of m_str and m_style, redone when the word grows
 
 	virtual bool CreatePath() PURE;
 
@@ -171,6 +207,14 @@ public:
 	BYTE* m_pAlphaMask;
 };
 
+// a word and the positions CLine::Paint*() is going to paint it at
+struct CWordPaintJob {
+	CWord* w;
+	CPoint org;
+	int count;
+	CPoint p[2];
+};
+
 class CLine : public CAtlList<CWord*>
 {
 public:
@@ -180,6 +224,8 @@ public:
 
 	void Compact();
 
+	void GetPaintJobs(CAtlArray<CWordPaintJob>& jobs, CPoint p, CPoint org);
+
 	CRect PaintShadow(SubPicDesc& spd, CRect& clipRect, BYTE* pAlphaMask, CPoint p, CPoint org, int time, int alpha);
 	CRect PaintOutline(SubPicDesc& spd, CRect& clipRect, BYTE* pAlphaMask, CPoint p, CPoint org, int time, int alpha);
 	CRect PaintBody(SubPicDesc& spd, CRect& clipRect, BYTE* pAlphaMask, CPoint p, CPoint org, int time, int alpha);
@@ -348,6 +394,12 @@ class __declspec(uuid("537DCACA-2812-4a4f-B2C6-1A34C17ADEB0"))
 	static CAtlMap<CStringW, SSATagCmd, CStringElementTraits<CStringW>> s_SSATagCmds;
 	CAtlMap<int, CSubtitle*> m_subtitleCache;
 
+	// what the last Render() drew, GetChangedRect() compares against it
+	REFERENCE_TIME m_rtLastRender;
+	CAtlArray<int> m_lastRenderSubs;
+	CAtlMap<int, CRect> m_subtitleBBox; // entry -> painted area, from the last full render
+	CRect m_rcRenderClip; // only set during RenderRect()
+
 	RenderingCaches m_renderingCaches;
 
 	CScreenLayoutAllocator m_sla;
@@ -355,6 +407,11 @@ class __declspec(uuid("537DCACA-2812-4a4f-B2C6-1A34C17ADEB0"))
 	CSize m_size;
 	CRect m_vidrect;
 
+	// the words of a subtitle are rasterized on this many threads before they are drawn in order
+#define RTS_MAX_RENDER_THREADS 8
+	int m_nRenderThreads;
+	void PaintWords(CAtlArray<CWordPaintJob>& jobs);
+
 	// temp variables, used when parsing the script
 	int m_time, m_delay;
 	int m_animStart, m_animEnd;
@@ -399,6 +456,14 @@ public:
 		m_overridePlacement.SetSize(lHorPos, lVerPos);
 	}
 
+	void SetFastBlur(bool bFastBlur) {
+		CAutoLock cAutoLock(&m_renderingCaches.csLock);
+		if (m_renderingCaches.bFastBlur != bFastBlur) {
+			m_renderingCaches.bFastBlur = bFastBlur;
+			m_renderingCaches.overlayCache.Clear();
+		}
+	}
+
 public:
 	bool Init(CSize size, const CRect& vidrect); // will call Deinit()
 	void Deinit();
@@ -416,6 +481,10 @@ public:
 
 	STDMETHODIMP_(SUBTITLE_TYPE) GetType(POSITION pos) { return ST_TEXT; };
 
+	// ISubPicProvider2
+	STDMETHODIMP GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, double fps, RECT& rcChanged);
+	STDMETHODIMP RenderRect(SubPicDesc& spd, REFERENCE_TIME rt, double fps, const RECT& rcClip, RECT& bbox);
+
 	// IPersist
 	STDMETHODIMP GetClassID(CLSID* pClassID);
 
@@ -795,7 +795,7 @@ void Rasterizer::CreateWidenedRegionFast(int rx, int ry)
 	flushLines(yPrec - ry, yPrec + ry + 1, m_pOutlineData->mWideOutline);
 }
 
-bool Rasterizer::Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur)
+bool Rasterizer::Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur, bool bFastBlur)
 {
 	m_pOverlayData = std::make_shared<COverlayData>();
 
@@ -812,7 +812,8 @@ bool Rasterizer::Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur)
 	m_pOverlayData->mOffsetX = m_pOutlineData->mPathOffsetX - xsub;
 	m_pOverlayData->mOffsetY = m_pOutlineData->mPathOffsetY - ysub;
 
-	m_pOutlineData->mWideBorder = (m_pOutlineData->mWideBorder + 7) &~ 7;
+	// the outline data is shared through the cache, only read it here
+	const int wideBorder = (m_pOutlineData->mWideBorder + 7) &~ 7;
 
 	if (!m_pOutlineData->mWideOutline.empty() || fBlur || fGaussianBlur > 0) {
 		int bluradjust = 0;
@@ -826,14 +827,14 @@ bool Rasterizer::Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur)
 		// Expand the buffer a bit when we're blurring, since that can also widen the borders a bit
 		bluradjust = (bluradjust+7)&~7;
 
-		width	+= 2 * m_pOutlineData->mWideBorder + bluradjust*2;
-		height	+= 2 * m_pOutlineData->mWideBorder + bluradjust*2;
+		width	+= 2 * wideBorder + bluradjust*2;
+		height	+= 2 * wideBorder + bluradjust*2;
 
-		xsub += m_pOutlineData->mWideBorder + bluradjust;
-		ysub += m_pOutlineData->mWideBorder + bluradjust;
+		xsub += wideBorder + bluradjust;
+		ysub += wideBorder + bluradjust;
 
-		m_pOverlayData->mOffsetX -= m_pOutlineData->mWideBorder + bluradjust;
-		m_pOverlayData->mOffsetY -= m_pOutlineData->mWideBorder + bluradjust;
+		m_pOverlayData->mOffsetX -= wideBorder + bluradjust;
+		m_pOverlayData->mOffsetY -= wideBorder + bluradjust;
 	}
 
 	m_pOverlayData->mOverlayWidth = ((width+7)>>3) + 1;
@@ -895,17 +896,32 @@ bool Rasterizer::Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur)
 		GaussianKernel filter(fGaussianBlur);
 		if (m_pOverlayData->mOverlayWidth >= filter.width && m_pOverlayData->mOverlayHeight >= filter.width) {
 			size_t pitch = m_pOverlayData->mOverlayPitch;
+			size_t size = pitch * m_pOverlayData->mOverlayHeight;
 
-			byte *tmp = (byte*)_aligned_malloc(pitch * m_pOverlayData->mOverlayHeight * sizeof(byte), 16);
+			// one scratch buffer for the whole blur: the intermediate image, then a padded line or the column sums
+			byte *tmp = (byte*)_aligned_malloc(size + (pitch + filter.width + 16) * sizeof(int), 16);
 			if (!tmp) {
 				return false;
 			}
+			byte* line = tmp + size;
 
 			byte* src = m_pOutlineData->mWideOutline.empty() ? m_pOverlayData->mpOverlayBufferBody : m_pOverlayData->mpOverlayBufferBorder;
 
-			if (m_bUseSSE2) {
+			if (bFastBlur && filter.width >= GAUSSIAN_BOX_MIN_WIDTH) {
+				// large sigma, three box blurs cost the same for any kernel width but are only close to the gaussian
+				int sizes[3];
+				filter.GetBoxSizes(sizes);
+
+				for (int i = 0; i < 3; i++) {
+					BoxFilterX(src, m_pOverlayData->mOverlayWidth, m_pOverlayData->mOverlayHeight, pitch, sizes[i], line);
+				}
+				BoxFilterY(src, tmp, m_pOverlayData->mOverlayWidth, m_pOverlayData->mOverlayHeight, pitch, sizes[0], (unsigned int*)line);
+				BoxFilterY(tmp, src, m_pOverlayData->mOverlayWidth, m_pOverlayData->mOverlayHeight, pitch, sizes[1], (unsigned int*)line);
+				BoxFilterY(src, tmp, m_pOverlayData->mOverlayWidth, m_pOverlayData->mOverlayHeight, pitch, sizes[2], (unsigned int*)line);
+				memcpy(src, tmp, size);
+			} else if (m_bUseSSE2) {
 				SeparableFilterX_SSE2(src, tmp, m_pOverlayData->mOverlayWidth, m_pOverlayData->mOverlayHeight, pitch,
-									  filter.kernel, filter.width, filter.divisor);
+									  filter.kernel, filter.width, filter.divisor, line);
 				SeparableFilterY_SSE2(tmp, src, m_pOverlayData->mOverlayWidth, m_pOverlayData->mOverlayHeight, pitch,
 									  filter.kernel, filter.width, filter.divisor);
 			} else {
@@ -921,16 +937,17 @@ bool Rasterizer::Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur)
 
 	// If we're blurring, do a 3x3 box blur
 	// Can't do it on subpictures smaller than 3x3 pixels
-	for (int pass = 0; pass < fBlur; pass++) {
-		if (m_pOverlayData->mOverlayWidth >= 3 && m_pOverlayData->mOverlayHeight >= 3) {
-			int pitch = m_pOverlayData->mOverlayPitch;
+	if (fBlur && m_pOverlayData->mOverlayWidth >= 3 && m_pOverlayData->mOverlayHeight >= 3) {
+		int pitch = m_pOverlayData->mOverlayPitch;
 
-			byte* tmp = DNew byte[pitch * m_pOverlayData->mOverlayHeight];
-			if (!tmp) {
-				return false;
-			}
+		byte* tmp = DNew byte[pitch * m_pOverlayData->mOverlayHeight];
+		if (!tmp) {
+			return false;
+		}
+
+		byte* buffer = m_pOutlineData->mWideOutline.empty() ? m_pOverlayData->mpOverlayBufferBody : m_pOverlayData->mpOverlayBufferBorder;
 
-			byte* buffer = m_pOutlineData->mWideOutline.empty() ? m_pOverlayData->mpOverlayBufferBody : m_pOverlayData->mpOverlayBufferBorder;
+		for (int pass = 0; pass < fBlur; pass++) {
 			memcpy(tmp, buffer, pitch * m_pOverlayData->mOverlayHeight);
 
 			// This could be done in a separated way and win some speed
@@ -944,9 +961,9 @@ bool Rasterizer::Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur)
 							+ src[-1 +pitch] + (src[+pitch] << 1) + src[+1 +pitch]) >> 4;
 				}
 			}
-
-			delete [] tmp;
 		}
+
+		delete [] tmp;
 	}
 
 	return true;
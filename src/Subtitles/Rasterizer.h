@@ -233,7 +233,7 @@ public:
 	bool PartialEndPath(HDC hdc, long dx, long dy);
 	bool ScanConvert();
 	bool CreateWidenedRegion(int borderX, int borderY);
-	bool Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur);
+	bool Rasterize(int xsub, int ysub, int fBlur, double fGaussianBlur, bool bFastBlur = false);
 	int getOverlayWidth();
 
 	CRect Draw(SubPicDesc& spd, CRect& clipRect, byte* pAlphaMask, int xsub, int ysub, const DWORD* switchpts, bool fBody, bool fBorder);
@@ -102,6 +102,12 @@ STDMETHODIMP CRenderedHdmvSubtitle::Render(SubPicDesc& spd, REFERENCE_TIME rt, d
 	return S_OK;
 }
 
+STDMETHODIMP CRenderedHdmvSubtitle::GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, double fps, RECT& rcChanged)
+{
+	CAutoLock cAutoLock(&m_csCritSec);
+	return m_pSub->GetChangedRect(rtFrom - m_rtStart, rtTo - m_rtStart, rcChanged);
+}
+
 STDMETHODIMP CRenderedHdmvSubtitle::GetTextureSize (POSITION pos, SIZE& MaxTextureSize, SIZE& VideoSize, POINT& VideoTopLeft)
 {
 	CAutoLock cAutoLock(&m_csCritSec);
@@ -45,6 +45,9 @@ public:
 
 	STDMETHODIMP_(SUBTITLE_TYPE) GetType(POSITION pos) { return m_nType; };
 
+	// ISubPicProvider2
+	STDMETHODIMP GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, double fps, RECT& rcChanged);
+
 	// IPersist
 	STDMETHODIMP GetClassID(CLSID* pClassID);
 
@@ -35,6 +35,14 @@ CTextDimsKey::CTextDimsKey(const CStringW& str, const STSStyle& style)
 	UpdateHash();
 }
 
+CTextDimsKey::CTextDimsKey(const CStringW& str, const STSStyle& style, ULONG hash)
+	: m_str(str)
+	, m_style(DNew STSStyle(style))
+	, m_hash(hash)
+{
+	ASSERT(m_hash == Hash(str, style));
+}
+
 CTextDimsKey::CTextDimsKey(const CTextDimsKey& textDimsKey)
 	: m_str(textDimsKey.m_str)
 	, m_style(DNew STSStyle(*textDimsKey.m_style))
@@ -42,25 +50,33 @@ CTextDimsKey::CTextDimsKey(const CTextDimsKey& textDimsKey)
 {
 }
 
+ULONG CTextDimsKey::Hash(const CStringW& str, const STSStyle& style)
+{
+	ULONG hash;
+	hash  = CStringElementTraits<CString>::Hash(str);
+	hash += hash << 5;
+	hash += style.charSet;
+	hash += hash << 5;
+	hash += CStringElementTraits<CString>::Hash(style.fontName);
+	hash += hash << 5;
+	hash += int(style.fontSize);
+	hash += hash << 5;
+	hash += int(style.fontSpacing);
+	hash += hash << 5;
+	hash += style.fontWeight;
+	hash += hash << 5;
+	hash += style.fItalic;
+	hash += hash << 5;
+	hash += style.fUnderline;
+	hash += hash << 5;
+	hash += style.fStrikeOut;
+
+	return hash;
+}
+
 void CTextDimsKey::UpdateHash()
 {
-	m_hash  = CStringElementTraits<CString>::Hash(m_str);
-	m_hash += m_hash << 5;
-	m_hash += m_style->charSet;
-	m_hash += m_hash << 5;
-	m_hash += CStringElementTraits<CString>::Hash(m_style->fontName);
-	m_hash += m_hash << 5;
-	m_hash += int(m_style->fontSize);
-	m_hash += m_hash << 5;
-	m_hash += int(m_style->fontSpacing);
-	m_hash += m_hash << 5;
-	m_hash += m_style->fontWeight;
-	m_hash += m_hash << 5;
-	m_hash += m_style->fItalic;
-	m_hash += m_hash << 5;
-	m_hash += m_style->fUnderline;
-	m_hash += m_hash << 5;
-	m_hash += m_style->fStrikeOut;
+	m_hash = Hash(m_str, *m_style);
 }
 
 bool CTextDimsKey::operator==(const CTextDimsKey& textDimsKey) const
@@ -109,7 +125,7 @@ bool CPolygonPathKey::operator==(const CPolygonPathKey& polygonPathKey) const
 }
 
 COutlineKey::COutlineKey(const CWord* word, CPoint org)
-	: CTextDimsKey(word->m_str, word->m_style)
+	: CTextDimsKey(word->m_str, word->m_style, word->m_textDimsHash)
 	, m_scalex(word->m_scalex)
 	, m_scaley(word->m_scaley)
 	, m_org(org)
@@ -118,7 +134,7 @@ COutlineKey::COutlineKey(const CWord* word, CPoint org)
 }
 
 COutlineKey::COutlineKey(const COutlineKey& outLineKey)
-	: CTextDimsKey(outLineKey.m_str, *outLineKey.m_style)
+	: CTextDimsKey(outLineKey)
 	, m_scalex(outLineKey.m_scalex)
 	, m_scaley(outLineKey.m_scaley)
 	, m_org(outLineKey.m_org)
@@ -22,19 +22,60 @@
 
 #include <atlcoll.h>
 
-template<typename K, typename V, class KTraits = CElementTraits<K>, class VTraits = CElementTraits<V>>
+// memory held by a cached value, specialized next to the value types which own buffers
+template<typename V>
+struct CRenderingCacheCostTraits {
+	static size_t GetCost(const V&) {
+		return sizeof(V);
+	}
+};
+
+struct CRenderingCacheStats {
+	size_t nHits, nMisses, nEvictions;
+	size_t nCount, nBytes;
+};
+
+template<typename K, typename V, class KTraits = CElementTraits<K>, class VTraits = CElementTraits<V>, class CTraits = CRenderingCacheCostTraits<V>>
 class CRenderingCache : private CAtlMap<K, POSITION, KTraits>
 {
 private:
-	size_t m_maxSize;
+	size_t m_maxSize, m_maxBytes;
+	size_t m_nBytes;
+	size_t m_nHits, m_nMisses, m_nEvictions;
 	struct CPositionValue {
 		POSITION pos;
+		size_t cost;
 		V value;
 	};
 	CAtlList<CPositionValue> m_list;
 
+	// out of the few least recently used entries the biggest one goes first,
+	// a large blurred overlay frees more memory than a handful of small ones
+	void Evict() {
+		POSITION posEvict = m_list.GetTailPosition();
+		POSITION pos = posEvict;
+		for (int i = 0; i < 8 && pos; i++) {
+			if (m_list.GetAt(pos).cost > m_list.GetAt(posEvict).cost) {
+				posEvict = pos;
+			}
+			m_list.GetPrev(pos);
+		}
+
+		CPositionValue& posVal = m_list.GetAt(posEvict);
+		m_nBytes -= posVal.cost;
+		__super::RemoveAtPos(posVal.pos);
+		m_list.RemoveAt(posEvict);
+		m_nEvictions++;
+	}
+
 public:
-	CRenderingCache(size_t maxSize) : m_maxSize(maxSize) {};
+	CRenderingCache(size_t maxSize, size_t maxBytes = SIZE_MAX)
+		: m_maxSize(maxSize)
+		, m_maxBytes(maxBytes)
+		, m_nBytes(0)
+		, m_nHits(0)
+		, m_nMisses(0)
+		, m_nEvictions(0) {};
 
 	bool Lookup(KINARGTYPE key, _Out_ typename VTraits::OUTARGTYPE value) {
 		POSITION pos;
@@ -43,6 +84,9 @@ public:
 		if (bFound) {
 			m_list.MoveToHead(pos);
 			value = m_list.GetHead().value;
+			m_nHits++;
+		} else {
+			m_nMisses++;
 		}
 
 		return bFound;
@@ -51,21 +95,26 @@ public:
 	POSITION SetAt(KINARGTYPE key, typename VTraits::INARGTYPE value) {
 		POSITION pos;
 		bool bFound = __super::Lookup(key, pos);
+		size_t cost = CTraits::GetCost(value);
 
 		if (bFound) {
 			m_list.MoveToHead(pos);
 			CPositionValue& posVal = m_list.GetHead();
 			pos = posVal.pos;
+			m_nBytes += cost - posVal.cost;
+			posVal.cost = cost;
 			posVal.value = value;
 		} else {
-			if (m_list.GetCount() >= m_maxSize) {
-				__super::RemoveAtPos(m_list.GetTail().pos);
-				m_list.RemoveTailNoReturn();
+			// an entry bigger than the whole budget is still cached on its own
+			while (!m_list.IsEmpty() && (m_list.GetCount() >= m_maxSize || m_nBytes + cost > m_maxBytes)) {
+				Evict();
 			}
 			pos = __super::SetAt(key, m_list.AddHead());
 			CPositionValue& posVal = m_list.GetHead();
 			posVal.pos = pos;
+			posVal.cost = cost;
 			posVal.value = value;
+			m_nBytes += cost;
 		}
 
 		return pos;
@@ -74,6 +123,15 @@ public:
 	void Clear() {
 		m_list.RemoveAll();
 		__super::RemoveAll();
+		m_nBytes = 0;
+	}
+
+	void GetStats(CRenderingCacheStats& stats) const {
+		stats.nHits      = m_nHits;
+		stats.nMisses    = m_nMisses;
+		stats.nEvictions = m_nEvictions;
+		stats.nCount     = m_list.GetCount();
+		stats.nBytes     = m_nBytes;
 	}
 };
 
@@ -103,10 +161,14 @@ protected:
 
 public:
 	CTextDimsKey(const CStringW& str, const STSStyle& style);
+	CTextDimsKey(const CStringW& str, const STSStyle& style, ULONG hash);
 	CTextDimsKey(const CTextDimsKey& textDimsKey);
 
 	ULONG GetHash() const { return m_hash; };
 
+	// the words compute it once and pass it in, so building a key doesn't rehash the strings
+	static ULONG Hash(const CStringW& str, const STSStyle& style);
+
 	void UpdateHash();
 
 	bool operator==(const CTextDimsKey& textDimsKey) const;
@@ -1830,6 +1830,64 @@ static OpenFunctStruct OpenFuncts[] = {
 
 static int nOpenFuncts = _countof(OpenFuncts);
 
+// Guesses the format from the first few KB of the file, so the matching parser can be tried first
+// instead of letting every parser before it read and reject the file. Only unambiguous signatures
+// are reported, anything else returns NULL and the parsers are tried in the usual order.
+static STSOpenFunct SniffOpenFunct(CTextFile* file)
+{
+	ULONGLONG pos = file->GetPosition();
+
+	STSOpenFunct open = NULL;
+
+	CStringW buff;
+	for (int nLines = 0; !open && nLines < 64 && file->GetPosition() - pos < 4096 && file->ReadString(buff); ) {
+		FastTrim(buff);
+		if (buff.IsEmpty()) {
+			continue;
+		}
+		nLines++;
+
+		CStringW lower(buff);
+		lower.MakeLower();
+
+		if (buff.Find(L"USFSubtitles") >= 0) {
+			open = OpenUSF;
+		} else if (lower.Find(L"[script info]") == 0 || lower.Find(L"[v4 styles]") == 0 || lower.Find(L"[v4+ styles]") == 0
+				|| lower.Find(L"[events]") == 0 || lower.Find(L"dialogue:") == 0) {
+			open = OpenSubStationAlpha;
+		} else if (lower.Find(L"<sami>") >= 0) {
+			open = OpenSami;
+		} else if (lower.Find(L"<window") >= 0) {
+			open = OpenRealText;
+		} else if (lower.Find(L"screenhorizontal") == 0 || lower.Find(L"screenvertical") == 0) {
+			open = OpenXombieSub;
+		} else if (lower.Find(L"[information]") == 0 || lower.Find(L"[subtitle]") == 0) {
+			open = OpenSubViewer;
+		} else {
+			WCHAR sep;
+			int hh1, mm1, ss1, hh2, mm2, ss2;
+			WCHAR msStr1[5] = {0}, msStr2[5] = {0};
+
+			if (swscanf_s(buff, L"%d%c%d%c%d%4[^-] --> %d%c%d%c%d%4s\n",
+						  &hh1, &sep, 1, &mm1, &sep, 1, &ss1, msStr1, _countof(msStr1),
+						  &hh2, &sep, 1, &mm2, &sep, 1, &ss2, msStr2, _countof(msStr2)) >= 11) {
+				open = OpenSubRipper;
+			} else if (swscanf_s(buff, L"{%d:%d:%d}{%d:%d:%d}", &hh1, &mm1, &ss1, &hh2, &mm2, &ss2) == 6) {
+				open = OpenOldSubRipper;
+			} else if (swscanf_s(buff, L"{%d}{%d}", &hh1, &hh2) == 2
+					   || (swscanf_s(buff, L"{%d}{}", &hh1) == 1 && buff.Find(L"{}") > 0)) {
+				open = OpenMicroDVD;
+			} else if (swscanf_s(buff, L"[%d][%d]", &hh1, &hh2) == 2) {
+				open = OpenMPL2;
+			}
+		}
+	}
+
+	file->Seek(pos, CFile::begin);
+
+	return open;
+}
+
 //
 
 CSimpleTextSubtitle::CSimpleTextSubtitle()
@@ -1844,6 +1902,7 @@ CSimpleTextSubtitle::CSimpleTextSubtitle()
 	, m_dPARCompensation(1.0)
 	, m_exttype(EXTSRT)
 	, m_fUsingAutoGeneratedDefaultStyle(false)
+	, m_fBulkLoad(false)
 {
 }
 
@@ -2000,6 +2059,11 @@ void CSimpleTextSubtitle::Add(CStringW str, bool fUnicode, int start, int end, C
 		return;
 	}
 
+	// EndBulkLoad() builds all the segments at once
+	if (m_fBulkLoad) {
+		return;
+	}
+
 	size_t segmentsCount = m_segments.GetCount();
 
 	if (segmentsCount == 0) { // First segment
@@ -2603,13 +2667,29 @@ static int BreakpointComp(const void* e1, const void* e2)
 	return (bp1->t - bp2->t);
 }
 
+void CSimpleTextSubtitle::BeginBulkLoad()
+{
+	m_fBulkLoad = true;
+}
+
+void CSimpleTextSubtitle::EndBulkLoad()
+{
+	if (m_fBulkLoad) {
+		m_fBulkLoad = false;
+		CreateSegments();
+	}
+}
+
 void CSimpleTextSubtitle::CreateSegments()
 {
 	m_segments.RemoveAll();
 
+	size_t count = GetCount();
+
 	CAtlArray<Breakpoint> breakpoints;
+	breakpoints.SetCount(0, count * 2);
 
-	for (size_t i = 0; i < GetCount(); i++) {
+	for (size_t i = 0; i < count; i++) {
 		STSEntry& stse = GetAt(i);
 		breakpoints.Add(Breakpoint(stse.start, true));
 		breakpoints.Add(Breakpoint(stse.end, false));
@@ -2617,21 +2697,39 @@ void CSimpleTextSubtitle::CreateSegments()
 
 	qsort(breakpoints.GetData(), breakpoints.GetCount(), sizeof(Breakpoint), BreakpointComp);
 
+	// one sweep over the sorted breakpoints, the number of open entries
+	// is also the final size of each segment's list
+	CAtlArray<size_t> subsCount;
 	ptrdiff_t startsCount = 0;
 	for (size_t i = 1, end = breakpoints.GetCount(); i < end; i++) {
 		startsCount += breakpoints[i - 1].isStart ? +1 : -1;
 		if (breakpoints[i - 1].t != breakpoints[i].t && startsCount > 0) {
 			m_segments.Add(STSSegment(breakpoints[i - 1].t, breakpoints[i].t));
+			subsCount.Add((size_t)startsCount);
 		}
 	}
 
+	for (size_t j = 0; j < m_segments.GetCount(); j++) {
+		m_segments[j].subs.SetCount(0, (int)subsCount[j]);
+	}
+
+	// fill the segments in read order, like Add() keeps them
+	CAtlArray<int> order;
+	order.SetCount(count);
+	for (size_t i = 0; i < count; i++) {
+		order[i] = (int)i;
+	}
+	std::stable_sort(order.GetData(), order.GetData() + count, [this](int a, int b) {
+		return GetAt(a).readorder < GetAt(b).readorder;
+	});
+
 	STSSegment* segmentsStart = m_segments.GetData();
 	STSSegment* segmentsEnd   = segmentsStart + m_segments.GetCount();
-	for (size_t i = 0; i < GetCount(); i++) {
-		const STSEntry& stse = GetAt(i);
+	for (size_t k = 0; k < count; k++) {
+		const STSEntry& stse = GetAt(order[k]);
 		STSSegment* segment = std::lower_bound(segmentsStart, segmentsEnd, stse.start, SegmentCompStart);
-		for (size_t j = segment - segmentsStart; j < m_segments.GetCount() && m_segments[j].end <= stse.end; j++) {
-			m_segments[j].subs.Add(int(i));
+		for (; segment < segmentsEnd && segment->end <= stse.end; segment++) {
+			segment->subs.Add(order[k]);
 		}
 	}
 
@@ -2758,7 +2856,23 @@ bool CSimpleTextSubtitle::Open(CTextFile* f, int CharSet, CString name)
 
 	ULONGLONG pos = f->GetPosition();
 
+	// the sniffed parser goes first, the others keep their order as fallback
+	CAtlArray<ptrdiff_t> order;
+	STSOpenFunct sniffed = SniffOpenFunct(f);
 	for (ptrdiff_t i = 0; i < nOpenFuncts; i++) {
+		if (OpenFuncts[i].open == sniffed) {
+			order.InsertAt(0, i);
+		} else {
+			order.Add(i);
+		}
+	}
+
+	// keeping the segments up to date on every Add() is quadratic on big scripts with many overlapping events
+	BeginBulkLoad();
+
+	for (size_t k = 0; k < order.GetCount(); k++) {
+		ptrdiff_t i = order[k];
+
 		if (!OpenFuncts[i].open(f, *this, CharSet)) {
 			if (!IsEmpty()) {
 				CString lastLine;
@@ -2781,13 +2895,15 @@ bool CSimpleTextSubtitle::Open(CTextFile* f, int CharSet, CString name)
 		m_encoding = f->GetEncoding();
 		m_path = f->GetFilePath();
 
-		// No need to call Sort() or CreateSegments(), everything is done on the fly
+		// No need to call Sort(), the segments are built once in EndBulkLoad()
 
 		CWebTextFile f2(CTextFile::UTF8);
 		if (f2.Open(f->GetFilePath() + _T(".style"))) {
 			OpenSubStationAlpha(&f2, *this, CharSet);
 		}
 
+		EndBulkLoad();
+
 		CreateDefaultStyle(CharSet);
 
 		ChangeUnknownStylesToDefault();
@@ -2799,6 +2915,8 @@ bool CSimpleTextSubtitle::Open(CTextFile* f, int CharSet, CString name)
 		return true;
 	}
 
+	m_fBulkLoad = false;
+
 	return false;
 }
 
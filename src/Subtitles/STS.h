@@ -124,6 +124,7 @@ class CSimpleTextSubtitle : public CAtlArray<STSEntry>
 
 protected:
 	CAtlArray<STSSegment> m_segments;
+	bool m_fBulkLoad;
 	virtual void OnChanged() {}
 
 public:
@@ -163,6 +164,10 @@ public:
 	void Sort(bool fRestoreReadorder = false);
 	void CreateSegments();
 
+	// Add() only collects the entries until EndBulkLoad(), which builds the segments in one pass
+	void BeginBulkLoad();
+	void EndBulkLoad();
+
 	void Append(CSimpleTextSubtitle& sts, int timeoff = -1);
 
 	bool Open(CString fn, int CharSet, CString name = L"", CString videoName = L"");
@@ -0,0 +1,180 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// STSLoadBench - load time of CSimpleTextSubtitle, not part of the Subtitles build
+//
+//   build it as an MFC console program with the Subtitles and DSUtil libraries
+//
+//   STSLoadBench [events]            synthetic scripts with the given number of events (default 20000)
+//   STSLoadBench <file> [file ...]   real subtitle files
+//
+// Every script is loaded with Open(), which builds the segments once in EndBulkLoad(), and then
+// its entries are added again one by one to a second instance, which keeps the segments up to
+// date on every Add() like the loaders did before. Both segment lists have to be identical.
+// Exits with 1 when they differ.
+//
+
+#include "stdafx.h"
+#include <stdio.h>
+#include "STS.h"
+
+class CSTSLoadBench : public CSimpleTextSubtitle
+{
+public:
+	bool SameSegments(const CSTSLoadBench& sts) const {
+		if (m_segments.GetCount() != sts.m_segments.GetCount()) {
+			return false;
+		}
+		for (size_t i = 0; i < m_segments.GetCount(); i++) {
+			const STSSegment& s1 = m_segments[i];
+			const STSSegment& s2 = sts.m_segments[i];
+			if (s1.start != s2.start || s1.end != s2.end || s1.subs.GetCount() != s2.subs.GetCount()) {
+				return false;
+			}
+			for (size_t j = 0; j < s1.subs.GetCount(); j++) {
+				if (s1.subs[j] != s2.subs[j]) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	size_t GetSegmentCount() const {
+		return m_segments.GetCount();
+	}
+};
+
+static double Now()
+{
+	LARGE_INTEGER freq, t;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart / freq.QuadPart;
+}
+
+static CStringA AssTime(int ms)
+{
+	CStringA str;
+	str.Format("%d:%02d:%02d.%02d", ms / 3600000, (ms / 60000) % 60, (ms / 1000) % 60, (ms / 10) % 100);
+	return str;
+}
+
+// dialogue lines that barely overlap, plus signs and karaoke syllables that stay on screen for a minute
+static CString WriteSyntheticScript(int events, int overlap)
+{
+	TCHAR path[MAX_PATH], fn[MAX_PATH];
+	if (!GetTempPath(MAX_PATH, path) || !GetTempFileName(path, _T("sts"), 0, fn)) {
+		return L"";
+	}
+
+	FILE* f = NULL;
+	if (_tfopen_s(&f, fn, _T("wb")) || !f) {
+		return L"";
+	}
+
+	fputs("[Script Info]\r\nScriptType: v4.00+\r\nPlayResX: 1920\r\nPlayResY: 1080\r\n\r\n", f);
+	fputs("[V4+ Styles]\r\n"
+		  "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\r\n"
+		  "Style: Default,Arial,48,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,100,100,0,0,1,2,0,2,10,10,10,1\r\n\r\n", f);
+	fputs("[Events]\r\nFormat: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\r\n", f);
+
+	for (int i = 0; i < events; i++) {
+		int start, end;
+		if (overlap <= 1) {
+			start = i * 1500;
+			end = start + 2000;
+		} else {
+			start = i * 60000 / overlap;
+			end = start + 60000;
+		}
+		fprintf(f, "Dialogue: %d,%s,%s,Default,,0,0,0,,{\\pos(%d,%d)}line %d\r\n",
+				i % 4, (LPCSTR)AssTime(start), (LPCSTR)AssTime(end), 100 + (i * 37) % 1700, 100 + (i * 53) % 900, i);
+	}
+
+	fclose(f);
+
+	return fn;
+}
+
+static bool Bench(LPCTSTR fn, LPCSTR name)
+{
+	CSTSLoadBench bulk;
+	double t0 = Now();
+	if (!bulk.Open(fn, DEFAULT_CHARSET)) {
+		printf("%-36s can't be loaded\n", name);
+		return true;
+	}
+	double t1 = Now();
+
+	CSTSLoadBench incremental;
+	for (size_t i = 0; i < bulk.GetCount(); i++) {
+		const STSEntry& stse = bulk.GetAt(i);
+		incremental.Add(stse.str, stse.fUnicode, stse.start, stse.end, stse.style, stse.actor, stse.effect, stse.marginRect, stse.layer, stse.readorder);
+	}
+	double t2 = Now();
+
+	bool bSame = bulk.SameSegments(incremental);
+	printf("%-36s %8u %9u %10.3f %12.3f   %s\n", name, (unsigned)bulk.GetCount(), (unsigned)bulk.GetSegmentCount(),
+		   t1 - t0, t2 - t1, bSame ? "identical" : "FAILED: segments differ");
+
+	return bSame;
+}
+
+int _tmain(int argc, TCHAR* argv[])
+{
+	if (!AfxWinInit(GetModuleHandle(NULL), NULL, GetCommandLine(), 0)) {
+		return 2;
+	}
+
+	int failed = 0;
+
+	printf("%-36s %8s %9s %10s %12s\n", "script", "events", "segments", "Open() s", "per Add() s");
+
+	if (argc > 1 && !_istdigit(argv[1][0])) {
+		for (int i = 1; i < argc; i++) {
+			failed += !Bench(argv[i], CStringA(argv[i]));
+		}
+	} else {
+		int events = argc > 1 ? _ttoi(argv[1]) : 20000;
+
+		static const struct {
+			LPCSTR name;
+			int overlap;	// events on screen at once
+		} scripts[] = {
+			{"dialogue", 1},
+			{"signs, 100 at once", 100},
+			{"karaoke, 1000 at once", 1000},
+		};
+
+		for (int i = 0; i < _countof(scripts); i++) {
+			CString fn = WriteSyntheticScript(events, scripts[i].overlap);
+			if (fn.IsEmpty()) {
+				printf("can't write a temporary file\n");
+				return 2;
+			}
+			failed += !Bench(fn, scripts[i].name);
+			DeleteFile(fn);
+		}
+	}
+
+	return failed ? 1 : 0;
+}
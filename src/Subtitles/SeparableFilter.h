@@ -110,222 +110,202 @@ void SeparableFilterY(unsigned char* src, unsigned char* dst, int width, int hei
 }
 
 
+#define SEPARABLEFILTER_BLOCK	512	// columns per strip of the vertical SSE2 pass
+#define GAUSSIAN_BOX_MIN_WIDTH	31	// with fast blur on, longer gaussian kernels are approximated by three box blurs
+
+static __forceinline unsigned char SeparableFilterClamp(int accum)
+{
+	if (accum > 255) {
+		accum = 255;
+	} else if (accum < 0) {
+		accum = 0;
+	}
+	return (unsigned char)accum;
+}
+
+// Multiply 16 pixels of two neighboring taps by their coefficients and add them to four 32-bit accumulators,
+// coeff holds the coefficient of a in the low and the one of b in the high word of each dword
+static __forceinline void SeparableFilterMadd_SSE2(__m128i a, __m128i b, __m128i coeff, __m128i acc[4])
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i alo = _mm_unpacklo_epi8(a, zero);
+	__m128i ahi = _mm_unpackhi_epi8(a, zero);
+	__m128i blo = _mm_unpacklo_epi8(b, zero);
+	__m128i bhi = _mm_unpackhi_epi8(b, zero);
+
+	acc[0] = _mm_add_epi32(acc[0], _mm_madd_epi16(_mm_unpacklo_epi16(alo, blo), coeff));
+	acc[1] = _mm_add_epi32(acc[1], _mm_madd_epi16(_mm_unpackhi_epi16(alo, blo), coeff));
+	acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(_mm_unpacklo_epi16(ahi, bhi), coeff));
+	acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(_mm_unpackhi_epi16(ahi, bhi), coeff));
+}
+
+// Divide the four accumulators and pack them into 16 8-bit unsigned integers
+static __forceinline __m128i SeparableFilterPack_SSE2(__m128i acc[4], const libdivide::divider<int>& divisor)
+{
+	__m128i lo = _mm_packs_epi32(acc[0] / divisor, acc[1] / divisor);
+	__m128i hi = _mm_packs_epi32(acc[2] / divisor, acc[3] / divisor);
+	return _mm_packus_epi16(lo, hi);
+}
+
 // Filter an image in horizontal direction with a one-dimensional filter
+// line is scratch memory of at least width + kernel_size + 16 bytes
 void SeparableFilterX_SSE2(unsigned char* src, unsigned char* dst, int width, int height, ptrdiff_t stride,
-						   short* kernel, int kernel_size, int divisor)
+						   short* kernel, int kernel_size, int divisor, unsigned char* line)
 {
+	int kOffset = kernel_size / 2;
 	int width16 = width & ~15;
-	int* tmp = (int*)_aligned_malloc(stride * sizeof(int), 16);
 	libdivide::divider<int> divisorLibdivide(divisor);
 
-	for (int y = 0; y < height; y++) {
-		ZeroMemory(tmp, stride * sizeof(int));
+	// Each row is copied into a zero padded line, all taps of an output pixel can then be summed in registers
+	ZeroMemory(line, width + kernel_size + 16);
 
+	for (int y = 0; y < height; y++) {
 		const unsigned char* in = src + y * stride;
 		unsigned char* out = dst + y * stride;
 
-		for (int k = 0; k < kernel_size; k++) {
-			int xOffset = k - kernel_size / 2;
-			int xStart = 0;
-			int xEnd = width;
-			if (xOffset < 0) {
-				xEnd += xOffset;
-			} else if (xOffset > 0) {
-				xStart += xOffset;
-			}
-			int xStart16 = (xStart + 15) & ~15;
-			int xEnd16 = xEnd & ~15;
-			if (xStart16 >= xEnd16) { // Don't use SSE2 at all
-				xStart16 = xEnd16 = xEnd;
-			}
-			for (int x = xStart; x < xStart16; x++) {
-				tmp[x - xOffset] += (int)(in[x] * kernel[k]);
-			}
-			__m128i coeff = _mm_set1_epi16(kernel[k]);
-			for (int x = xStart16; x < xEnd16; x += 16) {
-				// Load 16 values
-				__m128i data16 = _mm_load_si128((__m128i*)&in[x]);
-
-				// Multiply the first 8 values by the coefficient to get 8 32-bit integers
-				__m128i data8 = _mm_unpacklo_epi8(data16, _mm_setzero_si128());
-				__m128i resLo = _mm_mullo_epi16(data8, coeff);
-				__m128i resHi = _mm_mulhi_epi16(data8, coeff);
-				__m128i res32bitLo = _mm_unpacklo_epi16(resLo, resHi);
-				__m128i res32bitHi = _mm_unpackhi_epi16(resLo, resHi);
-
-				// Load the 4 32-bit integers values, add the values we computed and store them back
-				__m128i res = _mm_loadu_si128((__m128i*)&tmp[x - xOffset]);
-				res = _mm_add_epi32(res, res32bitLo);
-				_mm_storeu_si128((__m128i*)&tmp[x - xOffset], res);
-				// Repeat the same operation for the next 4 values
-				res = _mm_loadu_si128((__m128i*)&tmp[x - xOffset + 4]);
-				res = _mm_add_epi32(res, res32bitHi);
-				_mm_storeu_si128((__m128i*)&tmp[x - xOffset + 4], res);
-
-				// Multiply the next 8 values by the coefficient to get 8 32-bit integers
-				data8 = _mm_unpackhi_epi8(data16, _mm_setzero_si128());
-				resLo = _mm_mullo_epi16(data8, coeff);
-				resHi = _mm_mulhi_epi16(data8, coeff);
-				res32bitLo = _mm_unpacklo_epi16(resLo, resHi);
-				res32bitHi = _mm_unpackhi_epi16(resLo, resHi);
-
-				// Load the 4 32-bit integers values, add the values we computed and store them back
-				res = _mm_loadu_si128((__m128i*)&tmp[x - xOffset + 8]);
-				res = _mm_add_epi32(res, res32bitLo);
-				_mm_storeu_si128((__m128i*)&tmp[x - xOffset + 8], res);
-				// Repeat the same operation for the next 4 values
-				res = _mm_loadu_si128((__m128i*)&tmp[x - xOffset + 12]);
-				res = _mm_add_epi32(res, res32bitHi);
-				_mm_storeu_si128((__m128i*)&tmp[x - xOffset + 12], res);
+		memcpy(line + kOffset, in, width);
+
+		for (int x = 0; x < width16; x += 16) {
+			__m128i acc[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+
+			int k = 0;
+			for (; k + 1 < kernel_size; k += 2) {
+				__m128i coeff = _mm_set1_epi32(((int)kernel[k + 1] << 16) | (unsigned short)kernel[k]);
+				SeparableFilterMadd_SSE2(_mm_loadu_si128((__m128i*)&line[x + k]), _mm_loadu_si128((__m128i*)&line[x + k + 1]), coeff, acc);
 			}
-			for (int x = xEnd16; x < xEnd; x++) {
-				tmp[x - xOffset] += (int)(in[x] * kernel[k]);
+			if (k < kernel_size) {
+				__m128i coeff = _mm_set1_epi32((unsigned short)kernel[k]);
+				SeparableFilterMadd_SSE2(_mm_loadu_si128((__m128i*)&line[x + k]), _mm_setzero_si128(), coeff, acc);
 			}
-		}
-		for (int x = 0; x < width16; x += 16) {
-			// Load 4 32-bit integer values and divide them
-			__m128i accum1 = _mm_load_si128((__m128i*)&tmp[x]);
-			accum1 = accum1 / divisorLibdivide;
-			// Repeat the same operation on the next 4 32-bit integer values
-			__m128i accum2 = _mm_load_si128((__m128i*)&tmp[x + 4]);
-			accum2 = accum2 / divisorLibdivide;
-			// Pack the 8 32-bit integers into 8 16-bit integers
-			accum1 = _mm_packs_epi32(accum1, accum2);
-
-			// Load 4 32-bit integer values and divide them
-			__m128i accum3 = _mm_load_si128((__m128i*)&tmp[x + 8]);
-			accum3 = accum3 / divisorLibdivide;
-			// Repeat the same operation on the next 4 32-bit integer values
-			__m128i accum4 = _mm_load_si128((__m128i*)&tmp[x + 12]);
-			accum4 = accum4 / divisorLibdivide;
-			// Pack the 8 32-bit integers into 8 16-bit integers
-			accum3 = _mm_packs_epi32(accum3, accum4);
-
-			// Pack the 16 16-bit integers into 16 8-bit unsigned integers
-			accum1 = _mm_packus_epi16(accum1, accum3);
-
-			// Store the 16 8-bit unsigned integers
-			_mm_store_si128((__m128i*)&out[x], accum1);
+
+			_mm_store_si128((__m128i*)&out[x], SeparableFilterPack_SSE2(acc, divisorLibdivide));
 		}
 		for (int x = width16; x < width; x++) {
-			int accum = tmp[x] / divisor;
-			if (accum > 255) {
-				accum = 255;
-			} else if (accum < 0) {
-				accum = 0;
+			int accum = 0;
+			for (int k = 0; k < kernel_size; k++) {
+				accum += line[x + k] * kernel[k];
 			}
-			out[x] = (unsigned char)accum;
+			out[x] = SeparableFilterClamp(accum / divisor);
 		}
 	}
-
-	_aligned_free(tmp);
 }
 
 
 // Filter an image in vertical direction with a one-dimensional filter
+// The image is processed in strips of SEPARABLEFILTER_BLOCK columns, the rows of the kernel stay in the cache
+// from one output row to the next
 void SeparableFilterY_SSE2(unsigned char* src, unsigned char* dst, int width, int height, ptrdiff_t stride,
 						   short* kernel, int kernel_size, int divisor)
 {
+	int kOffset = kernel_size / 2;
 	int width16 = width & ~15;
-	int* tmp = (int*)_aligned_malloc(stride * sizeof(int), 16);
 	libdivide::divider<int> divisorLibdivide(divisor);
 
-#ifdef _OPENMP
-	#pragma omp parallel for
-#endif
-	for (int y = 0; y < height; y++) {
-		ZeroMemory(tmp, stride * sizeof(int));
+	for (int xStart = 0; xStart < width16; xStart += SEPARABLEFILTER_BLOCK) {
+		int xEnd = min(xStart + SEPARABLEFILTER_BLOCK, width16);
+
+		for (int y = 0; y < height; y++) {
+			int kStart = max(0, kOffset - y);
+			int kEnd = min(kernel_size, height - y + kOffset);
+			unsigned char* out = dst + y * stride;
+
+			for (int x = xStart; x < xEnd; x += 16) {
+				const unsigned char* in = src + x;
+				__m128i acc[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+
+				int k = kStart;
+				for (; k + 1 < kEnd; k += 2) {
+					__m128i coeff = _mm_set1_epi32(((int)kernel[k + 1] << 16) | (unsigned short)kernel[k]);
+					SeparableFilterMadd_SSE2(_mm_load_si128((__m128i*)&in[(y + k - kOffset) * stride]),
+											 _mm_load_si128((__m128i*)&in[(y + k + 1 - kOffset) * stride]), coeff, acc);
+				}
+				if (k < kEnd) {
+					__m128i coeff = _mm_set1_epi32((unsigned short)kernel[k]);
+					SeparableFilterMadd_SSE2(_mm_load_si128((__m128i*)&in[(y + k - kOffset) * stride]), _mm_setzero_si128(), coeff, acc);
+				}
+
+				_mm_store_si128((__m128i*)&out[x], SeparableFilterPack_SSE2(acc, divisorLibdivide));
+			}
+		}
+	}
 
-		const unsigned char* in = src + y * stride;
+	for (int y = 0; y < height; y++) {
+		int kStart = max(0, kOffset - y);
+		int kEnd = min(kernel_size, height - y + kOffset);
 		unsigned char* out = dst + y * stride;
 
-		int kOffset = kernel_size / 2;
-		int kStart = 0;
-		int kEnd = kernel_size;
-		if (y < kOffset) { // 0 > y - kOffset
-			kStart += kOffset - y;
-		} else if (height <= y + kOffset) {
-			kEnd -= kOffset + y + 1 - height;
+		for (int x = width16; x < width; x++) {
+			int accum = 0;
+			for (int k = kStart; k < kEnd; k++) {
+				accum += src[(y + k - kOffset) * stride + x] * kernel[k];
+			}
+			out[x] = SeparableFilterClamp(accum / divisor);
 		}
-		for (int k = kStart; k < kEnd; k++) {
-			__m128i coeff = _mm_set1_epi16(kernel[k]);
-			for (int x = 0; x < width16; x += 16) {
-				// Load 16 values
-				__m128i data16 = _mm_load_si128((__m128i*)&in[(k - kOffset) * stride + x]);
-
-				// Multiply the first 8 values by the coefficient to get 8 32-bit integers
-				__m128i data8 = _mm_unpacklo_epi8(data16, _mm_setzero_si128());
-				__m128i resLo = _mm_mullo_epi16(data8, coeff);
-				__m128i resHi = _mm_mulhi_epi16(data8, coeff);
-				__m128i res32bitLo = _mm_unpacklo_epi16(resLo, resHi);
-				__m128i res32bitHi = _mm_unpackhi_epi16(resLo, resHi);
-
-				// Load the 4 32-bit integers values, add the values we computed and store them back
-				__m128i res = _mm_load_si128((__m128i*)&tmp[x]);
-				res = _mm_add_epi32(res, res32bitLo);
-				_mm_store_si128((__m128i*)&tmp[x], res);
-				// Repeat the same operation for the next 4 values
-				res = _mm_load_si128((__m128i*)&tmp[x + 4]);
-				res = _mm_add_epi32(res, res32bitHi);
-				_mm_store_si128((__m128i*)&tmp[x + 4], res);
-
-				// Multiply the next 8 values by the coefficient to get 8 32-bit integers
-				data8 = _mm_unpackhi_epi8(data16, _mm_setzero_si128());
-				resLo = _mm_mullo_epi16(data8, coeff);
-				resHi = _mm_mulhi_epi16(data8, coeff);
-				res32bitLo = _mm_unpacklo_epi16(resLo, resHi);
-				res32bitHi = _mm_unpackhi_epi16(resLo, resHi);
-
-				// Load the 4 32-bit integers values, add the values we computed and store them back
-				res = _mm_load_si128((__m128i*)&tmp[x + 8]);
-				res = _mm_add_epi32(res, res32bitLo);
-				_mm_store_si128((__m128i*)&tmp[x + 8], res);
-				// Repeat the same operation for the next 4 values
-				res = _mm_load_si128((__m128i*)&tmp[x + 12]);
-				res = _mm_add_epi32(res, res32bitHi);
-				_mm_store_si128((__m128i*)&tmp[x + 12], res);
+	}
+}
+
+
+// Box blur in horizontal direction in place, pixels outside of the image count as zero
+// line is scratch memory of at least width bytes
+void BoxFilterX(unsigned char* buffer, int width, int height, ptrdiff_t stride, int boxsize, unsigned char* line)
+{
+	int r = boxsize / 2;
+	unsigned int mul = (1 << 16) / boxsize;
+
+	for (int y = 0; y < height; y++) {
+		unsigned char* row = buffer + y * stride;
+		memcpy(line, row, width);
+
+		// running sum of the window [x - r, x + r]
+		unsigned int sum = 0;
+		for (int x = 0; x < r && x < width; x++) {
+			sum += line[x];
+		}
+		for (int x = 0; x < width; x++) {
+			if (x + r < width) {
+				sum += line[x + r];
 			}
-			for (int x = width16; x < width; x++) {
-				tmp[x] += (int)(in[(k - kOffset) * stride + x] * kernel[k]);
+			if (x - r - 1 >= 0) {
+				sum -= line[x - r - 1];
 			}
+			row[x] = (unsigned char)((sum * mul + 0x8000) >> 16);
 		}
-		for (int x = 0; x < width16; x += 16) {
-			// Load 4 32-bit integer values and divide them
-			__m128i accum1 = _mm_load_si128((__m128i*)&tmp[x]);
-			accum1 = accum1 / divisorLibdivide;
-			// Repeat the same operation on the next 4 32-bit integer values
-			__m128i accum2 = _mm_load_si128((__m128i*)&tmp[x + 4]);
-			accum2 = accum2 / divisorLibdivide;
-			// Pack the 8 32-bit integers into 8 16-bit integers
-			accum1 = _mm_packs_epi32(accum1, accum2);
-
-			// Load 4 32-bit integer values and divide them
-			__m128i accum3 = _mm_load_si128((__m128i*)&tmp[x + 8]);
-			accum3 = accum3 / divisorLibdivide;
-			// Repeat the same operation on the next 4 32-bit integer values
-			__m128i accum4 = _mm_load_si128((__m128i*)&tmp[x + 12]);
-			accum4 = accum4 / divisorLibdivide;
-			// Pack the 8 32-bit integers into 8 16-bit integers
-			accum3 = _mm_packs_epi32(accum3, accum4);
-
-			// Pack the 16 16-bit integers into 16 8-bit unsigned integers
-			accum1 = _mm_packus_epi16(accum1, accum3);
-
-			// Store the 16 8-bit unsigned integers
-			_mm_store_si128((__m128i*)&out[x], accum1);
+	}
+}
+
+// Box blur in vertical direction, pixels outside of the image count as zero
+// sums is scratch memory of at least width ints
+void BoxFilterY(unsigned char* src, unsigned char* dst, int width, int height, ptrdiff_t stride, int boxsize, unsigned int* sums)
+{
+	int r = boxsize / 2;
+	unsigned int mul = (1 << 16) / boxsize;
+
+	// running sums of the rows [y - r, y + r], row by row so the loops stay sequential in memory
+	ZeroMemory(sums, width * sizeof(unsigned int));
+	for (int y = 0; y < r && y < height; y++) {
+		const unsigned char* in = src + y * stride;
+		for (int x = 0; x < width; x++) {
+			sums[x] += in[x];
 		}
-		for (int x = width16; x < width; x++) {
-			int accum = tmp[x] / divisor;
-			if (accum > 255) {
-				accum = 255;
-			} else if (accum < 0) {
-				accum = 0;
+	}
+	for (int y = 0; y < height; y++) {
+		if (y + r < height) {
+			const unsigned char* in = src + (y + r) * stride;
+			for (int x = 0; x < width; x++) {
+				sums[x] += in[x];
+			}
+		}
+		if (y - r - 1 >= 0) {
+			const unsigned char* in = src + (y - r - 1) * stride;
+			for (int x = 0; x < width; x++) {
+				sums[x] -= in[x];
 			}
-			out[x] = (unsigned char)accum;
+		}
+		unsigned char* out = dst + y * stride;
+		for (int x = 0; x < width; x++) {
+			out[x] = (unsigned char)((sums[x] * mul + 0x8000) >> 16);
 		}
 	}
-
-	_aligned_free(tmp);
 }
 
 
@@ -363,6 +343,29 @@ struct GaussianKernel {
 		}
 	}
 
+	// sizes of three successive box blurs with the same variance as the kernel
+	inline void GetBoxSizes(int sizes[3]) const {
+		double variance = 0.0;
+		for (int x = 0; x < width; x++) {
+			variance += (double)kernel[x] * (x - width / 2) * (x - width / 2);
+		}
+		variance /= divisor;
+
+		int wl = (int)sqrt(12.0 * variance / 3 + 1.0);
+		if (!(wl & 1)) {
+			wl--;
+		}
+		if (wl < 1) {
+			wl = 1;
+		}
+		int wu = wl + 2;
+		int m = (int)floor((12.0 * variance - 3 * wl * wl - 12 * wl - 9) / (-4.0 * wl - 4.0) + 0.5);
+
+		for (int i = 0; i < 3; i++) {
+			sizes[i] = i < m ? wl : wu;
+		}
+	}
+
 	inline ~GaussianKernel() {
 		delete [] kernel;
 	}
@@ -208,12 +208,18 @@ CString FindLangFromId(WORD id)
 CVobSubFile::CVobSubFile(CCritSec* pLock)
 	: CSubPicProviderImpl(pLock)
 	, m_sub(1024*1024)
+	, m_hSubFile(INVALID_HANDLE_VALUE)
+	, m_hSubMapping(NULL)
+	, m_pSubView(NULL)
+	, m_nSubView(0)
+	, m_rtRendered(-1)
 	, m_iLang(0)
 {
 }
 
 CVobSubFile::~CVobSubFile()
 {
+	CloseSub();
 }
 
 //
@@ -226,7 +232,10 @@ bool CVobSubFile::Copy(CVobSubFile& vsf)
 	m_title = vsf.m_title;
 	m_iLang = vsf.m_iLang;
 
-	m_sub.SetLength(vsf.m_sub.GetLength());
+	// the source may be memory mapped and have an empty m_sub
+	__int64 len = 0;
+	vsf.GetSubData(len);
+	m_sub.SetLength(len);
 	m_sub.SeekToBegin();
 
 	for (size_t i = 0; i < 32; i++) {
@@ -238,19 +247,19 @@ bool CVobSubFile::Copy(CVobSubFile& vsf)
 		dst.alt = src.alt;
 
 		for (size_t j = 0; j < src.subpos.GetCount(); j++) {
-			SubPos& sp = src.subpos[j];
+			SubPos sp = src.subpos[j];
 			if (!sp.fValid) {
 				continue;
 			}
 
-			if (sp.filepos != (__int64)vsf.m_sub.Seek(sp.filepos, CFile::begin)) {
+			__int64 filepos = sp.filepos;
+			const BYTE* buff = vsf.GetPack(filepos);
+			if (!buff) {
 				continue;
 			}
 
 			sp.filepos = m_sub.GetPosition();
 
-			BYTE buff[2048];
-			vsf.m_sub.Read(buff, 2048);
 			m_sub.Write(buff, 2048);
 
 			WORD packetsize = (buff[buff[0x16]+0x18]<<8) | buff[buff[0x16]+0x19];
@@ -262,10 +271,13 @@ bool CVobSubFile::Copy(CVobSubFile& vsf)
 				size = min(sizeleft, 2048 - hsize);
 
 				if (size != sizeleft) {
-					while (vsf.m_sub.Read(buff, 2048)) {
-						if (!(buff[0x15]&0x80) && buff[buff[0x16]+0x17] == (i|0x20)) {
-							break;
-						}
+					do {
+						filepos += 2048;
+						buff = vsf.GetPack(filepos);
+					} while (buff && ((buff[0x15]&0x80) || buff[buff[0x16]+0x17] != (i|0x20)));
+
+					if (!buff) {
+						break;
 					}
 
 					m_sub.Write(buff, 2048);
@@ -325,7 +337,7 @@ bool CVobSubFile::Open(CString fn)
 				sp[j].fForced = false;
 
 				int packetsize = 0, datasize = 0;
-				BYTE* buff = GetPacket((int)j, packetsize, datasize, i);
+				const BYTE* buff = GetPacket((int)j, packetsize, datasize, i);
 				if (!buff) {
 					sp[j].fValid = false;
 					continue;
@@ -344,8 +356,6 @@ bool CVobSubFile::Open(CString fn)
 				if (j > 0 && sp[j-1].stop > sp[j].start) {
 					sp[j-1].stop = sp[j].start;
 				}
-
-				delete [] buff;
 			}
 		}
 
@@ -361,6 +371,12 @@ bool CVobSubFile::Save(CString fn, SubFormat sf)
 {
 	TrimExtension(fn);
 
+	// a mapped file can't be truncated, let go of it when it is about to be overwritten
+	// (the caller holds the subtitle lock, nothing is reading the view meanwhile)
+	if (m_pSubView && !m_subfn.CompareNoCase(fn + _T(".sub"))) {
+		UnmapSub();
+	}
+
 	CVobSubFile vsf(NULL);
 	if (!vsf.Copy(*this)) {
 		return false;
@@ -387,6 +403,7 @@ void CVobSubFile::Close()
 	InitSettings();
 	m_title.Empty();
 	m_sub.SetLength(0);
+	CloseSub();
 	m_img.Invalidate();
 	m_iLang = -1;
 	for (size_t i = 0; i < 32; i++) {
@@ -731,8 +748,104 @@ bool CVobSubFile::ReadIdx(CString fn, int& ver)
 	return !fError;
 }
 
+void CVobSubFile::CloseSub()
+{
+	if (m_pSubView) {
+		UnmapViewOfFile(m_pSubView);
+		m_pSubView = NULL;
+	}
+	if (m_hSubMapping) {
+		CloseHandle(m_hSubMapping);
+		m_hSubMapping = NULL;
+	}
+	if (m_hSubFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_hSubFile);
+		m_hSubFile = INVALID_HANDLE_VALUE;
+	}
+	m_nSubView = 0;
+	m_subfn.Empty();
+	m_packet.RemoveAll();
+}
+
+// copy the mapped .sub into m_sub and release the file, so that it can be overwritten
+void CVobSubFile::UnmapSub()
+{
+	if (!m_pSubView) {
+		return;
+	}
+
+	m_sub.SetLength(m_nSubView);
+	m_sub.SeekToBegin();
+
+	for (__int64 pos = 0; pos < m_nSubView; pos += 1024*1024) {
+		m_sub.Write(&m_pSubView[pos], (UINT)min(m_nSubView - pos, 1024*1024));
+	}
+
+	UnmapViewOfFile(m_pSubView);
+	m_pSubView = NULL;
+	m_nSubView = 0;
+	CloseHandle(m_hSubMapping);
+	m_hSubMapping = NULL;
+	CloseHandle(m_hSubFile);
+	m_hSubFile = INVALID_HANDLE_VALUE;
+	m_subfn.Empty();
+}
+
+const BYTE* CVobSubFile::GetSubData(__int64& len) const
+{
+	if (m_pSubView) {
+		len = m_nSubView;
+		return m_pSubView;
+	}
+
+	len = m_sub.GetLength();
+	return m_sub.GetData();
+}
+
+// the 0x800 byte PS pack at filepos, NULL when it is outside of the file or not a pack
+const BYTE* CVobSubFile::GetPack(__int64 filepos) const
+{
+	__int64 len;
+	const BYTE* data = GetSubData(len);
+
+	if (!data || filepos < 0 || filepos + 0x800 > len
+			|| *(DWORD*)&data[filepos] != 0xba010000) {
+		return NULL;
+	}
+
+	return &data[filepos];
+}
+
 bool CVobSubFile::ReadSub(CString fn)
 {
+	CloseSub();
+
+	// map the file instead of copying it, the packs are only touched when their subpictures are needed
+	// the file stays open while the subtitles are loaded, don't keep it from being renamed or deleted
+	HANDLE hFile = CreateFile(fn, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0) {
+		if (HANDLE hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL)) {
+			if (const BYTE* pView = (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0)) {
+				m_hSubFile		= hFile;
+				m_hSubMapping	= hMapping;
+				m_pSubView		= pView;
+				m_nSubView		= size.QuadPart;
+				m_subfn			= fn;
+
+				return true;
+			}
+			CloseHandle(hMapping);
+		}
+	}
+
+	CloseHandle(hFile);
+
+	// no room for the view in the address space, fall back to a copy in memory
 	CFile f;
 	if (!f.Open(fn, CFile::modeRead|CFile::typeBinary|CFile::shareDenyNone)) {
 		return false;
@@ -1067,16 +1180,14 @@ bool CVobSubFile::WriteSub(CString fn)
 		return false;
 	}
 
-	if (m_sub.GetLength() == 0) {
+	__int64 len;
+	const BYTE* data = GetSubData(len);
+	if (!data || len == 0) {
 		return true;	// nothing to do...
 	}
 
-	m_sub.SeekToBegin();
-
-	int len;
-	BYTE buff[2048];
-	while ((len = m_sub.Read(buff, sizeof(buff))) > 0 && *(DWORD*)buff == 0xba010000) {
-		f.Write(buff, len);
+	for (__int64 pos = 0; pos + 4 <= len && *(DWORD*)&data[pos] == 0xba010000; pos += 2048) {
+		f.Write(&data[pos], (UINT)min(len - pos, 2048));
 	}
 
 	return true;
@@ -1084,68 +1195,60 @@ bool CVobSubFile::WriteSub(CString fn)
 
 //
 
-BYTE* CVobSubFile::GetPacket(int idx, int& packetsize, int& datasize, int iLang)
+const BYTE* CVobSubFile::GetPacket(int idx, int& packetsize, int& datasize, int iLang)
 {
-	BYTE* ret = NULL;
-
 	if (iLang < 0 || iLang >= 32) {
 		iLang = m_iLang;
 	}
 	CAtlArray<SubPos>& sp = m_langs[iLang].subpos;
 
-	do {
-		if (idx < 0 || (size_t)idx >= sp.GetCount()) {
-			break;
-		}
+	if (idx < 0 || (size_t)idx >= sp.GetCount()) {
+		return NULL;
+	}
 
-		if ((__int64)m_sub.Seek(sp[idx].filepos, CFile::begin) != sp[idx].filepos) {
-			break;
-		}
+	__int64 filepos = sp[idx].filepos;
+	const BYTE* buff = GetPack(filepos);
 
-		BYTE buff[0x800];
-		if (sizeof(buff) != m_sub.Read(buff, sizeof(buff))) {
-			break;
-		}
+	// let's check a few things to make sure...
+	if (!buff
+			|| *(DWORD*)&buff[0x0e] != 0xbd010000
+			|| !(buff[0x15] & 0x80)
+			|| (buff[0x17] & 0xf0) != 0x20
+			|| (buff[buff[0x16] + 0x17] & 0xe0) != 0x20
+			|| (buff[buff[0x16] + 0x17] & 0x1f) != iLang) {
+		return NULL;
+	}
 
-		// let's check a few things to make sure...
-		if (*(DWORD*)&buff[0x00] != 0xba010000
-				|| *(DWORD*)&buff[0x0e] != 0xbd010000
-				|| !(buff[0x15] & 0x80)
-				|| (buff[0x17] & 0xf0) != 0x20
-				|| (buff[buff[0x16] + 0x17] & 0xe0) != 0x20
-				|| (buff[buff[0x16] + 0x17] & 0x1f) != iLang) {
-			break;
-		}
+	packetsize = (buff[buff[0x16] + 0x18] << 8) + buff[buff[0x16] + 0x19];
+	datasize = (buff[buff[0x16] + 0x1a] << 8) + buff[buff[0x16] + 0x1b];
 
-		packetsize = (buff[buff[0x16] + 0x18] << 8) + buff[buff[0x16] + 0x19];
-		datasize = (buff[buff[0x16] + 0x1a] << 8) + buff[buff[0x16] + 0x1b];
+	int hsize = 0x18 + buff[0x16];
+	if (packetsize <= 0x800 - hsize) {
+		// the whole SPU is in the first pack, use it in place
+		return &buff[hsize];
+	}
 
-		ret = DNew BYTE[packetsize];
-		if (!ret) {
-			break;
-		}
+	m_packet.SetCount(packetsize);
 
-		int i = 0, sizeleft = packetsize;
-		for (int size; i < packetsize; i += size, sizeleft -= size) {
-			int hsize = 0x18 + buff[0x16];
-			size = min(sizeleft, 0x800 - hsize);
-			memcpy(&ret[i], &buff[hsize], size);
+	for (int i = 0, size; i < packetsize; i += size) {
+		hsize = 0x18 + buff[0x16];
+		size = min(packetsize - i, 0x800 - hsize);
+		memcpy(&m_packet[i], &buff[hsize], size);
 
-			if (size != sizeleft) {
-				while (m_sub.Read(buff, sizeof(buff))) {
-					if (/*!(buff[0x15] & 0x80) &&*/ buff[buff[0x16] + 0x17] == (iLang|0x20)) {
-						break;
-					}
-				}
-			}
-		}
+		if (i + size < packetsize) {
+			// the packs of the other streams are interleaved, skip to the next one of ours
+			do {
+				filepos += 0x800;
+				buff = GetPack(filepos);
+			} while (buff && buff[buff[0x16] + 0x17] != (iLang|0x20));
 
-		if (i != packetsize || sizeleft > 0) {
-			SAFE_DELETE_ARRAY(ret);
+			if (!buff) {
+				return NULL;
+			}
 		}
-	} while (false);
+	}
 
-	return ret;
+	return m_packet.GetData();
 }
 
 const CVobSubFile::SubPos* CVobSubFile::GetFrameInfo(int idx, int iLang /*= -1*/) const
@@ -1178,8 +1281,7 @@ bool CVobSubFile::GetFrame(int idx, int iLang /*= -1*/, REFERENCE_TIME rt /*= -1
 	if (m_img.iLang != iLang || m_img.iIdx != idx
 			|| (sp[idx].bAnimated && sp[idx].start + m_img.tCurrent <= rt)) {
 		int packetsize = 0, datasize = 0;
-		CAutoVectorPtr<BYTE> buff;
-		buff.Attach(GetPacket(idx, packetsize, datasize, iLang));
+		const BYTE* buff = GetPacket(idx, packetsize, datasize, iLang);
 		if (!buff || packetsize <= 0 || datasize <= 0) {
 			return false;
 		}
@@ -1320,6 +1422,9 @@ STDMETHODIMP CVobSubFile::Render(SubPicDesc& spd, REFERENCE_TIME rt, double fps,
 		return E_INVALIDARG;
 	}
 
+	m_rtRendered = -1;
+
+	const REFERENCE_TIME rtRender = rt;
 	rt /= 10000;
 
 	if (!GetFrame(GetFrameIdxByTimeStamp(rt), -1, rt)) {
@@ -1334,7 +1439,36 @@ STDMETHODIMP CVobSubFile::Render(SubPicDesc& spd, REFERENCE_TIME rt, double fps,
 		return E_FAIL;
 	}
 
-	return __super::Render(spd, bbox);
+	HRESULT hr = __super::Render(spd, bbox);
+	if (SUCCEEDED(hr)) {
+		m_rtRendered = rtRender;
+	}
+
+	return hr;
+}
+
+// ISubPicProvider2
+
+STDMETHODIMP CVobSubFile::GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, double fps, RECT& rcChanged)
+{
+	SetRectEmpty(&rcChanged);
+
+	if (m_rtRendered < 0 || rtFrom != m_rtRendered
+			|| m_img.iIdx < 0 || m_img.iLang != m_iLang) {
+		return S_FALSE;
+	}
+
+	// a still picture is redrawn identically as long as the same SPU stays on screen
+	rtTo /= 10000;
+
+	int idx = GetFrameIdxByTimeStamp(rtTo);
+	const SubPos* sp = GetFrameInfo(idx);
+	if (!sp || sp->bAnimated || idx != m_img.iIdx
+			|| rtTo < m_img.start || rtTo >= (m_img.start + m_img.delay)) {
+		return S_FALSE;
+	}
+
+	return S_OK;
 }
 
 // IPersist
@@ -77,6 +77,14 @@ public:
 	void SetAlignment(bool fAlign, int x, int y, int hor = 1, int ver = 1);
 };
 
+class CVobSubMemFile : public CMemFile
+{
+public:
+	CVobSubMemFile(UINT nGrowBytes) : CMemFile(nGrowBytes) {}
+
+	const BYTE* GetData() const { return m_lpBuffer; }
+};
+
 class __declspec(uuid("998D4C9A-460F-4de6-BDCD-35AB24F94ADF"))
 	CVobSubFile : public CVobSubSettings, public ISubStream, public CSubPicProviderImpl
 {
@@ -102,9 +110,25 @@ protected:
 	bool ReadIdx(CString fn, int& ver), ReadSub(CString fn), ReadRar(CString fn), ReadIfo(CString fn);
 	bool WriteIdx(CString fn), WriteSub(CString fn);
 
-	CMemFile m_sub;
+	CVobSubMemFile m_sub; // .sub built in memory (rar, ripper, Copy())
 
-	BYTE* GetPacket(int idx, int& packetsize, int& datasize, int iLang = -1);
+	// the .sub file mapped read-only, used instead of m_sub when it is set
+	HANDLE m_hSubFile, m_hSubMapping;
+	const BYTE* m_pSubView;
+	__int64 m_nSubView;
+	CString m_subfn;
+	void CloseSub();
+	void UnmapSub();
+
+	const BYTE* GetSubData(__int64& len) const;
+	const BYTE* GetPack(__int64 filepos) const;
+
+	CAtlArray<BYTE> m_packet; // SPU reassembled from several PS packs
+
+	REFERENCE_TIME m_rtRendered; // time of the last successful Render(), -1 if none
+
+	// the returned data stays valid until the next call
+	const BYTE* GetPacket(int idx, int& packetsize, int& datasize, int iLang = -1);
 	const SubPos* GetFrameInfo(int idx, int iLang = -1) const;
 	bool GetFrame(int idx, int iLang = -1, REFERENCE_TIME rt = -1);
 	bool GetFrameByTimeStamp(__int64 time);
@@ -151,6 +175,9 @@ public:
 
 	STDMETHODIMP_(SUBTITLE_TYPE) GetType(POSITION pos) { return ST_VOBSUB; };
 
+	// ISubPicProvider2
+	STDMETHODIMP GetChangedRect(REFERENCE_TIME rtFrom, REFERENCE_TIME rtTo, double fps, RECT& rcChanged);
+
 	// IPersist
 	STDMETHODIMP GetClassID(CLSID* pClassID);
 
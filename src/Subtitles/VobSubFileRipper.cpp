@@ -832,10 +832,9 @@ bool CVobSubFileRipper::Create()
 
 				sp[j].fValid = false;
 				int packetsize = 0, datasize = 0;
-				if (BYTE* buff = GetPacket((int)j, packetsize, datasize, (int)i)) {
+				if (const BYTE* buff = GetPacket((int)j, packetsize, datasize, (int)i)) {
 					m_img.GetPacketInfo(buff, packetsize, datasize);
 					sp[j].fValid = m_img.fForced;
-					delete [] buff;
 				}
 			}
 
@@ -88,7 +88,7 @@ void CVobSubImage::Free()
 	lpPixels = NULL;
 }
 
-bool CVobSubImage::Decode(BYTE* lpData, int packetsize, int datasize, int t,
+bool CVobSubImage::Decode(const BYTE* lpData, int packetsize, int datasize, int t,
 						  bool fCustomPal,
 						  int tridx,
 						  RGBQUAD* orgpal /*[16]*/, RGBQUAD* cuspal /*[4]*/,
@@ -76,7 +76,7 @@ public:
 	void Invalidate() { iLang = iIdx = -1; }
 
 	void GetPacketInfo(const BYTE* lpData, int packetsize, int datasize, int t = INT_MAX);
-	bool Decode(BYTE* lpData, int packetsize, int datasize, int t,
+	bool Decode(const BYTE* lpData, int packetsize, int datasize, int t,
 				bool fCustomPal,
 				int tridx,
 				RGBQUAD* orgpal /*[16]*/, RGBQUAD* cuspal /*[4]*/,
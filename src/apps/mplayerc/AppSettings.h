@@ -680,6 +680,7 @@ public:
 	// Subtitles - Rendering
 	bool			fOverridePlacement;
 	int				nHorPos, nVerPos;
+	bool			fFastBlur;
 	int				nSubDelayInterval;
 
 	// Subtitles - Default Style
@@ -16819,6 +16819,7 @@ void CMainFrame::SetSubtitle(ISubStream* pSubStream, int iSubtitleSel/* = -1*/,
 
 			pRTS->SetOverride(s.fUseDefaultSubtitlesStyle, s.subdefstyle);
 			pRTS->SetAlignment(s.fOverridePlacement, s.nHorPos, s.nVerPos);
+			pRTS->SetFastBlur(s.fFastBlur);
 			pRTS->Deinit();
 		} else if (clsid == __uuidof(CRenderedHdmvSubtitle) || clsid == __uuidof(CSupSubFile) || clsid == __uuidof(CXSUBSubtitle)) {
 			s.m_RenderersSettings.bPositionRelative	= s.subdefstyle.relativeTo;
@@ -110,6 +110,7 @@
 #define IDS_RS_SPOVERRIDEPLACEMENT			_T("SPOverridePlacement")
 #define IDS_RS_SPHORPOS						_T("SPHorPos")
 #define IDS_RS_SPVERPOS						_T("SPVerPos")
+#define IDS_RS_SPFASTBLUR					_T("SPFastBlur")
 
 #define IDS_RS_SPCSIZE						_T("SPCSize")
 #define IDS_RS_SPMAXTEXRES					_T("SPMaxTexRes")
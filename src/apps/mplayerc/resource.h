@@ -421,6 +421,7 @@
 #define IDS_MPEGSPLITTER_SUB_ORDER      7205
 #define IDS_MPEGSPLITTER_TRUEHD_OUTPUT  7207
 #define IDS_MPEGSPLITTER_SUB_EMPTY_PIN  7212
+#define IDS_MPEGSPLITTER_SEEK_INDEX_CACHE 7213
 // audio decoder
 #define IDS_MPADEC_SAMPLE_FMT           7300
 #define IDS_MPADEC_DRC                  7301
@@ -479,6 +480,7 @@
 #define IDS_MPEG2_HUE                   7508
 #define IDS_MPEG2_SATURATION            7509
 #define IDS_MPEG2_READ_AR               7511
+#define IDS_MPEG2_SLICE_THREADS         7512
 // audio renderer
 #define IDS_ARS_WASAPI_MODE             7600
 #define IDS_ARS_MUTE_FAST_FORWARD       7601
@@ -493,6 +495,7 @@
 // matroska splitter
 #define IDS_MKVSPLT_LOAD_EMBEDDED_FONTS 7700
 #define IDS_MKVSPLT_CALC_DURATION       7701
+#define IDS_MKVSPLT_SEEK_INDEX_CACHE    7702
 // VTS reader
 #define IDS_VTSREADER_LOAD_PGC          7800
 ////////////////////////////////////////////
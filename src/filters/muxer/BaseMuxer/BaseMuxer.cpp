@@ -24,6 +24,7 @@
 #include <aviriff.h>
 #include <atlpath.h>
 #include "BaseMuxer.h"
+#include "../../../DSUtil/BufferedStream.h"
 #include <InitGuid.h>
 #include <moreuuids.h>
 #include <basestruct.h>
@@ -261,6 +262,12 @@ void CBaseMuxerFilter::MuxFooterInternal()
 
 	MuxFooter();
 
+	// the tail of the file is still buffered, a failed write must abort like any other
+	HRESULT hr = m_pOutput->Commit();
+	if (FAILED(hr)) {
+		throw hr;
+	}
+
 	//
 
 	POSITION pos = m_pPins.GetHeadPosition();
@@ -268,6 +275,9 @@ void CBaseMuxerFilter::MuxFooterInternal()
 		if (CBaseMuxerInputPin* pInput = m_pPins.GetNext(pos))
 			if (CBaseMuxerRawOutputPin* pOutput = dynamic_cast<CBaseMuxerRawOutputPin*>(pInput->GetRelatedPin())) {
 				pOutput->MuxFooter(pInput->CurrentMediaType());
+				if (FAILED(hr = pOutput->Commit())) {
+					throw hr;
+				}
 			}
 	}
 }
@@ -952,16 +962,28 @@ IBitStream* CBaseMuxerOutputPin::GetBitStream()
 {
 	if (!m_pBitStream) {
 		if (CComQIPtr<IStream> pStream = GetConnected()) {
-			m_pBitStream = DNew CBitStream(pStream, true);
+			m_pBufferedStream = (IStream*)DNew CBufferedStream(pStream);
+			m_pBitStream = DNew CBitStream(m_pBufferedStream, true);
 		}
 	}
 
 	return m_pBitStream;
 }
 
+HRESULT CBaseMuxerOutputPin::Commit()
+{
+	if (!m_pBitStream) {
+		return S_OK;
+	}
+
+	m_pBitStream->BitFlush();
+	return m_pBufferedStream->Commit(STGC_DEFAULT);
+}
+
 HRESULT CBaseMuxerOutputPin::BreakConnect()
 {
 	m_pBitStream = NULL;
+	m_pBufferedStream = NULL;
 
 	return __super::BreakConnect();
 }
@@ -1019,6 +1041,7 @@ HRESULT CBaseMuxerOutputPin::GetMediaType(int iPosition, CMediaType* pmt)
 HRESULT CBaseMuxerOutputPin::DeliverEndOfStream()
 {
 	m_pBitStream = NULL;
+	m_pBufferedStream = NULL;
 
 	return __super::DeliverEndOfStream();
 }
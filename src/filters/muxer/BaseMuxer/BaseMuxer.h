@@ -163,12 +163,14 @@ public:
 class CBaseMuxerOutputPin : public CBaseOutputPin
 {
 	CComPtr<IBitStream> m_pBitStream;
+	CComPtr<IStream> m_pBufferedStream;
 
 public:
 	CBaseMuxerOutputPin(LPCWSTR pName, CBaseFilter* pFilter, CCritSec* pLock, HRESULT* phr);
 	virtual ~CBaseMuxerOutputPin() {}
 
 	IBitStream* GetBitStream();
+	HRESULT Commit(); // writes out the buffered data, returns the first write error
 
 	HRESULT BreakConnect();
 
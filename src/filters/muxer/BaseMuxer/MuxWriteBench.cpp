@@ -0,0 +1,193 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// MuxWriteBench - mux throughput of CBitStream on a file with and without CBufferedStream, not part of the build
+//
+//   build it as a console program from this file with the BaseMuxer, DSUtil and BaseClasses libraries
+//
+//   MuxWriteBench [MB]   output size per run, default 1024
+//
+// Both runs write the same muxer-like pattern into a file in the temp folder: a header with a reserved
+// seek head, clusters with a size field that is back-filled when the cluster is done, and packets with
+// bit-written DSM-style headers, byte-sized fields and payloads of 200 bytes to 20 kB. At the end the
+// seek head is patched in. The files have to be identical, exits with 1 when they aren't.
+//
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <Shlwapi.h>
+#include "BaseMuxer.h"
+#include "../../../DSUtil/BufferedStream.h"
+
+#pragma comment(lib, "Shlwapi.lib")
+
+#define SEEKHEAD_SIZE		4096
+#define CLUSTER_PACKETS		200
+
+static void WritePattern(IBitStream* pBS, UINT64 size)
+{
+	BYTE payload[20000];
+	for (int i = 0; i < _countof(payload); i++) {
+		payload[i] = (BYTE)(i * 7 + (i >> 8));
+	}
+
+	pBS->ByteWrite("\x1A\x45\xDF\xA3 mux write bench", 21);
+
+	const UINT64 seekheadPos = pBS->GetPos();
+	BYTE reserved[SEEKHEAD_SIZE] = {0};
+	pBS->ByteWrite(reserved, sizeof(reserved));
+
+	CAtlArray<UINT64> clusters;
+	unsigned rnd = 1;
+	UINT64 timecode = 0;
+
+	while (pBS->GetPos() < size) {
+		const UINT64 clusterPos = pBS->GetPos();
+		clusters.Add(clusterPos);
+		pBS->BitWrite(0x1F43B675, 32);
+		pBS->BitWrite(0, 64);	// size, back-filled
+
+		for (int i = 0; i < CLUSTER_PACKETS; i++, timecode += 400000) {
+			rnd = rnd * 1103515245u + 12345u;
+			const int len = 200 + (rnd >> 8) % (_countof(payload) - 200);
+
+			pBS->BitWrite(0x44534D, 24);		// sync
+			pBS->BitWrite(1, 1);				// packet type
+			pBS->BitWrite(3, 2);				// length size
+			pBS->BitWrite(0, 5);
+			pBS->BitWrite(len, 32);
+			for (int j = 40; j >= 0; j -= 8) {	// byte-wise like the EBML integer writers
+				pBS->BitWrite(timecode >> j, 8);
+			}
+			pBS->ByteWrite(payload, len);
+		}
+
+		const UINT64 end = pBS->GetPos();
+		pBS->Seek(clusterPos + 4);
+		pBS->BitWrite(end - clusterPos - 12, 64);
+		pBS->Seek(end);
+	}
+
+	const UINT64 end = pBS->GetPos();
+	pBS->Seek(seekheadPos);
+	for (size_t i = 0; i < clusters.GetCount() && i < SEEKHEAD_SIZE / 8; i++) {
+		pBS->BitWrite(clusters[i], 64);
+	}
+	pBS->Seek(end);
+}
+
+static HRESULT Run(LPCWSTR path, bool bBuffered, UINT64 size, double& seconds)
+{
+	CComPtr<IStream> pFileStream;
+	HRESULT hr = SHCreateStreamOnFileEx(path, STGM_CREATE | STGM_WRITE | STGM_SHARE_DENY_WRITE, FILE_ATTRIBUTE_NORMAL, TRUE, NULL, &pFileStream);
+	if (FAILED(hr)) {
+		return hr;
+	}
+
+	LARGE_INTEGER freq, start, stop;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&start);
+
+	try {
+		// as CBaseMuxerOutputPin::GetBitStream() builds it, the bit stream holds the only reference
+		CComPtr<IStream> pStream = pFileStream;
+		if (bBuffered) {
+			pStream = (IStream*)DNew CBufferedStream(pFileStream);
+		}
+		CComPtr<IBitStream> pBS = DNew CBitStream(pStream, true);
+		pStream.Release();
+
+		WritePattern(pBS, size);
+	} catch (HRESULT hrWrite) {
+		return hrWrite;
+	}
+
+	hr = pFileStream->Commit(STGC_DEFAULT);
+
+	QueryPerformanceCounter(&stop);
+	seconds = (double)(stop.QuadPart - start.QuadPart) / freq.QuadPart;
+
+	return hr;
+}
+
+static bool Compare(LPCWSTR path1, LPCWSTR path2)
+{
+	FILE* f1 = _wfopen(path1, L"rb");
+	FILE* f2 = _wfopen(path2, L"rb");
+
+	bool bSame = f1 && f2;
+	static BYTE buff1[1024 * 1024], buff2[1024 * 1024];
+	while (bSame) {
+		size_t len1 = fread(buff1, 1, sizeof(buff1), f1);
+		size_t len2 = fread(buff2, 1, sizeof(buff2), f2);
+		bSame = len1 == len2 && !memcmp(buff1, buff2, len1);
+		if (len1 < sizeof(buff1)) {
+			break;
+		}
+	}
+
+	if (f1) {
+		fclose(f1);
+	}
+	if (f2) {
+		fclose(f2);
+	}
+
+	return bSame;
+}
+
+int main(int argc, char* argv[])
+{
+	const UINT64 size = (argc > 1 ? _atoi64(argv[1]) : 1024) * 1024 * 1024;
+
+	WCHAR temp[MAX_PATH], path[2][MAX_PATH];
+	GetTempPathW(_countof(temp), temp);
+	swprintf_s(path[0], L"%smuxbench_direct.bin", temp);
+	swprintf_s(path[1], L"%smuxbench_buffered.bin", temp);
+
+	static const char* names[2] = {"direct", "buffered"};
+	double seconds[2] = {0, 0};
+	int failed = 0;
+
+	for (int i = 0; i < 2; i++) {
+		HRESULT hr = Run(path[i], i == 1, size, seconds[i]);
+		if (FAILED(hr)) {
+			printf("%-8s FAILED: hr = 0x%08x\n", names[i], hr);
+			failed++;
+			continue;
+		}
+		printf("%-8s %8.1f MB/s\n", names[i], size / seconds[i] / (1024 * 1024));
+	}
+
+	if (!failed) {
+		if (Compare(path[0], path[1])) {
+			printf("speedup  %8.2fx, files identical\n", seconds[0] / seconds[1]);
+		} else {
+			printf("FAILED: files differ\n");
+			failed++;
+		}
+	}
+
+	DeleteFileW(path[0]);
+	DeleteFileW(path[1]);
+
+	return failed ? 1 : 0;
+}
@@ -23,6 +23,7 @@
 #include <MMReg.h>
 #include "MatroskaMuxer.h"
 #include "../../../DSUtil/DSUtil.h"
+#include "../../../DSUtil/BufferedStream.h"
 
 #ifdef REGISTER_FILTER
 #include <InitGuid.h>
@@ -369,6 +370,9 @@ DWORD CMatroskaMuxerFilter::ThreadProc()
 		}
 	}
 
+	// collect the small EBML writes, the seek head and the info are patched in place if they are still buffered
+	pStream = (IStream*)DNew CBufferedStream(pStream);
+
 	REFERENCE_TIME rtDur = 0;
 	GetDuration(&rtDur);
 
@@ -692,6 +696,14 @@ DWORD CMatroskaMuxerFilter::ThreadProc()
 
 				// TODO: write some tags
 
+				// the tail of the file is still buffered, report a failed write
+				{
+					HRESULT hr = pStream->Commit(STGC_DEFAULT);
+					if (FAILED(hr)) {
+						NotifyEvent(EC_ERRORABORT, hr, 0);
+					}
+				}
+
 				m_pOutput->DeliverEndOfStream();
 
 				break;
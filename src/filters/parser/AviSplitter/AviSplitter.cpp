@@ -691,14 +691,13 @@ bool CAviSplitterFilter::DemuxLoop()
 				size = s->cs[f].orgsize;
 			}
 
-			CAutoPtr<Packet> p(DNew Packet());
+			CAutoPtr<Packet> p(m_PacketPool.Get(size));
 
 			p->TrackNumber		= (DWORD)curTrack;
 			p->bSyncPoint		= (BOOL)s->cs[f].fKeyFrame;
 			p->bDiscontinuity	= fDiscontinuity[curTrack];
 			p->rtStart			= s->GetRefTime(f, s->cs[f].size);
 			p->rtStop			= s->GetRefTime(f + 1, f + 1 < (DWORD)s->cs.GetCount() ? s->cs[f + 1].size : s->totalsize);
-			p->SetCount(size);
 			if (S_OK != (hr = m_pFile->ByteRead(p->GetData(), p->GetCount()))) {
 				return true;    // break;
 			}
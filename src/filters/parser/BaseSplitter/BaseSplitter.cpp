@@ -37,6 +37,7 @@ CBaseSplitterFilter::CBaseSplitterFilter(LPCTSTR pName, LPUNKNOWN pUnk, HRESULT*
 	, m_rtLastStart(INVALID_TIME)
 	, m_rtLastStop(INVALID_TIME)
 	, m_priority(THREAD_PRIORITY_NORMAL)
+	, m_fQueueWaiting(FALSE)
 	, m_nFlag(0)
 {
 	if (phr) {
@@ -31,6 +31,7 @@
 #include "BaseSplitterOutputPin.h"
 #include "BaseSplitterParserOutputPin.h"
 #include "AsyncReader.h"
+#include "SeekIndexCache.h"
 #include "../../../DSUtil/DSMPropertyBag.h"
 #include "../../../DSUtil/FontInstaller.h"
 #include "../../../DSUtil/MediaDescription.h"
@@ -69,6 +70,11 @@ class CBaseSplitterFilter
 protected:
 	CStringW m_fn;
 
+	CSeekIndexCache m_SeekIndexCache;
+
+	// plain packets are taken from here by the demuxer and given back by the output pins after delivery
+	CPacketPool m_PacketPool;
+
 	CAutoPtr<CBaseSplitterInputPin> m_pInput;
 	CAutoPtrList<CBaseSplitterOutputPin> m_pOutputs;
 
@@ -99,6 +105,10 @@ protected:
 
 	int m_priority;
 
+	// the demux thread waits on it in CBaseSplitterOutputPin::QueuePacket
+	CAMEvent m_evQueueSpace;
+	volatile LONG m_fQueueWaiting;
+
 	CFontInstaller m_fontinst;
 
 	DWORD m_nFlag;
@@ -122,6 +132,11 @@ public:
 	STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void** ppv);
 
 	bool IsAnyPinDrying(DWORD MaxQueuePackets);
+	void SignalQueueSpace() {
+		if (m_fQueueWaiting && InterlockedExchange(&m_fQueueWaiting, FALSE)) {
+			m_evQueueSpace.Set();
+		}
+	}
 
 	HRESULT BreakConnect(PIN_DIRECTION dir, CBasePin* pPin);
 	HRESULT CompleteConnect(PIN_DIRECTION dir, CBasePin* pPin);
@@ -33,13 +33,22 @@ CBaseSplitterFile::CBaseSplitterFile(IAsyncReader* pAsyncReader, HRESULT& hr, bo
 	, m_fStreaming(false)
 	, m_fRandomAccess(false)
 	, m_pos(0), m_len(0)
-	, m_bitbuff(0), m_bitlen(0)
 	, m_cachepos(0), m_cachelen(0)
 	, m_available(0)
 	, m_hThread(NULL)
 	, m_hThread_Duration(NULL)
 	, m_evUpdate_Duration_Set(TRUE)
+	, m_fPrefetch(true)
+	, m_nSequential(0)
+	, m_hThread_Prefetch(NULL)
 {
+	memset(&m_prefetchstats, 0, sizeof(m_prefetchstats));
+	for (int i = 0; i < _countof(m_prefetch); i++) {
+		m_prefetch[i].state	= prefetch_window_t::Free;
+		m_prefetch[i].pos	= m_prefetch[i].len = 0;
+		m_prefetch[i].hr	= S_OK;
+	}
+
 	if (!m_pAsyncReader) {
 		hr = E_UNEXPECTED;
 		return;
@@ -92,6 +101,17 @@ CBaseSplitterFile::~CBaseSplitterFile()
 			TerminateThread(m_hThread_Duration, 0xDEAD);
 		}
 	}
+
+	if (m_hThread_Prefetch != NULL) {
+		m_evStop_Prefetch.Set();
+		if (WaitForSingleObject(m_hThread_Prefetch, 5000) == WAIT_TIMEOUT) {
+			TerminateThread(m_hThread_Prefetch, 0xDEAD);
+		}
+		CloseHandle(m_hThread_Prefetch);
+	}
+
+	DbgLog((LOG_TRACE, 3, L"CBaseSplitterFile::~CBaseSplitterFile() : read-ahead hits = %I64u, stalls = %I64u, misses = %I64u",
+			m_prefetchstats.hits, m_prefetchstats.stalls, m_prefetchstats.misses));
 }
 
 DWORD WINAPI CBaseSplitterFile::StaticThreadProc(LPVOID lpParam)
@@ -157,8 +177,258 @@ DWORD CBaseSplitterFile::ThreadProc_Duration()
 	return 0;
 }
 
+DWORD WINAPI CBaseSplitterFile::StaticThreadProc_Prefetch(LPVOID lpParam)
+{
+	return ((CBaseSplitterFile*)lpParam)->ThreadProc_Prefetch();
+}
+
+DWORD CBaseSplitterFile::ThreadProc_Prefetch()
+{
+	HANDLE hEvts[] = {m_evStop_Prefetch, m_evPrefetch};
+
+	for (;;) {
+		DWORD dwObject = WaitForMultipleObjects(_countof(hEvts), hEvts, FALSE, INFINITE);
+		if (dwObject != WAIT_OBJECT_0 + 1) {
+			return 0;
+		}
+
+		for (;;) {
+			prefetch_window_t* w = NULL;
+			{
+				CAutoLock cAutoLock(&m_csPrefetch);
+
+				// windows are read in file order
+				for (int i = 0; i < _countof(m_prefetch); i++) {
+					if (m_prefetch[i].state == prefetch_window_t::Queued && (!w || m_prefetch[i].pos < w->pos)) {
+						w = &m_prefetch[i];
+					}
+				}
+				if (!w) {
+					break;
+				}
+				w->state = prefetch_window_t::Reading;
+			}
+
+			HRESULT hr = SyncRead(w->pos, w->len, w->buff);
+
+			{
+				CAutoLock cAutoLock(&m_csPrefetch);
+				w->hr		= hr;
+				w->state	= prefetch_window_t::Ready;
+			}
+			m_evPrefetchDone.Set();
+
+			if (m_evStop_Prefetch.Check()) {
+				return 0;
+			}
+		}
+	}
+
+	return 0;
+}
+
+void CBaseSplitterFile::SchedulePrefetch(__int64 pos)
+{
+	CAutoLock cAutoLock(&m_csPrefetch);
+
+	__int64 len = GetLength();
+	__int64 end = min(pos + PREFETCH_WINDOWS * m_cachetotal, len);
+
+	// drop everything that is no longer ahead of the reading position
+	for (int i = 0; i < _countof(m_prefetch); i++) {
+		prefetch_window_t& w = m_prefetch[i];
+		if ((w.state == prefetch_window_t::Queued || w.state == prefetch_window_t::Ready)
+				&& (w.pos < pos || w.pos >= end)) {
+			w.state = prefetch_window_t::Free;
+		}
+	}
+
+	bool fQueued = false;
+
+	for (__int64 wpos = pos; wpos < end; wpos += m_cachetotal) {
+		prefetch_window_t* pFree = NULL;
+		bool fExists = false;
+		for (int i = 0; i < _countof(m_prefetch); i++) {
+			prefetch_window_t& w = m_prefetch[i];
+			if (w.state == prefetch_window_t::Free) {
+				if (!pFree) {
+					pFree = &w;
+				}
+			} else if (w.pos == wpos) {
+				fExists = true;
+				break;
+			}
+		}
+		if (fExists) {
+			continue;
+		}
+		if (!pFree || (!pFree->buff && !pFree->buff.Allocate((size_t)m_cachetotal))) {
+			break;
+		}
+
+		pFree->pos		= wpos;
+		pFree->len		= min(len - wpos, m_cachetotal);
+		pFree->hr		= S_OK;
+		pFree->state	= prefetch_window_t::Queued;
+		fQueued = true;
+	}
+
+	if (fQueued) {
+		if (m_hThread_Prefetch == NULL) {
+			m_evStop_Prefetch.Reset();
+			DWORD ThreadId = 0;
+			m_hThread_Prefetch = ::CreateThread(NULL, 0, StaticThreadProc_Prefetch, (LPVOID)this, CREATE_SUSPENDED, &ThreadId);
+			UNREFERENCED_PARAMETER(ThreadId);
+			if (m_hThread_Prefetch == NULL) {
+				m_fPrefetch = false;
+				return;
+			}
+			SetThreadPriority(m_hThread_Prefetch, THREAD_PRIORITY_ABOVE_NORMAL);
+			ResumeThread(m_hThread_Prefetch);
+		}
+		m_evPrefetch.Set();
+	}
+}
+
+void CBaseSplitterFile::CancelPrefetch(bool fWait)
+{
+	CAutoLock cAutoLock(&m_csPrefetch);
+
+	for (int i = 0; i < _countof(m_prefetch); i++) {
+		prefetch_window_t& w = m_prefetch[i];
+		if (w.state == prefetch_window_t::Queued || w.state == prefetch_window_t::Ready) {
+			w.state = prefetch_window_t::Free;
+		}
+	}
+
+	if (fWait) {
+		// a window that is being read can't be aborted, wait until it is done and release all buffers
+		for (int i = 0; i < _countof(m_prefetch); i++) {
+			while (m_prefetch[i].state == prefetch_window_t::Reading) {
+				m_csPrefetch.Unlock();
+				WaitForSingleObject(m_evPrefetchDone, INFINITE);
+				m_csPrefetch.Lock();
+			}
+			m_prefetch[i].state = prefetch_window_t::Free;
+			m_prefetch[i].buff.Free();
+		}
+	}
+
+	m_nSequential = 0;
+}
+
+HRESULT CBaseSplitterFile::SyncRead(__int64 pos, __int64 len, BYTE* pData)
+{
+	// not every IAsyncReader implementation can handle concurrent SyncRead() calls
+	CAutoLock cAutoLock(&m_csRead);
+	return m_pAsyncReader->SyncRead(pos, (long)len, pData);
+}
+
+HRESULT CBaseSplitterFile::RefillCache(__int64 pos, __int64 len)
+{
+	HRESULT hr = S_OK;
+
+	if (!m_fPrefetch || !m_fRandomAccess) {
+		m_prefetchstats.misses++;
+
+		hr = SyncRead(pos, len, m_pCache);
+		if (S_OK == hr) {
+			m_cachepos = pos;
+			m_cachelen = len;
+		}
+		return hr;
+	}
+
+	// the read-ahead is started only after a few refills continuing right where the previous window ended,
+	// so the seek-and-peek patterns of the format probing code never trigger it
+	bool fFound = false;
+	if (pos == m_cachepos + m_cachelen) {
+		m_nSequential++;
+	} else {
+		m_nSequential = 0;
+	}
+
+	{
+		CAutoLock cAutoLock(&m_csPrefetch);
+
+		bool fStalled = false;
+		for (;;) {
+			prefetch_window_t* w = NULL;
+			for (int i = 0; i < _countof(m_prefetch); i++) {
+				if (m_prefetch[i].state != prefetch_window_t::Free
+						&& m_prefetch[i].pos <= pos && pos < m_prefetch[i].pos + m_prefetch[i].len) {
+					w = &m_prefetch[i];
+					break;
+				}
+			}
+
+			if (!w) {
+				break;
+			}
+
+			if (w->state == prefetch_window_t::Queued) {
+				// not started yet - read it here
+				w->state = prefetch_window_t::Free;
+				break;
+			}
+
+			if (w->state == prefetch_window_t::Reading) {
+				fStalled = true;
+				m_csPrefetch.Unlock();
+				WaitForSingleObject(m_evPrefetchDone, INFINITE);
+				m_csPrefetch.Lock();
+				continue;
+			}
+
+			w->state = prefetch_window_t::Free;
+			if (w->hr == S_OK) {
+				BYTE* pCache = m_pCache.Detach();
+				m_pCache.Attach(w->buff.Detach());
+				w->buff.Attach(pCache);
+
+				m_cachepos = w->pos;
+				m_cachelen = w->len;
+				fFound = true;
+			}
+			break;
+		}
+
+		if (fFound) {
+			if (fStalled) {
+				m_prefetchstats.stalls++;
+			} else {
+				m_prefetchstats.hits++;
+			}
+			m_nSequential = max(m_nSequential, PREFETCH_SEQ_TRIGGER);
+		}
+	}
+
+	if (!fFound) {
+		m_prefetchstats.misses++;
+
+		hr = SyncRead(pos, len, m_pCache);
+		if (S_OK != hr) {
+			CancelPrefetch(false);
+			return hr;
+		}
+
+		m_cachepos = pos;
+		m_cachelen = len;
+	}
+
+	if (m_nSequential >= PREFETCH_SEQ_TRIGGER) {
+		SchedulePrefetch(m_cachepos + m_cachelen);
+	} else {
+		CancelPrefetch(false);
+	}
+
+	return hr;
+}
+
 bool CBaseSplitterFile::SetCacheSize(size_t cachelen)
 {
+	CancelPrefetch(true);
+
 	m_pCache.Free();
 	m_cachetotal = 0;
 	m_pCache.Allocate(cachelen);
@@ -234,25 +504,25 @@ HRESULT CBaseSplitterFile::Read(BYTE* pData, __int64 len)
 	HRESULT hr = S_OK;
 
 	if (m_cachetotal == 0 || !m_pCache) {
-		hr = m_pAsyncReader->SyncRead(m_pos, (long)len, pData);
+		hr = SyncRead(m_pos, len, pData);
 		m_pos += len;
 		return hr;
 	}
 
-	BYTE* pCache = m_pCache;
-
 	if (m_cachepos <= m_pos && m_pos < m_cachepos + m_cachelen) {
 		__int64 minlen = min(len, m_cachelen - (m_pos - m_cachepos));
 
-		memcpy(pData, &pCache[m_pos - m_cachepos], (size_t)minlen);
+		memcpy(pData, &m_pCache[m_pos - m_cachepos], (size_t)minlen);
 
 		len -= minlen;
 		m_pos += minlen;
 		pData += minlen;
 	}
 
-	while (len > m_cachetotal) {
-		hr = m_pAsyncReader->SyncRead(m_pos, (long)m_cachetotal, pData);
+	// with the read-ahead running large reads go through the cache windows as well,
+	// a direct read would fetch the bytes of the queued windows again and break the sequential run
+	while (len > m_cachetotal && !(m_fPrefetch && m_fRandomAccess)) {
+		hr = SyncRead(m_pos, m_cachetotal, pData);
 		if (S_OK != hr) {
 			return hr;
 		}
@@ -270,15 +540,15 @@ HRESULT CBaseSplitterFile::Read(BYTE* pData, __int64 len)
 			return S_FALSE;
 		}
 
-		hr = m_pAsyncReader->SyncRead(m_pos, (long)maxlen, pCache);
+		hr = RefillCache(m_pos, maxlen);
 		if (S_OK != hr) {
 			return hr;
 		}
 
-		m_cachepos = m_pos;
-		m_cachelen = maxlen;
+		// the cache window may come from the read-ahead and start before the current position
+		minlen = min(len, m_cachelen - (m_pos - m_cachepos));
 
-		memcpy(pData, pCache, (size_t)minlen);
+		memcpy(pData, &m_pCache[m_pos - m_cachepos], (size_t)minlen);
 
 		len -= minlen;
 		m_pos += minlen;
@@ -288,45 +558,23 @@ HRESULT CBaseSplitterFile::Read(BYTE* pData, __int64 len)
 	return hr;
 }
 
-UINT64 CBaseSplitterFile::BitRead(int nBits, bool fPeek)
+const BYTE* CBaseSplitterFile::BitData(size_t& size)
 {
-	ASSERT(nBits >= 0 && nBits <= 64);
-
-	while (m_bitlen < nBits) {
-		m_bitbuff <<= 8;
-		if (S_OK != Read((BYTE*)&m_bitbuff, 1)) {
-			return 0;   // EOF? // ASSERT(0);
+	if (!(m_cachepos <= m_pos && m_pos < m_cachepos + m_cachelen)) {
+		// bring the current position into the cache
+		BYTE b;
+		if (S_OK != Read(&b, 1)) {
+			return NULL;
 		}
-		m_bitlen += 8;
-	}
-
-	int bitlen = m_bitlen - nBits;
-
-	UINT64 ret;
-	// The shift to 64 bits can give incorrect results.
-	// "The behavior is undefined if the right operand is negative, or greater than or equal to the length in bits of the promoted left operand."
-	if (nBits == 64) {
-		ret = m_bitbuff;
-	} else {
-		ret = (m_bitbuff >> bitlen) & ((1ui64 << nBits) - 1);
-	}
+		m_pos--;
 
-	if (!fPeek) {
-		m_bitbuff &= ((1ui64 << bitlen) - 1);
-		m_bitlen = bitlen;
+		if (!(m_cachepos <= m_pos && m_pos < m_cachepos + m_cachelen)) {
+			return NULL;
+		}
 	}
 
-	return ret;
-}
-
-void CBaseSplitterFile::BitByteAlign()
-{
-	m_bitlen &= ~7;
-}
-
-void CBaseSplitterFile::BitFlush()
-{
-	m_bitlen = 0;
+	size = (size_t)(m_cachelen - (m_pos - m_cachepos));
+	return &m_pCache[m_pos - m_cachepos];
 }
 
 HRESULT CBaseSplitterFile::ByteRead(BYTE* pData, __int64 len)
@@ -335,21 +583,6 @@ HRESULT CBaseSplitterFile::ByteRead(BYTE* pData, __int64 len)
 	return Read(pData, len);
 }
 
-UINT64 CBaseSplitterFile::UExpGolombRead()
-{
-	int n = -1;
-	for (BYTE b = 0; !b; n++) {
-		b = (BYTE)BitRead(1);
-	}
-	return (1ui64 << n) - 1 + BitRead(n);
-}
-
-INT64 CBaseSplitterFile::SExpGolombRead()
-{
-	UINT64 k = UExpGolombRead();
-	return ((k & 1) ? 1 : -1) * ((k + 1) >> 1);
-}
-
 HRESULT CBaseSplitterFile::HasMoreData(__int64 len, DWORD ms)
 {
 	__int64 available = GetLength() - GetPos();
@@ -22,24 +22,67 @@
 #pragma once
 
 #include <atlcoll.h>
+#include "../../../DSUtil/BitReader.h"
 
-class CBaseSplitterFile
+#define PREFETCH_WINDOWS		4	// number of cache windows read ahead in the background
+#define PREFETCH_SEQ_TRIGGER	2	// sequential cache refills before the read-ahead is started
+
+class CBaseSplitterFile : public CBitReader
 {
 	CComPtr<IAsyncReader> m_pAsyncReader;
 	CAutoVectorPtr<BYTE> m_pCache;
 	__int64 m_cachepos, m_cachelen, m_cachetotal;
 
+	// read-ahead
+	struct prefetch_stats_t {
+		UINT64 hits;	// cache refill served from a completed read-ahead window
+		UINT64 stalls;	// cache refill had to wait for a read-ahead window still in flight
+		UINT64 misses;	// cache refill done with a synchronous read
+	};
+	struct prefetch_window_t {
+		enum {
+			Free,
+			Queued,
+			Reading,
+			Ready
+		} state;
+		CAutoVectorPtr<BYTE> buff;
+		__int64 pos, len;
+		HRESULT hr;
+	};
+	prefetch_window_t m_prefetch[PREFETCH_WINDOWS];
+	int m_nSequential;
+	CCritSec m_csPrefetch;
+	CCritSec m_csRead;
+
+	HRESULT SyncRead(__int64 pos, __int64 len, BYTE* pData);
+	HRESULT RefillCache(__int64 pos, __int64 len);
+	void SchedulePrefetch(__int64 pos);
+	void CancelPrefetch(bool fWait);
+
+	DWORD ThreadProc_Prefetch();
+	static DWORD WINAPI StaticThreadProc_Prefetch(LPVOID lpParam);
+	HANDLE m_hThread_Prefetch;
+	CAMEvent m_evStop_Prefetch;
+	CAMEvent m_evPrefetch;
+	CAMEvent m_evPrefetchDone;
+
 	bool m_fStreaming, m_fRandomAccess;
+	bool m_fPrefetch;
+	prefetch_stats_t m_prefetchstats;	// only traced in the destructor
 	__int64 m_pos, m_len;
 	__int64 m_available;
 
 	virtual HRESULT Read(BYTE* pData, __int64 len); // use ByteRead
 	virtual void OnUpdateDuration() {};
 
-protected:
-	UINT64 m_bitbuff;
-	int m_bitlen;
+	// CBitReader
+	const BYTE* BitData(size_t& size);
+	void BitConsume(size_t size) {
+		m_pos += size;
+	}
 
+protected:
 	DWORD ThreadProc();
 	static DWORD WINAPI StaticThreadProc(LPVOID lpParam);
 	HANDLE m_hThread;
@@ -68,11 +111,6 @@ public:
 	virtual void Seek(__int64 pos);
 	void Skip(__int64 offset);
 
-	UINT64 UExpGolombRead();
-	INT64 SExpGolombRead();
-
-	UINT64 BitRead(int nBits, bool fPeek = false);
-	void BitByteAlign(), BitFlush();
 	HRESULT ByteRead(BYTE* pData, __int64 len);
 
 	bool IsStreaming()		const {
@@ -39,6 +39,7 @@ CBaseSplitterOutputPin::CBaseSplitterOutputPin(CAtlArray<CMediaType>& mts, LPCWS
 	, m_eEndFlush(TRUE)
 	, m_rtPrev(0)
 	, m_rtOffset(0)
+	, m_queue((static_cast<CBaseSplitterFilter*>(m_pFilter))->GetMaxQueuePackets() * factor * 2)
 	, m_MinQueuePackets((static_cast<CBaseSplitterFilter*>(m_pFilter))->GetMinQueuePackets())
 	, m_MaxQueuePackets((static_cast<CBaseSplitterFilter*>(m_pFilter))->GetMaxQueuePackets() * factor)
 	, m_MinQueueSize((static_cast<CBaseSplitterFilter*>(m_pFilter))->GetMinQueueSize())
@@ -56,6 +57,7 @@ CBaseSplitterOutputPin::CBaseSplitterOutputPin(LPCWSTR pName, CBaseFilter* pFilt
 	, m_fFlushing(false)
 	, m_fFlushed(false)
 	, m_eEndFlush(TRUE)
+	, m_queue((static_cast<CBaseSplitterFilter*>(m_pFilter))->GetMaxQueuePackets() * factor * 2)
 	, m_MinQueuePackets((static_cast<CBaseSplitterFilter*>(m_pFilter))->GetMinQueuePackets())
 	, m_MaxQueuePackets((static_cast<CBaseSplitterFilter*>(m_pFilter))->GetMaxQueuePackets() * factor)
 	, m_MinQueueSize((static_cast<CBaseSplitterFilter*>(m_pFilter))->GetMinQueueSize())
@@ -68,6 +70,10 @@ CBaseSplitterOutputPin::CBaseSplitterOutputPin(LPCWSTR pName, CBaseFilter* pFilt
 
 CBaseSplitterOutputPin::~CBaseSplitterOutputPin()
 {
+	// samples still held downstream must not return their packets to the filter's pool anymore
+	if (m_pPacketAllocator) {
+		m_pPacketAllocator->SetPool(NULL);
+	}
 }
 
 STDMETHODIMP CBaseSplitterOutputPin::NonDelegatingQueryInterface(REFIID riid, void** ppv)
@@ -98,6 +104,43 @@ HRESULT CBaseSplitterOutputPin::SetName(LPCWSTR pName)
 	return S_OK;
 }
 
+HRESULT CBaseSplitterOutputPin::DecideAllocator(IMemInputPin* pPin, IMemAllocator** ppAlloc)
+{
+	CheckPointer(pPin, E_POINTER);
+	CheckPointer(ppAlloc, E_POINTER);
+
+	ALLOCATOR_PROPERTIES prop;
+	ZeroMemory(&prop, sizeof(prop));
+	pPin->GetAllocatorRequirements(&prop);
+
+	// the packet buffers have no prefix and only the heap alignment
+	if (prop.cbPrefix == 0 && prop.cbAlign <= 1) {
+		HRESULT hr = S_OK;
+		if (!m_pPacketAllocator) {
+			m_pPacketAllocator = DNew CPacketAllocator(&(static_cast<CBaseSplitterFilter*>(m_pFilter))->m_PacketPool, &hr);
+		}
+
+		if (m_pPacketAllocator && SUCCEEDED(hr)) {
+			prop.cbAlign = 1;
+
+			*ppAlloc = m_pPacketAllocator;
+			(*ppAlloc)->AddRef();
+
+			if (SUCCEEDED(DecideBufferSize(*ppAlloc, &prop))
+					&& SUCCEEDED(pPin->NotifyAllocator(*ppAlloc, FALSE))) {
+				DbgLog((LOG_TRACE, 3, L"CBaseSplitterOutputPin::DecideAllocator() : '%s' delivers the packets without a copy", m_pName));
+				return NOERROR;
+			}
+
+			(*ppAlloc)->Release();
+			*ppAlloc = NULL;
+		}
+	}
+
+	// the downstream filter wants its own allocator, the packets are copied into its samples
+	return __super::DecideAllocator(pPin, ppAlloc);
+}
+
 HRESULT CBaseSplitterOutputPin::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PROPERTIES* pProperties)
 {
 	ASSERT(pAlloc);
@@ -190,6 +233,7 @@ HRESULT CBaseSplitterOutputPin::DeliverBeginFlush()
 	m_fFlushing = true;
 	m_hrDeliver = S_FALSE;
 	m_queue.RemoveAll();
+	(static_cast<CBaseSplitterFilter*>(m_pFilter))->SignalQueueSpace();
 	HRESULT hr = IsConnected() ? GetConnected()->BeginFlush() : S_OK;
 	if (S_OK != hr) {
 		m_eEndFlush.Set();
@@ -247,17 +291,32 @@ HRESULT CBaseSplitterOutputPin::QueueEndOfStream()
 	return QueuePacket(CAutoPtr<Packet>()); // NULL means EndOfStream
 }
 
+bool CBaseSplitterOutputPin::IsQueueFull()
+{
+	size_t count	= m_queue.GetCount();
+	size_t size		= m_queue.GetSize();
+
+	return m_queue.IsFull()
+		   || (count > (m_MaxQueuePackets*3/2) || size > (m_MaxQueueSize*3/2))
+		   || ((count > m_MaxQueuePackets || size > m_MaxQueueSize)
+			   && !(static_cast<CBaseSplitterFilter*>(m_pFilter))->IsAnyPinDrying(m_MaxQueuePackets));
+}
+
 HRESULT CBaseSplitterOutputPin::QueuePacket(CAutoPtr<Packet> p)
 {
 	if (!ThreadExists()) {
 		return S_FALSE;
 	}
 
-	while (S_OK == m_hrDeliver
-			&& ((m_queue.GetCount() > (m_MaxQueuePackets*3/2) || m_queue.GetSize() > (m_MaxQueueSize*3/2))
-				|| ((m_queue.GetCount() > m_MaxQueuePackets || m_queue.GetSize() > m_MaxQueueSize)
-					&& !(static_cast<CBaseSplitterFilter*>(m_pFilter))->IsAnyPinDrying(m_MaxQueuePackets)))) {
-		Sleep(10);
+	CBaseSplitterFilter* pFilter = static_cast<CBaseSplitterFilter*>(m_pFilter);
+
+	while (S_OK == m_hrDeliver && IsQueueFull()) {
+		// announce the wait before the last check, an output pin taking a packet in between sets the event
+		InterlockedExchange(&pFilter->m_fQueueWaiting, TRUE);
+		if (S_OK != m_hrDeliver || !IsQueueFull()) {
+			break;
+		}
+		pFilter->m_evQueueSpace.Wait(100);
 	}
 
 	if (S_OK != m_hrDeliver) {
@@ -313,9 +372,9 @@ DWORD CBaseSplitterOutputPin::ThreadProc()
 		GetConnected()->EndFlush();
 	}
 
-	for (;;) {
-		Sleep(1);
+	CBaseSplitterFilter* pFilter = static_cast<CBaseSplitterFilter*>(m_pFilter);
 
+	for (;;) {
 		DWORD cmd;
 		if (CheckRequest(&cmd)) {
 			m_hThread = NULL;
@@ -325,37 +384,32 @@ DWORD CBaseSplitterOutputPin::ThreadProc()
 			return 0;
 		}
 
-		int cnt = 0;
-		do {
-			CAutoPtr<Packet> p;
+		CAutoPtr<Packet> p;
+		if (!m_queue.Remove(p)) {
+			m_queue.WaitData(GetRequestHandle());
+			continue;
+		}
 
-			{
-				CAutoLock cAutoLock(&m_queue);
-				if ((cnt = m_queue.GetCount()) > 0) {
-					p = m_queue.Remove();
-				}
-			}
+		pFilter->SignalQueueSpace();
 
-			if (S_OK == m_hrDeliver && cnt > 0) {
-				ASSERT(!m_fFlushing);
+		if (S_OK == m_hrDeliver) {
+			ASSERT(!m_fFlushing);
 
-				m_fFlushed = false;
+			m_fFlushed = false;
 
-				// flushing can still start here, to release a blocked deliver call
+			// flushing can still start here, to release a blocked deliver call
 
-				HRESULT hr = p
-							 ? DeliverPacket(p)
-							 : DeliverEndOfStream();
+			HRESULT hr = p
+						 ? DeliverPacket(p)
+						 : DeliverEndOfStream();
 
-				m_eEndFlush.Wait(); // .. so we have to wait until it is done
+			m_eEndFlush.Wait(); // .. so we have to wait until it is done
 
-				if (hr != S_OK && !m_fFlushed) { // and only report the error in m_hrDeliver if we didn't flush the stream
-					// CAutoLock cAutoLock(&m_csQueueLock);
-					m_hrDeliver = hr;
-					break;
-				}
+			if (hr != S_OK && !m_fFlushed) { // and only report the error in m_hrDeliver if we didn't flush the stream
+				m_hrDeliver = hr;
+				pFilter->SignalQueueSpace();
 			}
-		} while (--cnt > 0);
+		}
 	}
 }
 
@@ -429,13 +483,15 @@ HRESULT CBaseSplitterOutputPin::DeliverPacket(CAutoPtr<Packet> p)
 		}
 	}
 
+	bool fPacketSample = m_pPacketAllocator && m_pAllocator == static_cast<IMemAllocator*>(m_pPacketAllocator);
+
 	do {
 		CComPtr<IMediaSample> pSample;
 		if (S_OK != (hr = GetDeliveryBuffer(&pSample, NULL, NULL, 0))) {
 			break;
 		}
 
-		if (nBytes > pSample->GetSize()) {
+		if (!fPacketSample && nBytes > pSample->GetSize()) {
 			pSample.Release();
 
 			ALLOCATOR_PROPERTIES props, actual;
@@ -487,13 +543,15 @@ HRESULT CBaseSplitterOutputPin::DeliverPacket(CAutoPtr<Packet> p)
 
 		ASSERT(!p->bSyncPoint || fTimeValid);
 
-		BYTE* pData = NULL;
-		if (S_OK != (hr = pSample->GetPointer(&pData)) || !pData) {
-			break;
-		}
-		memcpy(pData, p->GetData(), nBytes);
-		if (S_OK != (hr = pSample->SetActualDataLength(nBytes))) {
-			break;
+		if (!fPacketSample) {
+			BYTE* pData = NULL;
+			if (S_OK != (hr = pSample->GetPointer(&pData)) || !pData) {
+				break;
+			}
+			memcpy(pData, p->GetData(), nBytes);
+			if (S_OK != (hr = pSample->SetActualDataLength(nBytes))) {
+				break;
+			}
 		}
 		if (S_OK != (hr = pSample->SetTime(fTimeValid ? &p->rtStart : NULL, fTimeValid ? &p->rtStop : NULL))) {
 			break;
@@ -510,14 +568,25 @@ HRESULT CBaseSplitterOutputPin::DeliverPacket(CAutoPtr<Packet> p)
 		if (S_OK != (hr = pSample->SetPreroll(fTimeValid && p->rtStart < 0))) {
 			break;
 		}
+		if (fPacketSample) {
+			// the sample owns the packet from here, it goes back to the pool when the downstream filter releases the sample
+			static_cast<CPacketSample*>((IMediaSample*)pSample)->SetPacket(p);
+		}
 		if (S_OK != (hr = Deliver(pSample))) {
 			break;
 		}
 	} while (false);
 
+	(static_cast<CBaseSplitterFilter*>(m_pFilter))->m_PacketPool.Recycle(p);
+
 	return hr;
 }
 
+Packet* CBaseSplitterOutputPin::NewPacket(size_t size)
+{
+	return (static_cast<CBaseSplitterFilter*>(m_pFilter))->m_PacketPool.Get(size);
+}
+
 void CBaseSplitterOutputPin::MakeISCRHappy()
 {
 	CComPtr<IPin> pPinTo = this, pTmp;
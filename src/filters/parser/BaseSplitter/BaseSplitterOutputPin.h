@@ -27,6 +27,7 @@
 #include <IBitRateInfo.h>
 #include "../../../DSUtil/Packet.h"
 #include "../../../DSUtil/DSMPropertyBag.h"
+#include "PacketAllocator.h"
 
 class CBaseSplitterFilter;
 
@@ -42,7 +43,10 @@ protected:
 	int m_nBuffers;
 
 private:
-	CPacketQueue m_queue;
+	CPacketRing m_queue;
+
+	// preferred allocator, its samples take over the packets instead of a copy
+	CComPtr<CPacketAllocator> m_pPacketAllocator;
 
 	HRESULT m_hrDeliver;
 
@@ -74,6 +78,8 @@ private:
 	DWORD m_MinQueuePackets, m_MaxQueuePackets;
 	DWORD m_MinQueueSize, m_MaxQueueSize;
 
+	bool IsQueueFull();
+
 protected:
 	REFERENCE_TIME m_rtPrev, m_rtOffset;
 	REFERENCE_TIME m_rtStart;
@@ -82,6 +88,9 @@ protected:
 	// the default implementation will send the sample as is
 	virtual HRESULT DeliverPacket(CAutoPtr<Packet> p);
 
+	// new packet from the filter's packet pool
+	Packet* NewPacket(size_t size);
+
 	// IMediaSeeking
 
 	STDMETHODIMP GetCapabilities(DWORD* pCapabilities);
@@ -112,6 +121,7 @@ public:
 
 	HRESULT SetName(LPCWSTR pName);
 
+	HRESULT DecideAllocator(IMemInputPin* pPin, IMemAllocator** ppAlloc);
 	HRESULT DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PROPERTIES* pProperties);
 	HRESULT CheckMediaType(const CMediaType* pmt);
 	HRESULT GetMediaType(int iPosition, CMediaType* pmt);
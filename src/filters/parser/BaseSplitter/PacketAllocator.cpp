@@ -0,0 +1,123 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "PacketAllocator.h"
+
+//
+// CPacketSample
+//
+
+CPacketSample::CPacketSample(CPacketAllocator* pAlloc, HRESULT* phr)
+	: CMediaSample(NAME("CPacketSample"), (CBaseAllocator*)pAlloc, phr, NULL, 0)
+{
+}
+
+void CPacketSample::SetPacket(CAutoPtr<Packet>& p)
+{
+	m_pPacket = p;
+	SetPointer(m_pPacket->GetData(), (LONG)m_pPacket->GetCount());
+}
+
+//
+// CPacketAllocator
+//
+
+CPacketAllocator::CPacketAllocator(CPacketPool* pPool, HRESULT* phr)
+	: CBaseAllocator(NAME("CPacketAllocator"), NULL, phr)
+	, m_pPool(pPool)
+{
+}
+
+CPacketAllocator::~CPacketAllocator()
+{
+	Decommit();
+	ReallyFree();
+}
+
+void CPacketAllocator::SetPool(CPacketPool* pPool)
+{
+	CAutoLock cAutoLock(this);
+	m_pPool = pPool;
+}
+
+HRESULT CPacketAllocator::Alloc()
+{
+	CAutoLock cAutoLock(this);
+
+	HRESULT hr = __super::Alloc();
+	if (FAILED(hr)) {
+		return hr;
+	}
+	if (hr == S_FALSE) {
+		return NOERROR;
+	}
+
+	ReallyFree();
+
+	for (m_lAllocated = 0; m_lAllocated < m_lCount; m_lAllocated++) {
+		CPacketSample* pSample = DNew CPacketSample(this, &hr);
+		if (!pSample) {
+			return E_OUTOFMEMORY;
+		}
+		if (FAILED(hr)) {
+			delete pSample;
+			return hr;
+		}
+
+		m_lFree.Add(pSample);
+	}
+
+	m_bChanged = FALSE;
+
+	return NOERROR;
+}
+
+void CPacketAllocator::Free()
+{
+	// the samples stay allocated until the next Alloc() or the destructor, like CMemAllocator does
+}
+
+void CPacketAllocator::ReallyFree()
+{
+	ASSERT(m_lAllocated == m_lFree.GetCount());
+
+	while (CMediaSample* pSample = m_lFree.RemoveHead()) {
+		delete pSample;
+	}
+	m_lAllocated = 0;
+}
+
+STDMETHODIMP CPacketAllocator::ReleaseBuffer(IMediaSample* pSample)
+{
+	CheckPointer(pSample, E_POINTER);
+
+	CAutoPtr<Packet> p(static_cast<CPacketSample*>(pSample)->m_pPacket);
+	static_cast<CPacketSample*>(pSample)->SetPointer(NULL, 0);
+
+	if (p) {
+		CAutoLock cAutoLock(this);
+		if (m_pPool) {
+			m_pPool->Recycle(p);
+		}
+	}
+
+	return __super::ReleaseBuffer(pSample);
+}
@@ -0,0 +1,64 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "../../../DSUtil/Packet.h"
+
+//
+// CPacketAllocator - media samples without own memory, each delivered sample points into the payload of a Packet
+//
+// The sample owns its packet until the downstream filter releases it,
+// the packet then goes back to the splitter's packet pool (or is freed when the pool is already gone).
+//
+
+class CPacketAllocator;
+
+class CPacketSample : public CMediaSample
+{
+	friend class CPacketAllocator;
+
+	CAutoPtr<Packet> m_pPacket;
+
+public:
+	CPacketSample(CPacketAllocator* pAlloc, HRESULT* phr);
+
+	void SetPacket(CAutoPtr<Packet>& p);
+};
+
+class CPacketAllocator : public CBaseAllocator
+{
+	CPacketPool* m_pPool;
+
+	void ReallyFree();
+
+protected:
+	HRESULT Alloc();
+	void Free();
+
+public:
+	CPacketAllocator(CPacketPool* pPool, HRESULT* phr);
+	virtual ~CPacketAllocator();
+
+	// the output pin calls it with NULL before the pool goes away
+	void SetPool(CPacketPool* pPool);
+
+	STDMETHODIMP ReleaseBuffer(IMediaSample* pSample);
+};
@@ -0,0 +1,318 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <ShlObj.h>
+#include <algorithm>
+#include <vector>
+#include "SeekIndexCache.h"
+#include "../../../DSUtil/DSUtil.h"
+
+static UINT64 HashPath(const CStringW& fn, bool bReverse)
+{
+	// FNV-1a
+	UINT64 hash = 14695981039346656037ui64;
+	for (int i = 0, len = fn.GetLength(); i < len; i++) {
+		hash = (hash ^ fn[bReverse ? len - 1 - i : i]) * 1099511628211ui64;
+	}
+	return hash;
+}
+
+//
+// CSeekIndexCache
+//
+
+CSeekIndexCache::CSeekIndexCache()
+	: m_nSavedCount(0)
+	, m_hThread(NULL)
+	, m_bAbortSave(false)
+{
+	memset(&m_hdr, 0, sizeof(m_hdr));
+}
+
+CSeekIndexCache::~CSeekIndexCache()
+{
+	WaitSave();
+}
+
+void CSeekIndexCache::WaitSave()
+{
+	if (m_hThread) {
+		if (WaitForSingleObject(m_hThread, SEEKINDEX_SAVE_TIMEOUT) == WAIT_TIMEOUT) {
+			// the thread checks the flag between the writes and leaves no partial file behind
+			m_bAbortSave = true;
+			WaitForSingleObject(m_hThread, INFINITE);
+		}
+		CloseHandle(m_hThread);
+		m_hThread = NULL;
+		m_bAbortSave = false;
+	}
+}
+
+CStringW CSeekIndexCache::GetDefaultDir()
+{
+	CStringW dir;
+
+	// in ini mode the application has no registry key and the profile name is the full path of the ini file
+	CWinApp* pApp = AfxGetApp();
+	if (pApp && !pApp->m_pszRegistryKey && pApp->m_pszProfileName) {
+		CStringW ini(pApp->m_pszProfileName);
+		int k = ini.ReverseFind('\\');
+		if (k > 0 && ::PathFileExistsW(ini)) {
+			dir = ini.Left(k);
+		}
+	}
+
+	if (dir.IsEmpty()) {
+		WCHAR path[MAX_PATH];
+		if (FAILED(SHGetFolderPathW(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, path))) {
+			return L"";
+		}
+		dir.Format(L"%s\\MPC-BE", path);
+	}
+
+	return dir + L"\\SeekIndex";
+}
+
+bool CSeekIndexCache::Open(LPCWSTR pszDir, LPCWSTR pszFileName, DWORD fourcc, __int64 len)
+{
+	WaitSave();
+
+	m_idxfn.Empty();
+	m_nSavedCount = 0;
+
+	if (!pszDir || !*pszDir || !pszFileName || !*pszFileName || len <= 0) {
+		return false;
+	}
+
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesExW(pszFileName, GetFileExInfoStandard, &fad)
+			|| (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		return false;
+	}
+
+	CStringW fn(pszFileName);
+	fn.MakeLower();
+
+	memset(&m_hdr, 0, sizeof(m_hdr));
+	m_hdr.magic		= SEEKINDEX_MAGIC;
+	m_hdr.version	= SEEKINDEX_VERSION;
+	m_hdr.fourcc	= fourcc;
+	m_hdr.pathhash	= HashPath(fn, true);
+	m_hdr.size		= ((UINT64)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+	m_hdr.mtime		= ((UINT64)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+	m_hdr.len		= len;
+
+	m_idxfn.Format(L"%s\\%016I64x.idx", pszDir, HashPath(fn, false));
+
+	return true;
+}
+
+bool CSeekIndexCache::Load(CAtlArray<SyncPoint>& sps)
+{
+	sps.RemoveAll();
+
+	if (!IsOpen()) {
+		return false;
+	}
+
+	HANDLE hFile = CreateFileW(m_idxfn, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	bool bRet = false;
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(hFile, &size) && size.QuadPart >= sizeof(header_t)) {
+		if (HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL)) {
+			if (const BYTE* pView = (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0)) {
+				const header_t* hdr = (const header_t*)pView;
+				const SyncPoint* pSP = (const SyncPoint*)(pView + sizeof(header_t));
+
+				if (hdr->magic == m_hdr.magic
+						&& hdr->version == m_hdr.version
+						&& hdr->fourcc == m_hdr.fourcc
+						&& hdr->pathhash == m_hdr.pathhash
+						&& hdr->size == m_hdr.size
+						&& hdr->mtime == m_hdr.mtime
+						&& hdr->len == m_hdr.len
+						&& hdr->count <= (UINT64)size.QuadPart / sizeof(SyncPoint)
+						&& (UINT64)size.QuadPart == sizeof(header_t) + hdr->count * sizeof(SyncPoint)) {
+
+					bRet = true;
+					for (UINT64 i = 0; i < hdr->count; i++) {
+						if (pSP[i].fp < 0 || pSP[i].fp >= (__int64)m_hdr.len
+								|| (i > 0 && pSP[i].rt < pSP[i - 1].rt)) {
+							bRet = false;
+							break;
+						}
+					}
+
+					if (bRet) {
+						sps.SetCount((size_t)hdr->count);
+						memcpy(sps.GetData(), pSP, (size_t)hdr->count * sizeof(SyncPoint));
+					}
+				}
+
+				UnmapViewOfFile(pView);
+			}
+			CloseHandle(hMapping);
+		}
+	}
+
+	if (bRet) {
+		// the last write time orders the files for Prune()
+		FILETIME ft;
+		GetSystemTimeAsFileTime(&ft);
+		SetFileTime(hFile, NULL, NULL, &ft);
+
+		m_nSavedCount = sps.GetCount();
+	}
+
+	CloseHandle(hFile);
+
+	DbgLog((LOG_TRACE, 3, L"CSeekIndexCache::Load() : '%s' -> %s, %Iu entries", (LPCWSTR)m_idxfn, bRet ? L"OK" : L"rejected", sps.GetCount()));
+
+	return bRet;
+}
+
+bool CSeekIndexCache::Save(const CAtlArray<SyncPoint>& sps)
+{
+	// entries are only ever added, an index that did not grow is already on disk
+	if (!IsOpen() || sps.GetCount() <= m_nSavedCount) {
+		return false;
+	}
+
+	WaitSave();
+
+	m_sps.Copy(sps);
+	m_nSavedCount = sps.GetCount();
+
+	DWORD ThreadId = 0;
+	m_hThread = ::CreateThread(NULL, 0, StaticThreadProc, (LPVOID)this, CREATE_SUSPENDED, &ThreadId);
+	UNREFERENCED_PARAMETER(ThreadId);
+	if (m_hThread == NULL) {
+		return false;
+	}
+	SetThreadPriority(m_hThread, THREAD_PRIORITY_BELOW_NORMAL);
+	ResumeThread(m_hThread);
+
+	return true;
+}
+
+DWORD WINAPI CSeekIndexCache::StaticThreadProc(LPVOID lpParam)
+{
+	return ((CSeekIndexCache*)lpParam)->ThreadProc();
+}
+
+DWORD CSeekIndexCache::ThreadProc()
+{
+	SetThreadName((DWORD)-1, "CSeekIndexCache");
+
+	CStringW dir = m_idxfn.Left(m_idxfn.ReverseFind('\\'));
+	int ret = SHCreateDirectoryExW(NULL, dir, NULL);
+	if (ret != ERROR_SUCCESS && ret != ERROR_ALREADY_EXISTS && ret != ERROR_FILE_EXISTS) {
+		return 1;
+	}
+
+	// write to a temporary file and move it over the old index, a reader never sees a partial file
+	CStringW tmpfn = m_idxfn + L".tmp";
+
+	HANDLE hFile = CreateFileW(tmpfn, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return 1;
+	}
+
+	header_t hdr = m_hdr;
+	hdr.count = m_sps.GetCount();
+
+	DWORD len = sizeof(hdr), written = 0;
+	bool bRet = WriteFile(hFile, &hdr, len, &written, NULL) && written == len;
+
+	// in chunks, so a cancelled save stops quickly
+	const size_t chunk = 65536;
+	for (size_t i = 0; bRet && i < m_sps.GetCount(); i += chunk) {
+		if (m_bAbortSave) {
+			bRet = false;
+			break;
+		}
+		len = (DWORD)(min(chunk, m_sps.GetCount() - i) * sizeof(SyncPoint));
+		bRet = WriteFile(hFile, &m_sps[i], len, &written, NULL) && written == len;
+	}
+
+	CloseHandle(hFile);
+
+	if (!bRet || m_bAbortSave || !MoveFileExW(tmpfn, m_idxfn, MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileW(tmpfn);
+		return 1;
+	}
+
+	DbgLog((LOG_TRACE, 3, L"CSeekIndexCache::ThreadProc() : '%s' -> %Iu entries saved", (LPCWSTR)m_idxfn, m_sps.GetCount()));
+
+	Prune(dir);
+
+	return 0;
+}
+
+void CSeekIndexCache::Prune(const CStringW& dir)
+{
+	struct idxfile_t {
+		CStringW	fn;
+		UINT64		size;
+		UINT64		mtime;
+	};
+	std::vector<idxfile_t> files;
+	UINT64 total = 0;
+
+	WIN32_FIND_DATAW fd;
+	HANDLE hFind = FindFirstFileW(dir + L"\\*.idx", &fd);
+	if (hFind == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	do {
+		if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+			idxfile_t f;
+			f.fn	= dir + L"\\" + fd.cFileName;
+			f.size	= ((UINT64)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+			f.mtime	= ((UINT64)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+			total += f.size;
+			files.push_back(f);
+		}
+	} while (!m_bAbortSave && FindNextFileW(hFind, &fd));
+	FindClose(hFind);
+
+	if (total <= SEEKINDEX_MAX_BYTES) {
+		return;
+	}
+
+	// least recently used first, Load() touches the files it accepts
+	std::sort(files.begin(), files.end(), [](const idxfile_t& a, const idxfile_t& b) {
+		return a.mtime < b.mtime;
+	});
+
+	for (size_t i = 0; i < files.size() && total > SEEKINDEX_MAX_BYTES && !m_bAbortSave; i++) {
+		if (files[i].fn.CompareNoCase(m_idxfn) && DeleteFileW(files[i].fn)) {
+			total -= files[i].size;
+		}
+	}
+
+	DbgLog((LOG_TRACE, 3, L"CSeekIndexCache::Prune() : %I64u bytes left in '%s'", total, (LPCWSTR)dir));
+}
@@ -0,0 +1,85 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atlcoll.h>
+#include <basestruct.h>
+
+//
+// CSeekIndexCache - persistent time -> file position table for containers without a usable index
+//
+// The table is stored in the directory given to Open(), one file per media file named by a hash of its path,
+// and is only accepted back when the path, size and last write time of the media file still match.
+// Load() maps the index file, Save() writes it from a background thread when the table has grown
+// and then removes the least recently used files while the directory is over SEEKINDEX_MAX_BYTES.
+//
+
+#define SEEKINDEX_MAGIC			0x49534d50	// 'PMSI'
+#define SEEKINDEX_VERSION		2
+#define SEEKINDEX_MAX_BYTES		(64 * 1024 * 1024)
+#define SEEKINDEX_SAVE_TIMEOUT	2000		// ms a running save may take before it is cancelled
+
+class CSeekIndexCache
+{
+#pragma pack(push, 1)
+	struct header_t {
+		DWORD	magic;
+		DWORD	version;
+		DWORD	fourcc;		// container type, set by the splitter
+		DWORD	reserved;
+		UINT64	pathhash;	// second hash of the lowercase path, the path itself is not stored
+		UINT64	size;		// file size
+		UINT64	mtime;		// last write time
+		UINT64	len;		// stream length as seen by the splitter
+		UINT64	count;		// SyncPoint entries after the header
+	};
+#pragma pack(pop)
+
+	CStringW	m_idxfn;	// index file
+	header_t	m_hdr;
+	size_t		m_nSavedCount;	// entries in the index file as loaded or last saved
+
+	CAtlArray<SyncPoint> m_sps;	// entries being written, owned by the save thread while it runs
+	HANDLE		m_hThread;
+	volatile bool m_bAbortSave;
+
+	DWORD ThreadProc();
+	static DWORD WINAPI StaticThreadProc(LPVOID lpParam);
+
+	void WaitSave();
+	void Prune(const CStringW& dir);
+
+public:
+	CSeekIndexCache();
+	~CSeekIndexCache();
+
+	// %LOCALAPPDATA%\MPC-BE\SeekIndex, or SeekIndex next to the ini file when the settings are stored there
+	static CStringW GetDefaultDir();
+
+	// pszDir == NULL or empty disables the cache
+	bool Open(LPCWSTR pszDir, LPCWSTR pszFileName, DWORD fourcc, __int64 len);
+	bool IsOpen() const {
+		return !m_idxfn.IsEmpty();
+	}
+
+	bool Load(CAtlArray<SyncPoint>& sps);
+	bool Save(const CAtlArray<SyncPoint>& sps);
+};
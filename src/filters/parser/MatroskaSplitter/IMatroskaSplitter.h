@@ -29,4 +29,7 @@ public IUnknown {
 	STDMETHOD_(BOOL, GetLoadEmbeddedFonts()) PURE;
 	STDMETHOD(SetCalcDuration(BOOL nValue)) PURE;
 	STDMETHOD_(BOOL, GetCalcDuration()) PURE;
+
+	STDMETHOD(SetSeekIndexCache(BOOL nValue)) PURE;
+	STDMETHOD_(BOOL, GetSeekIndexCache()) PURE;
 };
@@ -81,6 +81,8 @@ HRESULT CMatroskaFile::Init()
 		return E_FAIL;
 	}
 
+	m_segment.BuildCueIndex();
+
 	CAutoPtr<CMatroskaNode> pSegment, pCluster;
 	if ((pSegment = Root.Child(MATROSKA_ID_SEGMENT))
 			&& (pCluster = pSegment->Child(MATROSKA_ID_CLUSTER))) {
@@ -296,6 +298,125 @@ UINT64 Segment::GetMasterTrack()
 	return TrackNumber;
 }
 
+static int cuesort(const void* a, const void* b)
+{
+	const CueIndexItem* c1 = (const CueIndexItem*)a;
+	const CueIndexItem* c2 = (const CueIndexItem*)b;
+
+	if (c1->CueTrack != c2->CueTrack) {
+		return c1->CueTrack < c2->CueTrack ? -1 : 1;
+	}
+	if (c1->CueTime != c2->CueTime) {
+		return c1->CueTime < c2->CueTime ? -1 : 1;
+	}
+	return c1->nOrder < c2->nOrder ? -1 : (c1->nOrder > c2->nOrder ? 1 : 0);
+}
+
+void Segment::BuildCueIndex()
+{
+	size_t count = 0;
+	POSITION pos1 = Cues.GetHeadPosition();
+	while (pos1) {
+		Cue* pCue = Cues.GetNext(pos1);
+
+		POSITION pos2 = pCue->CuePoints.GetHeadPosition();
+		while (pos2) {
+			count += pCue->CuePoints.GetNext(pos2)->CueTrackPositions.GetCount();
+		}
+	}
+
+	if (count) {
+		CueIndex.SetCount(CueIndex.GetCount(), (int)count);
+	}
+
+	pos1 = Cues.GetHeadPosition();
+	while (pos1) {
+		Cue* pCue = Cues.GetNext(pos1);
+
+		POSITION pos2 = pCue->CuePoints.GetHeadPosition();
+		while (pos2) {
+			CuePoint* pCuePoint = pCue->CuePoints.GetNext(pos2);
+
+			POSITION pos3 = pCuePoint->CueTrackPositions.GetHeadPosition();
+			while (pos3) {
+				CueTrackPosition* pCueTrackPositions = pCuePoint->CueTrackPositions.GetNext(pos3);
+
+				CueIndexItem item;
+				item.CueTrack				= pCueTrackPositions->CueTrack;
+				item.CueTime				= pCuePoint->CueTime;
+				item.CueClusterPosition		= pCueTrackPositions->CueClusterPosition;
+				item.CueRelativePosition	= pCueTrackPositions->CueRelativePosition;
+				item.CueDuration			= pCueTrackPositions->CueDuration;
+				item.nOrder					= CueIndex.GetCount();
+				CueIndex.Add(item);
+			}
+		}
+	}
+
+	qsort(CueIndex.GetData(), CueIndex.GetCount(), sizeof(CueIndexItem), cuesort);
+
+	// everything is served from the index now
+	Cues.RemoveAll();
+}
+
+void Segment::AddCue(UINT64 TrackNumber, UINT64 CueTime, UINT64 CueClusterPosition)
+{
+	// used when reindexing, BuildCueIndex() must be called afterwards
+	CueIndexItem item;
+	item.CueTrack				= TrackNumber;
+	item.CueTime				= CueTime;
+	item.CueClusterPosition		= CueClusterPosition;
+	item.CueRelativePosition	= 0;
+	item.CueDuration			= 0;
+	item.nOrder					= CueIndex.GetCount();
+	CueIndex.Add(item);
+}
+
+size_t Segment::GetCueRange(UINT64 TrackNumber, size_t& first) const
+{
+	size_t lo = 0, hi = CueIndex.GetCount();
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (CueIndex[mid].CueTrack < TrackNumber) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	first = lo;
+
+	hi = CueIndex.GetCount();
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (CueIndex[mid].CueTrack <= TrackNumber) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo - first;
+}
+
+INT_PTR Segment::FindCue(UINT64 TrackNumber, REFERENCE_TIME rt) const
+{
+	size_t first = 0;
+	size_t count = GetCueRange(TrackNumber, first);
+
+	// first cue point of the track after rt
+	size_t lo = first, hi = first + count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (GetRefTime(CueIndex[mid].CueTime) <= rt) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo > first ? (INT_PTR)lo - 1 : -1;
+}
+
 ChapterAtom* ChapterAtom::FindChapterAtom(UINT64 id)
 {
 	if (ChapterUID == id) {
@@ -466,6 +466,11 @@ namespace MatroskaReader
 		HRESULT Parse(CMatroskaNode* pMN);
 	};
 
+	struct CueIndexItem {
+		UINT64 CueTrack, CueTime, CueClusterPosition, CueRelativePosition, CueDuration;
+		size_t nOrder; // position in the Cues element, keeps the sort stable
+	};
+
 	class AttachedFile
 	{
 	public:
@@ -595,11 +600,19 @@ namespace MatroskaReader
 		CNode<Chapter> Chapters;
 		CNode<Tags> Tags;
 
+		// all CueTrackPositions of Cues in one array, sorted by track and time
+		CAtlArray<CueIndexItem> CueIndex;
+
 		HRESULT Parse(CMatroskaNode* pMN);
 		HRESULT ParseMinimal(CMatroskaNode* pMN);
 
 		UINT64 GetMasterTrack();
 
+		void BuildCueIndex();
+		void AddCue(UINT64 TrackNumber, UINT64 CueTime, UINT64 CueClusterPosition);
+		size_t GetCueRange(UINT64 TrackNumber, size_t& first) const;
+		INT_PTR FindCue(UINT64 TrackNumber, REFERENCE_TIME rt) const;
+
 		REFERENCE_TIME GetRefTime(INT64 t) const {
 			return t*(REFERENCE_TIME)(SegmentInfo.TimeCodeScale)/100;
 		}
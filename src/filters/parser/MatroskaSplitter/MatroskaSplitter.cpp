@@ -37,6 +37,7 @@
 #define OPT_SECTION_MATROSKASplit	_T("Filters\\Matroska Splitter")
 #define OPT_LoadEmbeddedFonts		_T("LoadEmbeddedFonts")
 #define OPT_CalcDuration			_T("CalculateDuration")
+#define OPT_SeekIndexCache			_T("SeekIndexCache")
 
 using namespace MatroskaReader;
 
@@ -96,6 +97,7 @@ CMatroskaSplitterFilter::CMatroskaSplitterFilter(LPUNKNOWN pUnk, HRESULT* phr)
 	: CBaseSplitterFilter(NAME("CMatroskaSplitterFilter"), pUnk, phr, __uuidof(this))
 	, m_bLoadEmbeddedFonts(true)
 	, m_bCalcDuration(false)
+	, m_bSeekIndexCache(false)
 	, m_Seek_rt(INVALID_TIME)
 	, m_bSupportCueDuration(FALSE)
 {
@@ -112,10 +114,15 @@ CMatroskaSplitterFilter::CMatroskaSplitterFilter(LPUNKNOWN pUnk, HRESULT* phr)
 		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_CalcDuration, dw)) {
 			m_bCalcDuration = !!dw;
 		}
+
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_SeekIndexCache, dw)) {
+			m_bSeekIndexCache = !!dw;
+		}
 	}
 #else
 	m_bLoadEmbeddedFonts	= !!AfxGetApp()->GetProfileInt(OPT_SECTION_MATROSKASplit, OPT_LoadEmbeddedFonts, m_bLoadEmbeddedFonts);
 	m_bCalcDuration			= !!AfxGetApp()->GetProfileInt(OPT_SECTION_MATROSKASplit, OPT_CalcDuration, m_bCalcDuration);
+	m_bSeekIndexCache		= !!AfxGetApp()->GetProfileInt(OPT_SECTION_MATROSKASplit, OPT_SeekIndexCache, TRUE);
 #endif
 }
 
@@ -200,6 +207,10 @@ HRESULT CMatroskaSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 		return hr;
 	}
 
+	if (m_pFile->IsRandomAccess()) {
+		m_SeekIndexCache.Open(m_bSeekIndexCache ? CSeekIndexCache::GetDefaultDir() : L"", GetPartFilename(pAsyncReader), FCC('MKV '), m_pFile->GetLength());
+	}
+
 	CMatroskaNode Root(m_pFile);
 	if (!m_pFile
 			|| !(m_pSegment = Root.Child(MATROSKA_ID_SEGMENT))
@@ -591,103 +602,81 @@ HRESULT CMatroskaSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 					CAtlArray<INT64> timecodes;
 					bool readmore = true;
 
-					CNode<Cue>* pCues;
-					CNode<Cue>  Cues;
-					if (m_pFile->m_segment.Cues.GetCount()) {
-						pCues = &m_pFile->m_segment.Cues;
-					} else {
-						UINT64 TrackNumber = m_pFile->m_segment.GetMasterTrack();
-
-						CAutoPtr<Cue> pCue(DNew Cue());
-
+					const CueIndexItem* pCues = NULL;
+					size_t nCues = 0;
+					CAtlArray<CueIndexItem> Cues;
+					if (m_pFile->m_segment.CueIndex.GetCount()) {
+						size_t first = 0;
+						nCues = m_pFile->m_segment.GetCueRange(pTE->TrackNumber, first);
+						pCues = m_pFile->m_segment.CueIndex.GetData() + first;
+					} else if (m_pFile->m_segment.GetMasterTrack() == pTE->TrackNumber) {
 						do {
 							Cluster c;
 							c.ParseTimeCode(m_pCluster);
 
-							CAutoPtr<CuePoint> pCuePoint(DNew CuePoint());
-							CAutoPtr<CueTrackPosition> pCueTrackPosition(DNew CueTrackPosition());
-							pCuePoint->CueTime.Set(c.TimeCode);
-							pCueTrackPosition->CueTrack.Set(TrackNumber);
-							pCueTrackPosition->CueClusterPosition.Set(m_pCluster->m_filepos - m_pSegment->m_start);
-							pCuePoint->CueTrackPositions.AddTail(pCueTrackPosition);
-							pCue->CuePoints.AddTail(pCuePoint);
-						} while (m_pCluster->Next(true) && pCue->CuePoints.GetCount() < 2);
-
-						Cues.AddTail(pCue);
-						pCues = &Cues;
+							CueIndexItem item = {pTE->TrackNumber, c.TimeCode, m_pCluster->m_filepos - m_pSegment->m_start, 0, 0, Cues.GetCount()};
+							Cues.Add(item);
+						} while (m_pCluster->Next(true) && Cues.GetCount() < 2);
+
+						nCues = Cues.GetCount();
+						pCues = Cues.GetData();
 					}
 
-					POSITION pos1 = pCues->GetHeadPosition();
-					while (readmore && pos1) {
-						Cue* pCue = pCues->GetNext(pos1);
-						POSITION pos2 = pCue->CuePoints.GetHeadPosition();
-						while (readmore && pos2) {
-							CuePoint* pCuePoint = pCue->CuePoints.GetNext(pos2);
-							POSITION pos3 = pCuePoint->CueTrackPositions.GetHeadPosition();
-							while (readmore && pos3) {
-								CueTrackPosition* pCueTrackPositions = pCuePoint->CueTrackPositions.GetNext(pos3);
-								if (pCueTrackPositions->CueTrack != pTE->TrackNumber) {
-									continue;
-								}
+					for (size_t i = 0; readmore && i < nCues; i++) {
+						const CueIndexItem& cue = pCues[i];
+
+						if (lastCueClusterPosition == cue.CueClusterPosition) {
+							continue;
+						}
+						lastCueClusterPosition = cue.CueClusterPosition;
+
+						m_pCluster->SeekTo(m_pSegment->m_start + cue.CueClusterPosition);
+						m_pCluster->Parse();
+
+						Cluster c;
+						c.ParseTimeCode(m_pCluster);
+
+						if (CAutoPtr<CMatroskaNode> pBlock = m_pCluster->GetFirstBlock()) {
+							do {
+								CBlockGroupNode bgn;
 
-								if (lastCueClusterPosition == pCueTrackPositions->CueClusterPosition) {
-									continue;
+								if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
+									bgn.Parse(pBlock, true);
+								} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
+									CAutoPtr<BlockGroup> bg(DNew BlockGroup());
+									bg->Block.Parse(pBlock, true);
+									if (!(bg->Block.Lacing & 0x80)) {
+										bg->ReferenceBlock.Set(0);    // not a kf
+									}
+									bgn.AddTail(bg);
 								}
-								lastCueClusterPosition = pCueTrackPositions->CueClusterPosition;
-
-								m_pCluster->SeekTo(m_pSegment->m_start + pCueTrackPositions->CueClusterPosition);
-								m_pCluster->Parse();
-
-								Cluster c;
-								c.ParseTimeCode(m_pCluster);
-
-								if (CAutoPtr<CMatroskaNode> pBlock = m_pCluster->GetFirstBlock()) {
-									do {
-										CBlockGroupNode bgn;
-
-										if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
-											bgn.Parse(pBlock, true);
-										} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
-											CAutoPtr<BlockGroup> bg(DNew BlockGroup());
-											bg->Block.Parse(pBlock, true);
-											if (!(bg->Block.Lacing & 0x80)) {
-												bg->ReferenceBlock.Set(0);    // not a kf
-											}
-											bgn.AddTail(bg);
-										}
-
-										POSITION pos4 = bgn.GetHeadPosition();
-										while (pos4) {
-											BlockGroup* bg = bgn.GetNext(pos4);
-											if (bg->Block.TrackNumber != pTE->TrackNumber) {
-												continue;
-											}
-											INT64 tc = c.TimeCode + bg->Block.TimeCode;
-
-											if (tc < 0) {
-												continue;
-											}
-
-											timecodes.Add(tc);
-											DbgLog((LOG_TRACE, 3, L"	=> Frame: %02d, TimeCode: %5I64d = %10I64d", timecodes.GetCount(), tc, m_pFile->m_segment.GetRefTime(tc)));
-
-											if (timecodes.GetCount() >= 50) {
-												readmore = false;
-												break;
-											}
-										}
-									} while (readmore && pBlock->NextBlock());
+
+								POSITION pos4 = bgn.GetHeadPosition();
+								while (pos4) {
+									BlockGroup* bg = bgn.GetNext(pos4);
+									if (bg->Block.TrackNumber != pTE->TrackNumber) {
+										continue;
+									}
+									INT64 tc = c.TimeCode + bg->Block.TimeCode;
+
+									if (tc < 0) {
+										continue;
+									}
+
+									timecodes.Add(tc);
+									DbgLog((LOG_TRACE, 3, L"	=> Frame: %02d, TimeCode: %5I64d = %10I64d", timecodes.GetCount(), tc, m_pFile->m_segment.GetRefTime(tc)));
+
+									if (timecodes.GetCount() >= 50) {
+										readmore = false;
+										break;
+									}
 								}
-							}
+							} while (readmore && pBlock->NextBlock());
 						}
 					}
 
 					m_pCluster.Free();
 
-					if (Cues.GetCount()) {
-						Cues.RemoveAll();
-					}
-
 					if (timecodes.GetCount()) {
 						qsort(timecodes.GetData(), timecodes.GetCount(), sizeof(INT64), compare);
 
@@ -1102,7 +1091,7 @@ HRESULT CMatroskaSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 
 	m_rtDuration = (REFERENCE_TIME)(info.Duration * info.TimeCodeScale / 100);
 
-	if (m_bCalcDuration && bHasVideo && m_pFile->m_segment.Cues.GetCount()) {
+	if (m_bCalcDuration && bHasVideo && m_pFile->m_segment.CueIndex.GetCount()) {
 		// calculate duration from video track;
 		m_pSegment = Root.Child(MATROSKA_ID_SEGMENT);
 		m_pCluster = m_pSegment->Child(MATROSKA_ID_CLUSTER);
@@ -1113,61 +1102,48 @@ HRESULT CMatroskaSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 
 		REFERENCE_TIME rtDur = INVALID_TIME;
 
-		POSITION pos1 = s.Cues.GetTailPosition();
-		while (pos1 && rtDur == INVALID_TIME) {
-			Cue* pCue = s.Cues.GetPrev(pos1);
-
-			POSITION pos2 = pCue->CuePoints.GetTailPosition();
-			while (pos2 && rtDur == INVALID_TIME) {
-				CuePoint* pCuePoint = pCue->CuePoints.GetPrev(pos2);
+		size_t first = 0;
+		size_t count = s.GetCueRange(TrackNumber, first);
+		for (size_t i = first + count; i > first && rtDur == INVALID_TIME; i--) {
+			const CueIndexItem& cue = s.CueIndex[i - 1];
 
-				POSITION pos3 = pCuePoint->CueTrackPositions.GetTailPosition();
-				while (pos3 && rtDur == INVALID_TIME) {
-					CueTrackPosition* pCueTrackPositions = pCuePoint->CueTrackPositions.GetPrev(pos3);
+			m_pCluster->SeekTo(m_pSegment->m_start + cue.CueClusterPosition);
+			if (FAILED(m_pCluster->Parse())) {
+				continue;
+			}
 
-					if (TrackNumber != pCueTrackPositions->CueTrack) {
-						continue;
-					}
+			do {
+				Cluster c;
+				c.ParseTimeCode(m_pCluster);
 
-					m_pCluster->SeekTo(m_pSegment->m_start + pCueTrackPositions->CueClusterPosition);
-					if (FAILED(m_pCluster->Parse())) {
-						continue;
-					}
+				if (CAutoPtr<CMatroskaNode> pBlock = m_pCluster->GetFirstBlock()) {
 
 					do {
-						Cluster c;
-						c.ParseTimeCode(m_pCluster);
-
-						if (CAutoPtr<CMatroskaNode> pBlock = m_pCluster->GetFirstBlock()) {
-
-							do {
-								CBlockGroupNode bgn;
-
-								if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
-									bgn.Parse(pBlock, true);
-								} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
-									CAutoPtr<BlockGroup> bg(DNew BlockGroup());
-									bg->Block.Parse(pBlock, true);
-									if (!(bg->Block.Lacing & 0x80)) {
-										bg->ReferenceBlock.Set(0); // not a kf
-									}
-									bgn.AddTail(bg);
-								}
+						CBlockGroupNode bgn;
+
+						if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
+							bgn.Parse(pBlock, true);
+						} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
+							CAutoPtr<BlockGroup> bg(DNew BlockGroup());
+							bg->Block.Parse(pBlock, true);
+							if (!(bg->Block.Lacing & 0x80)) {
+								bg->ReferenceBlock.Set(0); // not a kf
+							}
+							bgn.AddTail(bg);
+						}
 
-								POSITION pos4 = bgn.GetHeadPosition();
-								while (pos4) {
-									BlockGroup* bg = bgn.GetNext(pos4);
+						POSITION pos4 = bgn.GetHeadPosition();
+						while (pos4) {
+							BlockGroup* bg = bgn.GetNext(pos4);
 
-									if (bg->Block.TrackNumber == pCueTrackPositions->CueTrack) {
-										REFERENCE_TIME rt = s.GetRefTime(c.TimeCode + bg->Block.TimeCode) + (bg->BlockDuration.IsValid() ? m_pFile->m_segment.GetRefTime(bg->BlockDuration) : 0);
-										rtDur = max(rtDur, rt);
-									}
-								}
-							} while (pBlock->NextBlock());
+							if (bg->Block.TrackNumber == cue.CueTrack) {
+								REFERENCE_TIME rt = s.GetRefTime(c.TimeCode + bg->Block.TimeCode) + (bg->BlockDuration.IsValid() ? m_pFile->m_segment.GetRefTime(bg->BlockDuration) : 0);
+								rtDur = max(rtDur, rt);
+							}
 						}
-					} while (m_pCluster->Next(true));
+					} while (pBlock->NextBlock());
 				}
-			}
+			} while (m_pCluster->Next(true));
 		}
 		m_pCluster.Free();
 		m_pBlock.Free();
@@ -1398,49 +1374,61 @@ bool CMatroskaSplitterFilter::DemuxInit()
 	}
 
 	// reindex if needed
-	if (m_pFile->IsRandomAccess() && m_pFile->m_segment.Cues.GetCount() == 0) {
+	if (m_pFile->IsRandomAccess() && m_pFile->m_segment.CueIndex.GetCount() == 0) {
 		m_nOpenProgress = 0;
 		m_pFile->m_segment.SegmentInfo.Duration.Set(0);
 
 		UINT64 TrackNumber = m_pFile->m_segment.GetMasterTrack();
 
-		CAutoPtr<Cue> pCue(DNew Cue());
-
-		do {
-			Cluster c;
-			c.ParseTimeCode(m_pCluster);
+		// cluster timecode -> cluster position, stored on a previous open
+		CAtlArray<SyncPoint> sps;
+		if (m_SeekIndexCache.Load(sps) && sps.GetCount()) {
+			for (size_t i = 0; i < sps.GetCount(); i++) {
+				m_pFile->m_segment.AddCue(TrackNumber, sps[i].rt, sps[i].fp);
+			}
+			m_pFile->m_segment.SegmentInfo.Duration.Set((float)sps[sps.GetCount() - 1].rt - m_pFile->m_rtOffset / 10000);
+		} else {
+			do {
+				Cluster c;
+				c.ParseTimeCode(m_pCluster);
 
-			m_pFile->m_segment.SegmentInfo.Duration.Set((float)c.TimeCode - m_pFile->m_rtOffset / 10000);
+				m_pFile->m_segment.SegmentInfo.Duration.Set((float)c.TimeCode - m_pFile->m_rtOffset / 10000);
 
-			CAutoPtr<CuePoint> pCuePoint(DNew CuePoint());
-			CAutoPtr<CueTrackPosition> pCueTrackPosition(DNew CueTrackPosition());
-			pCuePoint->CueTime.Set(c.TimeCode);
-			pCueTrackPosition->CueTrack.Set(TrackNumber);
-			pCueTrackPosition->CueClusterPosition.Set(m_pCluster->m_filepos - m_pSegment->m_start);
-			pCuePoint->CueTrackPositions.AddTail(pCueTrackPosition);
-			pCue->CuePoints.AddTail(pCuePoint);
+				m_pFile->m_segment.AddCue(TrackNumber, c.TimeCode, m_pCluster->m_filepos - m_pSegment->m_start);
 
-			m_nOpenProgress = m_pFile->GetPos() * 100 / m_pFile->GetLength();
+				m_nOpenProgress = m_pFile->GetPos() * 100 / m_pFile->GetLength();
 
-			DWORD cmd;
-			if (CheckRequest(&cmd)) {
-				if (cmd == CMD_EXIT) {
-					m_fAbort = true;
-				} else {
-					Reply(S_OK);
+				DWORD cmd;
+				if (CheckRequest(&cmd)) {
+					if (cmd == CMD_EXIT) {
+						m_fAbort = true;
+					} else {
+						Reply(S_OK);
+					}
 				}
-			}
-		} while (!m_fAbort && m_pCluster->Next(true));
+			} while (!m_fAbort && m_pCluster->Next(true));
+		}
 
 		m_nOpenProgress = 100;
 
-		if (!m_fAbort) {
-			m_pFile->m_segment.Cues.AddTail(pCue);
+		if (m_fAbort) {
+			m_pFile->m_segment.CueIndex.RemoveAll();
+		}
+		m_pFile->m_segment.BuildCueIndex();
+
+		if (!m_fAbort && sps.IsEmpty()) {
+			const CAtlArray<CueIndexItem>& CueIndex = m_pFile->m_segment.CueIndex;
+			sps.SetCount(CueIndex.GetCount());
+			for (size_t i = 0; i < CueIndex.GetCount(); i++) {
+				sps[i].rt = CueIndex[i].CueTime;
+				sps[i].fp = CueIndex[i].CueClusterPosition;
+			}
+			m_SeekIndexCache.Save(sps);
 		}
 
 		m_fAbort = false;
 
-		if (m_pFile->m_segment.Cues.GetCount()) {
+		if (m_pFile->m_segment.CueIndex.GetCount()) {
 			Info& info		= m_pFile->m_segment.SegmentInfo;
 			m_rtDuration	= (REFERENCE_TIME)(info.Duration * info.TimeCodeScale / 100);
 			m_rtNewStop		= m_rtStop = m_rtDuration;
@@ -1450,23 +1438,11 @@ bool CMatroskaSplitterFilter::DemuxInit()
 	m_pCluster.Free();
 	m_pBlock.Free();
 
-	POSITION pos1 = m_pFile->m_segment.Cues.GetHeadPosition();
-	while (pos1) {
-		Cue* pCue = m_pFile->m_segment.Cues.GetNext(pos1);
-
-		POSITION pos2 = pCue->CuePoints.GetTailPosition();
-		while (pos2) {
-			CuePoint* pCuePoint = pCue->CuePoints.GetPrev(pos2);
-
-			POSITION pos3 = pCuePoint->CueTrackPositions.GetHeadPosition();
-			while (pos3) {
-				CueTrackPosition* pCueTrackPositions = pCuePoint->CueTrackPositions.GetNext(pos3);
-
-				if (pCueTrackPositions->CueDuration && pCueTrackPositions->CueRelativePosition) {
-					m_bSupportCueDuration = TRUE;
-					break;
-				}
-			}
+	const CAtlArray<CueIndexItem>& CueIndex = m_pFile->m_segment.CueIndex;
+	for (size_t i = 0; i < CueIndex.GetCount(); i++) {
+		if (CueIndex[i].CueDuration && CueIndex[i].CueRelativePosition) {
+			m_bSupportCueDuration = TRUE;
+			break;
 		}
 	}
 
@@ -1491,94 +1467,75 @@ void CMatroskaSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 
 		REFERENCE_TIME seek_rt = 0;
 
-		POSITION pos1 = s.Cues.GetHeadPosition();
-		while (pos1) {
-			Cue* pCue = s.Cues.GetNext(pos1);
+		for (INT_PTR i = s.FindCue(TrackNumber, rt); i >= 0 && s.CueIndex[i].CueTrack == TrackNumber; i--) {
+			const CueIndexItem& cue = s.CueIndex[i];
 
-			POSITION pos2 = pCue->CuePoints.GetTailPosition();
-			while (pos2) {
-				CuePoint* pCuePoint = pCue->CuePoints.GetPrev(pos2);
-
-				if (rt < s.GetRefTime(pCuePoint->CueTime)) {
-					continue;
-				}
-
-				POSITION pos3 = pCuePoint->CueTrackPositions.GetHeadPosition();
-				while (pos3) {
-					CueTrackPosition* pCueTrackPositions = pCuePoint->CueTrackPositions.GetNext(pos3);
-
-					if (TrackNumber != pCueTrackPositions->CueTrack) {
-						continue;
-					}
-
-					if (lastCueClusterPosition == pCueTrackPositions->CueClusterPosition) {
-						continue;
-					}
-
-					lastCueClusterPosition = pCueTrackPositions->CueClusterPosition;
-
-					m_pCluster->SeekTo(m_pSegment->m_start + pCueTrackPositions->CueClusterPosition);
-					if (FAILED(m_pCluster->Parse())) {
-						continue;
-					}
-
-					{
-						Cluster c;
-						c.ParseTimeCode(m_pCluster);
-						seek_rt = s.GetRefTime(c.TimeCode);
+			if (lastCueClusterPosition == cue.CueClusterPosition) {
+				continue;
+			}
 
-						bool fPassedCueTime = false;
-						if (CAutoPtr<CMatroskaNode> pBlock = m_pCluster->GetFirstBlock()) {
+			lastCueClusterPosition = cue.CueClusterPosition;
 
-							do {
-								CBlockGroupNode bgn;
+			m_pCluster->SeekTo(m_pSegment->m_start + cue.CueClusterPosition);
+			if (FAILED(m_pCluster->Parse())) {
+				continue;
+			}
 
-								if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
-									bgn.Parse(pBlock, true);
-								} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
-									CAutoPtr<BlockGroup> bg(DNew BlockGroup());
-									bg->Block.Parse(pBlock, true);
-									if (!(bg->Block.Lacing & 0x80)) {
-										bg->ReferenceBlock.Set(0); // not a kf
-									}
-									bgn.AddTail(bg);
-								}
+			{
+				Cluster c;
+				c.ParseTimeCode(m_pCluster);
+				seek_rt = s.GetRefTime(c.TimeCode);
 
-								POSITION pos4 = bgn.GetHeadPosition();
-								while (!fPassedCueTime && pos4) {
-									BlockGroup* bg = bgn.GetNext(pos4);
-									seek_rt = s.GetRefTime(c.TimeCode + bg->Block.TimeCode);
+				bool fPassedCueTime = false;
+				if (CAutoPtr<CMatroskaNode> pBlock = m_pCluster->GetFirstBlock()) {
 
-									if ((bg->Block.TrackNumber == pCueTrackPositions->CueTrack && rt < seek_rt) || (abs(seek_rt - rt) <= 5000000i64)) {
-										fPassedCueTime = true;
-									}
-								}
-							} while (!fPassedCueTime && pBlock->NextBlock());
+					do {
+						CBlockGroupNode bgn;
+
+						if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
+							bgn.Parse(pBlock, true);
+						} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
+							CAutoPtr<BlockGroup> bg(DNew BlockGroup());
+							bg->Block.Parse(pBlock, true);
+							if (!(bg->Block.Lacing & 0x80)) {
+								bg->ReferenceBlock.Set(0); // not a kf
+							}
+							bgn.AddTail(bg);
 						}
 
-						if (fPassedCueTime && seek_rt > 0) {
-							DbgLog((LOG_TRACE, 3, L"CMatroskaSplitterFilter::DemuxSeek() : Seek One - %s => %s, [%10I64d - %10I64d]", ReftimeToString(rt), ReftimeToString(seek_rt), rt, seek_rt));
-							goto end;
+						POSITION pos4 = bgn.GetHeadPosition();
+						while (!fPassedCueTime && pos4) {
+							BlockGroup* bg = bgn.GetNext(pos4);
+							seek_rt = s.GetRefTime(c.TimeCode + bg->Block.TimeCode);
+
+							if ((bg->Block.TrackNumber == cue.CueTrack && rt < seek_rt) || (abs(seek_rt - rt) <= 5000000i64)) {
+								fPassedCueTime = true;
+							}
 						}
-					}
+					} while (!fPassedCueTime && pBlock->NextBlock());
 				}
 
-				Cluster c;
-				c.ParseTimeCode(m_pCluster);
-				REFERENCE_TIME seek_rt2 = s.GetRefTime(c.TimeCode);
-
-				if (seek_rt2 > 0) {
-					DbgLog((LOG_TRACE, 3, L"CMatroskaSplitterFilter::DemuxSeek() : Seek Two - %s => %s, [%10I64d - %10I64d]", ReftimeToString(rt), ReftimeToString(seek_rt2), rt, seek_rt2));
+				if (fPassedCueTime && seek_rt > 0) {
+					DbgLog((LOG_TRACE, 3, L"CMatroskaSplitterFilter::DemuxSeek() : Seek One - %s => %s, [%10I64d - %10I64d]", ReftimeToString(rt), ReftimeToString(seek_rt), rt, seek_rt));
 					goto end;
 				}
 			}
 
-			if (seek_rt > 0 && seek_rt < rt) {
-				DbgLog((LOG_TRACE, 3, L"CMatroskaSplitterFilter::DemuxSeek() : Seek Three - %s => %s, [%10I64d - %10I64d]", ReftimeToString(rt), ReftimeToString(seek_rt), rt, seek_rt));
+			Cluster c;
+			c.ParseTimeCode(m_pCluster);
+			REFERENCE_TIME seek_rt2 = s.GetRefTime(c.TimeCode);
+
+			if (seek_rt2 > 0) {
+				DbgLog((LOG_TRACE, 3, L"CMatroskaSplitterFilter::DemuxSeek() : Seek Two - %s => %s, [%10I64d - %10I64d]", ReftimeToString(rt), ReftimeToString(seek_rt2), rt, seek_rt2));
 				goto end;
 			}
 		}
 
+		if (seek_rt > 0 && seek_rt < rt) {
+			DbgLog((LOG_TRACE, 3, L"CMatroskaSplitterFilter::DemuxSeek() : Seek Three - %s => %s, [%10I64d - %10I64d]", ReftimeToString(rt), ReftimeToString(seek_rt), rt, seek_rt));
+			goto end;
+		}
+
 		{
 			// Plan B
 			m_pCluster = m_pSegment->Child(MATROSKA_ID_CLUSTER);
@@ -1656,215 +1613,99 @@ bool CMatroskaSplitterFilter::DemuxLoop()
 			CMatroskaNode Root(m_pFile);
 			CAutoPtr<CMatroskaNode> pCluster = m_pSegment->Child(MATROSKA_ID_CLUSTER);
 
-			QWORD lastCueClusterPosition = ULONGLONG_MAX;
-			BOOL bBreak = FALSE;
-
-			if (pCluster && !bBreak) {
-				pos1 = s.Cues.GetHeadPosition();
-				while (pos1) {
-					Cue* pCue = s.Cues.GetNext(pos1);
-
-					POSITION pos2 = pCue->CuePoints.GetTailPosition();
-					while (pos2 && !bBreak) {
-						CuePoint* pCuePoint = pCue->CuePoints.GetPrev(pos2);
-
-						REFERENCE_TIME cueTime = s.GetRefTime(pCuePoint->CueTime);
-						if (cueTime > m_Seek_rt) {
-							continue;
-						}
-
-						POSITION pos3 = pCuePoint->CueTrackPositions.GetHeadPosition();
-						while (pos3 && !bBreak) {
-							CueTrackPosition* pCueTrackPositions = pCuePoint->CueTrackPositions.GetNext(pos3);
-
-							if (m_bSupportCueDuration && !TrackNumbers.Find(pCueTrackPositions->CueTrack)) {
-								continue;
-							}
-
-							if (m_bSupportCueDuration && (!pCueTrackPositions->CueDuration || !pCueTrackPositions->CueRelativePosition)) {
-								continue;
-							}
-
-							if (lastCueClusterPosition == pCueTrackPositions->CueClusterPosition) {
-								continue;
-							}
-							lastCueClusterPosition = pCueTrackPositions->CueClusterPosition;
-
-							if (m_bSupportCueDuration) {
-								REFERENCE_TIME cueDuration = s.GetRefTime(pCueTrackPositions->CueDuration);
-								if (cueTime + cueDuration > m_Seek_rt) {
-									pCluster->SeekTo(m_pSegment->m_start + pCueTrackPositions->CueClusterPosition);
-									if (FAILED(pCluster->Parse())) {
-										continue;
-									}
-
-									QWORD pos = pCluster->GetPos();
+			pos1 = TrackNumbers.GetHeadPosition();
+			while (pCluster && pos1) {
+				UINT64 TrackNumber = TrackNumbers.GetNext(pos1);
 
-									Cluster c;
-									c.ParseTimeCode(pCluster);
+				QWORD lastCueClusterPosition = ULONGLONG_MAX;
 
-									pCluster->SeekTo(pos + pCueTrackPositions->CueRelativePosition);
-									CAutoPtr<CMatroskaNode> pBlock(DNew CMatroskaNode(pCluster));
+				for (INT_PTR i = s.FindCue(TrackNumber, m_Seek_rt); i >= 0 && s.CueIndex[i].CueTrack == TrackNumber; i--) {
+					const CueIndexItem& cue = s.CueIndex[i];
 
-									if (!pBlock) {
-										continue;
-									}
-
-									CBlockGroupNode bgn;
-									if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
-										bgn.Parse(pBlock, true);
-									} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
-										CAutoPtr<BlockGroup> bg(DNew BlockGroup());
-										bg->Block.Parse(pBlock, true);
-										if (!(bg->Block.Lacing & 0x80)) {
-											bg->ReferenceBlock.Set(0);    // not a kf
-										}
-										bgn.AddTail(bg);
-									}
-
-									while (bgn.GetCount()) {
-										CAutoPtr<MatroskaPacket> p(DNew MatroskaPacket());
-										p->bg = bgn.RemoveHead();
-
-										if (!TrackNumbers.Find(p->bg->Block.TrackNumber)) {
-											continue;
-										}
-
-										p->bSyncPoint = !p->bg->ReferenceBlock.IsValid();
-										p->TrackNumber = (DWORD)p->bg->Block.TrackNumber;
-
-										TrackEntry* pTE = NULL;
-
-										if (!m_pTrackEntryMap.Lookup(p->TrackNumber, pTE) || !pTE) {
-											continue;
-										}
-
-										p->rtStart = s.GetRefTime((REFERENCE_TIME)c.TimeCode + p->bg->Block.TimeCode);
-										p->rtStop = p->rtStart + (p->bg->BlockDuration.IsValid() ? s.GetRefTime(p->bg->BlockDuration) : 1);
+					if (!cue.CueDuration || !cue.CueRelativePosition) {
+						continue;
+					}
 
-										// Fix subtitle with duration = 0
-										if (!p->bg->BlockDuration.IsValid()) {
-											p->bg->BlockDuration.Set(1); // just setting it to be valid
-											p->rtStop = p->rtStart;
-										}
+					if (lastCueClusterPosition == cue.CueClusterPosition) {
+						continue;
+					}
+					lastCueClusterPosition = cue.CueClusterPosition;
 
-										if (p->rtStart >= m_Seek_rt || p->rtStop < m_Seek_rt) {
-											continue;
-										}
+					REFERENCE_TIME cueTime		= s.GetRefTime(cue.CueTime);
+					REFERENCE_TIME cueDuration	= s.GetRefTime(cue.CueDuration);
+					if (cueTime + cueDuration > m_Seek_rt) {
+						pCluster->SeekTo(m_pSegment->m_start + cue.CueClusterPosition);
+						if (FAILED(pCluster->Parse())) {
+							continue;
+						}
 
+						QWORD pos = pCluster->GetPos();
 
-										POSITION pos = p->bg->Block.BlockData.GetHeadPosition();
-										while (pos) {
-											CBinary* pb = p->bg->Block.BlockData.GetNext(pos);
-											pTE->Expand(*pb, ContentEncoding::AllFrameContents);
-										}
+						Cluster c;
+						c.ParseTimeCode(pCluster);
 
-										// HACK
-										p->rtStart -= m_pFile->m_rtOffset;
-										p->rtStop -= m_pFile->m_rtOffset;
+						pCluster->SeekTo(pos + cue.CueRelativePosition);
+						CAutoPtr<CMatroskaNode> pBlock(DNew CMatroskaNode(pCluster));
 
-										hr = DeliverPacket(p);
-									};
-								}
-							} else if (cueTime < m_Seek_rt - 60 * 10000000i64) {
-								bBreak = TRUE;
-								break;
-							} else { // look no earlier than 1 minute ...
-								pCluster->SeekTo(m_pSegment->m_start + pCueTrackPositions->CueClusterPosition);
-								if (FAILED(pCluster->Parse())) {
-									continue;
-								}
+						if (!pBlock) {
+							continue;
+						}
 
-								Cluster c;
-								c.ParseTimeCode(pCluster);
-
-								CAutoPtrList<CBlockGroupNode> bgnList;
-								if (CAutoPtr<CMatroskaNode> pBlock = pCluster->GetFirstBlock()) {
-									do {
-										CAutoPtr<CBlockGroupNode> bgn(DNew CBlockGroupNode());
-
-										if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
-											bgn->Parse(pBlock, true);
-										} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
-											CAutoPtr<BlockGroup> bg(DNew BlockGroup());
-											bg->Block.Parse(pBlock, true);
-											if (!(bg->Block.Lacing & 0x80)) {
-												bg->ReferenceBlock.Set(0); // not a kf
-											}
-											bgn->AddTail(bg);
-										}
-
-										BOOL bIsValid = FALSE;
-										POSITION pos = bgn->GetHeadPosition();
-										while (pos) {
-											BlockGroup* bg = bgn->GetNext(pos);
-
-											if (!TrackNumbers.Find(bg->Block.TrackNumber)) {
-												continue;
-											}
-
-											if (bg->BlockDuration.IsValid() && (cueTime + s.GetRefTime(bg->BlockDuration) > m_Seek_rt)) {
-												bIsValid = TRUE;
-												break;
-											}
-										}
-
-										if (bIsValid) {
-											bgnList.AddTail(bgn);
-										}
-									} while (pBlock->NextBlock());
-								}
+						CBlockGroupNode bgn;
+						if (pBlock->m_id == MATROSKA_ID_BLOCKGROUP) {
+							bgn.Parse(pBlock, true);
+						} else if (pBlock->m_id == MATROSKA_ID_SIMPLEBLOCK) {
+							CAutoPtr<BlockGroup> bg(DNew BlockGroup());
+							bg->Block.Parse(pBlock, true);
+							if (!(bg->Block.Lacing & 0x80)) {
+								bg->ReferenceBlock.Set(0);    // not a kf
+							}
+							bgn.AddTail(bg);
+						}
 
-								if (bgnList.GetCount()) {
-									while (bgnList.GetCount()) {
-										CAutoPtr<CBlockGroupNode> bgn = bgnList.RemoveHead();
+						while (bgn.GetCount()) {
+							CAutoPtr<MatroskaPacket> p(DNew MatroskaPacket());
+							p->bg = bgn.RemoveHead();
 
-										while (bgn->GetCount() && SUCCEEDED(hr)) {
-											CAutoPtr<MatroskaPacket> p(DNew MatroskaPacket());
-											p->bg = bgn->RemoveHead();
+							if (!TrackNumbers.Find(p->bg->Block.TrackNumber)) {
+								continue;
+							}
 
-											if (!TrackNumbers.Find(p->bg->Block.TrackNumber)) {
-												continue;
-											}
+							p->bSyncPoint = !p->bg->ReferenceBlock.IsValid();
+							p->TrackNumber = (DWORD)p->bg->Block.TrackNumber;
 
-											p->bSyncPoint = !p->bg->ReferenceBlock.IsValid();
-											p->TrackNumber = (DWORD)p->bg->Block.TrackNumber;
+							TrackEntry* pTE = NULL;
 
-											TrackEntry* pTE = NULL;
+							if (!m_pTrackEntryMap.Lookup(p->TrackNumber, pTE) || !pTE) {
+								continue;
+							}
 
-											if (!m_pTrackEntryMap.Lookup(p->TrackNumber, pTE) || !pTE) {
-												continue;
-											}
+							p->rtStart = s.GetRefTime((REFERENCE_TIME)c.TimeCode + p->bg->Block.TimeCode);
+							p->rtStop = p->rtStart + (p->bg->BlockDuration.IsValid() ? s.GetRefTime(p->bg->BlockDuration) : 1);
 
-											p->rtStart = m_pFile->m_segment.GetRefTime((REFERENCE_TIME)c.TimeCode + p->bg->Block.TimeCode);
-											p->rtStop = p->rtStart + (p->bg->BlockDuration.IsValid() ? m_pFile->m_segment.GetRefTime(p->bg->BlockDuration) : 1);
+							// Fix subtitle with duration = 0
+							if (!p->bg->BlockDuration.IsValid()) {
+								p->bg->BlockDuration.Set(1); // just setting it to be valid
+								p->rtStop = p->rtStart;
+							}
 
-											// Fix subtitle with duration = 0
-											if (pTE->TrackType == TrackEntry::TypeSubtitle && !p->bg->BlockDuration.IsValid()) {
-												p->bg->BlockDuration.Set(1); // just setting it to be valid
-												p->rtStop = p->rtStart;
-											}
+							if (p->rtStart >= m_Seek_rt || p->rtStop < m_Seek_rt) {
+								continue;
+							}
 
-											if (p->rtStart >= m_Seek_rt || p->rtStop < m_Seek_rt) {
-												continue;
-											}
 
-											POSITION pos = p->bg->Block.BlockData.GetHeadPosition();
-											while (pos) {
-												CBinary* pb = p->bg->Block.BlockData.GetNext(pos);
-												pTE->Expand(*pb, ContentEncoding::AllFrameContents);
-											}
+							POSITION pos = p->bg->Block.BlockData.GetHeadPosition();
+							while (pos) {
+								CBinary* pb = p->bg->Block.BlockData.GetNext(pos);
+								pTE->Expand(*pb, ContentEncoding::AllFrameContents);
+							}
 
-											// HACK
-											p->rtStart -= m_pFile->m_rtOffset;
-											p->rtStop -= m_pFile->m_rtOffset;
+							// HACK
+							p->rtStart -= m_pFile->m_rtOffset;
+							p->rtStop -= m_pFile->m_rtOffset;
 
-											hr = DeliverPacket(p);
-										}
-									}
-								}
-							}
-						}
+							hr = DeliverPacket(p);
+						};
 					}
 				}
 			}
@@ -1947,26 +1788,9 @@ STDMETHODIMP CMatroskaSplitterFilter::GetKeyFrameCount(UINT& nKFs)
 {
 	CheckPointer(m_pFile, E_UNEXPECTED);
 
-	nKFs				= 0;
+	size_t first		= 0;
 	Segment& s			= m_pFile->m_segment;
-	UINT64 TrackNumber	= s.GetMasterTrack();
-
-	POSITION pos = s.Cues.GetHeadPosition();
-	while (pos) {
-		Cue* pCue = s.Cues.GetNext(pos);
-		if (pCue) {
-			POSITION pos2 = pCue->CuePoints.GetHeadPosition();
-			while (pos2) {
-				CuePoint* pCuePoint = pCue->CuePoints.GetNext(pos2);
-				if (pCuePoint && pCuePoint->CueTrackPositions.GetCount()) {
-					CueTrackPosition* pCueTrackPositions = pCuePoint->CueTrackPositions.GetHead();
-					if (pCueTrackPositions->CueTrack == TrackNumber) {
-						nKFs++;
-					}
-				}
-			}
-		}
-	}
+	nKFs				= (UINT)s.GetCueRange(s.GetMasterTrack(), first);
 
 	return S_OK;
 }
@@ -1983,23 +1807,11 @@ STDMETHODIMP CMatroskaSplitterFilter::GetKeyFrames(const GUID* pFormat, REFERENC
 
 	UINT nKFsTmp		= 0;
 	Segment& s			= m_pFile->m_segment;
-	UINT64 TrackNumber	= s.GetMasterTrack();
+	size_t first		= 0;
+	size_t count		= s.GetCueRange(s.GetMasterTrack(), first);
 
-	POSITION pos = s.Cues.GetHeadPosition();
-	while (pos) {
-		Cue* pCue = s.Cues.GetNext(pos);
-		if (pCue) {
-			POSITION pos2 = pCue->CuePoints.GetHeadPosition();
-			while (pos2) {
-				CuePoint* pCuePoint = pCue->CuePoints.GetNext(pos2);
-				if (pCuePoint && pCuePoint->CueTrackPositions.GetCount()) {
-					CueTrackPosition* pCueTrackPositions = pCuePoint->CueTrackPositions.GetHead();
-					if (pCueTrackPositions->CueTrack == TrackNumber) {
-						pKFs[nKFsTmp++] = s.GetRefTime(pCuePoint->CueTime);
-					}
-				}
-			}
-		}
+	for (size_t i = first; i < first + count && nKFsTmp < nKFs; i++) {
+		pKFs[nKFsTmp++] = s.GetRefTime(s.CueIndex[i].CueTime);
 	}
 
 	nKFs = nKFsTmp;
@@ -2247,7 +2059,8 @@ HRESULT CMatroskaSplitterOutputPin::DeliverBlock(MatroskaPacket* p)
 
 	POSITION pos = p->bg->Block.BlockData.GetHeadPosition();
 	while (pos) {
-		CAutoPtr<Packet> tmp(DNew Packet());
+		// reserve a bit more for the start codes and headers added below
+		CAutoPtr<Packet> tmp(NewPacket(p->bg->Block.BlockData.GetAt(pos)->GetCount() + 8));
 
 		tmp->TrackNumber	= p->TrackNumber;
 		tmp->bDiscontinuity	= p->bDiscontinuity;
@@ -2468,10 +2281,12 @@ STDMETHODIMP CMatroskaSplitterFilter::Apply()
 	if (ERROR_SUCCESS == key.Create(HKEY_CURRENT_USER, OPT_REGKEY_MATROSKASplit)) {
 		key.SetDWORDValue(OPT_LoadEmbeddedFonts, m_bLoadEmbeddedFonts);
 		key.SetDWORDValue(OPT_CalcDuration, m_bCalcDuration);
+		key.SetDWORDValue(OPT_SeekIndexCache, m_bSeekIndexCache);
 	}
 #else
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MATROSKASplit, OPT_LoadEmbeddedFonts, m_bLoadEmbeddedFonts);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MATROSKASplit, OPT_CalcDuration, m_bCalcDuration);
+	AfxGetApp()->WriteProfileInt(OPT_SECTION_MATROSKASplit, OPT_SeekIndexCache, m_bSeekIndexCache);
 #endif
 
 	return S_OK;
@@ -2502,3 +2317,16 @@ STDMETHODIMP_(BOOL) CMatroskaSplitterFilter::GetCalcDuration()
 	CAutoLock cAutoLock(&m_csProps);
 	return m_bCalcDuration;
 }
+
+STDMETHODIMP CMatroskaSplitterFilter::SetSeekIndexCache(BOOL nValue)
+{
+	CAutoLock cAutoLock(&m_csProps);
+	m_bSeekIndexCache = !!nValue;
+	return S_OK;
+}
+
+STDMETHODIMP_(BOOL) CMatroskaSplitterFilter::GetSeekIndexCache()
+{
+	CAutoLock cAutoLock(&m_csProps);
+	return m_bSeekIndexCache;
+}
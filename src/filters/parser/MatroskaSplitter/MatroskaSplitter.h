@@ -94,6 +94,7 @@ class __declspec(uuid("149D2E01-C32E-4939-80F6-C07B81015A7A"))
 private:
 	CCritSec m_csProps;
 	bool m_bLoadEmbeddedFonts, m_bCalcDuration;
+	bool m_bSeekIndexCache;	// off by default in the standalone filter, other hosts don't expect files written on their behalf
 
 protected:
 	CAutoPtr<MatroskaReader::CMatroskaFile> m_pFile;
@@ -146,6 +147,8 @@ public:
 	STDMETHODIMP_(BOOL) GetLoadEmbeddedFonts();
 	STDMETHODIMP SetCalcDuration(BOOL nValue);
 	STDMETHODIMP_(BOOL) GetCalcDuration();
+	STDMETHODIMP SetSeekIndexCache(BOOL nValue);
+	STDMETHODIMP_(BOOL) GetSeekIndexCache();
 };
 
 class __declspec(uuid("0A68C3B5-9164-4a54-AFAF-995B2FF0E0D4"))
@@ -59,10 +59,14 @@ bool CMatroskaSplitterSettingsWnd::OnActivate()
 	p.y += IPP_SCALE(20);
 
 	m_cbCalcDuration.Create(ResStr(IDS_MKVSPLT_CALC_DURATION), dwStyle | BS_AUTOCHECKBOX | BS_LEFTTEXT, CRect(p, CSize(IPP_SCALE(290), m_fontheight)), this, IDC_STATIC);
+	p.y += IPP_SCALE(20);
+
+	m_cbSeekIndexCache.Create(ResStr(IDS_MKVSPLT_SEEK_INDEX_CACHE), dwStyle | BS_AUTOCHECKBOX | BS_LEFTTEXT, CRect(p, CSize(IPP_SCALE(290), m_fontheight)), this, IDC_STATIC);
 
 	if (m_pMSF) {
 		m_cbLoadEmbeddedFonts.SetCheck(m_pMSF->GetLoadEmbeddedFonts());
 		m_cbCalcDuration.SetCheck(m_pMSF->GetCalcDuration());
+		m_cbSeekIndexCache.SetCheck(m_pMSF->GetSeekIndexCache());
 	}
 
 	for (CWnd* pWnd = GetWindow(GW_CHILD); pWnd; pWnd = pWnd->GetNextWindow()) {
@@ -85,6 +89,7 @@ bool CMatroskaSplitterSettingsWnd::OnApply()
 	if (m_pMSF) {
 		m_pMSF->SetLoadEmbeddedFonts(m_cbLoadEmbeddedFonts.GetCheck());
 		m_pMSF->SetCalcDuration(m_cbCalcDuration.GetCheck());
+		m_pMSF->SetSeekIndexCache(m_cbSeekIndexCache.GetCheck());
 		m_pMSF->Apply();
 	}
 
@@ -5,6 +5,7 @@
 #define IDS_FILTER_SETTINGS_CAPTION     7000
 #define IDS_MKVSPLT_LOAD_EMBEDDED_FONTS 7700
 #define IDS_MKVSPLT_CALC_DURATION       7701
+#define IDS_MKVSPLT_SEEK_INDEX_CACHE    7702
 
 // Next default values for new objects
 // 
@@ -43,5 +43,8 @@ public IUnknown {
 	STDMETHOD(SetSubEmptyPin(BOOL nValue)) PURE;
 	STDMETHOD_(BOOL, GetSubEmptyPin()) PURE;
 
+	STDMETHOD(SetSeekIndexCache(BOOL nValue)) PURE;
+	STDMETHOD_(BOOL, GetSeekIndexCache()) PURE;
+
 	STDMETHOD_(int, GetMPEGType()) PURE;
 };
@@ -42,6 +42,7 @@
 #define OPT_AC3CoreOnly       _T("AC3CoreOnly")
 #define OPT_AltDuration       _T("AlternativeDuration")
 #define OPT_SubEmptyOutput    _T("SubtitleEmptyOutput")
+#define OPT_SeekIndexCache    _T("SeekIndexCache")
 
 #ifdef REGISTER_FILTER
 
@@ -483,10 +484,13 @@ CMpegSplitterFilter::CMpegSplitterFilter(LPUNKNOWN pUnk, HRESULT* phr, const CLS
 	, m_rtPlaylistDuration(0)
 	, m_rtMin(0)
 	, m_rtMax(0)
+	, m_bSeekIndexUpdated(false)
+	, m_dwMasterTrack(0)
 	, m_ForcedSub(false)
 	, m_AC3CoreOnly(0)
 	, m_AlternativeDuration(false)
 	, m_SubEmptyPin(false)
+	, m_bSeekIndexCache(false)
 	, bIsStreamingSupport(FALSE)
 {
 #ifdef REGISTER_FILTER
@@ -521,6 +525,10 @@ CMpegSplitterFilter::CMpegSplitterFilter(LPUNKNOWN pUnk, HRESULT* phr, const CLS
 		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_SubEmptyOutput, dw)) {
 			m_SubEmptyPin = !!dw;
 		}
+
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_SeekIndexCache, dw)) {
+			m_bSeekIndexCache = !!dw;
+		}
 	}
 #else
 	m_ForcedSub					= !!AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGSplit, OPT_ForcedSub, m_ForcedSub);
@@ -534,6 +542,7 @@ CMpegSplitterFilter::CMpegSplitterFilter(LPUNKNOWN pUnk, HRESULT* phr, const CLS
 	m_AC3CoreOnly				= AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGSplit, OPT_AC3CoreOnly, m_AC3CoreOnly);
 	m_AlternativeDuration		= !!AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGSplit, OPT_AltDuration, m_AlternativeDuration);
 	m_SubEmptyPin				= !!AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGSplit, OPT_SubEmptyOutput, m_SubEmptyPin);
+	m_bSeekIndexCache			= !!AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGSplit, OPT_SeekIndexCache, TRUE);
 
 	m_nFlag					   |= PACKET_PTS_DISCONTINUITY;
 #endif
@@ -660,6 +669,8 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 				return S_FALSE;
 			}
 		} else if ((b >= 0xbd && b < 0xf0) || (b == 0xfd)) { // pes packet
+			__int64 hdrpos = m_pFile->GetPos() - 4;
+
 			CMpegSplitterFile::peshdr h;
 
 			if (!m_pFile->Read(h, b) || !h.len) {
@@ -676,7 +687,9 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 			DWORD TrackNumber = m_pFile->AddStream(0, b, h.id_ext, h.len);
 
 			if (GetOutputPin(TrackNumber)) {
-				CAutoPtr<Packet> p(DNew Packet());
+				__int64 nBytes = h.len - (m_pFile->GetPos() - pos);
+
+				CAutoPtr<Packet> p(m_PacketPool.Get(nBytes > 0 ? (size_t)nBytes : 0));
 
 				p->TrackNumber	= TrackNumber;
 				p->bSyncPoint	= !!h.fpts;
@@ -684,9 +697,11 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 				p->rtStart		= h.fpts ? (h.pts - rtStartOffset) : INVALID_TIME;
 				p->rtStop		= p->rtStart + 1;
 
-				__int64 nBytes = h.len - (m_pFile->GetPos() - pos);
+				if (h.fpts && TrackNumber == m_dwMasterTrack && m_SeekIndexCache.IsOpen()) {
+					AddSeekPoint(h.pts - m_pFile->m_rtMin, hdrpos);
+				}
+
 				if (nBytes > 0) {
-					p->SetCount((size_t)nBytes);
 					m_pFile->ByteRead(p->GetData(), nBytes);
 
 					hr = DeliverPacket(p);
@@ -696,7 +711,8 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 		}
 	} else if (m_pFile->m_type == MPEG_TYPES::mpeg_ts) {
 		CMpegSplitterFile::trhdr h;
-		if (m_pFile->Read(h) == -1) {
+		__int64 hdrpos = m_pFile->Read(h);
+		if (hdrpos == -1) {
 			return S_FALSE;
 		}
 
@@ -724,7 +740,11 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 				}
 
 				if (h.bytes > (m_pFile->GetPos() - pos)) {
-					CAutoPtr<Packet> p(DNew Packet());
+					__int64 nBytes = h.bytes - (m_pFile->GetPos() - pos);
+
+					// the rest of the PES gets appended to this packet in the output queue, reserve it if the length is known
+					CAutoPtr<Packet> p(m_PacketPool.Get(max((size_t)nBytes, h2.fpts ? (size_t)h2.len : 0)));
+					p->SetCount((size_t)nBytes);
 
 					/*
 					if (h.fPCR) {
@@ -741,18 +761,18 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 					}
 					p->rtStop		= (p->rtStart == INVALID_TIME) ? INVALID_TIME : p->rtStart + 1;
 					p->bSyncPoint	= !!h2.fpts && (p->rtStart != INVALID_TIME);
+
+					if (p->bSyncPoint && TrackNumber == m_dwMasterTrack && m_SeekIndexCache.IsOpen()) {
+						AddSeekPoint(h2.pts - m_pFile->m_rtMin, hdrpos);
+					}
 #if (DEBUG) && 0
 					if (h2.fpts) {
 						TRACE(_T("h.pid = %d, m_rtPTSOffset = [%10I64d], h2.pts = %ws [%10I64d] ==> %ws [%10I64d]\n"), h.pid, rtStartOffset, ReftimeToString(h2.pts), h2.pts, ReftimeToString(p->rtStart), p->rtStart);
 					}
 #endif
-					__int64 nBytes = h.bytes - (m_pFile->GetPos() - pos);
-					if (nBytes > 0) {
-						p->SetCount(nBytes);
-						m_pFile->ByteRead(p->GetData(), nBytes);
+					m_pFile->ByteRead(p->GetData(), nBytes);
 
-						hr = DeliverPacket(p);
-					}
+					hr = DeliverPacket(p);
 				}
 			}
 		}
@@ -769,7 +789,7 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 		__int64 pos = m_pFile->GetPos();
 
 		if (GetOutputPin(TrackNumber)) {
-			CAutoPtr<Packet> p(DNew Packet());
+			CAutoPtr<Packet> p(m_PacketPool.Get(h.length));
 
 			p->TrackNumber	= TrackNumber;
 			p->bSyncPoint	= !!h.fpts;
@@ -777,7 +797,6 @@ HRESULT CMpegSplitterFilter::DemuxNextPacket(REFERENCE_TIME rtStartOffset)
 			p->rtStart		= h.fpts ? (h.pts - rtStartOffset) : INVALID_TIME;
 			p->rtStop		= p->rtStart + 1;
 
-			p->SetCount(h.length);
 			m_pFile->ByteRead(p->GetData(), h.length);
 
 			hr = DeliverPacket(p);
@@ -1165,6 +1184,13 @@ HRESULT CMpegSplitterFilter::CreateOutputs(IAsyncReader* pAsyncReader)
 
 	m_rtNewStop = m_rtStop = m_rtDuration;
 
+	m_SeekIndex.RemoveAll();
+	m_bSeekIndexUpdated = false;
+	if (m_pFile->IsRandomAccess() && m_rtDuration > 0
+			&& m_SeekIndexCache.Open(m_bSeekIndexCache ? CSeekIndexCache::GetDefaultDir() : L"", GetPartFilename(pAsyncReader), FCC('MPEG'), m_pFile->GetLength())) {
+		m_SeekIndexCache.Load(m_SeekIndex);
+	}
+
 	if (bIsStreamingSupport) {
 		m_pFile->StartStreamingDetect();
 	}
@@ -1205,6 +1231,46 @@ bool CMpegSplitterFilter::DemuxInit()
 
 #define SeekPos(t) (__int64)(1.0 * t / m_rtDuration * len)
 
+void CMpegSplitterFilter::AddSeekPoint(REFERENCE_TIME rt, __int64 fp)
+{
+	if (rt < 0 || rt > m_rtDuration || fp < 0) {
+		return;
+	}
+
+	// one point per second is enough, positions must grow with the time (skip PTS discontinuities)
+	int i = range_bsearch(m_SeekIndex, rt);
+	if (i >= 0 && (rt - m_SeekIndex[i].rt < UNITS || fp <= m_SeekIndex[i].fp)) {
+		return;
+	}
+	if (i + 1 < (int)m_SeekIndex.GetCount() && (m_SeekIndex[i + 1].rt - rt < UNITS || fp >= m_SeekIndex[i + 1].fp)) {
+		return;
+	}
+
+	SyncPoint sp = {rt, fp};
+	m_SeekIndex.InsertAt(i + 1, sp);
+	m_bSeekIndexUpdated = true;
+}
+
+__int64 CMpegSplitterFilter::SeekIndexPos(REFERENCE_TIME rt, __int64 len)
+{
+	// interpolate between the nearest known points, fall back to the average bitrate
+	int i = range_bsearch(m_SeekIndex, rt);
+	if (i < 0) {
+		return m_SeekIndex.IsEmpty() ? SeekPos(rt) : min(SeekPos(rt), m_SeekIndex[0].fp);
+	}
+
+	const SyncPoint& sp = m_SeekIndex[i];
+	if (i + 1 < (int)m_SeekIndex.GetCount()) {
+		const SyncPoint& sp2 = m_SeekIndex[i + 1];
+		if (sp2.rt > sp.rt) {
+			return sp.fp + (__int64)(1.0 * (rt - sp.rt) / (sp2.rt - sp.rt) * (sp2.fp - sp.fp));
+		}
+		return sp.fp;
+	}
+
+	return min(sp.fp + SeekPos(rt - sp.rt), len);
+}
+
 void CMpegSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 {
 	CAtlList<CMpegSplitterFile::stream>* pMasterStream = m_pFile->GetMasterStream();
@@ -1244,7 +1310,7 @@ void CMpegSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 		}
 
 		__int64 len				= m_pFile->GetLength();
-		__int64 seekpos			= SeekPos(rt);
+		__int64 seekpos			= SeekIndexPos(rt, len);
 		__int64 minseekpos		= _I64_MIN;
 
 		REFERENCE_TIME rtmax	= rt - UNITS;
@@ -1282,6 +1348,14 @@ void CMpegSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 		}
 
 		if (!m_pFile->m_bIsBadPacked && m_pFile->m_bPESPTSPresent) {
+			// known point inside the search window - no bisection reads
+			int i = range_bsearch(m_SeekIndex, rtmax);
+			if (i >= 0 && m_SeekIndex[i].rt >= rtmin) {
+				m_rtStartOffset = 0;
+				m_pFile->Seek(m_SeekIndex[i].fp);
+				return;
+			}
+
 			POSITION pos = pMasterStream->GetHeadPosition();
 			while (pos) {
 				DWORD TrackNum = pMasterStream->GetNext(pos);
@@ -1302,6 +1376,7 @@ void CMpegSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 							if (rtmin <= rt2 && rt2 <= rtmax) {
 								//minseekpos = curpos;
 								minseekpos = m_pFile->GetPos();
+								AddSeekPoint(rt2, minseekpos);
 								break;
 							}
 
@@ -1329,6 +1404,7 @@ void CMpegSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 							if (rtmin <= rt2 && rt2 <= rtmax) {
 								//minseekpos = curpos;
 								minseekpos = m_pFile->GetPos();
+								AddSeekPoint(rt2, minseekpos);
 								break;
 							}
 
@@ -1347,7 +1423,7 @@ void CMpegSplitterFilter::DemuxSeek(REFERENCE_TIME rt)
 		} else {
 			// simple seek by bitrate
 
-			seekpos	= SeekPos(rt);
+			seekpos	= SeekIndexPos(rt, len);
 			m_pFile->Seek(seekpos);
 
 			if (m_pFile->m_bPESPTSPresent) {
@@ -1373,6 +1449,7 @@ bool CMpegSplitterFilter::DemuxLoop()
 	}
 
 	const CMpegSplitterFile::stream st = pMasterStream->GetHead();
+	m_dwMasterTrack		= st;
 	BOOL bMainIsVideo	= (st.mt.majortype == MEDIATYPE_Video);
 	__int64 AvailBytes	= bMainIsVideo ? 256 * KILOBYTE : 16 * KILOBYTE;
 
@@ -1385,6 +1462,11 @@ bool CMpegSplitterFilter::DemuxLoop()
 		hr = DemuxNextPacket(rtStartOffset);
 	}
 
+	if (m_bSeekIndexUpdated) {
+		m_SeekIndexCache.Save(m_SeekIndex);
+		m_bSeekIndexUpdated = false;
+	}
+
 	return true;
 }
 
@@ -1729,12 +1811,14 @@ STDMETHODIMP CMpegSplitterFilter::Apply()
 		key.SetDWORDValue(OPT_AC3CoreOnly, m_AC3CoreOnly);
 		key.SetDWORDValue(OPT_AltDuration, m_AlternativeDuration);
 		key.SetDWORDValue(OPT_SubEmptyOutput, m_SubEmptyPin);
+		key.SetDWORDValue(OPT_SeekIndexCache, m_bSeekIndexCache);
 	}
 #else
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGSplit, OPT_ForcedSub, m_ForcedSub);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGSplit, OPT_AC3CoreOnly, m_AC3CoreOnly);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGSplit, OPT_AltDuration, m_AlternativeDuration);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGSplit, OPT_SubEmptyOutput, m_SubEmptyPin);
+	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGSplit, OPT_SeekIndexCache, m_bSeekIndexCache);
 #endif
 
 	return S_OK;
@@ -1818,6 +1902,19 @@ STDMETHODIMP_(BOOL) CMpegSplitterFilter::GetSubEmptyPin()
 	return m_SubEmptyPin;
 }
 
+STDMETHODIMP CMpegSplitterFilter::SetSeekIndexCache(BOOL nValue)
+{
+	CAutoLock cAutoLock(&m_csProps);
+	m_bSeekIndexCache = !!nValue;
+	return S_OK;
+}
+
+STDMETHODIMP_(BOOL) CMpegSplitterFilter::GetSeekIndexCache()
+{
+	CAutoLock cAutoLock(&m_csProps);
+	return m_bSeekIndexCache;
+}
+
 STDMETHODIMP_(int) CMpegSplitterFilter::GetMPEGType()
 {
 	CAutoLock cAutoLock(&m_csProps);
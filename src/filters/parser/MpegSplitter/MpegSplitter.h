@@ -64,11 +64,19 @@ class __declspec(uuid("DC257063-045F-4BE2-BD5B-E12279C464F0"))
 	REFERENCE_TIME m_rtPlaylistDuration;
 	REFERENCE_TIME m_rtMin, m_rtMax;
 
+	// PTS -> file position points of the master stream, learned while demuxing and seeking, kept in m_SeekIndexCache
+	CAtlArray<SyncPoint> m_SeekIndex;
+	bool	m_bSeekIndexUpdated;
+	DWORD	m_dwMasterTrack;
+	void	AddSeekPoint(REFERENCE_TIME rt, __int64 fp);
+	__int64	SeekIndexPos(REFERENCE_TIME rt, __int64 len);
+
 	BOOL bIsStreamingSupport;
 
 private:
 	CString m_AudioLanguageOrder, m_SubtitlesLanguageOrder;
 	bool m_ForcedSub, m_AlternativeDuration, m_SubEmptyPin;
+	bool m_bSeekIndexCache;	// off by default in the standalone filter, other hosts don't expect files written on their behalf
 	int m_AC3CoreOnly;
 	CCritSec m_csProps;
 
@@ -124,6 +132,9 @@ public:
 	STDMETHODIMP SetSubEmptyPin(BOOL nValue);
 	STDMETHODIMP_(BOOL) GetSubEmptyPin();
 
+	STDMETHODIMP SetSeekIndexCache(BOOL nValue);
+	STDMETHODIMP_(BOOL) GetSeekIndexCache();
+
 	STDMETHODIMP_(int) GetMPEGType();
 };
 
@@ -65,6 +65,9 @@ bool CMpegSplitterSettingsWnd::OnActivate()
 	p.y += h20;
 
 	m_cbSubEmptyPin.Create(ResStr(IDS_MPEGSPLITTER_SUB_EMPTY_PIN), dwStyle | BS_AUTOCHECKBOX | BS_LEFTTEXT, CRect(p, CSize(IPP_SCALE(305), m_fontheight)), this, IDC_PP_ENABLE_SUB_EMPTY_PIN);
+	p.y += h20;
+
+	m_cbSeekIndexCache.Create(ResStr(IDS_MPEGSPLITTER_SEEK_INDEX_CACHE), dwStyle | BS_AUTOCHECKBOX | BS_LEFTTEXT, CRect(p, CSize(IPP_SCALE(305), m_fontheight)), this, IDC_PP_SEEK_INDEX_CACHE);
 	p.y += h25;
 
 #ifdef REGISTER_FILTER
@@ -95,6 +98,7 @@ bool CMpegSplitterSettingsWnd::OnActivate()
 		m_cbAC3Core.SetCheck(!m_cbTrueHD.GetCheck());
 		m_cbAlternativeDuration.SetCheck(m_pMSF->GetAlternativeDuration());
 		m_cbSubEmptyPin.SetCheck(m_pMSF->GetSubEmptyPin());
+		m_cbSeekIndexCache.SetCheck(m_pMSF->GetSeekIndexCache());
 	}
 
 	for (CWnd* pWnd = GetWindow(GW_CHILD); pWnd; pWnd = pWnd->GetNextWindow()) {
@@ -122,6 +126,7 @@ bool CMpegSplitterSettingsWnd::OnApply()
 		m_pMSF->SetTrueHD(m_cbTrueHD.GetCheck() ? 0 : 1);
 		m_pMSF->SetAlternativeDuration(m_cbAlternativeDuration.GetCheck());
 		m_pMSF->SetSubEmptyPin(m_cbSubEmptyPin.GetCheck());
+		m_pMSF->SetSeekIndexCache(m_cbSeekIndexCache.GetCheck());
 
 #ifdef REGISTER_FILTER
 		CString str;
@@ -42,6 +42,7 @@ private :
 	CButton		m_cbAC3Core;
 
 	CButton		m_cbSubEmptyPin;
+	CButton		m_cbSeekIndexCache;
 
 	enum {
 		IDC_PP_SUBTITLE_FORCED = 10000,
@@ -50,7 +51,8 @@ private :
 		IDC_PP_TRUEHD,
 		IDC_PP_AC3CORE,
 		IDC_PP_ALTERNATIVE_DURATION,
-		IDC_PP_ENABLE_SUB_EMPTY_PIN
+		IDC_PP_ENABLE_SUB_EMPTY_PIN,
+		IDC_PP_SEEK_INDEX_CACHE
 	};
 
 public:
@@ -63,7 +65,7 @@ public:
 	bool OnApply();
 
 	static LPCTSTR GetWindowTitle() { return MAKEINTRESOURCE(IDS_FILTER_SETTINGS_CAPTION); }
-	static CSize GetWindowSize() { return CSize(325, 250); }
+	static CSize GetWindowSize() { return CSize(325, 270); }
 
 	DECLARE_MESSAGE_MAP()
 };
@@ -9,6 +9,7 @@
 #define IDS_MPEGSPLITTER_SUB_ORDER      7205
 #define IDS_MPEGSPLITTER_TRUEHD_OUTPUT  7207
 #define IDS_MPEGSPLITTER_SUB_EMPTY_PIN  7212
+#define IDS_MPEGSPLITTER_SEEK_INDEX_CACHE 7213
 
 // Next default values for new objects
 // 
@@ -0,0 +1,147 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+//
+// CGenlockControl - the control loop of CGenlock without the display and the clock
+//
+// It is fed the sync offset (ms between the scheduled render time and the next vsync) and the frame cycle
+// of every presented frame and decides when the display refresh rate or the reference clock has to move.
+// CGenlock applies the decisions through PowerStrip or ISyncClock. Only plain C++ is used here,
+// so the same loop can be driven by synthetic vsync/frame timing traces outside the renderer, see GenlockSim.cpp.
+//
+
+#define MAX_FIFO_SIZE 1024
+
+namespace GothSync
+{
+	class CGenlockControl
+	{
+	public:
+		class MovingAverage
+		{
+		public:
+			MovingAverage(int size):
+				fifoSize(size),
+				oldestSample(0),
+				sum(0) {
+				if (fifoSize > MAX_FIFO_SIZE) {
+					fifoSize = MAX_FIFO_SIZE;
+				}
+				for (int i = 0; i < MAX_FIFO_SIZE; i++) {
+					fifo[i] = 0;
+				}
+			}
+
+			~MovingAverage() {
+			}
+
+			double Average(double sample) {
+				sum = sum + sample - fifo[oldestSample];
+				fifo[oldestSample] = sample;
+				oldestSample++;
+				if (oldestSample == fifoSize) {
+					oldestSample = 0;
+				}
+				return sum / fifoSize;
+			}
+
+		private:
+			int fifoSize;
+			double fifo[MAX_FIFO_SIZE];
+			int oldestSample;
+			double sum;
+		};
+
+		CGenlockControl(double target, double limit):
+			controlLimit(limit),
+			adjDelta(0),
+			syncOffsetFifo(64),
+			frameCycleFifo(4),
+			syncOffsetAvg(0),
+			frameCycleAvg(0) {
+			SetSyncOffsetLimits(target, limit);
+			ResetMinMax();
+		}
+
+		// Where the scheduled render time should be in relation to the next vsync and how far it may drift from there
+		void SetSyncOffsetLimits(double target, double limit) {
+			targetSyncOffset = target;
+			lowSyncOffset = target - limit;
+			highSyncOffset = target + limit;
+		}
+
+		void ResetMinMax() {
+			minSyncOffset = 1000000.0;
+			maxSyncOffset = -1000000.0;
+			minFrameCycle = 1000000.0;
+			maxFrameCycle = -1000000.0;
+		}
+
+		// Don't adjust anything, just update the syncOffset stats
+		void UpdateStats(double syncOffset, double frameCycle) {
+			syncOffsetAvg = syncOffsetFifo.Average(syncOffset);
+			minSyncOffset = syncOffset < minSyncOffset ? syncOffset : minSyncOffset;
+			maxSyncOffset = syncOffset > maxSyncOffset ? syncOffset : maxSyncOffset;
+			frameCycleAvg = frameCycleFifo.Average(frameCycle);
+			minFrameCycle = frameCycle < minFrameCycle ? frameCycle : minFrameCycle;
+			maxFrameCycle = frameCycle > maxFrameCycle ? frameCycle : maxFrameCycle;
+		}
+
+		// Update the stats and return true if adjDelta has changed. The caller then makes the display faster (1),
+		// slower (-1) or nominal (0), or the reference clock slower, faster or nominal respectively.
+		bool Control(double syncOffset, double frameCycle) {
+			UpdateStats(syncOffset, frameCycle);
+
+			// Adjust as seldom as possible by checking the current controlState before changing it.
+			int delta = adjDelta;
+			if ((syncOffsetAvg > highSyncOffset) && (adjDelta != 1)) {
+				delta = 1;
+			} else if ((syncOffsetAvg < lowSyncOffset) && (adjDelta != -1)) {
+				delta = -1;
+			} else if (((syncOffsetAvg < targetSyncOffset) && (adjDelta == 1))
+					   || ((syncOffsetAvg > targetSyncOffset) && (adjDelta == -1))) {
+				delta = 0; // Cruise.
+			}
+
+			if (delta == adjDelta) {
+				return false;
+			}
+			adjDelta = delta;
+			return true;
+		}
+
+		double controlLimit; // How much the sync offset is allowed to drift from target sync offset
+		int adjDelta; // -1 for display slower in relation to video, 0 for keep, 1 for faster
+
+		MovingAverage syncOffsetFifo;
+		MovingAverage frameCycleFifo;
+		double minSyncOffset, maxSyncOffset;
+		double syncOffsetAvg; // Average of the above
+		double minFrameCycle, maxFrameCycle;
+		double frameCycleAvg;
+
+	protected:
+		double lowSyncOffset; // The closest we want to let the scheduled render time to get to the next vsync. In % of the frame time
+		double targetSyncOffset; // Where we want the scheduled render time to be in relation to the next vsync
+		double highSyncOffset; // The furthers we want to let the scheduled render time to get to the next vsync
+	};
+}
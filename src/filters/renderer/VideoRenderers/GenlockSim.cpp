@@ -0,0 +1,256 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// GenlockSim - headless frame pacing simulator for CGenlockControl, not part of the renderer build
+//
+//   g++ -O2 -o GenlockSim GenlockSim.cpp
+//   GenlockSim           report all traces
+//   GenlockSim --check   also compare them with the limits in the trace table, exits with 1 on a regression
+//   GenlockSim --bench   time Control()
+//
+// Vsyncs and video frames are generated on one time axis and the renderer is reduced to what CBaseAP::Paint()
+// and CGenlock do with them: a frame is painted when the reference clock reaches its sample time, shown at the
+// first vsync after that the display doesn't miss, and the sync offset (ms from the paint to the next vsync)
+// and the frame cycle go into the control loop. Its decisions move the reference clock like ControlClock()
+// or the refresh rate like ControlDisplay() with a line delta of 1.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include "GenlockControl.h"
+
+using namespace GothSync;
+
+#define SIM_SECONDS			600.0
+#define TARGET_SYNC_OFFSET	12.0			// the CRenderersSettings defaults
+#define CONTROL_LIMIT		2.0
+#define CYCLE_DELTA			0.0012
+#define DISPLAY_DELTA		(1.0 / 1125)	// one line of a 1125 line timing
+#define SETTLED_BAND		(2 * CONTROL_LIMIT)	// the loop only acts at the edges of the control band and overshoots a little
+
+enum control_t {
+	ControlNone,	// statistics only, no sync or sync to nearest neighbor
+	ControlClock,	// the reference clock moves
+	ControlDisplay	// the display refresh rate moves
+};
+
+struct trace_t {
+	const char*	name;
+	double		fps;
+	double		refresh;		// Hz
+	double		clockPPM;		// error of the reference clock against the display
+	double		dropVsync;		// probability of a missed vsync
+	control_t	control;
+
+	// limits for --check
+	int			maxDrops;
+	int			maxRepeats;
+	double		maxConvergence;	// s, < 0 when the sync offset isn't expected to settle
+	double		maxJudder;		// ms
+};
+
+struct result_t {
+	int		frames;
+	int		drops;			// vsyncs the frames lost against the pulldown cadence
+	int		repeats;		// vsyncs the frames stayed on screen beyond it
+	int		adjustments;	// changes of adjDelta
+	double	judder;			// ms, rms deviation of the time on screen from the frame duration
+	double	convergence;	// s until the sync offset average stays within SETTLED_BAND of the target, < 0 if it never does
+};
+
+static const trace_t s_traces[] = {
+	// name										fps				refresh			ppm		missed	control			drops	repeats	conv	judder
+	{"25/50, no sync",							25.0,			50.0,			0,		0,		ControlNone,	0,		0,		-1,		0.1},
+	{"25/50, clock +300 ppm, no sync",			25.0,			50.0,			300,	0,		ControlNone,	12,		2,		-1,		1.0},
+	{"25/50, clock +300 ppm, clock",			25.0,			50.0,			300,	0,		ControlClock,	0,		0,		10,		0.1},
+	{"25/50, clock -800 ppm, clock",			25.0,			50.0,			-800,	0,		ControlClock,	0,		0,		10,		0.1},
+	{"25/50, clock +300 ppm, display",			25.0,			50.0,			300,	0,		ControlDisplay,	0,		0,		12,		0.1},
+	{"25/50, 0.5% missed vsyncs, clock",		25.0,			50.0,			0,		0.005,	ControlClock,	90,		90,		10,		2.5},
+	{"23.976/60, no sync",						24000 / 1001.,	60.0,			0,		0,		ControlNone,	0,		40,		-1,		9.0},
+	{"23.976/60, clock",						24000 / 1001.,	60.0,			0,		0,		ControlClock,	0,		0,		10,		9.0},
+	{"23.976/59.94, clock -150 ppm, clock",		24000 / 1001.,	60000 / 1001.,	-150,	0,		ControlClock,	45,		0,		-1,		9.0},
+	{"23.976/59.94, clock -150 ppm, display",	24000 / 1001.,	60000 / 1001.,	-150,	0,		ControlDisplay,	35,		0,		-1,		9.0},
+};
+
+static result_t Simulate(const trace_t& tr)
+{
+	CGenlockControl genlock(TARGET_SYNC_OFFSET, CONTROL_LIMIT);
+
+	const double frameTime	= 1000.0 / tr.fps;			// ms of stream time
+	const double vsyncTime	= 1000.0 / tr.refresh;		// ms
+	const double clockRate	= 1.0 + tr.clockPPM * 1e-6;	// stream ms per ms at the nominal clock speed
+	const double frameReal	= frameTime / clockRate;	// time a frame should stay on screen
+	const double cadence	= floor(2.0 * tr.refresh / tr.fps + 0.5) / 2.0;	// vsyncs per frame, 2 for 25/50, 2.5 for 3:2
+
+	// reference clock, stream time = sBase + (t - tBase) * rate, the first frame comes 3 ms after a vsync
+	double tBase = 3.0, sBase = 0.0, rate = clockRate;
+
+	double vsync = 0.0, period = vsyncTime;
+	int vsyncIndex = 0;
+	bool bVsyncMissed = false;
+	unsigned rnd = 1;
+
+	std::vector<int> shown;
+	std::vector<double> shownTime;
+	double lastUnsettled = 0.0;
+
+	result_t r;
+	memset(&r, 0, sizeof(r));
+
+	for (int i = 0; ; i++) {
+		const double t = tBase + (i * frameTime - sBase) / rate;
+		if (t > SIM_SECONDS * 1000.0) {
+			break;
+		}
+
+		// the renderer measures the offset to the next vsync from the scanline, it can't see a missed one
+		while (vsync <= t) {
+			vsync += period;
+			vsyncIndex++;
+			rnd = rnd * 1103515245u + 12345u;
+			bVsyncMissed = ((rnd >> 8) & 0xffffff) < tr.dropVsync * 0x1000000;
+		}
+		const double syncOffset = vsync - t;
+		while (bVsyncMissed) {
+			vsync += period;
+			vsyncIndex++;
+			rnd = rnd * 1103515245u + 12345u;
+			bVsyncMissed = ((rnd >> 8) & 0xffffff) < tr.dropVsync * 0x1000000;
+		}
+		shown.push_back(vsyncIndex);
+		shownTime.push_back(vsync);
+
+		bool bChanged = false;
+		if (tr.control == ControlNone) {
+			genlock.UpdateStats(syncOffset, frameTime);
+		} else {
+			bChanged = genlock.Control(syncOffset, frameTime);
+		}
+
+		if (bChanged) {
+			r.adjustments++;
+			const double delta = genlock.adjDelta;
+			if (tr.control == ControlClock) {
+				// faster (1) makes the clock slower and the frames later
+				sBase += (t - tBase) * rate;
+				tBase = t;
+				rate = clockRate * (1.0 - delta * CYCLE_DELTA);
+			} else {
+				// faster (1) makes the display faster and the vsyncs earlier, from the next one on
+				period = vsyncTime * (1.0 - delta * DISPLAY_DELTA);
+			}
+		}
+
+		// the fifo starts filled with zeroes, don't judge it before it has seen real samples
+		if (i < 64 || fabs(genlock.syncOffsetAvg - TARGET_SYNC_OFFSET) > SETTLED_BAND) {
+			lastUnsettled = t;
+		}
+	}
+
+	r.frames = (int)shown.size();
+
+	// a whole vsync ahead of or behind the cadence is a repeat or a drop, 3:3 in a 3:2 pattern is one repeat
+	double sum = 0.0, acc = 0.0;
+	for (size_t i = 0; i + 1 < shown.size(); i++) {
+		acc += (shown[i + 1] - shown[i]) - cadence;
+		for (; acc >= 1.0 - 1e-9; acc -= 1.0) {
+			r.repeats++;
+		}
+		for (; acc <= -1.0 + 1e-9; acc += 1.0) {
+			r.drops++;
+		}
+		const double d = (shownTime[i + 1] - shownTime[i]) - frameReal;
+		sum += d * d;
+	}
+	r.judder = shown.size() > 1 ? sqrt(sum / (shown.size() - 1)) : 0.0;
+
+	// settled means staying there for the last minute at least
+	r.convergence = lastUnsettled < (SIM_SECONDS - 60.0) * 1000.0 ? lastUnsettled / 1000.0 : -1.0;
+
+	return r;
+}
+
+static void Bench()
+{
+	CGenlockControl genlock(TARGET_SYNC_OFFSET, CONTROL_LIMIT);
+
+	const int n = 10000000;
+	int changes = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < n; i++) {
+		changes += genlock.Control(TARGET_SYNC_OFFSET + 6.0 * sin(i * 0.001), 40.0);
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+	printf("Control(): %.1f ns per frame (%d adjustments)\n", ns, changes);
+}
+
+int main(int argc, char* argv[])
+{
+	bool bCheck = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--check")) {
+			bCheck = true;
+		} else if (!strcmp(argv[i], "--bench")) {
+			Bench();
+			return 0;
+		} else {
+			fprintf(stderr, "usage: %s [--check | --bench]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	int failed = 0;
+
+	printf("%-42s %7s %6s %7s %6s %9s %10s\n", "trace", "frames", "drops", "repeats", "adjust", "judder ms", "converge s");
+	for (size_t i = 0; i < sizeof(s_traces) / sizeof(s_traces[0]); i++) {
+		const trace_t& tr = s_traces[i];
+		const result_t r = Simulate(tr);
+
+		char conv[16];
+		if (r.convergence < 0) {
+			strcpy(conv, "never");
+		} else {
+			sprintf(conv, "%.1f", r.convergence);
+		}
+		printf("%-42s %7d %6d %7d %6d %9.2f %10s\n", tr.name, r.frames, r.drops, r.repeats, r.adjustments, r.judder, conv);
+
+		if (bCheck) {
+			if (r.drops > tr.maxDrops
+					|| r.repeats > tr.maxRepeats
+					|| r.judder > tr.maxJudder
+					|| (tr.maxConvergence >= 0 && (r.convergence < 0 || r.convergence > tr.maxConvergence))) {
+				printf("  FAILED: drops <= %d, repeats <= %d, judder <= %.2f ms, convergence <= %.0f s expected\n",
+					   tr.maxDrops, tr.maxRepeats, tr.maxJudder, tr.maxConvergence);
+				failed++;
+			}
+		}
+	}
+
+	if (bCheck) {
+		printf(failed ? "%d trace(s) FAILED\n" : "all traces passed\n", failed);
+	}
+
+	return failed ? 1 : 0;
+}
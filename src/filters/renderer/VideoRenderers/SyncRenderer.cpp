@@ -4121,16 +4121,12 @@ STDMETHODIMP CSyncRenderer::NonDelegatingQueryInterface(REFIID riid, void** ppv)
 }
 
 CGenlock::CGenlock(DOUBLE target, DOUBLE limit, INT lineD, INT colD, DOUBLE clockD, UINT mon):
-	targetSyncOffset(target), // Target sync offset, typically around 10 ms
-	controlLimit(limit), // How much sync offset is allowed to drift from target sync offset before control kicks in
+	CGenlockControl(target, limit), // Target sync offset, typically around 10 ms, and how much sync offset is allowed to drift from it before control kicks in
 	lineDelta(lineD), // Number of rows used in display frequency adjustment, typically 1 (one)
 	columnDelta(colD),  // Number of columns used in display frequency adjustment, typically 1 - 2
 	cycleDelta(clockD),  // Delta used in clock speed adjustment. In fractions of 1.0. Typically around 0.001
 	monitor(mon) // The monitor to be adjusted if the display refresh rate is the controlled parameter
 {
-	lowSyncOffset = targetSyncOffset - controlLimit;
-	highSyncOffset = targetSyncOffset + controlLimit;
-	adjDelta = 0;
 	displayAdjustmentsMade = 0;
 	clockAdjustmentsMade = 0;
 	displayFreqCruise = 0;
@@ -4140,21 +4136,11 @@ CGenlock::CGenlock(DOUBLE target, DOUBLE limit, INT lineD, INT colD, DOUBLE cloc
 	psWnd = NULL;
 	liveSource = FALSE;
 	powerstripTimingExists = FALSE;
-	syncOffsetFifo = DNew MovingAverage(64);
-	frameCycleFifo = DNew MovingAverage(4);
 }
 
 CGenlock::~CGenlock()
 {
 	ResetTiming();
-	if (syncOffsetFifo != NULL) {
-		delete syncOffsetFifo;
-		syncOffsetFifo = NULL;
-	}
-	if (frameCycleFifo != NULL) {
-		delete frameCycleFifo;
-		frameCycleFifo = NULL;
-	}
 	syncClock = NULL;
 };
 
@@ -4257,13 +4243,18 @@ HRESULT CGenlock::GetTiming()
 	return S_OK;
 }
 
+// Send one of the timing strings made by GetTiming() to PowerStrip.
+HRESULT CGenlock::SetTiming(LPCTSTR timing)
+{
+	ATOM setTiming = GlobalAddAtom(timing);
+	SendMessage(psWnd, UM_SETCUSTOMTIMINGFAST, monitor, setTiming);
+	GlobalDeleteAtom(setTiming);
+	return S_OK;
+}
+
 // Reset display timing parameters to nominal.
 HRESULT CGenlock::ResetTiming()
 {
-	LPARAM lParam = NULL;
-	WPARAM wParam = monitor;
-	ATOM setTiming;
-	LRESULT ret;
 	CAutoLock lock(&csGenlockLock);
 
 	if (!PowerstripRunning()) {
@@ -4271,10 +4262,7 @@ HRESULT CGenlock::ResetTiming()
 	}
 
 	if (displayAdjustmentsMade > 0) {
-		setTiming = GlobalAddAtom(cruise);
-		lParam = setTiming;
-		ret = SendMessage(psWnd, UM_SETCUSTOMTIMINGFAST, wParam, lParam);
-		GlobalDeleteAtom(setTiming);
+		SetTiming(cruise);
 		curDisplayFreq = displayFreqCruise;
 	}
 	adjDelta = 0;
@@ -4294,9 +4282,7 @@ HRESULT CGenlock::ResetClock()
 
 HRESULT CGenlock::SetTargetSyncOffset(DOUBLE targetD)
 {
-	targetSyncOffset = targetD;
-	lowSyncOffset = targetD - controlLimit;
-	highSyncOffset = targetD + controlLimit;
+	SetSyncOffsetLimits(targetD, controlLimit);
 	return S_OK;
 }
 
@@ -4349,10 +4335,7 @@ HRESULT CGenlock::SetMonitor(UINT mon)
 HRESULT CGenlock::ResetStats()
 {
 	CAutoLock lock(&csGenlockLock);
-	minSyncOffset = 1000000.0;
-	maxSyncOffset = -1000000.0;
-	minFrameCycle = 1000000.0;
-	maxFrameCycle = -1000000.0;
+	ResetMinMax();
 	displayAdjustmentsMade = 0;
 	clockAdjustmentsMade = 0;
 	return S_OK;
@@ -4361,65 +4344,30 @@ HRESULT CGenlock::ResetStats()
 // Synchronize by adjusting display refresh rate
 HRESULT CGenlock::ControlDisplay(double syncOffset, double frameCycle)
 {
-	LPARAM lParam = NULL;
-	WPARAM wParam = monitor;
-	ATOM setTiming;
-
 	CRenderersSettings& s = GetRenderersSettings();
-	targetSyncOffset = s.m_AdvRendSets.fTargetSyncOffset;
-	lowSyncOffset = targetSyncOffset - s.m_AdvRendSets.fControlLimit;
-	highSyncOffset = targetSyncOffset + s.m_AdvRendSets.fControlLimit;
-
-	syncOffsetAvg = syncOffsetFifo->Average(syncOffset);
-	minSyncOffset = min(minSyncOffset, syncOffset);
-	maxSyncOffset = max(maxSyncOffset, syncOffset);
-	frameCycleAvg = frameCycleFifo->Average(frameCycle);
-	minFrameCycle = min(minFrameCycle, frameCycle);
-	maxFrameCycle = max(maxFrameCycle, frameCycle);
+	SetSyncOffsetLimits(s.m_AdvRendSets.fTargetSyncOffset, s.m_AdvRendSets.fControlLimit);
 
 	if (!PowerstripRunning() || !powerstripTimingExists) {
+		CGenlockControl::UpdateStats(syncOffset, frameCycle);
 		return E_FAIL;
 	}
-	// Adjust as seldom as possible by checking the current controlState before changing it.
-	if ((syncOffsetAvg > highSyncOffset) && (adjDelta != 1))
-		// Speed up display refresh rate by subtracting pixels from the image.
-	{
-		adjDelta = 1; // Increase refresh rate
-		curDisplayFreq = displayFreqFaster;
-		setTiming = GlobalAddAtom(faster);
-		lParam = setTiming;
-		SendMessage(psWnd, UM_SETCUSTOMTIMINGFAST, wParam, lParam);
-		GlobalDeleteAtom(setTiming);
-		displayAdjustmentsMade++;
-	} else
-		// Slow down display refresh rate by adding pixels to the image.
-		if ((syncOffsetAvg < lowSyncOffset) && (adjDelta != -1)) {
-			adjDelta = -1;
+
+	if (Control(syncOffset, frameCycle)) {
+		if (adjDelta == 1) {
+			// Speed up display refresh rate by subtracting pixels from the image.
+			curDisplayFreq = displayFreqFaster;
+			SetTiming(faster);
+		} else if (adjDelta == -1) {
+			// Slow down display refresh rate by adding pixels to the image.
 			curDisplayFreq = displayFreqSlower;
-			setTiming = GlobalAddAtom(slower);
-			lParam = setTiming;
-			SendMessage(psWnd, UM_SETCUSTOMTIMINGFAST, wParam, lParam);
-			GlobalDeleteAtom(setTiming);
-			displayAdjustmentsMade++;
-		} else
+			SetTiming(slower);
+		} else {
 			// Cruise.
-			if ((syncOffsetAvg < targetSyncOffset) && (adjDelta == 1)) {
-				adjDelta = 0;
-				curDisplayFreq = displayFreqCruise;
-				setTiming = GlobalAddAtom(cruise);
-				lParam = setTiming;
-				SendMessage(psWnd, UM_SETCUSTOMTIMINGFAST, wParam, lParam);
-				GlobalDeleteAtom(setTiming);
-				displayAdjustmentsMade++;
-			} else if ((syncOffsetAvg > targetSyncOffset) && (adjDelta == -1)) {
-				adjDelta = 0;
-				curDisplayFreq = displayFreqCruise;
-				setTiming = GlobalAddAtom(cruise);
-				lParam = setTiming;
-				SendMessage(psWnd, UM_SETCUSTOMTIMINGFAST, wParam, lParam);
-				GlobalDeleteAtom(setTiming);
-				displayAdjustmentsMade++;
-			}
+			curDisplayFreq = displayFreqCruise;
+			SetTiming(cruise);
+		}
+		displayAdjustmentsMade++;
+	}
 	return S_OK;
 }
 
@@ -4428,55 +4376,32 @@ HRESULT CGenlock::ControlDisplay(double syncOffset, double frameCycle)
 HRESULT CGenlock::ControlClock(double syncOffset, double frameCycle)
 {
 	CRenderersSettings& s = GetRenderersSettings();
-	targetSyncOffset = s.m_AdvRendSets.fTargetSyncOffset;
-	lowSyncOffset = targetSyncOffset - s.m_AdvRendSets.fControlLimit;
-	highSyncOffset = targetSyncOffset + s.m_AdvRendSets.fControlLimit;
-
-	syncOffsetAvg = syncOffsetFifo->Average(syncOffset);
-	minSyncOffset = min(minSyncOffset, syncOffset);
-	maxSyncOffset = max(maxSyncOffset, syncOffset);
-	frameCycleAvg = frameCycleFifo->Average(frameCycle);
-	minFrameCycle = min(minFrameCycle, frameCycle);
-	maxFrameCycle = max(maxFrameCycle, frameCycle);
+	SetSyncOffsetLimits(s.m_AdvRendSets.fTargetSyncOffset, s.m_AdvRendSets.fControlLimit);
 
 	if (!syncClock) {
+		CGenlockControl::UpdateStats(syncOffset, frameCycle);
 		return E_FAIL;
 	}
-	// Adjust as seldom as possible by checking the current controlState before changing it.
-	if ((syncOffsetAvg > highSyncOffset) && (adjDelta != 1))
-		// Slow down video stream.
-	{
-		adjDelta = 1;
-		syncClock->AdjustClock(1.0 - cycleDelta); // Makes the clock move slower by providing smaller increments
-		clockAdjustmentsMade++;
-	} else
-		// Speed up video stream.
-		if ((syncOffsetAvg < lowSyncOffset) && (adjDelta != -1)) {
-			adjDelta = -1;
+
+	if (Control(syncOffset, frameCycle)) {
+		if (adjDelta == 1) {
+			// Slow down video stream.
+			syncClock->AdjustClock(1.0 - cycleDelta); // Makes the clock move slower by providing smaller increments
+		} else if (adjDelta == -1) {
+			// Speed up video stream.
 			syncClock->AdjustClock(1.0 + cycleDelta);
-			clockAdjustmentsMade++;
-		} else
+		} else {
 			// Cruise.
-			if ((syncOffsetAvg < targetSyncOffset) && (adjDelta == 1)) {
-				adjDelta = 0;
-				syncClock->AdjustClock(1.0);
-				clockAdjustmentsMade++;
-			} else if ((syncOffsetAvg > targetSyncOffset) && (adjDelta == -1)) {
-				adjDelta = 0;
-				syncClock->AdjustClock(1.0);
-				clockAdjustmentsMade++;
-			}
+			syncClock->AdjustClock(1.0);
+		}
+		clockAdjustmentsMade++;
+	}
 	return S_OK;
 }
 
 // Don't adjust anything, just update the syncOffset stats
 HRESULT CGenlock::UpdateStats(double syncOffset, double frameCycle)
 {
-	syncOffsetAvg = syncOffsetFifo->Average(syncOffset);
-	minSyncOffset = min(minSyncOffset, syncOffset);
-	maxSyncOffset = max(maxSyncOffset, syncOffset);
-	frameCycleAvg = frameCycleFifo->Average(frameCycle);
-	minFrameCycle = min(minFrameCycle, frameCycle);
-	maxFrameCycle = max(maxFrameCycle, frameCycle);
+	CGenlockControl::UpdateStats(syncOffset, frameCycle);
 	return S_OK;
 }
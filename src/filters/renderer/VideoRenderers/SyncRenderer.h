@@ -24,6 +24,7 @@
 #include "RenderersSettings.h"
 #include "SyncAllocatorPresenter.h"
 #include "AllocatorCommon.h"
+#include "GenlockControl.h"
 #include <dxva2api.h>
 
 #define VMRBITMAP_UPDATE 0x80000000
@@ -65,8 +66,6 @@ extern bool g_bExternalSubtitleTime;
 #define PIXELCLOCK 8
 #define UNKNOWN 9
 
-#define MAX_FIFO_SIZE 1024
-
 // Guid to tag IMFSample with DirectX surface index
 static const GUID GUID_SURFACE_INDEX = { 0x30c8e9f6, 0x415, 0x4b81, { 0xa3, 0x15, 0x1, 0xa, 0xc6, 0xa9, 0xda, 0x19 } };
 
@@ -578,44 +577,9 @@ namespace GothSync
 		virtual HRESULT STDMETHODCALLTYPE NonDelegatingQueryInterface(REFIID riid, void** ppvObject);
 	};
 
-	class CGenlock
+	class CGenlock : public CGenlockControl
 	{
 	public:
-		class MovingAverage
-		{
-		public:
-			MovingAverage(INT size):
-				fifoSize(size),
-				oldestSample(0),
-				sum(0) {
-				if (fifoSize > MAX_FIFO_SIZE) {
-					fifoSize = MAX_FIFO_SIZE;
-				}
-				for (INT i = 0; i < MAX_FIFO_SIZE; i++) {
-					fifo[i] = 0;
-				}
-			}
-
-			~MovingAverage() {
-			}
-
-			double Average(double sample) {
-				sum = sum + sample - fifo[oldestSample];
-				fifo[oldestSample] = sample;
-				oldestSample++;
-				if (oldestSample == fifoSize) {
-					oldestSample = 0;
-				}
-				return sum / fifoSize;
-			}
-
-		private:
-			INT fifoSize;
-			double fifo[MAX_FIFO_SIZE];
-			INT oldestSample;
-			double sum;
-		};
-
 		CGenlock(DOUBLE target, DOUBLE limit, INT rowD, INT colD, DOUBLE clockD, UINT mon);
 		~CGenlock();
 
@@ -638,7 +602,6 @@ namespace GothSync
 
 		BOOL powerstripTimingExists; // TRUE if display timing has been got through Powerstrip
 		BOOL liveSource; // TRUE if live source -> display sync is the only option
-		INT adjDelta; // -1 for display slower in relation to video, 0 for keep, 1 for faster
 		INT lineDelta; // The number of rows added or subtracted when adjusting display fps
 		INT columnDelta; // The number of colums added or subtracted when adjusting display fps
 		DOUBLE cycleDelta; // Adjustment factor for cycle time as fraction of nominal value
@@ -647,19 +610,12 @@ namespace GothSync
 
 		UINT totalLines, totalColumns; // Including the porches and sync widths
 		UINT visibleLines, visibleColumns; // The nominal resolution
-		MovingAverage *syncOffsetFifo;
-		MovingAverage *frameCycleFifo;
-		DOUBLE minSyncOffset, maxSyncOffset;
-		DOUBLE syncOffsetAvg; // Average of the above
-		DOUBLE minFrameCycle, maxFrameCycle;
-		DOUBLE frameCycleAvg;
 
 		UINT pixelClock; // In pixels/s
 		DOUBLE displayFreqCruise;  // Nominal display frequency in frames/s
 		DOUBLE displayFreqSlower;
 		DOUBLE displayFreqFaster;
 		DOUBLE curDisplayFreq; // Current (adjusted) display frequency
-		DOUBLE controlLimit; // How much the sync offset is allowed to drift from target sync offset
 		WPARAM monitor; // The monitor to be controlled. 0-based.
 		CComPtr<ISyncClock> syncClock; // Interface to an adjustable reference clock
 
@@ -673,9 +629,8 @@ namespace GothSync
 		TCHAR cruise[MAX_LOADSTRING]; // String corresponding to nominal display frequency
 		TCHAR slower[MAX_LOADSTRING]; // String corresponding to slower display frequency
 		TCHAR savedTiming[MAX_LOADSTRING]; // String version of saved timing (to be restored upon exit)
-		DOUBLE lowSyncOffset; // The closest we want to let the scheduled render time to get to the next vsync. In % of the frame time
-		DOUBLE targetSyncOffset; // Where we want the scheduled render time to be in relation to the next vsync
-		DOUBLE highSyncOffset; // The furthers we want to let the scheduled render time to get to the next vsync
 		CCritSec csGenlockLock;
+
+		HRESULT SetTiming(LPCTSTR timing); // Send timing parameters to PowerStrip
 	};
 }
@@ -111,6 +111,29 @@ static DWORD GetChannelLayout(const WAVEFORMATEX* wfe)
 	return channel_layout;
 }
 
+#define AUDIO_BLOCK 1024 // frames, a multiple of the 512 frames that CAudioNormalizer::MSteadyHQ32() processes at once
+
+static void Gain(const SampleFormat sfmt, const double factor, const size_t allsamples, BYTE* pData)
+{
+	switch (sfmt) {
+	case SAMPLE_FMT_U8:
+		gain_uint8(factor, allsamples, (uint8_t*)pData);
+		break;
+	case SAMPLE_FMT_S16:
+		gain_int16(factor, allsamples, (int16_t*)pData);
+		break;
+	case SAMPLE_FMT_S24:
+		gain_int24(factor, allsamples, pData);
+		break;
+	case SAMPLE_FMT_S32:
+		gain_int32(factor, allsamples, (int32_t*)pData);
+		break;
+	case SAMPLE_FMT_FLT:
+		gain_float(factor, allsamples, (float*)pData);
+		break;
+	}
+}
+
 //
 // CAudioSwitcherFilter
 //
@@ -274,47 +297,52 @@ HRESULT CAudioSwitcherFilter::Transform(IMediaSample* pIn, IMediaSample* pOut)
 		data			= out;
 		in_channels		= out_wfe->nChannels;
 		in_allsamples	= in_samples * in_channels;
-	} else if (in_sampleformat == SAMPLE_FMT_FLT) {
-		memcpy(pDataOut, data, in_allsamples * sizeof(float));
-		data = pDataOut;
 	}
 
-	// Auto volume control
-	if (m_bAutoVolumeControl) {
-		if (data == pDataIn) {
-			UpdateBufferSize(in_allsamples);
-			convert_to_float(in_sampleformat, in_channels, in_samples, data, m_buffer);
-			data = (BYTE*)m_buffer;
-		}
-		in_samples		= m_AudioNormalizer.MSteadyHQ32((float*)data, in_samples, in_channels);
-		in_allsamples	= in_samples * in_channels;
-	}
+	const bool bGain = !m_bAutoVolumeControl && m_fGainFactor != 1.0f;
 
-	// Copy or convert to output
-	if (data == pDataIn) {
+	if (data == pDataIn && !m_bAutoVolumeControl && !bGain) {
 		memcpy(pDataOut, data, in_allsamples * in_bytespersample);
-	} else if (data == (BYTE*)m_buffer) {
-		convert_float_to(in_sampleformat, in_channels, in_samples, m_buffer, pDataOut);
-	}
+	} else {
+		// Auto volume control, conversion to the output format and gain, one block at a time.
+		// The block is still in the cache for the next step, the sample data is read and written once.
+		if (data == pDataIn && m_bAutoVolumeControl && in_sampleformat != SAMPLE_FMT_FLT) {
+			UpdateBufferSize(AUDIO_BLOCK * in_channels);
+		}
 
-	// Gain
-	if (!m_bAutoVolumeControl && m_fGainFactor != 1.0f) {
-		switch (in_sampleformat) {
-		case SAMPLE_FMT_U8:
-			gain_uint8(m_fGainFactor, in_allsamples, (uint8_t*)pDataOut);
-			break;
-		case SAMPLE_FMT_S16:
-			gain_int16(m_fGainFactor, in_allsamples, (int16_t*)pDataOut);
-			break;
-		case SAMPLE_FMT_S24:
-			gain_int24(m_fGainFactor, in_allsamples, pDataOut);
-			break;
-		case SAMPLE_FMT_S32:
-			gain_int32(m_fGainFactor, in_allsamples, (int32_t*)pDataOut);
-			break;
-		case SAMPLE_FMT_FLT:
-			gain_float(m_fGainFactor, in_allsamples, (float*)pDataOut);
-			break;
+		for (unsigned pos = 0; pos < in_samples; pos += AUDIO_BLOCK) {
+			const unsigned block_samples	= min(in_samples - pos, (unsigned)AUDIO_BLOCK);
+			const size_t block_allsamples	= block_samples * in_channels;
+			BYTE* dst = pDataOut + pos * in_channels * in_bytespersample;
+
+			float* fdata = NULL; // the block in float, if the chain goes through float
+			if (data == pDataIn) {
+				BYTE* src = pDataIn + pos * in_channels * in_bytespersample;
+				if (!m_bAutoVolumeControl || in_sampleformat == SAMPLE_FMT_FLT) {
+					memcpy(dst, src, block_allsamples * in_bytespersample);
+					if (m_bAutoVolumeControl) {
+						fdata = (float*)dst;
+					}
+				} else {
+					convert_to_float(in_sampleformat, in_channels, block_samples, src, m_buffer);
+					fdata = m_buffer;
+				}
+			} else {
+				// mixer output, m_buffer or already in place in pDataOut
+				fdata = (float*)data + pos * in_channels;
+			}
+
+			if (m_bAutoVolumeControl) {
+				m_AudioNormalizer.MSteadyHQ32(fdata, block_samples, in_channels);
+			}
+
+			if (fdata && (BYTE*)fdata != dst) {
+				convert_float_to(in_sampleformat, in_channels, block_samples, fdata, dst);
+			}
+
+			if (bGain) {
+				Gain(in_sampleformat, m_fGainFactor, block_allsamples, dst);
+			}
 		}
 	}
 
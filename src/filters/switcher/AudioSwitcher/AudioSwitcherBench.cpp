@@ -0,0 +1,262 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// AudioSwitcherBench - throughput of the CAudioSwitcherFilter::Transform() chain after the mixer, not part of the build
+//
+//   build it as a console program from this file and AudioNormalizer.cpp, with the AudioTools and DSUtil libraries
+//
+//   AudioSwitcherBench [seconds]   audio per case, default 10
+//
+// Runs the auto volume control, the conversion back to the output format and the gain twice. The first
+// run is the earlier Transform(), with one pass over the whole sample per step. The second is the current
+// one, with all steps on one block of AUDIO_BLOCK frames at a time. Both have to give the same output,
+// exits with 1 when they don't.
+//
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "AudioNormalizer.h"
+#include "../../../AudioTools/AudioHelper.h"
+#include "../../../DSUtil/AudioTools.h"
+
+#define AUDIO_BLOCK		1024	// as in AudioSwitcher.cpp
+#define SAMPLE_FRAMES	4800	// 100 ms at 48 kHz per media sample
+
+static void Gain(const SampleFormat sfmt, const double factor, const size_t allsamples, BYTE* pData)
+{
+	switch (sfmt) {
+	case SAMPLE_FMT_S16:
+		gain_int16(factor, allsamples, (int16_t*)pData);
+		break;
+	case SAMPLE_FMT_S24:
+		gain_int24(factor, allsamples, pData);
+		break;
+	case SAMPLE_FMT_S32:
+		gain_int32(factor, allsamples, (int32_t*)pData);
+		break;
+	case SAMPLE_FMT_FLT:
+		gain_float(factor, allsamples, (float*)pData);
+		break;
+	}
+}
+
+struct chain_t {
+	SampleFormat		sfmt;
+	unsigned			channels;
+	unsigned			bytespersample;
+	bool				bAutoVolumeControl;
+	float				fGainFactor;
+	CAudioNormalizer	normalizer;
+	std::vector<float>	buffer;
+
+	chain_t(SampleFormat sfmt, unsigned channels, bool bAutoVolumeControl, float fGainFactor)
+		: sfmt(sfmt)
+		, channels(channels)
+		, bytespersample(get_bytes_per_sample(sfmt))
+		, bAutoVolumeControl(bAutoVolumeControl)
+		, fGainFactor(fGainFactor) {
+		normalizer.SetParam(75, true, 8);
+	}
+};
+
+// a pass per step over the whole sample
+static void ProcessPasses(chain_t& c, BYTE* pDataIn, BYTE* pDataOut, unsigned samples)
+{
+	const unsigned allsamples = samples * c.channels;
+	BYTE* data = pDataIn;
+
+	if (c.sfmt == SAMPLE_FMT_FLT) {
+		memcpy(pDataOut, data, allsamples * sizeof(float));
+		data = pDataOut;
+	}
+
+	if (c.bAutoVolumeControl) {
+		if (data == pDataIn) {
+			c.buffer.resize(allsamples);
+			convert_to_float(c.sfmt, c.channels, samples, data, &c.buffer[0]);
+			data = (BYTE*)&c.buffer[0];
+		}
+		c.normalizer.MSteadyHQ32((float*)data, samples, c.channels);
+	}
+
+	if (data == pDataIn) {
+		memcpy(pDataOut, data, allsamples * c.bytespersample);
+	} else if (data != pDataOut) {
+		convert_float_to(c.sfmt, c.channels, samples, (float*)data, pDataOut);
+	}
+
+	if (!c.bAutoVolumeControl && c.fGainFactor != 1.0f) {
+		Gain(c.sfmt, c.fGainFactor, allsamples, pDataOut);
+	}
+}
+
+// all steps on one block, like Transform() does without the mixer
+static void ProcessBlocks(chain_t& c, BYTE* pDataIn, BYTE* pDataOut, unsigned samples)
+{
+	const bool bGain = !c.bAutoVolumeControl && c.fGainFactor != 1.0f;
+
+	if (!c.bAutoVolumeControl && !bGain) {
+		memcpy(pDataOut, pDataIn, samples * c.channels * c.bytespersample);
+		return;
+	}
+
+	if (c.bAutoVolumeControl && c.sfmt != SAMPLE_FMT_FLT) {
+		c.buffer.resize(AUDIO_BLOCK * c.channels);
+	}
+
+	for (unsigned pos = 0; pos < samples; pos += AUDIO_BLOCK) {
+		const unsigned block_samples	= min(samples - pos, (unsigned)AUDIO_BLOCK);
+		const size_t block_allsamples	= block_samples * c.channels;
+		BYTE* src = pDataIn + pos * c.channels * c.bytespersample;
+		BYTE* dst = pDataOut + pos * c.channels * c.bytespersample;
+
+		float* fdata = NULL;
+		if (!c.bAutoVolumeControl || c.sfmt == SAMPLE_FMT_FLT) {
+			memcpy(dst, src, block_allsamples * c.bytespersample);
+			if (c.bAutoVolumeControl) {
+				fdata = (float*)dst;
+			}
+		} else {
+			convert_to_float(c.sfmt, c.channels, block_samples, src, &c.buffer[0]);
+			fdata = &c.buffer[0];
+		}
+
+		if (c.bAutoVolumeControl) {
+			c.normalizer.MSteadyHQ32(fdata, block_samples, c.channels);
+		}
+
+		if (fdata && (BYTE*)fdata != dst) {
+			convert_float_to(c.sfmt, c.channels, block_samples, fdata, dst);
+		}
+
+		if (bGain) {
+			Gain(c.sfmt, c.fGainFactor, block_allsamples, dst);
+		}
+	}
+}
+
+static double Now()
+{
+	LARGE_INTEGER freq, t;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart / freq.QuadPart;
+}
+
+// a quiet and a loud tone with some noise, so the volume control has something to do
+static void FillSamples(SampleFormat sfmt, unsigned channels, unsigned frame0, unsigned frames, BYTE* p)
+{
+	static unsigned rnd = 1;
+	for (unsigned i = 0; i < frames; i++) {
+		unsigned t = frame0 + i;
+		double level = (t / 48000) & 1 ? 0.9 : 0.05;
+		for (unsigned ch = 0; ch < channels; ch++) {
+			rnd = rnd * 1103515245u + 12345u;
+			double noise = ((rnd >> 8) & 0xffff) / 65536.0 - 0.5;
+			float f = (float)(level * sin(t * (0.03 + ch * 0.01)) + 0.01 * noise);
+			size_t n = (size_t)i * channels + ch;
+			switch (sfmt) {
+				case SAMPLE_FMT_S16:
+					((int16_t*)p)[n] = SAMPLE_float_to_int16(f);
+					break;
+				case SAMPLE_FMT_S24: {
+						int32_t s = SAMPLE_float_to_int32(f);
+						p[n * 3 + 0] = (BYTE)(s >> 8);
+						p[n * 3 + 1] = (BYTE)(s >> 16);
+						p[n * 3 + 2] = (BYTE)(s >> 24);
+					}
+					break;
+				case SAMPLE_FMT_S32:
+					((int32_t*)p)[n] = SAMPLE_float_to_int32(f);
+					break;
+				case SAMPLE_FMT_FLT:
+					((float*)p)[n] = f;
+					break;
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const double seconds = argc > 1 ? atof(argv[1]) : 10.0;
+	const unsigned nSamples = (unsigned)(seconds * 48000 / SAMPLE_FRAMES);
+
+	static const struct {
+		SampleFormat	sfmt;
+		const char*		name;
+	} formats[] = {
+		{SAMPLE_FMT_S16,	"s16"},
+		{SAMPLE_FMT_S24,	"s24"},
+		{SAMPLE_FMT_S32,	"s32"},
+		{SAMPLE_FMT_FLT,	"flt"},
+	};
+	static const unsigned channels[] = {2, 6, 8};
+	static const struct {
+		bool		bAutoVolumeControl;
+		float		fGainFactor;
+		const char*	name;
+	} modes[] = {
+		{false,	1.5f,	"gain"},
+		{true,	1.0f,	"volume control"},
+	};
+
+	int failed = 0;
+
+	printf("%-4s %3s %-16s %14s %14s %8s\n", "fmt", "ch", "", "passes Ms/s", "blocks Ms/s", "speedup");
+	for (size_t f = 0; f < _countof(formats); f++) {
+		for (size_t ch = 0; ch < _countof(channels); ch++) {
+			for (size_t m = 0; m < _countof(modes); m++) {
+				chain_t passes(formats[f].sfmt, channels[ch], modes[m].bAutoVolumeControl, modes[m].fGainFactor);
+				chain_t blocks(formats[f].sfmt, channels[ch], modes[m].bAutoVolumeControl, modes[m].fGainFactor);
+
+				const size_t bytes = (size_t)SAMPLE_FRAMES * channels[ch] * passes.bytespersample;
+				std::vector<BYTE> in(bytes * nSamples), out1(bytes), out2(bytes);
+				FillSamples(formats[f].sfmt, channels[ch], 0, SAMPLE_FRAMES * nSamples, &in[0]);
+
+				double t[2] = {0, 0};
+				bool bSame = true;
+				for (unsigned i = 0; i < nSamples; i++) {
+					double start = Now();
+					ProcessPasses(passes, &in[i * bytes], &out1[0], SAMPLE_FRAMES);
+					double mid = Now();
+					ProcessBlocks(blocks, &in[i * bytes], &out2[0], SAMPLE_FRAMES);
+					t[0] += mid - start;
+					t[1] += Now() - mid;
+
+					if (out1 != out2) {
+						bSame = false;
+					}
+				}
+
+				const double allsamples = (double)SAMPLE_FRAMES * channels[ch] * nSamples;
+				printf("%-4s %3u %-16s %14.1f %14.1f %7.2fx%s\n", formats[f].name, channels[ch], modes[m].name,
+					   allsamples / t[0] / 1e6, allsamples / t[1] / 1e6, t[0] / t[1], bSame ? "" : "  FAILED: output differs");
+				failed += !bSame;
+			}
+		}
+	}
+
+	return failed ? 1 : 0;
+}
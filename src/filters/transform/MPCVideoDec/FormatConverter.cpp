@@ -22,6 +22,7 @@
 #include "stdafx.h"
 #include "FormatConverter.h"
 #include "CpuId.h"
+#include "../../../DSUtil/DSUtil.h"
 #include <moreuuids.h>
 
 #pragma warning(push)
@@ -175,9 +176,16 @@ CFormatConverter::CFormatConverter()
 	, m_pAlignedBuffer(NULL)
 	, m_nCPUFlag(0)
 	, m_RequiredAlignment(0)
+	, m_nThreads(-1)
+	, m_bExitThreads(false)
+	, m_bSliceFn(false)
 {
 	ASSERT(PixFmt_count == _countof(s_sw_formats));
 
+	memset(m_Threads, 0, sizeof(m_Threads));
+	memset(m_hEvDone, 0, sizeof(m_hEvDone));
+	memset(&m_Job, 0, sizeof(m_Job));
+
 	m_FProps.avpixfmt	= AV_PIX_FMT_NONE;
 	m_FProps.width		= 0;
 	m_FProps.height		= 0;
@@ -194,9 +202,117 @@ CFormatConverter::CFormatConverter()
 
 CFormatConverter::~CFormatConverter()
 {
+	StopThreads();
 	Cleanup();
 }
 
+void CFormatConverter::StartThreads()
+{
+	CCpuId cpuId;
+	const int nThreads = min(cpuId.GetProcessorNumber(), CONV_MAX_THREADS) - 1;
+
+	m_bExitThreads = false;
+
+	for (m_nThreads = 0; m_nThreads < nThreads; m_nThreads++) {
+		conv_thread_t& thread = m_Threads[m_nThreads];
+		thread.pConverter	= this;
+		thread.slice		= m_nThreads + 1;
+		thread.hEvStart		= CreateEvent(NULL, FALSE, FALSE, NULL);
+		m_hEvDone[m_nThreads] = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+		thread.hThread = (thread.hEvStart && m_hEvDone[m_nThreads]) ? ::CreateThread(NULL, 0, SliceThreadProc, &thread, 0, NULL) : NULL;
+		if (!thread.hThread) {
+			if (thread.hEvStart) {
+				CloseHandle(thread.hEvStart);
+			}
+			if (m_hEvDone[m_nThreads]) {
+				CloseHandle(m_hEvDone[m_nThreads]);
+			}
+			memset(&thread, 0, sizeof(thread));
+			m_hEvDone[m_nThreads] = NULL;
+			break;
+		}
+	}
+
+	DbgLog((LOG_TRACE, 3, L"CFormatConverter::StartThreads() : %d slice threads", m_nThreads));
+}
+
+void CFormatConverter::StopThreads()
+{
+	if (m_nThreads > 0) {
+		m_bExitThreads = true;
+		for (int i = 0; i < m_nThreads; i++) {
+			SetEvent(m_Threads[i].hEvStart);
+		}
+		for (int i = 0; i < m_nThreads; i++) {
+			WaitForSingleObject(m_Threads[i].hThread, INFINITE);
+			CloseHandle(m_Threads[i].hThread);
+			CloseHandle(m_Threads[i].hEvStart);
+			CloseHandle(m_hEvDone[i]);
+		}
+		memset(m_Threads, 0, sizeof(m_Threads));
+		memset(m_hEvDone, 0, sizeof(m_hEvDone));
+	}
+
+	m_nThreads = -1;
+}
+
+DWORD WINAPI CFormatConverter::SliceThreadProc(LPVOID lpParam)
+{
+	conv_thread_t* pThread = (conv_thread_t*)lpParam;
+	CFormatConverter* pConverter = pThread->pConverter;
+
+	SetThreadName((DWORD)-1, "CFormatConverter");
+
+	for (;;) {
+		WaitForSingleObject(pThread->hEvStart, INFINITE);
+		if (pConverter->m_bExitThreads) {
+			break;
+		}
+
+		pConverter->ConvertSlice(pThread->slice);
+		SetEvent(pConverter->m_hEvDone[pThread->slice - 1]);
+	}
+
+	return 0;
+}
+
+void CFormatConverter::ConvertSlice(int slice)
+{
+	const SW_OUT_FMT& swof = s_sw_formats[m_out_pixfmt];
+	const int planes = max(swof.planes, 1);
+
+	const int y				= slice * m_Job.sliceHeight;
+	const int height		= min(m_Job.sliceHeight, m_FProps.height - y);
+	const int chromaShift	= (m_FProps.pftype == PFType_YUV420 || m_FProps.pftype == PFType_YUV420Px) ? 1 : 0;
+
+	const uint8_t*	src[4]	= {NULL};
+	uint8_t*		out[4]	= {NULL};
+	for (int i = 0; i < 4; i++) {
+		if (m_Job.src[i]) {
+			src[i] = m_Job.src[i] + ((i == 1 || i == 2) ? y >> chromaShift : y) * m_Job.srcStride[i];
+		}
+	}
+	for (int i = 0; i < planes; i++) {
+		out[i] = m_Job.out[i] + (y / swof.planeHeight[i]) * m_Job.outStride[i];
+	}
+
+	(this->*pConvertFn)(src, m_Job.srcStride, out, m_FProps.width, height, m_Job.outStride);
+
+	if (m_Job.out[0] != m_Job.dst[0]) {
+		// copy the slice out of the aligned buffer on its own thread. The converters write with streaming stores
+		// (PIXCONV_PUT_STREAM), so this reads it back from memory, but the copies of all slices run in parallel
+		const size_t widthBytes = m_FProps.width * swof.codedbytes;
+		for (int i = 0; i < planes; i++) {
+			const size_t planeWidth	= widthBytes / swof.planeWidth[i];
+			const int lastLine		= (y + height) / swof.planeHeight[i];
+			for (int line = y / swof.planeHeight[i]; line < lastLine; ++line) {
+				memcpy(m_Job.dst[i] + line * m_Job.dstStride[i], m_Job.out[i] + line * m_Job.outStride[i], planeWidth);
+			}
+		}
+	}
+}
+
 bool CFormatConverter::Init()
 {
 	Cleanup();
@@ -321,6 +437,9 @@ void CFormatConverter::SetConvertFunc()
 			break;
 		}
 	}
+
+	// yuv420 -> yuy2 interpolates the chroma across the lines and sws_scale wants the whole frame
+	m_bSliceFn = pConvertFn != &CFormatConverter::ConvertGeneric && pConvertFn != &CFormatConverter::convert_yuv420_yuy2;
 }
 
 void CFormatConverter::UpdateOutput(MPCPixelFormat out_pixfmt, int dstStride, int planeHeight)
@@ -425,51 +544,46 @@ int CFormatConverter::Converting(BYTE* dst, AVFrame* pFrame)
 		out = m_pAlignedBuffer;
 	}
 
-	uint8_t*	dstArray[4]			= {NULL};
-	ptrdiff_t	dstStrideArray[4]	= {0};
-	ptrdiff_t	byteStride			= outStride * swof.codedbytes;
-
-	dstArray[0] = out;
-	dstStrideArray[0] = byteStride;
-	for (int i = 1; i < swof.planes; ++i) {
-		dstArray[i] = dstArray[i - 1] + dstStrideArray[i - 1] * (m_planeHeight / swof.planeHeight[i-1]);
-		dstStrideArray[i] = byteStride / swof.planeWidth[i];
+	const int planes = max(swof.planes, 1);
+	const ptrdiff_t byteStride		= outStride * swof.codedbytes;
+	const ptrdiff_t dstByteStride	= m_dstStride * swof.codedbytes;
+
+	memset(&m_Job, 0, sizeof(m_Job));
+
+	m_Job.out[0]		= out;
+	m_Job.outStride[0]	= byteStride;
+	m_Job.dst[0]		= dst;
+	m_Job.dstStride[0]	= dstByteStride;
+	for (int i = 1; i < planes; ++i) {
+		m_Job.out[i]		= m_Job.out[i - 1] + m_Job.outStride[i - 1] * (m_planeHeight / swof.planeHeight[i-1]);
+		m_Job.outStride[i]	= byteStride / swof.planeWidth[i];
+		m_Job.dst[i]		= m_Job.dst[i - 1] + m_Job.dstStride[i - 1] * (m_planeHeight / swof.planeHeight[i-1]);
+		m_Job.dstStride[i]	= dstByteStride / swof.planeWidth[i];
 	}
 
-	ptrdiff_t srcStride[4];
 	for (int i = 0; i < 4; i++) {
-		srcStride[i] = pFrame->linesize[i];
+		m_Job.src[i]		= pFrame->data[i];
+		m_Job.srcStride[i]	= pFrame->linesize[i];
 	}
 
-	(this->*pConvertFn)(pFrame->data, srcStride, dstArray, m_FProps.width, m_FProps.height, dstStrideArray);
+	int slices = 1;
+	if (m_bSliceFn && m_FProps.height >= 2 * CONV_MIN_SLICE) {
+		if (m_nThreads < 0) {
+			StartThreads();
+		}
+		slices = min(m_nThreads + 1, m_FProps.height / CONV_MIN_SLICE);
+	}
+	m_Job.sliceHeight = FFALIGN((m_FProps.height + slices - 1) / slices, 16);
+	slices = (m_FProps.height + m_Job.sliceHeight - 1) / m_Job.sliceHeight;
 
-	if (out != dst) {
-		int line = 0;
+	for (int i = 1; i < slices; i++) {
+		SetEvent(m_Threads[i - 1].hEvStart);
+	}
 
-		// Copy first plane
-		const size_t widthBytes			= m_FProps.width * swof.codedbytes;
-		const ptrdiff_t srcStrideBytes	= outStride * swof.codedbytes;
-		const ptrdiff_t dstStrideBytes	= m_dstStride * swof.codedbytes;
-		for (line = 0; line < m_FProps.height; ++line) {
-			memcpy(dst, out, widthBytes);
-			out += srcStrideBytes;
-			dst += dstStrideBytes;
-		}
-		dst += (m_planeHeight - m_FProps.height) * dstStrideBytes;
-
-		for (int plane = 1; plane < swof.planes; ++plane) {
-			const size_t planeWidth			= widthBytes      / swof.planeWidth[plane];
-			const int activePlaneHeight		= m_FProps.height / swof.planeHeight[plane];
-			const int totalPlaneHeight		= m_planeHeight   / swof.planeHeight[plane];
-			const ptrdiff_t srcPlaneStride	= srcStrideBytes  / swof.planeWidth[plane];
-			const ptrdiff_t dstPlaneStride	= dstStrideBytes  / swof.planeWidth[plane];
-			for (line = 0; line < activePlaneHeight; ++line) {
-				memcpy(dst, out, planeWidth);
-				out += srcPlaneStride;
-				dst += dstPlaneStride;
-			}
-			dst+= (totalPlaneHeight - activePlaneHeight) * dstPlaneStride;
-		}
+	ConvertSlice(0);
+
+	if (slices > 1) {
+		WaitForMultipleObjects(slices - 1, m_hEvDone, TRUE, INFINITE);
 	}
 
 	return 0;
@@ -90,6 +90,9 @@ typedef struct {
 	enum AVColorRange	colorrange;
 } FrameProps;
 
+#define CONV_MAX_THREADS	8	// slices per frame, including the calling thread
+#define CONV_MIN_SLICE		128	// lines
+
 class CFormatConverter
 {
 #define CONV_FUNC_PARAMS const uint8_t* const src[4], const ptrdiff_t srcStride[4], uint8_t* dst[], int width, int height, const ptrdiff_t dstStride[]
@@ -115,6 +118,35 @@ protected:
 
 	unsigned			m_RequiredAlignment;
 
+	// slice threads, the frame is cut into horizontal bands of a multiple of 16 lines
+	// (keeps the 4:2:0 chroma lines and the 8x8 dither pattern in step) and the calling thread converts the first one
+	struct conv_thread_t {
+		CFormatConverter*	pConverter;
+		HANDLE				hThread;
+		HANDLE				hEvStart;
+		int					slice;
+	};
+	conv_thread_t		m_Threads[CONV_MAX_THREADS - 1];
+	HANDLE				m_hEvDone[CONV_MAX_THREADS - 1];
+	int					m_nThreads;			// -1 until the first sliced frame
+	bool				m_bExitThreads;
+	bool				m_bSliceFn;			// pConvertFn can run on a part of the frame
+
+	struct {
+		const uint8_t*	src[4];
+		ptrdiff_t		srcStride[4];
+		uint8_t*		out[4];			// converter output, points into m_pAlignedBuffer when dst does not fit
+		ptrdiff_t		outStride[4];
+		uint8_t*		dst[4];
+		ptrdiff_t		dstStride[4];
+		int				sliceHeight;
+	} m_Job;
+
+	void StartThreads();
+	void StopThreads();
+	void ConvertSlice(int slice);
+	static DWORD WINAPI SliceThreadProc(LPVOID lpParam);
+
 	bool Init();
 	void UpdateDetails();
 
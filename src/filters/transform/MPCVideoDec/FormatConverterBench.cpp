@@ -0,0 +1,197 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// FormatConverterBench - speed of CFormatConverter per conversion on synthetic frames, not part of the filter build
+//
+//   build it as a console program from this file, FormatConverter.cpp, pixconv_functions.cpp and CpuId.cpp
+//   with the ffmpeg and DSUtil libraries
+//
+//   FormatConverterBench [frames]   frames per case, default 200
+//
+// Every case converts the same 1920x1080 noise frames on the calling thread only and with the slice threads,
+// into an aligned destination and into one that is neither aligned nor has an aligned stride, so the
+// converter goes through its aligned buffer. All four outputs have to be identical, exits with 1 when
+// they aren't.
+//
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <vector>
+#include "FormatConverter.h"
+
+#pragma warning(push)
+#pragma warning(disable: 4005)
+extern "C" {
+	#include <ffmpeg/libavutil/frame.h>
+	#include <ffmpeg/libavutil/pixdesc.h>
+}
+#pragma warning(pop)
+
+#define FRAME_WIDTH		1920
+#define FRAME_HEIGHT	1080
+#define FRAME_COUNT		4		// different frames, converted in turn
+
+class CFormatConverterBench : public CFormatConverter
+{
+public:
+	CFormatConverterBench(bool bThreads) {
+		if (!bThreads) {
+			m_nThreads = 0; // Converting() starts the threads only while it is -1
+		}
+		SetOptions(2, 2, 0);
+	}
+
+	LPCTSTR GetConvertFnName() {
+		return pConvertFn == &CFormatConverter::ConvertGeneric ? _T("sws_scale") : _T("sse2");
+	}
+};
+
+static const struct {
+	AVPixelFormat	srcfmt;
+	MPCPixelFormat	dstfmt;
+} s_cases[] = {
+	{AV_PIX_FMT_YUV420P,		PixFmt_NV12},
+	{AV_PIX_FMT_YUV420P,		PixFmt_YUY2},
+	{AV_PIX_FMT_YUV444P,		PixFmt_YV24},
+	{AV_PIX_FMT_YUV420P10LE,	PixFmt_NV12},
+	{AV_PIX_FMT_YUV420P10LE,	PixFmt_YV12},
+	{AV_PIX_FMT_YUV420P10LE,	PixFmt_YUY2},
+	{AV_PIX_FMT_YUV420P10LE,	PixFmt_P010},
+	{AV_PIX_FMT_YUV420P10LE,	PixFmt_P016},
+	{AV_PIX_FMT_YUV422P10LE,	PixFmt_YUY2},
+	{AV_PIX_FMT_YUV422P10LE,	PixFmt_YV16},
+	{AV_PIX_FMT_YUV422P10LE,	PixFmt_P210},
+	{AV_PIX_FMT_YUV444P10LE,	PixFmt_YV24},
+	{AV_PIX_FMT_YUV444P10LE,	PixFmt_AYUV},
+	{AV_PIX_FMT_YUV444P10LE,	PixFmt_Y410},
+	{AV_PIX_FMT_YUV420P16LE,	PixFmt_P016},
+	{AV_PIX_FMT_YUV420P,		PixFmt_RGB32},
+};
+
+static AVFrame* CreateFrame(AVPixelFormat fmt, unsigned seed)
+{
+	AVFrame* pFrame = av_frame_alloc();
+	pFrame->format		= fmt;
+	pFrame->width		= FRAME_WIDTH;
+	pFrame->height		= FRAME_HEIGHT;
+	pFrame->colorspace	= AVCOL_SPC_BT709;
+	pFrame->color_range	= AVCOL_RANGE_MPEG;
+	av_frame_get_buffer(pFrame, 32);
+
+	const AVPixFmtDescriptor* pfdesc = av_pix_fmt_desc_get(fmt);
+	const int bits = pfdesc->comp->depth_minus1 + 1;
+
+	// noise over a gradient, every value of the bit depth appears
+	unsigned rnd = seed;
+	for (int p = 0; p < 4 && pFrame->data[p]; p++) {
+		const int w = p ? -((-FRAME_WIDTH) >> pfdesc->log2_chroma_w) : FRAME_WIDTH;
+		const int h = p ? -((-FRAME_HEIGHT) >> pfdesc->log2_chroma_h) : FRAME_HEIGHT;
+		for (int y = 0; y < h; y++) {
+			BYTE* line = pFrame->data[p] + y * pFrame->linesize[p];
+			for (int x = 0; x < w; x++) {
+				rnd = rnd * 1103515245u + 12345u;
+				const unsigned v = (((x + y) << (bits - 8)) + (rnd >> 16)) & ((1 << bits) - 1);
+				if (bits > 8) {
+					((uint16_t*)line)[x] = (uint16_t)v;
+				} else {
+					line[x] = (BYTE)v;
+				}
+			}
+		}
+	}
+
+	return pFrame;
+}
+
+int main(int argc, char* argv[])
+{
+	const int nFrames = argc > 1 ? atoi(argv[1]) : 200;
+
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+
+	int failed = 0;
+
+	printf("%-14s %-6s %-9s %12s %12s %12s %8s\n", "source", "output", "converter", "1 thread fps", "sliced fps", "unaligned", "speedup");
+	for (size_t c = 0; c < _countof(s_cases); c++) {
+		const SW_OUT_FMT* swof = GetSWOF(s_cases[c].dstfmt);
+
+		AVFrame* frames[FRAME_COUNT];
+		for (int i = 0; i < FRAME_COUNT; i++) {
+			frames[i] = CreateFrame(s_cases[c].srcfmt, i + 1);
+		}
+
+		// run 0 and 1 into an aligned buffer, 2 and 3 into one at an odd offset with an odd stride
+		static const int strides[2] = {FRAME_WIDTH, FRAME_WIDTH + 3};
+		std::vector<BYTE> outputs[4];
+		double fps[4];
+		LPCTSTR name = NULL;
+
+		for (int run = 0; run < 4; run++) {
+			const bool bThreads		= (run & 1) != 0;
+			const int stride		= strides[run >> 1];
+			const size_t size		= ((size_t)stride * FRAME_HEIGHT * swof->bpp) >> 3;
+
+			BYTE* buffer = (BYTE*)_aligned_malloc(size + 32, 32);
+			BYTE* dst = buffer + (run >> 1) * 3;
+
+			CFormatConverterBench conv(bThreads);
+			conv.UpdateOutput(s_cases[c].dstfmt, stride, FRAME_HEIGHT);
+			conv.Converting(dst, frames[0]); // init and thread start are not timed
+			name = conv.GetConvertFnName();
+
+			LARGE_INTEGER start, stop;
+			QueryPerformanceCounter(&start);
+			for (int i = 0; i < nFrames; i++) {
+				conv.Converting(dst, frames[i % FRAME_COUNT]);
+			}
+			QueryPerformanceCounter(&stop);
+			fps[run] = nFrames * (double)freq.QuadPart / (stop.QuadPart - start.QuadPart);
+
+			// compare the picture without the stride padding
+			conv.Converting(dst, frames[0]);
+			const size_t widthBytes = (size_t)FRAME_WIDTH * swof->codedbytes;
+			BYTE* plane = dst;
+			for (int p = 0; p < max(swof->planes, 1); p++) {
+				const size_t planeStride = (size_t)stride * swof->codedbytes / swof->planeWidth[p];
+				const int planeLines = FRAME_HEIGHT / swof->planeHeight[p];
+				for (int y = 0; y < planeLines; y++) {
+					outputs[run].insert(outputs[run].end(), plane + y * planeStride, plane + y * planeStride + widthBytes / swof->planeWidth[p]);
+				}
+				plane += planeStride * planeLines;
+			}
+
+			_aligned_free(buffer);
+		}
+
+		const bool bSame = outputs[0] == outputs[1] && outputs[0] == outputs[2] && outputs[0] == outputs[3];
+		printf("%-14s %-6S %-9S %12.1f %12.1f %12.1f %7.2fx%s\n",
+			   av_get_pix_fmt_name(s_cases[c].srcfmt), swof->name, name, fps[0], fps[1], fps[3], fps[1] / fps[0],
+			   bSame ? "" : "  FAILED: outputs differ");
+		failed += !bSame;
+
+		for (int i = 0; i < FRAME_COUNT; i++) {
+			av_frame_free(&frames[i]);
+		}
+	}
+
+	return failed ? 1 : 0;
+}
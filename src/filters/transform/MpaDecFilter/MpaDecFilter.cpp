@@ -584,10 +584,9 @@ HRESULT CMpaDecFilter::Receive(IMediaSample* pIn)
 		m_bResync = false;
 	}
 
-	size_t bufflen = m_buff.GetCount();
-	m_buff.SetCount(bufflen + len, 4096);
-	memcpy(m_buff.GetData() + bufflen, pDataIn, len);
-	len += (long)bufflen;
+	if (!m_buff.Append(pDataIn, len)) {
+		return E_OUTOFMEMORY;
+	}
 
 	if (m_bBitstreamSupported[SPDIF]) {
 		if (GetSPDIF(ac3) && (subtype == MEDIASUBTYPE_DOLBY_AC3 || subtype == MEDIASUBTYPE_WAVE_DOLBY_AC3 || subtype == MEDIASUBTYPE_DNET)) {
@@ -716,8 +715,7 @@ HRESULT CMpaDecFilter::ProcessLPCM()
 		break;
 	}
 
-	memmove(base, p, end - p);
-	m_buff.SetCount(end - p);
+	m_buff.Consume(p - base);
 
 	return Deliver(outBuff.GetData(), outSize, out_sf, wfein->nSamplesPerSec, wfein->nChannels, GetDefChannelMask(wfein->nChannels));
 }
@@ -776,8 +774,7 @@ HRESULT CMpaDecFilter::ProcessHdmvLPCM(bool bAlignOldBuffer) // Blu ray LPCM
 		}
 		break;
 	}
-	memmove(m_buff.GetData(), pDataIn, m_buff.GetCount() - len );
-	m_buff.SetCount(m_buff.GetCount() - len);
+	m_buff.Consume(len);
 
 	return Deliver(outBuff.GetData(), outSize, out_sf, wfein->nSamplesPerSec, wfein->nChannels, remap->dwChannelMask);
 }
@@ -856,8 +853,7 @@ HRESULT CMpaDecFilter::ProcessFFmpeg(enum AVCodecID nCodecId, BOOL bEOF/* = FALS
 		end = base + m_buff.GetCount();
 	}
 
-	memmove(base, p, end - p);
-	m_buff.SetCount(end - p);
+	m_buff.Consume(p - base);
 
 	return S_OK;
 }
@@ -950,8 +946,7 @@ HRESULT CMpaDecFilter::ProcessAC3_SPDIF()
 		p += size;
 	}
 
-	memmove(base, p, end - p);
-	m_buff.SetCount(end - p);
+	m_buff.Consume(p - base);
 
 	return S_OK;
 }
@@ -1001,8 +996,7 @@ HRESULT CMpaDecFilter::ProcessEAC3_SPDIF()
 		}
 	}
 
-	memmove(base, p, end - p);
-	m_buff.SetCount(end - p);
+	m_buff.Consume(p - base);
 
 	return S_OK;
 }
@@ -1087,8 +1081,7 @@ HRESULT CMpaDecFilter::ProcessTrueHD_SPDIF()
 		}
 	}
 
-	memmove(base, p, end - p);
-	m_buff.SetCount(end - p);
+	m_buff.Consume(p - base);
 
 	return S_OK;
 }
@@ -1159,8 +1152,7 @@ HRESULT CMpaDecFilter::ProcessDTS_SPDIF()
 		p += (size + sizehd);
 	}
 
-	memmove(base, p, end - p);
-	m_buff.SetCount(end - p);
+	m_buff.Consume(p - base);
 
 	return S_OK;
 }
@@ -1414,8 +1406,7 @@ HRESULT CMpaDecFilter::ProcessPS2PCM()
 		}
 	}
 
-	memmove(base, p, end - p);
-	m_buff.SetCount(end - p);
+	m_buff.Consume(p - base);
 
 	return S_OK;
 }
@@ -1498,8 +1489,7 @@ HRESULT CMpaDecFilter::ProcessPS2ADPCM()
 		}
 	}
 
-	memmove(base, p, end - p);
-	m_buff.SetCount(end - p);
+	m_buff.Consume(p - base);
 
 	return S_OK;
 }
@@ -83,7 +83,7 @@ protected:
 	bool            m_fSPDIF[etcount];
 
 	CCritSec m_csReceive;
-	CPaddedArray    m_buff;
+	CPaddedBuffer   m_buff;
 	REFERENCE_TIME  m_rtStart;
 	bool            m_fDiscontinuity;
 	bool            m_bResync;
@@ -45,3 +45,90 @@ public:
 		return false;
 	}
 };
+
+//
+// CPaddedBuffer - input accumulator for the bitstream parsers
+//
+// The parsers read from GetData() and report the bytes they used with Consume(), that only moves the read offset.
+// The unconsumed tail goes back to the front when Append() runs out of room, not after every frame.
+// There are always m_padsize zero bytes after the data.
+//
+
+class CPaddedBuffer
+{
+	CAtlArray<BYTE> m_data;	// allocated size is the capacity
+	size_t m_padsize;
+	size_t m_pos;	// read offset
+	size_t m_size;	// end of the data
+
+	bool Reserve(size_t nSize) {
+		if (nSize + m_padsize <= m_data.GetCount()) {
+			return true;
+		}
+
+		if (m_pos) {
+			memmove(m_data.GetData(), m_data.GetData() + m_pos, m_size - m_pos);
+			m_size -= m_pos;
+			nSize -= m_pos;
+			m_pos = 0;
+			if (nSize + m_padsize <= m_data.GetCount()) {
+				return true;
+			}
+		}
+
+		size_t nCapacity = nSize + m_padsize;
+		nCapacity += nCapacity / 2;
+		return m_data.SetCount((nCapacity + 4095) & ~4095);
+	}
+
+	void Pad() {
+		if (m_data.GetCount()) {
+			memset(m_data.GetData() + m_size, 0, m_padsize);
+		}
+	}
+
+public:
+	CPaddedBuffer(size_t padsize)
+		: m_padsize(padsize)
+		, m_pos(0)
+		, m_size(0) {
+	}
+
+	BYTE* GetData() {
+		return m_data.GetData() + m_pos;
+	}
+
+	size_t GetCount() const {
+		return m_size - m_pos;
+	}
+
+	bool Append(const BYTE* pData, size_t nSize) {
+		if (!Reserve(m_size + nSize)) {
+			return false;
+		}
+		memcpy(m_data.GetData() + m_size, pData, nSize);
+		m_size += nSize;
+		Pad();
+		return true;
+	}
+
+	void Consume(size_t nSize) {
+		m_pos += min(nSize, m_size - m_pos);
+		if (m_pos == m_size) {
+			RemoveAll();
+		}
+	}
+
+	// truncates the data, the memory is kept
+	void SetCount(size_t nNewSize) {
+		if (nNewSize < GetCount()) {
+			m_size = m_pos + nNewSize;
+			Pad();
+		}
+	}
+
+	void RemoveAll() {
+		m_pos = m_size = 0;
+		Pad();
+	}
+};
@@ -21,7 +21,7 @@
 
 #pragma once
 
-typedef enum {DIAuto, DIWeave, DIBlend, DIBob, DIFieldShift, DIELA} ditype;
+typedef enum {DIAuto, DIWeave, DIBlend, DIBob, DIFieldShift, DIELA, DIYadif, DIYadif2x} ditype;
 
 interface __declspec(uuid("0ABEAA65-0317-47B9-AE1D-D9EA905AFD25"))
 IMpeg2DecFilter :
@@ -54,5 +54,9 @@ public IUnknown {
 	STDMETHOD(EnableReadARFromStream(bool fEnable)) PURE;
 	STDMETHOD_(bool, IsReadARFromStreamEnabled()) PURE;
 
+	// decode the slices of a picture on several threads, takes effect at the next start of streaming
+	STDMETHOD(EnableSliceThreads(bool fEnable)) PURE;
+	STDMETHOD_(bool, IsSliceThreadsEnabled()) PURE;
+
 	STDMETHOD(Apply()) PURE;
 };
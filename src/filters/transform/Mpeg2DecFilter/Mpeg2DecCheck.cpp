@@ -0,0 +1,161 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// Mpeg2DecCheck - decodes an MPEG-1/2 video elementary stream without a filter graph, once on the calling
+// thread and once with slice threads, and compares the pictures, not part of the filter build
+//
+//   build it as a console program from this file, libmpeg2.cpp, idct_sse2.cpp, mc_sse2.cpp,
+//   idct_mmx.obj, motion_comp_mmx.obj and DSUtil (for g_cpuid)
+//
+//   Mpeg2DecCheck <file.m2v> [threads]   exits with 1 when a picture differs
+//
+// The pictures are taken where CMpeg2DecFilter::Transform() delivers them and reduced to a hash per plane.
+//
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <vector>
+#include "libmpeg2.h"
+
+#define CHUNK_SIZE	(64 * 1024)	// about the size of a splitter packet
+
+struct picture_hash_t {
+	unsigned hash[3];
+};
+
+static unsigned HashPlane(const BYTE* p, int w, int h, int pitch)
+{
+	unsigned hash = 2166136261u;
+	for (int y = 0; y < h; y++, p += pitch) {
+		for (int x = 0; x < w; x++) {
+			hash = (hash ^ p[x]) * 16777619u;
+		}
+	}
+	return hash;
+}
+
+static void Decode(std::vector<BYTE>& data, int threads, std::vector<picture_hash_t>& pictures, double& seconds)
+{
+	CAutoPtr<CMpeg2Dec> dec(DNew CMpeg2Dec());
+	dec->mpeg2_set_threads(threads);
+
+	LARGE_INTEGER freq, start, stop;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&start);
+
+	size_t pos = 0;
+	for (;;) {
+		mpeg2_state_t state = dec->mpeg2_parse();
+
+#ifndef _WIN64
+		__asm emms;
+#endif
+		if (state == STATE_BUFFER) {
+			if (pos >= data.size()) {
+				break;
+			}
+			size_t len = min(data.size() - pos, (size_t)CHUNK_SIZE);
+			dec->mpeg2_buffer(&data[pos], &data[pos] + len);
+			pos += len;
+		} else if (state == STATE_PICTURE) {
+			dec->m_picture->fDelivered = false;
+		} else if (state == STATE_SLICE || state == STATE_END) {
+			mpeg2_picture_t* picture = dec->m_info.m_display_picture;
+			mpeg2_fbuf_t* fbuf = dec->m_info.m_display_fbuf;
+
+			if (picture && !(picture->flags & PIC_FLAG_SKIP) && fbuf && !picture->fDelivered) {
+				picture->fDelivered = true;
+
+				int w = dec->m_info.m_sequence->picture_width;
+				int h = dec->m_info.m_sequence->picture_height;
+				int pitch = dec->m_info.m_sequence->width;
+
+				picture_hash_t ph;
+				ph.hash[0] = HashPlane(fbuf->buf[0], w, h, pitch);
+				ph.hash[1] = HashPlane(fbuf->buf[1], w / 2, h / 2, pitch / 2);
+				ph.hash[2] = HashPlane(fbuf->buf[2], w / 2, h / 2, pitch / 2);
+				pictures.push_back(ph);
+			}
+		}
+	}
+
+	QueryPerformanceCounter(&stop);
+	seconds = (double)(stop.QuadPart - start.QuadPart) / freq.QuadPart;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <file.m2v> [threads]\n", argv[0]);
+		return 2;
+	}
+
+	int threads;
+	if (argc > 2) {
+		threads = atoi(argv[2]);
+	} else {
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		threads = min((int)si.dwNumberOfProcessors, MPEG2_MAX_THREADS);
+	}
+
+	FILE* f = NULL;
+	if (fopen_s(&f, argv[1], "rb") || !f) {
+		fprintf(stderr, "can't open %s\n", argv[1]);
+		return 2;
+	}
+	std::vector<BYTE> data;
+	BYTE buff[CHUNK_SIZE];
+	for (size_t len; (len = fread(buff, 1, sizeof(buff), f)) > 0; ) {
+		data.insert(data.end(), buff, buff + len);
+	}
+	fclose(f);
+
+	std::vector<picture_hash_t> seq, mt;
+	double tSeq, tMt;
+	Decode(data, 1, seq, tSeq);
+	Decode(data, threads, mt, tMt);
+
+	printf("sequential: %u pictures, %.3f s\n", (unsigned)seq.size(), tSeq);
+	printf("%d threads: %u pictures, %.3f s\n", threads, (unsigned)mt.size(), tMt);
+
+	if (seq.empty()) {
+		printf("no pictures decoded\n");
+		return 2;
+	}
+
+	if (mt.size() != seq.size()) {
+		printf("FAILED: picture count differs\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < seq.size(); i++) {
+		for (int p = 0; p < 3; p++) {
+			if (seq[i].hash[p] != mt[i].hash[p]) {
+				printf("FAILED: picture %u differs in plane %d\n", (unsigned)i, p);
+				return 1;
+			}
+		}
+	}
+
+	printf("identical\n");
+	return 0;
+}
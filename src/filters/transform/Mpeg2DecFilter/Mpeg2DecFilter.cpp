@@ -92,8 +92,10 @@ private:
 #define OPT_PlanarYUV       _T("PlanarYUV")
 #define OPT_Interlaced      _T("Interlaced")
 #define OPT_ReadStreamAR    _T("ReadARFromStream")
+#define OPT_SliceThreads    _T("SliceThreads")
 
 #define EPSILON 1e-4
+#define POSTPROC_BAND 32	// lines copied and post-processed in one go
 
 #ifdef REGISTER_FILTER
 
@@ -242,8 +244,14 @@ CMpeg2DecFilter::CMpeg2DecFilter(LPUNKNOWN lpunk, HRESULT* phr)
 	: CBaseVideoFilter(NAME("CMpeg2DecFilter"), lpunk, phr, __uuidof(this), 1)
 	, m_fWaitForKeyFrame(true)
 	, m_fInitializedBuffer(true)
+	, m_nYadifFrames(0)
+	, m_fYadifNextDelivered(false)
 	, m_ControlThread(NULL)
 {
+	for (int i = 0; i < _countof(m_yadif_frames); i++) {
+		m_yadif_frames[i] = &m_yadif_fb[i];
+	}
+
 	if (FAILED(*phr)) {
 		return;
 	}
@@ -290,6 +298,7 @@ CMpeg2DecFilter::CMpeg2DecFilter(LPUNKNOWN lpunk, HRESULT* phr)
 	EnablePlanarYUV(true);
 	EnableInterlaced(false);
 	EnableReadARFromStream(true);
+	EnableSliceThreads(false);
 
 #ifdef REGISTER_FILTER
 	CRegKey key;
@@ -322,6 +331,9 @@ CMpeg2DecFilter::CMpeg2DecFilter(LPUNKNOWN lpunk, HRESULT* phr)
 		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_ReadStreamAR, dw)) {
 			EnableReadARFromStream(!!dw);
 		}
+		if (ERROR_SUCCESS == key.QueryDWORDValue(OPT_SliceThreads, dw)) {
+			EnableSliceThreads(!!dw);
+		}
 	}
 #else
 	DWORD dw;
@@ -343,6 +355,8 @@ CMpeg2DecFilter::CMpeg2DecFilter(LPUNKNOWN lpunk, HRESULT* phr)
 	EnableInterlaced(!!dw);
 	dw = AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGDec, OPT_ReadStreamAR, m_bReadARFromStream);
 	EnableReadARFromStream(!!dw);
+	dw = AfxGetApp()->GetProfileInt(OPT_SECTION_MPEGDec, OPT_SliceThreads, m_fSliceThreads);
+	EnableSliceThreads(!!dw);
 
 #endif
 
@@ -371,6 +385,7 @@ STDMETHODIMP CMpeg2DecFilter::Apply()
 		key.SetDWORDValue(OPT_PlanarYUV, m_fPlanarYUV);
 		key.SetDWORDValue(OPT_Interlaced, m_fInterlaced);
 		key.SetDWORDValue(OPT_ReadStreamAR, m_bReadARFromStream);
+		key.SetDWORDValue(OPT_SliceThreads, m_fSliceThreads);
 	}
 #else
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_DeintMethod, m_ditype);
@@ -382,6 +397,7 @@ STDMETHODIMP CMpeg2DecFilter::Apply()
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_PlanarYUV, m_fPlanarYUV);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_Interlaced, m_fInterlaced);
 	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_ReadStreamAR, m_bReadARFromStream);
+	AfxGetApp()->WriteProfileInt(OPT_SECTION_MPEGDec, OPT_SliceThreads, m_fSliceThreads);
 #endif
 
 	return S_OK;
@@ -425,6 +441,10 @@ CBasePin* CMpeg2DecFilter::GetPin(int n)
 HRESULT CMpeg2DecFilter::EndOfStream()
 {
 	CAutoLock cAutoLock(&m_csReceive);
+	if (m_fb.di == DIYadif || m_fb.di == DIYadif2x) {
+		// the last frame is still waiting for its successor
+		DeliverYadif(NULL, 0);
+	}
 	m_pClosedCaptionOutput->EndOfStream();
 	return __super::EndOfStream();
 }
@@ -446,6 +466,7 @@ HRESULT CMpeg2DecFilter::NewSegment(REFERENCE_TIME tStart, REFERENCE_TIME tStop,
 	CAutoLock cAutoLock(&m_csReceive);
 	m_pClosedCaptionOutput->DeliverNewSegment(tStart, tStop, dRate);
 	m_fDropFrames = false;
+	m_nYadifFrames = 0;
 	return __super::NewSegment(tStart, tStop, dRate);
 }
 
@@ -497,6 +518,8 @@ void CMpeg2DecFilter::InputTypeChanged()
 
 	m_fFilm = false;
 	m_fb.flags = 0;
+
+	m_nYadifFrames = 0;
 }
 
 void CMpeg2DecFilter::SetDeinterlaceMethod()
@@ -527,7 +550,8 @@ void CMpeg2DecFilter::SetDeinterlaceMethod()
 	} else {
 		m_fb.di = GetDeinterlaceMethod();
 
-		if (m_fb.di == DIAuto || m_fb.di != DIWeave && m_fb.di != DIBlend && m_fb.di != DIBob && m_fb.di != DIFieldShift && m_fb.di != DIELA) {
+		if (m_fb.di == DIAuto || m_fb.di != DIWeave && m_fb.di != DIBlend && m_fb.di != DIBob && m_fb.di != DIFieldShift && m_fb.di != DIELA
+				&& m_fb.di != DIYadif && m_fb.di != DIYadif2x) {
 			if (seqflags & SEQ_FLAG_PROGRESSIVE_SEQUENCE) {
 				m_fb.di = DIWeave;    // hurray!
 			} else if (m_fFilm) {
@@ -699,6 +723,14 @@ HRESULT CMpeg2DecFilter::Transform(IMediaSample* pIn)
 							m_fInitializedBuffer = true;
 						}
 					}
+
+					// sequence end code, a still picture (DVD menu, still cell) gets no successor to wait for
+					if (state == STATE_END && (m_fb.di == DIYadif || m_fb.di == DIYadif2x)) {
+						hr = DeliverYadif(NULL, 0);
+						if (hr != S_OK) {
+							return hr;
+						}
+					}
 				}
 				break;
 			default:
@@ -740,9 +772,24 @@ HRESULT CMpeg2DecFilter::Deliver()
 
 	bool tff = !!(m_fb.flags & PIC_FLAG_TOP_FIELD_FIRST);
 
+	if (m_fb.di == DIYadif || m_fb.di == DIYadif2x) {
+		return DeliverYadif(fbuf->buf, spitch);
+	}
+	m_nYadifFrames = 0;
+
 	// deinterlace
 	if (m_fb.di == DIWeave) {
-		BitBltFromI420ToI420(w, h, m_fb.buf[0], m_fb.buf[1], m_fb.buf[2], dpitch, fbuf->buf[0], fbuf->buf[1], fbuf->buf[2], spitch);
+		CAutoLock cAutoLock(&m_csProps);
+
+		// postproc each band right after the copy, while it is still in the cache
+		int band = HasBrContHueSat() ? POSTPROC_BAND : h;
+		for (int y = 0; y < h; y += band) {
+			int lines = min(band, h - y);
+			BitBltFromI420ToI420(w, lines,
+								 m_fb.buf[0] + y * dpitch, m_fb.buf[1] + (y / 2) * (dpitch / 2), m_fb.buf[2] + (y / 2) * (dpitch / 2), dpitch,
+								 fbuf->buf[0] + y * spitch, fbuf->buf[1] + (y / 2) * (spitch / 2), fbuf->buf[2] + (y / 2) * (spitch / 2), spitch);
+			ApplyBrContHueSat(m_fb.buf, dpitch, w, y, y + lines);
+		}
 	} else if (m_fb.di == DIBlend) {
 		DeinterlaceBlend(m_fb.buf[0], fbuf->buf[0], w, h, dpitch, spitch);
 		DeinterlaceBlend(m_fb.buf[1], fbuf->buf[1], w/2, h/2, dpitch/2, spitch/2);
@@ -767,7 +814,9 @@ HRESULT CMpeg2DecFilter::Deliver()
 	}
 
 	// postproc
-	ApplyBrContHueSat(m_fb.buf[0], m_fb.buf[1], m_fb.buf[2], w, h, dpitch);
+	if (m_fb.di != DIWeave) {
+		ApplyBrContHueSat(m_fb.buf[0], m_fb.buf[1], m_fb.buf[2], w, h, dpitch);
+	}
 
 	// deliver
 	if (m_fb.di == DIWeave || m_fInitializedBuffer) {
@@ -809,6 +858,115 @@ HRESULT CMpeg2DecFilter::Deliver()
 	return hr;
 }
 
+HRESULT CMpeg2DecFilter::DeliverYadif(BYTE* const src[3], int spitch)
+{
+	int w = m_fb.w;
+	int h = m_fb.h;
+
+	framebuf* prev;
+	framebuf* cur;
+	framebuf* next;
+
+	bool fSpatial = false;
+
+	if (src) {
+		if (m_nYadifFrames && (m_yadif_frames[2]->w != w || m_yadif_frames[2]->h != h || m_yadif_frames[2]->pitch != spitch)) {
+			m_nYadifFrames = 0;
+		}
+
+		const bool fCurDelivered = m_fYadifNextDelivered;
+		m_fYadifNextDelivered = false;
+
+		// the oldest frame takes the new one
+		framebuf* fb = m_yadif_frames[0];
+		m_yadif_frames[0] = m_yadif_frames[1];
+		m_yadif_frames[1] = m_yadif_frames[2];
+		m_yadif_frames[2] = fb;
+
+		if (!fb->buf_base || fb->w != w || fb->h != h || fb->pitch != spitch) {
+			fb->Alloc(w, h, spitch);
+		}
+		BitBltFromI420ToI420(w, h, fb->buf[0], fb->buf[1], fb->buf[2], spitch, src[0], src[1], src[2], spitch);
+		fb->rtStart	= m_fb.rtStart;
+		fb->rtStop	= m_fb.rtStop;
+		fb->flags	= m_fb.flags;
+
+		if (m_nYadifFrames < 3) {
+			m_nYadifFrames++;
+		}
+		if (m_nYadifFrames < 2) {
+			// a still or the first frame after a seek, its successor may never come,
+			// show it at once deinterlaced within the frame
+			m_fYadifNextDelivered = true;
+			fSpatial = true;
+			prev = cur = next = fb;
+		} else if (fCurDelivered) {
+			return S_OK;
+		} else {
+			cur		= m_yadif_frames[1];
+			next	= m_yadif_frames[2];
+			prev	= m_nYadifFrames > 2 ? m_yadif_frames[0] : cur;
+		}
+	} else {
+		// end of stream or of the sequence, the last frame has no successor
+		if (!m_nYadifFrames || m_fYadifNextDelivered) {
+			m_nYadifFrames = 0;
+			m_fYadifNextDelivered = false;
+			return S_OK;
+		}
+
+		cur		= m_yadif_frames[2];
+		next	= cur;
+		prev	= m_nYadifFrames > 1 ? m_yadif_frames[1] : cur;
+
+		m_nYadifFrames = 0;
+	}
+
+	REFERENCE_TIME rtStart = m_fb.rtStart;
+	REFERENCE_TIME rtStop = m_fb.rtStop;
+	DWORD flags = m_fb.flags;
+
+	bool tff = !!(cur->flags & PIC_FLAG_TOP_FIELD_FIRST);
+	int fields = m_fb.di == DIYadif2x ? 2 : 1;
+
+	HRESULT hr = S_OK;
+
+	m_fb.flags = cur->flags;
+
+	for (int field = 0; field < fields && SUCCEEDED(hr); field++) {
+		if (fields == 2) {
+			m_fb.rtStart = field ? (cur->rtStart + cur->rtStop) / 2 : cur->rtStart;
+			m_fb.rtStop = field ? cur->rtStop : (cur->rtStart + cur->rtStop) / 2;
+		} else {
+			m_fb.rtStart = cur->rtStart;
+			m_fb.rtStop = cur->rtStop;
+		}
+
+		// deinterlace and postproc, the band threads read the picture controls without locking
+		if (fSpatial) {
+			// with prev == cur == next yadif would only weave, use the edge line average
+			const bool topfield = field ? !tff : tff;
+			DeinterlaceELA(m_fb.buf[0], cur->buf[0], w, h, m_fb.pitch, cur->pitch, topfield);
+			DeinterlaceELA(m_fb.buf[1], cur->buf[1], w/2, h/2, m_fb.pitch/2, cur->pitch/2, topfield);
+			DeinterlaceELA(m_fb.buf[2], cur->buf[2], w/2, h/2, m_fb.pitch/2, cur->pitch/2, topfield);
+			ApplyBrContHueSat(m_fb.buf[0], m_fb.buf[1], m_fb.buf[2], w, h, m_fb.pitch);
+		} else {
+			CAutoLock cAutoLock(&m_csProps);
+			m_yadif.Deinterlace(m_fb.buf, m_fb.pitch, prev->buf, cur->buf, next->buf, cur->pitch, w, h, field ? !tff : tff, tff,
+								HasBrContHueSat() ? YadifPostProc : NULL, this);
+		}
+
+		// deliver
+		hr = Deliver(false);
+	}
+
+	m_fb.rtStart = rtStart;
+	m_fb.rtStop = rtStop;
+	m_fb.flags = flags;
+
+	return hr;
+}
+
 HRESULT CMpeg2DecFilter::Deliver(bool fRepeatLast)
 {
 	CAutoLock cAutoLock(&m_csReceive);
@@ -989,6 +1147,12 @@ HRESULT CMpeg2DecFilter::StartStreaming()
 		return E_OUTOFMEMORY;
 	}
 
+	if (IsSliceThreadsEnabled()) {
+		SYSTEM_INFO SystemInfo;
+		GetSystemInfo(&SystemInfo);
+		m_dec->mpeg2_set_threads(SystemInfo.dwNumberOfProcessors);
+	}
+
 	InputTypeChanged();
 
 	//	g_clock = clock();
@@ -1000,6 +1164,11 @@ HRESULT CMpeg2DecFilter::StopStreaming()
 {
 	m_dec.Free();
 
+	m_nYadifFrames = 0;
+	for (int i = 0; i < _countof(m_yadif_fb); i++) {
+		m_yadif_fb[i].Free();
+	}
+
 	return __super::StopStreaming();
 }
 
@@ -1072,12 +1241,18 @@ static void CalcBrCont(BYTE* YTbl, float bright, float cont)
 	}
 }
 
-static void CalcHueSat(BYTE* UTbl, BYTE* VTbl, float hue, float sat)
+static void CalcHueSatCoefs(float hue, float sat, int& Sin, int& Cos, int& Sat)
 {
-	int Sat = (int)(sat * 512);
 	double Hue = (hue * 3.1415926) / 180.0;
-	int Sin = (int)(sin(Hue) * 4096);
-	int Cos = (int)(cos(Hue) * 4096);
+	Sin = (int)(sin(Hue) * 4096);
+	Cos = (int)(cos(Hue) * 4096);
+	Sat = (int)(sat * 512);
+}
+
+static void CalcHueSat(BYTE* UTbl, BYTE* VTbl, float hue, float sat)
+{
+	int Sin, Cos, Sat;
+	CalcHueSatCoefs(hue, sat, Sin, Cos, Sat);
 
 	for (int y = 0; y < 256; y++) {
 		for (int x = 0; x < 256; x++) {
@@ -1095,72 +1270,127 @@ static void CalcHueSat(BYTE* UTbl, BYTE* VTbl, float hue, float sat)
 	}
 }
 
+bool CMpeg2DecFilter::HasBrContHueSat()
+{
+	return fabs(m_bright) > EPSILON || fabs(m_cont - 1.0) > EPSILON
+		   || fabs(m_hue) > EPSILON || fabs(m_sat - 1.0) > EPSILON;
+}
+
+void CMpeg2DecFilter::YadifPostProc(LPVOID param, BYTE* const dst[3], int dstpitch, int w, int y0, int y1)
+{
+	((CMpeg2DecFilter*)param)->ApplyBrContHueSat(dst, dstpitch, w, y0, y1);
+}
+
 void CMpeg2DecFilter::ApplyBrContHueSat(BYTE* srcy, BYTE* srcu, BYTE* srcv, int w, int h, int pitch)
 {
 	CAutoLock cAutoLock(&m_csProps);
 
-	if (fabs(m_bright) > EPSILON || fabs(m_cont - 1.0) > EPSILON) {
-		int size = pitch*h;
-
-		if ((g_cpuid.m_flags & CCpuID::sse2) && ((DWORD_PTR)srcy & 15) == 0) {
-			short Cont = (short)(min(max(m_cont, 0) * 512, (1 << 16) - 1));
-			short Bright = (short)(m_bright + 16);
+	BYTE* buf[3] = {srcy, srcu, srcv};
+	ApplyBrContHueSat(buf, pitch, w, 0, h);
+}
 
-			__m128i bc = _mm_set_epi16(Bright, Cont, Bright, Cont, Bright, Cont, Bright, Cont);
+// luma lines [y0, y1) and the matching chroma lines, the caller holds m_csProps
+// the sse2 code gives the same results as the lookup tables
 
-			__m128i zero = _mm_setzero_si128();
-			__m128i _16 = _mm_set1_epi16(16);
-			__m128i _512 = _mm_set1_epi16(512);
+void CMpeg2DecFilter::ApplyBrContHueSat(BYTE* const buf[3], int pitch, int w, int y0, int y1)
+{
+	const bool bSSE2 = !!(g_cpuid.m_flags & CCpuID::sse2);
 
-			for (int i = 0, j = size >> 4; i < j; i++) {
-				__m128i r = _mm_load_si128((__m128i*)&srcy[i * 16]);
+	if (fabs(m_bright) > EPSILON || fabs(m_cont - 1.0) > EPSILON) {
+		int Cont = (int)(m_cont * 512);
+		int Bright = (int)m_bright + 16;
+		bool bSIMD = bSSE2 && Cont >= SHRT_MIN && Cont <= SHRT_MAX;
 
-				__m128i rl = _mm_unpacklo_epi8(r, zero);
-				__m128i rh = _mm_unpackhi_epi8(r, zero);
+		for (int y = y0; y < y1; y++) {
+			BYTE* p = buf[0] + y * pitch;
+			int x = 0;
 
-				rl = _mm_subs_epi16(rl, _16);
-				rh = _mm_subs_epi16(rh, _16);
+			if (bSIMD) {
+				// ((Cont * (i - 16)) >> 9) + Bright + 16 as (i - 16, 512) . (Cont, Bright + 16) >> 9
+				__m128i bc = _mm_set_epi16(Bright, Cont, Bright, Cont, Bright, Cont, Bright, Cont);
 
-				__m128i rll = _mm_unpacklo_epi16(rl, _512);
-				__m128i rlh = _mm_unpackhi_epi16(rl, _512);
-				__m128i rhl = _mm_unpacklo_epi16(rh, _512);
-				__m128i rhh = _mm_unpackhi_epi16(rh, _512);
+				__m128i zero = _mm_setzero_si128();
+				__m128i _16 = _mm_set1_epi16(16);
+				__m128i _512 = _mm_set1_epi16(512);
 
-				rll = _mm_madd_epi16(rll, bc);
-				rlh = _mm_madd_epi16(rlh, bc);
-				rhl = _mm_madd_epi16(rhl, bc);
-				rhh = _mm_madd_epi16(rhh, bc);
+				for (; x + 16 <= w; x += 16) {
+					__m128i r = _mm_loadu_si128((__m128i*)&p[x]);
 
-				rll = _mm_srai_epi32(rll, 9);
-				rlh = _mm_srai_epi32(rlh, 9);
-				rhl = _mm_srai_epi32(rhl, 9);
-				rhh = _mm_srai_epi32(rhh, 9);
+					__m128i rl = _mm_sub_epi16(_mm_unpacklo_epi8(r, zero), _16);
+					__m128i rh = _mm_sub_epi16(_mm_unpackhi_epi8(r, zero), _16);
 
-				rl = _mm_packs_epi32(rll, rlh);
-				rh = _mm_packs_epi32(rhl, rhh);
+					__m128i rll = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(rl, _512), bc), 9);
+					__m128i rlh = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(rl, _512), bc), 9);
+					__m128i rhl = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(rh, _512), bc), 9);
+					__m128i rhh = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(rh, _512), bc), 9);
 
-				r = _mm_packus_epi16(rl, rh);
+					r = _mm_packus_epi16(_mm_packs_epi32(rll, rlh), _mm_packs_epi32(rhl, rhh));
 
-				_mm_store_si128((__m128i*)&srcy[i * 16], r);
+					_mm_storeu_si128((__m128i*)&p[x], r);
+				}
 			}
 
-			srcy += size>>4;
-			size &= 15;
-		}
-
-		for (; size > 0; size--) {
-			*srcy++ = m_YTbl[*srcy];
+			for (; x < w; x++) {
+				p[x] = m_YTbl[p[x]];
+			}
 		}
 	}
 
 	if (fabs(m_hue) > EPSILON || fabs(m_sat - 1.0) > EPSILON) {
+		int Sin, Cos, Sat;
+		CalcHueSatCoefs(m_hue, m_sat, Sin, Cos, Sat);
+		bool bSIMD = bSSE2 && Cos <= SHRT_MAX && Sat >= SHRT_MIN && Sat <= SHRT_MAX;
+
 		pitch /= 2;
 		w /= 2;
-		h /= 2;
-		for (int size = pitch*h; size > 0; size--) {
-			WORD uv = (*srcv << 8) | *srcu;
-			*srcu++ = m_UTbl[uv];
-			*srcv++ = m_VTbl[uv];
+
+		for (int y = y0 / 2; y < y1 / 2; y++) {
+			BYTE* pu = buf[1] + y * pitch;
+			BYTE* pv = buf[2] + y * pitch;
+			int x = 0;
+
+			if (bSIMD) {
+				// rotate (u, v) with (u, v) . (Cos, Sin) and (u, v) . (-Sin, Cos), then scale by Sat
+				__m128i cs = _mm_set_epi16(Sin, Cos, Sin, Cos, Sin, Cos, Sin, Cos);
+				__m128i sc = _mm_set_epi16(Cos, -Sin, Cos, -Sin, Cos, -Sin, Cos, -Sin);
+				__m128i sat = _mm_set1_epi16(Sat);
+
+				__m128i zero = _mm_setzero_si128();
+				__m128i _128 = _mm_set1_epi16(128);
+				__m128i _16 = _mm_set1_epi16(16);
+				__m128i _235 = _mm_set1_epi16(235);
+
+				for (; x + 8 <= w; x += 8) {
+					__m128i u = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&pu[x]), zero), _128);
+					__m128i v = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&pv[x]), zero), _128);
+
+					__m128i uvl = _mm_unpacklo_epi16(u, v);
+					__m128i uvh = _mm_unpackhi_epi16(u, v);
+
+					u = _mm_packs_epi32(_mm_srai_epi32(_mm_madd_epi16(uvl, cs), 12), _mm_srai_epi32(_mm_madd_epi16(uvh, cs), 12));
+					v = _mm_packs_epi32(_mm_srai_epi32(_mm_madd_epi16(uvl, sc), 12), _mm_srai_epi32(_mm_madd_epi16(uvh, sc), 12));
+
+					// 32 bit products from the low and high halves
+					__m128i lo = _mm_mullo_epi16(u, sat);
+					__m128i hi = _mm_mulhi_epi16(u, sat);
+					u = _mm_packs_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 9), _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 9));
+					lo = _mm_mullo_epi16(v, sat);
+					hi = _mm_mulhi_epi16(v, sat);
+					v = _mm_packs_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 9), _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 9));
+
+					u = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(u, _128), _16), _235);
+					v = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(v, _128), _16), _235);
+
+					_mm_storel_epi64((__m128i*)&pu[x], _mm_packus_epi16(u, zero));
+					_mm_storel_epi64((__m128i*)&pv[x], _mm_packus_epi16(v, zero));
+				}
+			}
+
+			for (; x < w; x++) {
+				WORD uv = (pv[x] << 8) | pu[x];
+				pu[x] = m_UTbl[uv];
+				pv[x] = m_VTbl[uv];
+			}
 		}
 	}
 }
@@ -1269,6 +1499,19 @@ STDMETHODIMP_(bool) CMpeg2DecFilter::IsReadARFromStreamEnabled()
 	return m_bReadARFromStream;
 }
 
+STDMETHODIMP CMpeg2DecFilter::EnableSliceThreads(bool fEnable)
+{
+	CAutoLock cAutoLock(&m_csProps);
+	m_fSliceThreads = fEnable;
+	return S_OK;
+}
+
+STDMETHODIMP_(bool) CMpeg2DecFilter::IsSliceThreadsEnabled()
+{
+	CAutoLock cAutoLock(&m_csProps);
+	return m_fSliceThreads;
+}
+
 //
 // CMpeg2DecInputPin
 //
@@ -27,6 +27,7 @@
 #include "../BaseVideoFilter/BaseVideoFilter.h"
 #include "IMpeg2DecFilter.h"
 #include "Mpeg2DecFilterSettingsWnd.h"
+#include "../../../DSUtil/DeinterlaceYadif.h"
 
 #ifdef MPEG2ONLY
 #define Mpeg2DecFilterName L"MPC MPEG-2 Video Decoder"
@@ -98,9 +99,20 @@ class __declspec(uuid("39F498AF-1A09-4275-B193-673B0BA3D478"))
 				_aligned_free(buf_base);
 			}
 			buf_base = NULL;
+			w = h = pitch = 0;
+			memset(&buf, 0, sizeof(buf));
 		}
 	} m_fb;
 
+	// yadif needs the previous and the next frame, the output lags one frame behind the decoder
+	// except for the first frame after a reset, which is shown at once
+	CYadifDeinterlacer m_yadif;
+	framebuf m_yadif_fb[3];
+	framebuf* m_yadif_frames[3];	// previous, current, next
+	int m_nYadifFrames;
+	bool m_fYadifNextDelivered;		// the newest frame had no predecessor and was shown right away
+	HRESULT DeliverYadif(BYTE* const src[3], int spitch);
+
 	bool m_fFilm;
 	void SetDeinterlaceMethod();
 	void SetTypeSpecificFlags(IMediaSample* pMS);
@@ -154,8 +166,12 @@ protected:
 	bool m_fPlanarYUV;
 	bool m_fInterlaced;
 	bool m_bReadARFromStream;
+	bool m_fSliceThreads;
 
 	void ApplyBrContHueSat(BYTE* srcy, BYTE* srcu, BYTE* srcv, int w, int h, int pitch);
+	void ApplyBrContHueSat(BYTE* const buf[3], int pitch, int w, int y0, int y1);
+	bool HasBrContHueSat();
+	static void YadifPostProc(LPVOID param, BYTE* const dst[3], int dstpitch, int w, int y0, int y1);
 
 public:
 
@@ -193,6 +209,9 @@ public:
 	STDMETHODIMP EnableReadARFromStream(bool fEnable);
 	STDMETHODIMP_(bool) IsReadARFromStreamEnabled();
 
+	STDMETHODIMP EnableSliceThreads(bool fEnable);
+	STDMETHODIMP_(bool) IsSliceThreadsEnabled();
+
 private:
 	enum {
 		CNTRL_EXIT,
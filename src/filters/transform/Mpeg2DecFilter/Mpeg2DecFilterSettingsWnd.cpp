@@ -64,6 +64,7 @@ bool CMpeg2DecSettingsWnd::OnConnect(const CInterfaceList<IUnknown, &IID_IUnknow
 	m_planaryuv = m_pM2DF->IsPlanarYUVEnabled();
 	m_interlaced = m_pM2DF->IsInterlacedEnabled();
 	m_readARFromStream = m_pM2DF->IsReadARFromStreamEnabled();
+	m_slicethreads = m_pM2DF->IsSliceThreadsEnabled();
 
 	return true;
 }
@@ -95,6 +96,10 @@ bool CMpeg2DecSettingsWnd::OnActivate()
 
 	m_readARFromStream_check.Create(ResStr(IDS_MPEG2_READ_AR), dwStyle | BS_AUTOCHECKBOX, CRect(p, CSize(IPP_SCALE(300), m_fontheight)), this, IDC_PP_CHECK4);
 	m_readARFromStream_check.SetCheck(m_readARFromStream ? BST_CHECKED : BST_UNCHECKED);
+	p.y += h20;
+
+	m_slicethreads_check.Create(ResStr(IDS_MPEG2_SLICE_THREADS), dwStyle | BS_AUTOCHECKBOX, CRect(p, CSize(IPP_SCALE(300), m_fontheight)), this, IDC_PP_CHECK5);
+	m_slicethreads_check.SetCheck(m_slicethreads ? BST_CHECKED : BST_UNCHECKED);
 	p.y += h25;
 
 	m_ditype_static.Create(ResStr(IDS_MPEG2_DEINTERLACING), WS_VISIBLE | WS_CHILD, CRect(p, CSize(IPP_SCALE(100), m_fontheight)), this);
@@ -105,6 +110,8 @@ bool CMpeg2DecSettingsWnd::OnActivate()
 	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("Bob")), (DWORD)DIBob);
 	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("Field Shift")), (DWORD)DIFieldShift);
 	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("ELA")), (DWORD)DIELA);
+	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("Yadif")), (DWORD)DIYadif);
+	m_ditype_combo.SetItemData(m_ditype_combo.AddString(_T("Yadif 2x")), (DWORD)DIYadif2x);
 	m_ditype_combo.SetCurSel(0);
 	for (int i = 0; i < m_ditype_combo.GetCount(); i++)
 		if ((int)m_ditype_combo.GetItemData(i) == m_ditype) {
@@ -167,6 +174,7 @@ void CMpeg2DecSettingsWnd::OnDeactivate()
 	m_interlaced = !!IsDlgButtonChecked(m_interlaced_check.GetDlgCtrlID());
 	m_forcedsubs = !!IsDlgButtonChecked(m_forcedsubs_check.GetDlgCtrlID());
 	m_readARFromStream = !!IsDlgButtonChecked(m_readARFromStream_check.GetDlgCtrlID());
+	m_slicethreads = !!IsDlgButtonChecked(m_slicethreads_check.GetDlgCtrlID());
 }
 
 bool CMpeg2DecSettingsWnd::OnApply()
@@ -183,6 +191,7 @@ bool CMpeg2DecSettingsWnd::OnApply()
 		m_pM2DF->EnablePlanarYUV(m_planaryuv);
 		m_pM2DF->EnableInterlaced(m_interlaced);
 		m_pM2DF->EnableReadARFromStream(m_readARFromStream);
+		m_pM2DF->EnableSliceThreads(m_slicethreads);
 		m_pM2DF->Apply();
 	}
 
@@ -36,6 +36,7 @@ class __declspec(uuid("E5FB6957-65E6-491B-BB37-B25C9FE3BEA7"))
 	bool m_interlaced;
 	bool m_forcedsubs;
 	bool m_readARFromStream;
+	bool m_slicethreads;
 
 	enum {
 		IDC_PP_COMBO1 = 10000,
@@ -47,6 +48,7 @@ class __declspec(uuid("E5FB6957-65E6-491B-BB37-B25C9FE3BEA7"))
 		IDC_PP_CHECK2,
 		IDC_PP_CHECK3,
 		IDC_PP_CHECK4,
+		IDC_PP_CHECK5,
 		IDC_PP_BUTTON1,
 		IDC_PP_BUTTON2
 	};
@@ -62,6 +64,7 @@ class __declspec(uuid("E5FB6957-65E6-491B-BB37-B25C9FE3BEA7"))
 	CButton m_interlaced_check;
 	CButton m_forcedsubs_check;
 	CButton m_readARFromStream_check;
+	CButton m_slicethreads_check;
 	CStatic m_note_static;
 
 	void UpdateProcampValues();
@@ -76,7 +79,7 @@ public:
 	bool OnApply();
 
 	static LPCTSTR GetWindowTitle() { return MAKEINTRESOURCE(IDS_FILTER_SETTINGS_CAPTION); }
-	static CSize GetWindowSize() { return CSize(340, 296); }
+	static CSize GetWindowSize() { return CSize(340, 316); }
 
 	DECLARE_MESSAGE_MAP()
 
@@ -0,0 +1,213 @@
+/*
+ * (C) 2014 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// Mpeg2DecPostProcCheck - exactness and speed of the picture controls of CMpeg2DecFilter, not part of the filter build
+//
+//   build it as an MFC console program from this file with the Mpeg2DecFilter, DSUtil and BaseClasses libraries
+//
+//   Mpeg2DecPostProcCheck           run ApplyBrContHueSat() over a grid of settings once with g_cpuid's SSE2 flag
+//                                   cleared, which gives the lookup tables, and once with it set
+//   Mpeg2DecPostProcCheck --bench   also time the tables against SSE2 and the weave copy with a separate
+//                                   picture control pass against the banded one Deliver() does
+//
+// The pictures have widths from 1 to 721 pixels at odd addresses, so the SSE2 code runs unaligned and leaves
+// tails for the tables. The outputs, the stride padding included, have to be bit identical, exits with 1 when
+// they aren't.
+//
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <vector>
+#include "Mpeg2DecFilter.h"
+#include "../../../DSUtil/vd.h"
+
+#define POSTPROC_BAND	32	// as in Mpeg2DecFilter.cpp
+#define BENCH_WIDTH		1920
+#define BENCH_HEIGHT	1088
+#define BENCH_FRAMES	200
+
+class CMpeg2DecPostProcCheck : public CMpeg2DecFilter
+{
+public:
+	CMpeg2DecPostProcCheck(HRESULT* phr)
+		: CMpeg2DecFilter(NULL, phr) {
+	}
+
+	void SetControls(float bright, float cont, float hue, float sat) {
+		SetBrightness(bright);
+		SetContrast(cont);
+		SetHue(hue);
+		SetSaturation(sat);
+	}
+
+	using CMpeg2DecFilter::ApplyBrContHueSat;
+};
+
+struct picture_t {
+	int w, h, pitch;
+	std::vector<BYTE> data;
+	BYTE* buf[3];
+
+	// pitch is even and the planes start at odd addresses
+	picture_t(int w, int h, int pitch)
+		: w(w), h(h), pitch(pitch), data(pitch * h * 3 / 2 + 3) {
+		buf[0] = &data[1];
+		buf[1] = buf[0] + pitch * h;
+		buf[2] = buf[1] + pitch * h / 4;
+	}
+};
+
+static void FillNoise(picture_t& p, unsigned seed)
+{
+	unsigned rnd = seed;
+	for (size_t i = 0; i < p.data.size(); i++) {
+		rnd = rnd * 1103515245u + 12345u;
+		p.data[i] = (BYTE)(rnd >> 16);
+	}
+}
+
+static double Now()
+{
+	LARGE_INTEGER freq, t;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart / freq.QuadPart;
+}
+
+static int Check(CMpeg2DecPostProcCheck* pFilter)
+{
+	static const float bright[] = {-128.0f, -20.0f, 0.0f, 12.5f, 127.0f};
+	static const float cont[] = {0.0f, 0.5f, 1.0f, 1.3f, 10.0f};
+	static const float hue[] = {-180.0f, -45.0f, 0.0f, 30.0f, 90.0f, 180.0f};
+	static const float sat[] = {0.0f, 0.4f, 1.0f, 1.7f, 2.0f};
+	static const int widths[] = {1, 7, 8, 15, 16, 17, 31, 33, 720, 721};
+
+	const CCpuID::flag_t flags = g_cpuid.m_flags;
+	int cases = 0, failed = 0;
+
+	for (size_t b = 0; b < _countof(bright); b++)
+	for (size_t c = 0; c < _countof(cont); c++)
+	for (size_t hu = 0; hu < _countof(hue); hu++)
+	for (size_t s = 0; s < _countof(sat); s++) {
+		pFilter->SetControls(bright[b], cont[c], hue[hu], sat[s]);
+
+		for (size_t i = 0; i < _countof(widths); i++) {
+			const int w = widths[i], h = 6, pitch = (w + 33) & ~1;
+			picture_t tables(w, h, pitch), sse2(w, h, pitch);
+			FillNoise(tables, (unsigned)(cases + 1));
+			FillNoise(sse2, (unsigned)(cases + 1));
+
+			g_cpuid.m_flags = (CCpuID::flag_t)(flags & ~CCpuID::sse2);
+			pFilter->ApplyBrContHueSat(tables.buf[0], tables.buf[1], tables.buf[2], w, h, pitch);
+			g_cpuid.m_flags = (CCpuID::flag_t)(flags | CCpuID::sse2);
+			pFilter->ApplyBrContHueSat(sse2.buf[0], sse2.buf[1], sse2.buf[2], w, h, pitch);
+
+			cases++;
+			if (tables.data != sse2.data) {
+				printf("FAILED: brightness %g, contrast %g, hue %g, saturation %g, width %d\n", bright[b], cont[c], hue[hu], sat[s], w);
+				failed++;
+			}
+		}
+	}
+
+	g_cpuid.m_flags = flags;
+
+	printf("%d cases, %d failed\n", cases, failed);
+
+	return failed;
+}
+
+static void Bench(CMpeg2DecPostProcCheck* pFilter)
+{
+	const CCpuID::flag_t flags = g_cpuid.m_flags;
+	const int w = BENCH_WIDTH, h = BENCH_HEIGHT, pitch = BENCH_WIDTH;
+
+	picture_t src(w, h, pitch), dst(w, h, pitch);
+	FillNoise(src, 1);
+	pFilter->SetControls(10.0f, 1.2f, 20.0f, 1.3f);
+
+	printf("\n%dx%d, frames per second\n", w, h);
+
+	for (int run = 0; run < 2; run++) {
+		g_cpuid.m_flags = (CCpuID::flag_t)(run ? flags | CCpuID::sse2 : flags & ~CCpuID::sse2);
+
+		double start = Now();
+		for (int i = 0; i < BENCH_FRAMES; i++) {
+			pFilter->ApplyBrContHueSat(dst.buf[0], dst.buf[1], dst.buf[2], w, h, pitch);
+		}
+		printf("%-34s %8.1f\n", run ? "picture controls, sse2" : "picture controls, tables", BENCH_FRAMES / (Now() - start));
+	}
+
+	// weave as Deliver() did it before and does it now
+	double start = Now();
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		BitBltFromI420ToI420(w, h, dst.buf[0], dst.buf[1], dst.buf[2], pitch, src.buf[0], src.buf[1], src.buf[2], pitch);
+		pFilter->ApplyBrContHueSat(dst.buf[0], dst.buf[1], dst.buf[2], w, h, pitch);
+	}
+	const double separate = BENCH_FRAMES / (Now() - start);
+	printf("%-34s %8.1f\n", "weave, then picture controls", separate);
+
+	start = Now();
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		for (int y = 0; y < h; y += POSTPROC_BAND) {
+			const int lines = min(POSTPROC_BAND, h - y);
+			BitBltFromI420ToI420(w, lines,
+								 dst.buf[0] + y * pitch, dst.buf[1] + (y / 2) * (pitch / 2), dst.buf[2] + (y / 2) * (pitch / 2), pitch,
+								 src.buf[0] + y * pitch, src.buf[1] + (y / 2) * (pitch / 2), src.buf[2] + (y / 2) * (pitch / 2), pitch);
+			pFilter->ApplyBrContHueSat(dst.buf, pitch, w, y, y + lines);
+		}
+	}
+	const double fused = BENCH_FRAMES / (Now() - start);
+	printf("%-34s %8.1f (%.2fx)\n", "weave and picture controls banded", fused, fused / separate);
+
+	g_cpuid.m_flags = flags;
+}
+
+int main(int argc, char* argv[])
+{
+	bool bBench = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--bench")) {
+			bBench = true;
+		} else {
+			fprintf(stderr, "usage: %s [--bench]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	HRESULT hr = S_OK;
+	CMpeg2DecPostProcCheck* pFilter = DNew CMpeg2DecPostProcCheck(&hr);
+	if (FAILED(hr)) {
+		fprintf(stderr, "CMpeg2DecFilter failed, hr = 0x%08x\n", hr);
+		delete pFilter;
+		return 2;
+	}
+
+	int failed = Check(pFilter);
+
+	if (bBench) {
+		Bench(pFilter);
+	}
+
+	delete pFilter;
+
+	return failed ? 1 : 0;
+}
@@ -414,6 +414,13 @@ CMpeg2Dec::CMpeg2Dec()
     m_alloc_index = 0;
     m_first_decode_slice = m_nb_decode_slices = 0;
 
+    memset(&m_slice_threads, 0, sizeof(m_slice_threads));
+    memset(&m_slice_done, 0, sizeof(m_slice_done));
+    m_nb_slices = 0;
+    m_nb_slice_threads = 0;
+    m_nb_slice_jobs = 1;
+    m_slice_exit = false;
+
     memset(&m_new_sequence, 0, sizeof(m_new_sequence));
     memset(&m_sequence, 0, sizeof(m_sequence));
     memset(&m_gop, 0, sizeof(m_gop));
@@ -437,6 +444,7 @@ CMpeg2Dec::CMpeg2Dec()
 
 CMpeg2Dec::~CMpeg2Dec()
 {
+	mpeg2_stop_threads();
 	mpeg2_close();
 }
 
@@ -630,6 +638,18 @@ mpeg2_state_t CMpeg2Dec::mpeg2_parse()
 			int size_chunk = (m_chunk_buffer + BUFFER_SIZE - m_chunk_ptr);
 			int copied;
 
+			if(size_buffer > size_chunk && m_nb_slices)
+			{
+				/* no room left behind the queued slices, decode them and */
+				/* move the current slice to the start of the chunk buffer */
+				uint8_t* start = m_chunk_start;
+				int len = m_chunk_ptr - m_chunk_start;
+				mpeg2_decode_slices();
+				memmove(m_chunk_buffer, start, len);
+				m_chunk_ptr = m_chunk_buffer + len;
+				size_chunk = (m_chunk_buffer + BUFFER_SIZE - m_chunk_ptr);
+			}
+
 			if(size_buffer <= size_chunk)
 			{
 				copied = copy_chunk(size_buffer);
@@ -654,9 +674,21 @@ mpeg2_state_t CMpeg2Dec::mpeg2_parse()
 
 			m_bytes_since_pts += copied;
 
-			m_decoder.mpeg2_slice(m_code, m_chunk_start);
-			m_code = m_buf_start[-1];
-			m_chunk_ptr = m_chunk_start;
+			if(m_nb_slice_threads > 0
+			&& (m_nb_slices < (int)m_slices.GetCount() || m_slices.SetCount(m_nb_slices + 256)))
+			{
+				m_slices[m_nb_slices].code = m_code;
+				m_slices[m_nb_slices].buffer = m_chunk_start;
+				m_nb_slices++;
+				m_code = m_buf_start[-1];
+				m_chunk_start = m_chunk_ptr;
+			}
+			else
+			{
+				m_decoder.mpeg2_slice(m_code, m_chunk_start);
+				m_code = m_buf_start[-1];
+				m_chunk_ptr = m_chunk_start;
+			}
 		}
 
 		if((unsigned)(m_code - 1) >= 0xb0 - 1)
@@ -665,6 +697,9 @@ mpeg2_state_t CMpeg2Dec::mpeg2_parse()
 			return STATE_BUFFER;
 	}
 
+	/* end of the picture */
+	mpeg2_decode_slices();
+
 	switch(m_code)
 	{
 	case 0x00:
@@ -706,6 +741,123 @@ void CMpeg2Dec::mpeg2_slice_region(int start, int end)
 	m_nb_decode_slices = end - start;
 }
 
+void CMpeg2Dec::mpeg2_set_threads(int threads)
+{
+	mpeg2_stop_threads();
+
+	if(threads > MPEG2_MAX_THREADS)
+		threads = MPEG2_MAX_THREADS;
+
+	m_slice_exit = false;
+
+	for(m_nb_slice_threads = 0; m_nb_slice_threads < threads - 1; m_nb_slice_threads++)
+	{
+		slice_thread_t* t = &m_slice_threads[m_nb_slice_threads];
+		t->dec = this;
+		t->index = m_nb_slice_threads + 1;
+		t->decoder = new CMpeg2Decoder();
+		t->start = CreateEvent(NULL, FALSE, FALSE, NULL);
+		m_slice_done[m_nb_slice_threads] = CreateEvent(NULL, FALSE, FALSE, NULL);
+		t->thread = (t->start && m_slice_done[m_nb_slice_threads])
+			? CreateThread(NULL, 0, mpeg2_slice_thread, t, 0, NULL)
+			: NULL;
+
+		if(!t->thread)
+		{
+			if(t->start) CloseHandle(t->start);
+			if(m_slice_done[m_nb_slice_threads]) CloseHandle(m_slice_done[m_nb_slice_threads]);
+			delete t->decoder;
+			memset(t, 0, sizeof(*t));
+			m_slice_done[m_nb_slice_threads] = NULL;
+			break;
+		}
+	}
+}
+
+void CMpeg2Dec::mpeg2_stop_threads()
+{
+	/* the queued slices are decoded by the calling thread from now on */
+	mpeg2_decode_slices();
+
+	m_slice_exit = true;
+
+	for(int i = 0; i < m_nb_slice_threads; i++)
+		SetEvent(m_slice_threads[i].start);
+
+	for(int i = 0; i < m_nb_slice_threads; i++)
+	{
+		slice_thread_t* t = &m_slice_threads[i];
+		WaitForSingleObject(t->thread, INFINITE);
+		CloseHandle(t->thread);
+		CloseHandle(t->start);
+		CloseHandle(m_slice_done[i]);
+		delete t->decoder;
+	}
+
+	memset(&m_slice_threads, 0, sizeof(m_slice_threads));
+	memset(&m_slice_done, 0, sizeof(m_slice_done));
+	m_nb_slice_threads = 0;
+	m_nb_slice_jobs = 1;
+}
+
+DWORD WINAPI CMpeg2Dec::mpeg2_slice_thread(LPVOID param)
+{
+	slice_thread_t* t = (slice_thread_t*)param;
+
+	while(1)
+	{
+		WaitForSingleObject(t->start, INFINITE);
+		if(t->dec->m_slice_exit)
+			break;
+
+		t->dec->mpeg2_decode_slice_rows(*t->decoder, t->index, t->dec->m_nb_slice_jobs);
+		SetEvent(t->dec->m_slice_done[t->index - 1]);
+	}
+
+	return 0;
+}
+
+void CMpeg2Dec::mpeg2_decode_slice_rows(CMpeg2Decoder& decoder, int index, int jobs)
+{
+	for(int i = 0; i < m_nb_slices; i++)
+	{
+		const slice_t& slice = m_slices[i];
+		if(slice.code % jobs == index)
+			decoder.mpeg2_slice(slice.code, slice.buffer);
+	}
+}
+
+void CMpeg2Dec::mpeg2_decode_slices()
+{
+	if(!m_nb_slices)
+		return;
+
+	/* each mpeg2 slice stays within its macroblock row, mpeg1 slices may span several */
+	int jobs = 1;
+	if(!m_decoder.m_mpeg1)
+	{
+		jobs = m_nb_slice_threads + 1;
+		if(jobs > m_nb_slices)
+			jobs = m_nb_slices;
+	}
+
+	m_nb_slice_jobs = jobs;
+
+	for(int i = 1; i < jobs; i++)
+	{
+		m_slice_threads[i - 1].decoder->mpeg2_copy_state(m_decoder);
+		SetEvent(m_slice_threads[i - 1].start);
+	}
+
+	mpeg2_decode_slice_rows(m_decoder, 0, jobs);
+
+	if(jobs > 1)
+		WaitForMultipleObjects(jobs - 1, m_slice_done, TRUE, INFINITE);
+
+	m_nb_slices = 0;
+	m_chunk_start = m_chunk_ptr = m_chunk_buffer;
+}
+
 void CMpeg2Dec::mpeg2_pts(uint32_t pts)
 {
 	m_pts_previous = m_pts_current;
@@ -839,6 +991,7 @@ void CMpeg2Dec::mpeg2_header_state_init()
 	m_alloc_index = 0;
 	m_first_decode_slice = 1;
 	m_nb_decode_slices = 0xb0 - 1;
+	m_nb_slices = 0;
 }
 
 int CMpeg2Dec::mpeg2_header_sequence()
@@ -3711,6 +3864,22 @@ void CMpeg2Decoder::mpeg2_slice(int code, const uint8_t* buffer)
 #undef bits
 #undef bit_ptr
 
+void CMpeg2Decoder::mpeg2_copy_state(const CMpeg2Decoder& decoder)
+{
+	/* everything but the DCT block, ref2 has to point into our own motion_t */
+	int16_t* DCTblock = m_DCTblock;
+	*this = decoder;
+	m_DCTblock = DCTblock;
+
+	for(int i = 0; i < 2; i++)
+	{
+		if(decoder.m_f_motion.ref2[i])
+			m_f_motion.ref2[i] = m_f_motion.ref[0] + (decoder.m_f_motion.ref2[i] - decoder.m_f_motion.ref[0]);
+		if(decoder.m_b_motion.ref2[i])
+			m_b_motion.ref2[i] = m_b_motion.ref[0] + (decoder.m_b_motion.ref2[i] - decoder.m_b_motion.ref[0]);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 
@@ -29,6 +29,7 @@
 #pragma warning(disable: 4005)
 #include <stdint.h>
 #pragma warning(pop)
+#include <atlcoll.h>
 
 #define MPEG2_VERSION(a,b,c) (((a)<<16)|((b)<<8)|(c))
 #define MPEG2_RELEASE MPEG2_VERSION (0, 3, 2)	/* 0.3.2 */
@@ -220,6 +221,7 @@ public:
 
 	void mpeg2_init_fbuf(uint8_t* current_fbuf[3], uint8_t* forward_fbuf[3], uint8_t* backward_fbuf[3]);
 	void mpeg2_slice(int code, const uint8_t* buffer);
+	void mpeg2_copy_state(const CMpeg2Decoder& decoder);
 
 	int16_t* m_DCTblock;
 
@@ -305,8 +307,40 @@ public:
     int m_user_data_len;
 };
 
+#define MPEG2_MAX_THREADS 8
+
 class CMpeg2Dec
 {
+	/* slice threads: the slices of a picture are queued in the chunk buffer and */
+	/* decoded at the end of the picture, slice row n goes to thread n % jobs */
+	struct slice_t
+	{
+		uint8_t code;
+		const uint8_t* buffer;
+	};
+
+	struct slice_thread_t
+	{
+		CMpeg2Dec* dec;
+		CMpeg2Decoder* decoder;
+		HANDLE thread;
+		HANDLE start;
+		int index;
+	};
+
+	CAtlArray<slice_t> m_slices;
+	int m_nb_slices;
+	slice_thread_t m_slice_threads[MPEG2_MAX_THREADS - 1];
+	HANDLE m_slice_done[MPEG2_MAX_THREADS - 1];
+	int m_nb_slice_threads;
+	int m_nb_slice_jobs;
+	bool m_slice_exit;
+
+	void mpeg2_stop_threads();
+	void mpeg2_decode_slices();
+	void mpeg2_decode_slice_rows(CMpeg2Decoder& decoder, int index, int jobs);
+	static DWORD WINAPI mpeg2_slice_thread(LPVOID param);
+
 	int skip_chunk(int bytes);
 	int copy_chunk(int bytes);
 	mpeg2_state_t seek_chunk(), seek_header(), seek_sequence();
@@ -331,6 +365,7 @@ public:
 
 	void mpeg2_skip(int skip);
 	void mpeg2_slice_region(int start, int end);
+	void mpeg2_set_threads(int threads);
 
 	void mpeg2_pts(uint32_t pts);
 